@@ -0,0 +1,527 @@
+// Headless frontend for the VBA-M core.
+//
+// Runs a GBA or GB/GBC ROM for an exact number of frames with no display,
+// audio device or input and reports wall time, frames per second and the
+// ARM/Thumb opcode counters of the GBA interpreter. Used to benchmark core
+// changes on a desktop host and, through the frame and audio checksums, to
+// check that renderer and sound changes stay bit-exact.
+//
+// Given several ROMs it runs each in its own core instance on its own
+// thread, several at once, and prints the reports in command line order.
+// With -L the instances are plugged into an in-process link cable and run
+// in lock-step, one ROM per player or the same ROM for all of them.
+
+#include "../WP8VBAMComponent/VBAM/System.h"
+#include "../WP8VBAMComponent/VBAM/Util.h"
+#include "../WP8VBAMComponent/VBAM/common/Rewind.h"
+#include "../WP8VBAMComponent/VBAM/common/SoundDrivers.h"
+#include "../WP8VBAMComponent/VBAM/apu/Blip_Simd.h"
+#include "../WP8VBAMComponent/VBAM/gba/GBA.h"
+#include "../WP8VBAMComponent/VBAM/gba/Cheats.h"
+#include "../WP8VBAMComponent/VBAM/gba/GBABlockCache.h"
+#include "../WP8VBAMComponent/VBAM/gb/gbOpcodeCache.h"
+#include "../WP8VBAMComponent/VBAM/gba/GBAGfx.h"
+#include "../WP8VBAMComponent/VBAM/gba/GBALinkLocal.h"
+#include "../WP8VBAMComponent/VBAM/gba/Globals.h"
+#include "../WP8VBAMComponent/VBAM/gba/Sound.h"
+#include "../WP8VBAMComponent/VBAM/gb/gb.h"
+#include "../WP8VBAMComponent/VBAM/gb/gbCheats.h"
+#include "../WP8VBAMComponent/VBAM/gb/gbGlobals.h"
+#include "../WP8VBAMComponent/VBAM/gb/gbSound.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern CORE_LOCAL int armOpcodeCount;
+extern CORE_LOCAL int thumbOpcodeCount;
+extern const char *soundDriverName;
+extern CORE_LOCAL SoundDriver *soundDriver;
+
+int turboSkip = 5;
+
+// options, shared by all instances
+static int frames = 3600;
+static int warmup = 0;
+static int rewindBudget = 0;
+static bool gbEffects = false;
+static bool checksumOption = false;
+static size_t framePitch = 241 * 4;
+static const char *loadName = NULL;
+static const char *saveName = NULL;
+static LocalLink *linkCable = NULL;
+static int linkWindow = LOCAL_LINK_DEFAULT_WINDOW;
+static std::vector<std::string> cheatCodes;
+
+static CORE_LOCAL int frameCount = 0;
+static CORE_LOCAL int drawnCount = 0;
+static CORE_LOCAL bool checksumFrames = false;
+static CORE_LOCAL u32 frameChecksum = 2166136261u;
+static CORE_LOCAL int screenWidth = 240;
+static CORE_LOCAL int screenHeight = 160;
+
+// FNV-1a over the visible part of every drawn frame. The core writes line
+// N of the picture to row N+1 of pix, hence the one row offset.
+static void hashFrame()
+{
+	for (int y = 1; y <= screenHeight; y++)
+	{
+		const u8 *line = pix + gbaPitch * y;
+		for (int i = 0; i < screenWidth * 4; i++)
+		{
+			frameChecksum ^= line[i];
+			frameChecksum *= 16777619u;
+		}
+	}
+}
+
+void systemDrawScreen()
+{
+	drawnCount++;
+	if (checksumFrames)
+		hashFrame();
+}
+
+void systemFrame()
+{
+	frameCount++;
+}
+
+// Return to the runner after every frame so it can stop on an exact count.
+bool systemPauseOnFrame() { return true; }
+
+static double now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *readFile(const char *name, int *size)
+{
+	FILE *f = fopen(name, "rb");
+	if (!f)
+		return NULL;
+	fseek(f, 0, SEEK_END);
+	long len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	char *data = (char *)malloc(len > 0 ? len : 1);
+	if (data && fread(data, 1, len, f) != (size_t)len)
+	{
+		free(data);
+		data = NULL;
+	}
+	fclose(f);
+	*size = (int)len;
+	return data;
+}
+
+static void report(std::string &out, const char *format, ...)
+{
+	char line[256];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	out += line;
+}
+
+static bool isGBRom(const char *name)
+{
+	const char *p = strrchr(name, '.');
+	return p && (_stricmp(p, ".gb") == 0 || _stricmp(p, ".gbc") == 0 ||
+		_stricmp(p, ".cgb") == 0 || _stricmp(p, ".sgb") == 0);
+}
+
+static bool loadGBA(const char *data, int size)
+{
+	if (!CPULoadRomData(data, size))
+		return false;
+	skipBios = true;
+	soundInit();
+	CPUInit(NULL, false);
+	CPUReset();
+	return true;
+}
+
+static bool loadGB(const char *data, int size)
+{
+	for (int i = 0; i < 24;)
+	{
+		systemGbPalette[i++] = (0x1f) | (0x1f << 5) | (0x1f << 10);
+		systemGbPalette[i++] = (0x15) | (0x15 << 5) | (0x15 << 10);
+		systemGbPalette[i++] = (0x0c) | (0x0c << 5) | (0x0c << 10);
+		systemGbPalette[i++] = 0;
+	}
+	if (!gbLoadRomData(data, size))
+		return false;
+	gbGetHardwareType();
+	gbReset();
+	gbBorderOn = 0;
+	soundInit();
+	gbSoundReset();
+	return true;
+}
+
+// Adds the -x codes the way the phone front end does: told apart by length
+// for the GBA (CodeBreaker, GameShark v1/2, GameShark v3 with its space),
+// GameGenie or GameShark for the GB.
+static void addCheats(bool gb)
+{
+	for (size_t i = 0; i < cheatCodes.size(); i++)
+	{
+		std::string code = cheatCodes[i];
+		if (gb)
+		{
+			if (code.size() == 11 || code.size() == 7)
+				gbAddGgCheat(code.c_str(), "");
+			else if (code.size() == 8)
+				gbAddGsCheat(code.c_str(), "");
+		}
+		else if (code.size() == 13)
+			cheatsAddCBACode(code.c_str(), "");
+		else if (code.size() == 16)
+			cheatsAddGSACode(code.c_str(), "", false);
+		else if (code.size() == 17)
+		{
+			code = code.substr(0, 8) + code.substr(9, 8);
+			cheatsAddGSACode(code.c_str(), "", true);
+		}
+	}
+	cheatsEnabled = !cheatCodes.empty();
+}
+
+static void usage()
+{
+	fprintf(stderr,
+		"usage: vbam-headless [options] <rom>...\n"
+		"  -f <frames>  frames to emulate and time (default 3600)\n"
+		"  -w <frames>  untimed warm-up frames before the run (default 0)\n"
+		"  -c           print a checksum of every drawn frame\n"
+		"  -k <frames>  frames skipped after each drawn one (default 0)\n"
+		"  -n           disable the ARM/Thumb block cache and GB opcode cache\n"
+		"  -s           use the scalar GBA compositor, exact GB line renderer and\n"
+		"               scalar sound mixer\n"
+		"  -e           turn on the GB sound echo, stereo and surround effects\n"
+		"  -p <bytes>   row pitch of the frame buffer (default 964)\n"
+		"  -r <MB>      keep a rewind history of this size, captured every frame\n"
+		"  -l <state>   load a raw save state before the run\n"
+		"  -o <state>   write a raw save state after the run\n"
+		"  -a <driver>  sound driver, name[:arg]; memory prints an audio checksum\n"
+		"  -j <count>   ROMs run at once when several are given (default: one\n"
+		"               per CPU); -l and -o need a single ROM\n"
+		"  -L <players> link 2 to 4 GBA instances, one per ROM or all running\n"
+		"               the same ROM, all at once\n"
+		"  -W <cycles>  cycles between link syncs (default 1232)\n"
+		"  -x <code>    add a cheat code, GBA CodeBreaker or GameShark, GB\n"
+		"               GameGenie or GameShark; may be repeated\n");
+	for (const SoundDriverInfo *info = soundDrivers; info->name; info++)
+		fprintf(stderr, "                 %-8s %s\n", info->name, info->description);
+}
+
+
+// Load, run and report on one ROM with the core instance of the calling
+// thread, as the given link player if linked; returns the exit status.
+static int runRom(const char *romName, int player, std::string &out)
+{
+	// joined first so that the other players are never left waiting for
+	// one that failed to load; the thread leaves when this returns
+	if (linkCable)
+		localLinkJoin(linkCable, player);
+
+	int size = 0;
+	char *data = readFile(romName, &size);
+	if (!data)
+	{
+		fprintf(stderr, "cannot read %s\n", romName);
+		return 1;
+	}
+
+	// The core draws straight into this buffer, the way the phone hands it
+	// a mapped texture: 32bpp rows plus the guard rows the line writers
+	// expect.
+	u8 *frame = (u8 *)calloc(1, framePitch * 162);
+	utilSetFrameTarget(frame, framePitch);
+
+	bool gb = isGBRom(romName);
+	if (!(gb ? loadGB(data, size) : loadGBA(data, size)) ||
+		(soundDriverName && !soundDriver))
+	{
+		fprintf(stderr, "cannot load %s\n", romName);
+		free(data);
+		free(frame);
+		return 1;
+	}
+	free(data);
+
+	EmulatedSystem emulator = gb ? GBSystem : GBASystem;
+	if (loadName)
+	{
+		int stateSize = 0;
+		char *state = readFile(loadName, &stateSize);
+		bool loaded = state && utilReadRawState(emulator, (u8 *)state, stateSize);
+		free(state);
+		if (!loaded)
+		{
+			fprintf(stderr, "cannot load state %s\n", loadName);
+			free(frame);
+			return 1;
+		}
+	}
+	addCheats(gb);
+	if (rewindBudget && !rewindInit(&emulator, (size_t)rewindBudget << 20))
+	{
+		fprintf(stderr, "cannot allocate the rewind history\n");
+		free(frame);
+		return 1;
+	}
+	if (gb)
+	{
+		if (gbEffects)
+		{
+			gb_effects_config_t effects = { true, 0.5f, 0.5f, true };
+			gbSoundConfigEffects(effects);
+		}
+		screenWidth = 160;
+		screenHeight = 144;
+	}
+
+	emulating = 1;
+
+	while (frameCount < warmup)
+		emulator.emuMain(emulator.emuCount);
+	checksumFrames = checksumOption;
+
+	frameCount = 0;
+	drawnCount = 0;
+	armOpcodeCount = 0;
+	thumbOpcodeCount = 0;
+	MemorySoundDriver *capture = dynamic_cast<MemorySoundDriver *>(soundDriver);
+	if (capture)
+		capture->clear();
+
+	double captureTime = 0;
+	double start = now();
+	while (frameCount < frames)
+	{
+		int frame = frameCount;
+		emulator.emuMain(emulator.emuCount);
+		if (rewindBudget && frameCount != frame)
+		{
+			double t = now();
+			rewindCapture();
+			captureTime += now() - t;
+		}
+	}
+	double elapsed = now() - start;
+	localLinkLeave();
+
+	report(out, "rom: %s\n", romName);
+	report(out, "system: %s\n", gb ? "GB" : "GBA");
+	if (linkCable)
+		report(out, "link: player %d, %d cycle window\n", player, linkWindow);
+	report(out, "frames: %d (%d drawn)\n", frameCount, drawnCount);
+	report(out, "time: %.3f s\n", elapsed);
+	report(out, "fps: %.1f\n", elapsed > 0 ? frameCount / elapsed : 0.0);
+	if (!gb)
+	{
+		report(out, "armOpcodeCount: %d\n", armOpcodeCount);
+		report(out, "thumbOpcodeCount: %d\n", thumbOpcodeCount);
+	}
+	if (checksumFrames)
+		report(out, "checksum: %08x\n", frameChecksum);
+	if (capture)
+	{
+		// FNV-1a over the samples of the timed run
+		const std::vector<u16> &samples = capture->getSamples();
+		u32 audioChecksum = 2166136261u;
+		for (size_t i = 0; i < samples.size(); i++)
+		{
+			audioChecksum ^= samples[i] & 0xff;
+			audioChecksum *= 16777619u;
+			audioChecksum ^= samples[i] >> 8;
+			audioChecksum *= 16777619u;
+		}
+		report(out, "audio: %d samples at %ld Hz, checksum %08x\n",
+			(int)samples.size() / 2, capture->getSampleRate(), audioChecksum);
+	}
+	if (rewindBudget)
+	{
+		report(out, "rewind: %d states in %.1f MB, %.3f ms capture per frame\n",
+			rewindCount(), rewindSize() / 1048576.0,
+			captureTime * 1000 / frameCount);
+		rewindCleanUp();
+	}
+
+	if (saveName)
+	{
+		u8 *state = (u8 *)malloc(RAW_STATE_MAX);
+		size_t stateSize = state ? utilWriteRawState(emulator, state, RAW_STATE_MAX) : 0;
+		FILE *f = stateSize ? fopen(saveName, "wb") : NULL;
+		bool saved = f && fwrite(state, 1, stateSize, f) == stateSize;
+		if (f)
+			saved = fclose(f) == 0 && saved;
+		free(state);
+		if (!saved)
+			fprintf(stderr, "cannot write state %s\n", saveName);
+	}
+
+	emulating = 0;
+	emulator.emuCleanUp();
+	soundShutdown();
+	free(frame);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int frameSkip = 0;
+	int jobs = (int)std::thread::hardware_concurrency();
+
+	int players = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "f:w:ck:nsep:r:l:o:a:j:L:W:x:")) != -1)
+	{
+		switch (opt)
+		{
+		case 'f':
+			frames = atoi(optarg);
+			break;
+		case 'w':
+			warmup = atoi(optarg);
+			break;
+		case 'c':
+			checksumOption = true;
+			break;
+		case 'k':
+			frameSkip = atoi(optarg);
+			break;
+		case 'n':
+			blockCacheEnabled = false;
+			gbOpcodeCacheEnabled = false;
+			break;
+		case 's':
+			gfxComposeSIMD = false;
+			gbFastLineEnabled = false;
+			blip_simd_enabled = false;
+			break;
+		case 'e':
+			gbEffects = true;
+			break;
+		case 'p':
+			framePitch = atoi(optarg);
+			break;
+		case 'r':
+			rewindBudget = atoi(optarg);
+			break;
+		case 'l':
+			loadName = optarg;
+			break;
+		case 'o':
+			saveName = optarg;
+			break;
+		case 'a':
+			soundDriverName = optarg;
+			break;
+		case 'j':
+			jobs = atoi(optarg);
+			break;
+		case 'L':
+			players = atoi(optarg);
+			break;
+		case 'W':
+			linkWindow = atoi(optarg);
+			break;
+		case 'x':
+			cheatCodes.push_back(optarg);
+			break;
+		default:
+			usage();
+			return 2;
+		}
+	}
+	std::vector<const char *> romNames(argv + optind, argv + argc);
+	if (players && romNames.size() == 1)
+		romNames.resize(players, romNames[0]);
+	int roms = (int)romNames.size();
+	if (roms < 1 || frames <= 0 || warmup < 0 || frameSkip < 0 ||
+		rewindBudget < 0 || framePitch < 240 * 4 || framePitch % 4 ||
+		(roms > 1 && (loadName || saveName)) ||
+		(players && roms != players))
+	{
+		usage();
+		return 2;
+	}
+	if (players)
+	{
+		for (int i = 0; i < roms; i++)
+			if (isGBRom(romNames[i]))
+			{
+				fprintf(stderr, "cannot link %s, only GBA ROMs can be linked\n",
+					romNames[i]);
+				return 2;
+			}
+		linkCable = localLinkCreate(players, linkWindow);
+		if (!linkCable)
+		{
+			usage();
+			return 2;
+		}
+		// the players wait for each other, so all of them run at once
+		jobs = players;
+	}
+	if (jobs < 1)
+		jobs = 1;
+
+	systemColorDepth = 32;
+	systemRedShift = 19;
+	systemGreenShift = 11;
+	systemBlueShift = 3;
+	utilUpdateSystemColorMaps();
+	systemFrameSkip = frameSkip;
+
+	if (roms == 1)
+	{
+		std::string out;
+		int status = runRom(romNames[0], 0, out);
+		fputs(out.c_str(), stdout);
+		return status;
+	}
+
+	// A fresh thread per ROM so that each starts from a fresh instance; at
+	// most jobs of them run at once, and the reports come out in order.
+	std::vector<std::thread> threads(roms);
+	std::vector<std::string> outs(roms);
+	std::vector<int> status(roms);
+	int result = 0;
+	for (int i = 0; i < roms + jobs; i++)
+	{
+		if (i >= jobs)
+		{
+			int done = i - jobs;
+			if (done >= roms)
+				break;
+			threads[done].join();
+			if (done > 0)
+				fputs("\n", stdout);
+			fputs(outs[done].c_str(), stdout);
+			fflush(stdout);
+			if (status[done])
+				result = status[done];
+		}
+		if (i < roms)
+			threads[i] = std::thread([&, i]() {
+				status[i] = runRom(romNames[i], i, outs[i]);
+				localLinkLeave();
+			});
+	}
+	localLinkDestroy(linkCable);
+	return result;
+}
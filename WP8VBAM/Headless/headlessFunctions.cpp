@@ -0,0 +1,83 @@
+#include "../WP8VBAMComponent/VBAM/System.h"
+#include "../WP8VBAMComponent/VBAM/common/SoundDrivers.h"
+#include <stdio.h>
+#include <stdarg.h>
+#include <time.h>
+
+// System callbacks for the headless frontend. Mirrors vbaFunctions.cpp of the
+// phone component with the platform bits (XAudio2, sensors, virtual
+// controller) replaced by no-ops so the core runs without any device.
+
+int sensorX = 2047;
+int sensorY = 2047;
+
+// Sound driver picked with -a; none by default.
+const char *soundDriverName = NULL;
+
+void log(const char *,...) { }
+
+void winSignal(int, int) { }
+
+void winOutput(const char *s, u32 addr) { }
+
+void (*dbgSignal)(int,int) = winSignal;
+void (*dbgOutput)(const char *, u32) = winOutput;
+
+void systemGbPrint(u8 *,int,int,int,int) { }
+void systemScreenCapture(int) { }
+// updates the joystick data
+bool systemReadJoypads() { return true; }
+u32 systemReadJoypad(int) { return 0; }
+// Retrieves the number of milliseconds elapsed on a monotonic clock.
+u32 systemGetClock()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (u32) (ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+void systemMessage(int, const char *msg, ...)
+{
+	va_list args;
+	va_start(args, msg);
+	vfprintf(stderr, msg, args);
+	va_end(args);
+	fputc('\n', stderr);
+}
+void systemSetTitle(const char *) { }
+void systemWriteDataToSoundBuffer() { }
+void systemSoundShutdown() { }
+void systemSoundPause() { }
+void systemSoundResume() { }
+void systemSoundReset() { }
+SoundDriver *systemSoundInit()
+{
+	return soundDriverName ? soundDriverCreate(soundDriverName) : NULL;
+}
+void systemScreenMessage(const char *) { }
+
+bool systemCanChangeSoundQuality() { return false; }
+void systemShowSpeed(int) { }
+void system10Frames(int){ }
+void systemGbBorderOn(){ }
+void winlog(const char *, ...) { }
+void systemOnWriteDataToSoundBuffer(const u16 * finalWave, int length) { }
+void systemOnSoundShutdown() { }
+void systemGbPrint(unsigned char *, int, int, int, int, int) { }
+void systemUpdateMotionSensor() { }
+int  systemGetSensorX() { return sensorX; }
+int  systemGetSensorY() { return sensorY; }
+
+int RGB_LOW_BITS_MASK = 65793;
+CORE_LOCAL int emulating;
+CORE_LOCAL bool systemSoundOn;
+u16 systemColorMap16[0x10000];
+u32 systemColorMap32[0x10000];
+u16 systemGbPalette[24];
+int systemRedShift;
+int systemGreenShift;
+int systemBlueShift;
+int systemColorDepth;
+int systemDebug;
+int systemVerbose;
+int systemFrameSkip;
+CORE_LOCAL int systemSaveUpdateCounter;
@@ -0,0 +1,37 @@
+#ifndef MSVCCOMPAT_H
+#define MSVCCOMPAT_H
+
+// Maps the handful of MSVC CRT extensions used by the core onto their
+// POSIX equivalents so the core builds unmodified with GCC/Clang.
+// Force-included by the headless Makefile; never included by the app.
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+
+#define _stricmp strcasecmp
+#define _strnicmp strncasecmp
+#define _snprintf snprintf
+#define vsprintf_s vsnprintf
+
+#ifdef __cplusplus
+template <size_t N>
+inline int strcpy_s(char (&dest)[N], const char *src)
+{
+  strncpy(dest, src, N - 1);
+  dest[N - 1] = 0;
+  return 0;
+}
+
+template <size_t N>
+inline int strncpy_s(char (&dest)[N], const char *src, size_t count)
+{
+  size_t n = count < N - 1 ? count : N - 1;
+  strncpy(dest, src, n);
+  dest[n] = 0;
+  return 0;
+}
+#endif
+
+#endif // MSVCCOMPAT_H
@@ -21,13 +21,13 @@ using namespace Windows::Foundation;
 using namespace Windows::System::Threading;
 using namespace PhoneDirect3DXamlAppComponent;
 
-extern int emulating;
+extern CORE_LOCAL int emulating;
 extern void ContinueEmulation(void);
 
 //extern CRITICAL_SECTION swapCS;
 //extern bool csInit;
 
-extern SoundDriver *soundDriver;
+extern CORE_LOCAL SoundDriver *soundDriver;
 extern long  soundSampleRate;
 
 extern void soundShutdown(void);
@@ -14,6 +14,7 @@
 #include "EmulatorSettings.h"
 #include "EmulatorRenderer.h"
 #include <fstream>
+#include <atomic>
 #include <Util.h>
 #include <Gb_Apu.h>
 #include <Sound.h>
@@ -29,11 +30,13 @@ using namespace Windows::Storage::FileProperties;
 using namespace std;
 
 #define SAVE_FOLDER	"saves"
+// Largest .sav file: 128 KB of flash or cartridge RAM plus the clock data.
+#define SRAM_MAX	0x21000
 
-extern bool cheatsEnabled;
-extern int gbaSaveType;
-extern int romSize;
-extern int emulating;
+extern CORE_LOCAL bool cheatsEnabled;
+extern CORE_LOCAL int gbaSaveType;
+extern CORE_LOCAL int romSize;
+extern CORE_LOCAL int emulating;
 
 // Extern functions used for read and save state
 extern bool soundInit();
@@ -45,17 +48,17 @@ extern void CPUUpdateWindow1();
 extern void sramWrite(u32, u8);
 extern void CPUReadHelper(void);
 
-extern int gbBattery;
-extern int gbRomType;
-extern u8 *gbRam;
-extern int gbRamSizeMask;
-extern u8 *gbMemoryMap[16];
-extern mapperMBC3 gbDataMBC3;
-extern mapperTAMA5 gbDataTAMA5;
-extern u8 *gbMemory;
-extern u8 *gbTAMA5ram;
-extern int gbTAMA5ramSize;
-extern int gbRamSize;
+extern CORE_LOCAL int gbBattery;
+extern CORE_LOCAL int gbRomType;
+extern CORE_LOCAL u8 *gbRam;
+extern CORE_LOCAL int gbRamSizeMask;
+extern CORE_LOCAL u8 *gbMemoryMap[16];
+extern CORE_LOCAL mapperMBC3 gbDataMBC3;
+extern CORE_LOCAL mapperTAMA5 gbDataTAMA5;
+extern CORE_LOCAL u8 *gbMemory;
+extern CORE_LOCAL u8 *gbTAMA5ram;
+extern CORE_LOCAL int gbTAMA5ramSize;
+extern CORE_LOCAL int gbRamSize;
 
 namespace Emulator
 {
@@ -108,6 +111,86 @@ namespace Emulator
 		return buffer;
 	}
 
+	// Save states are written as one raw block (see utilWriteRawState) taken
+	// from the core in a single pass instead of field by field.
+	static u8 *stateBuffer = nullptr;
+
+	static u8 *GetStateBuffer(void)
+	{
+		if(!stateBuffer)
+		{
+			stateBuffer = new u8[RAW_STATE_MAX];
+		}
+		return stateBuffer;
+	}
+
+	static void WriteStateFile(const wstring &fileName, const u8 *data, size_t size)
+	{
+		FILE *file;
+		auto error = _wfopen_s(&file, fileName.c_str(), L"wb");
+		if(!file)
+		{
+#if _DEBUG
+			wstringstream ss;
+			ss << "Unable to open file '";
+			ss << fileName;
+			ss << "' to store savestate (";
+			ss << error;
+			ss << ").";
+			OutputDebugStringW(ss.str().c_str());
+#endif
+			return;
+		}
+		if(fwrite(data, 1, size, file) != size)
+		{
+#if _DEBUG
+			OutputDebugStringW(L"Unable to write savestate.");
+#endif
+		}
+		fclose(file);
+	}
+
+	static void WriteRawStateFile(const wstring &fileName)
+	{
+		u8 *data = GetStateBuffer();
+		size_t size = utilWriteRawState(EmulatorGame::emulator, data, RAW_STATE_MAX);
+		if(!size)
+		{
+#if _DEBUG
+			OutputDebugStringW(L"Unable to take savestate.");
+#endif
+			return;
+		}
+		WriteStateFile(fileName, data, size);
+	}
+
+	// Returns false for states in the old field by field format, which the
+	// caller parses itself; raw states are loaded here, even if loading fails.
+	static bool ReadRawStateFile(ifstream &stream)
+	{
+		RawStateHeader header;
+		if(!stream.read(reinterpret_cast<char *>(&header), sizeof(header)) ||
+			!utilIsRawState(reinterpret_cast<const u8 *>(&header), sizeof(header)))
+		{
+			stream.clear();
+			stream.seekg(0, ios::beg);
+			return false;
+		}
+
+		u8 *data = GetStateBuffer();
+		size_t size = sizeof(header) + header.size;
+		memcpy(data, &header, sizeof(header));
+		if(size > RAW_STATE_MAX ||
+			!stream.read(reinterpret_cast<char *>(data + sizeof(header)), header.size) ||
+			!utilReadRawState(EmulatorGame::emulator, data, size))
+		{
+#if _DEBUG
+			OutputDebugStringW(L"Unable to load savestate.");
+#endif
+		}
+		return true;
+	}
+
 	task<void> SaveStateAsync(void)
 	{
 		if(gbaROMLoaded)
@@ -151,193 +234,7 @@ namespace Emulator
 			tmpFileNameStream << wRomName << SavestateSlot << ".sgm";
 			wstring fileNameA = tmpFileNameStream.str();
 
-			FILE *file;
-			auto error = _wfopen_s(&file, fileNameA.c_str(), L"wb");
-			if(!file)
-			{
-#if _DEBUG
-				wstringstream ss;
-				ss << "Unable to open file '";
-				ss << fileNameA;
-				ss << "' to store savestate (";
-				ss << error;
-				ss << ").";
-				OutputDebugStringW(ss.str().c_str());
-				return;
-#endif
-			}
-			fclose(file);
-
-			ofstream stream (fileNameA.c_str(), ios::binary);
-			if(!stream.is_open())
-			{
-#if _DEBUG
-				wstringstream ss;
-				ss << "Unable to open file '";
-				ss << fileNameA;
-				ss << "' to store savestate.";
-				OutputDebugStringW(ss.str().c_str());
-				return;
-#endif
-			}
-
-			extern u8* gbRom;
-			extern bool useBios;
-			extern bool inBios;
-			extern variable_desc gbSaveGameStruct[78];
-			extern u16 IFF;
-			extern int gbSgbMode;
-			extern variable_desc gbSgbSaveStructV3[11];
-			extern u8 *gbSgbBorder;
-			extern u8 *gbSgbBorderChar;
-			extern u8 gbSgbPacket[112];
-			extern u16 gbSgbSCPPalette[2048];
-			extern u8 gbSgbATF[360];
-			extern u8 gbSgbATFList[16200];
-			extern mapperMBC1 gbDataMBC1;
-			extern mapperMBC2 gbDataMBC2;
-			extern mapperMBC3 gbDataMBC3;
-			extern mapperMBC5 gbDataMBC5;
-			extern mapperHuC1 gbDataHuC1;
-			extern mapperHuC3 gbDataHuC3;
-			extern mapperTAMA5 gbDataTAMA5;
-			extern u8 *gbTAMA5ram;
-			extern int gbTAMA5ramSize;
-			extern mapperMMM01 gbDataMMM01;
-			extern u16 gbPalette[128];
-			extern u8 *gbMemory;
-			extern int gbRamSize;
-			extern u8 *gbRam;
-			extern int gbCgbMode;
-			extern u8 *gbVram;
-			extern u8 *gbWram;
-			extern variable_desc gb_state[20];
-			extern int gbCheatNumber;
-			extern gbCheat gbCheatList[100];
-			extern int gbLcdModeDelayed;
-			extern int gbLcdTicksDelayed;
-			extern int gbLcdLYIncrementTicksDelayed;
-			extern u8 gbSpritesTicks[300];
-			extern bool gbTimerModeChange;
-			extern bool gbTimerOnChange;
-			extern int gbHardware;
-			extern bool gbBlackScreen;
-			extern u8 oldRegister_WY;
-			extern int gbWindowLine;
-			extern int inUseRegister_WY;
-			extern bool gbScreenOn;
-			int marker = 0x12345678;
-
-			int version = 12;
-			stream.write(reinterpret_cast<const char *>(&version), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&gbRom[0x134]), 15);
-
-			int ub = useBios;
-			int ib = inBios;
-			stream.write(reinterpret_cast<const char *>(&ub), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&ib), sizeof(int));
-
-			int i = 0;
-			for (; i < ARRAYSIZE(gbSaveGameStruct); i++)
-			{
-				if(gbSaveGameStruct[i].size > 0)
-				{
-					stream.write(reinterpret_cast<const char *>(gbSaveGameStruct[i].address), gbSaveGameStruct[i].size);
-				}
-			}
-
-			stream.write(reinterpret_cast<const char *>(&IFF), sizeof(u16));
-
-			if(gbSgbMode)
-			{
-				i = 0;
-				for (; i < ARRAYSIZE(gbSgbSaveStructV3); i++)
-				{
-					if(gbSgbSaveStructV3[i].size > 0)
-					{
-						stream.write(reinterpret_cast<const char *>(gbSgbSaveStructV3[i].address), gbSgbSaveStructV3[i].size);
-					}
-				}
-
-				stream.write(reinterpret_cast<const char *>(gbSgbBorder), 2048);
-				stream.write(reinterpret_cast<const char *>(gbSgbBorderChar), 32*256);
-
-				stream.write(reinterpret_cast<const char *>(gbSgbPacket), 16 * 7);
-
-				stream.write(reinterpret_cast<const char *>(gbSgbSCPPalette), 4 * 512 * sizeof(u16));
-				stream.write(reinterpret_cast<const char *>(gbSgbATF), 20 * 18);
-				stream.write(reinterpret_cast<const char *>(gbSgbATFList), 45 * 20 * 18);
-			}
-
-			stream.write(reinterpret_cast<const char *>(&gbDataMBC1), sizeof(gbDataMBC1));
-			stream.write(reinterpret_cast<const char *>(&gbDataMBC2), sizeof(gbDataMBC2));
-			stream.write(reinterpret_cast<const char *>(&gbDataMBC3), sizeof(gbDataMBC3));
-			stream.write(reinterpret_cast<const char *>(&gbDataMBC5), sizeof(gbDataMBC5));
-			stream.write(reinterpret_cast<const char *>(&gbDataHuC1), sizeof(gbDataHuC1));
-			stream.write(reinterpret_cast<const char *>(&gbDataHuC3), sizeof(gbDataHuC3));
-			stream.write(reinterpret_cast<const char *>(&gbDataTAMA5), sizeof(gbDataTAMA5));
-			if(gbTAMA5ram != NULL)
-			{
-				stream.write(reinterpret_cast<const char *>(gbTAMA5ram), gbTAMA5ramSize);
-			}
-			stream.write(reinterpret_cast<const char *>(&gbDataMMM01), sizeof(gbDataMMM01));
-
-			stream.write(reinterpret_cast<const char *>(gbPalette), 128 * sizeof(u16));
-
-			stream.write(reinterpret_cast<const char *>(&gbMemory[0x8000]), 0x8000);
-
-			if(gbRamSize && gbRam)
-			{
-				stream.write(reinterpret_cast<const char *>(&gbRamSize), sizeof(int));
-				stream.write(reinterpret_cast<const char *>(gbRam), gbRamSize);
-			}
-
-			if(gbCgbMode)
-			{
-				stream.write(reinterpret_cast<const char *>(gbVram), 0x4000);
-				stream.write(reinterpret_cast<const char *>(gbWram), 0x8000);
-			}
-
-			// Sound
-			gbSoundSaveGame2();
-			i = 0;
-			for (; i < ARRAYSIZE(gb_state); i++)
-			{
-				if(gb_state[i].size > 0)
-				{
-					stream.write(reinterpret_cast<const char *>(gb_state[i].address), gb_state[i].size);
-				}
-			}
-
-			// Cheats
-			stream.write(reinterpret_cast<const char *>(&gbCheatNumber), sizeof(int));
-			if(gbCheatNumber > 0)
-			{
-				stream.write(reinterpret_cast<const char *>(&gbCheatList[0]), sizeof(gbCheat)*gbCheatNumber);
-			}
-
-			int spriteTicks = gbSpritesTicks[299];
-			int timerModeChange = gbTimerModeChange;
-			int timerOnChange = gbTimerOnChange;
-			int blackScreen = gbBlackScreen;
-			int oldRegister = oldRegister_WY;
-			int screenOn = gbScreenOn;
-			stream.write(reinterpret_cast<const char *>(&gbLcdModeDelayed), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&gbLcdTicksDelayed), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&gbLcdLYIncrementTicksDelayed), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&spriteTicks), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&timerModeChange), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&timerOnChange), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&gbHardware), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&blackScreen), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&oldRegister), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&gbWindowLine), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&inUseRegister_WY), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&screenOn), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&marker), sizeof(int));
-
-			stream.flush();
-			stream.close();
+			WriteRawStateFile(fileNameA);
 		}).then([emulator](task<void> t)
 		{
 			try
@@ -380,105 +277,7 @@ namespace Emulator
 			tmpFileNameStream << wRomName << SavestateSlot << ".sgm";
 			wstring fileNameA = tmpFileNameStream.str();
 
-			FILE *file;
-			auto error = _wfopen_s(&file, fileNameA.c_str(), L"wb");
-			if(!file)
-			{
-#if _DEBUG
-				wstringstream ss;
-				ss << "Unable to open file '";
-				ss << fileNameA;
-				ss << "' to store savestate (";
-				ss << error;
-				ss << ").";
-				OutputDebugStringW(ss.str().c_str());
-				return;
-#endif
-			}
-			fclose(file);
-
-			ofstream stream (fileNameA.c_str(), ios::binary);
-			if(!stream.is_open())
-			{
-#if _DEBUG
-				wstringstream ss;
-				ss << "Unable to open file '";
-				ss << fileNameA;
-				ss << "' to store savestate.";
-				OutputDebugStringW(ss.str().c_str());
-				return;
-#endif
-			}
-
-			extern Gb_Apu *gb_apu;
-			extern gb_apu_state_ss state;
-			extern variable_desc saveGameStruct[116];
-			extern variable_desc eepromSaveData[8];
-			extern variable_desc flashSaveData3[6];
-			extern variable_desc gba_state[32];
-			extern RTCCLOCKDATA rtcClockData;
-			extern bool stopState;
-			extern int IRQTicks;
-			extern int dummy_state [16];
-
-			int version = SAVE_GAME_VERSION;
-			stream.write(reinterpret_cast<const char *>(&version), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(&rom[0xa0]), 16);
-			stream.write(reinterpret_cast<const char *>(&useBios), sizeof(bool));
-			stream.write(reinterpret_cast<const char *>(&reg[0]), sizeof(reg));
-			int i = 0;
-			for (; i < ARRAYSIZE(saveGameStruct); i++)
-			{
-				if(saveGameStruct[i].size > 0)
-				{
-					stream.write(reinterpret_cast<const char *>(saveGameStruct[i].address), saveGameStruct[i].size);
-				}
-			}
-			stream.write(reinterpret_cast<const char *>(&stopState), sizeof(bool));
-			stream.write(reinterpret_cast<const char *>(&IRQTicks), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(internalRAM), 0x8000);
-			stream.write(reinterpret_cast<const char *>(paletteRAM), 0x400);
-			stream.write(reinterpret_cast<const char *>(workRAM), 0x40000);
-			stream.write(reinterpret_cast<const char *>(vram), 0x20000);
-			stream.write(reinterpret_cast<const char *>(oam), 0x400);
-			//stream.write(reinterpret_cast<const char *>(pix), 0x400);
-			stream.write(reinterpret_cast<const char *>(ioMem), 0x400);
-
-			// EEPROM
-			for (i = 0; i < ARRAYSIZE(eepromSaveData); i++)
-			{
-				if(eepromSaveData[i].size > 0)
-				{
-					stream.write(reinterpret_cast<const char *>(eepromSaveData[i].address), eepromSaveData[i].size);
-				}
-			}
-			stream.write(reinterpret_cast<const char *>(&eepromSize), sizeof(int));
-			stream.write(reinterpret_cast<const char *>(eepromData), 0x2000);
-
-			// Flash
-			for (i = 0; i < ARRAYSIZE(flashSaveData3); i++)
-			{
-				if(flashSaveData3[i].size > 0)
-				{
-					stream.write(reinterpret_cast<const char *>(flashSaveData3[i].address), flashSaveData3[i].size);
-				}
-			}
-
-			// Sound
-			gb_apu->save_state(&state.apu);
-			memset(dummy_state, 0, sizeof dummy_state);
-			for (i = 0; i < ARRAYSIZE(gba_state); i++)
-			{
-				if(gba_state[i].size > 0)
-				{
-					stream.write(reinterpret_cast<const char *>(gba_state[i].address), gba_state[i].size);
-				}
-			}
-
-			stream.write(reinterpret_cast<const char *>(&rtcClockData), sizeof(rtcClockData));
-
-			stream.flush();
-			stream.close();
+			WriteRawStateFile(fileNameA);
 		}).then([emulator](task<void> t)
 		{
 			try
@@ -561,6 +360,17 @@ namespace Emulator
 				return;
 			}
 
+			if(ReadRawStateFile(stream))
+			{
+				stream.close();
+				if(cheatsTmp != nullptr)
+				{
+					LoadCheats(cheatsTmp);
+					cheatsTmp = nullptr;
+				}
+				return;
+			}
+
 			extern u8* gbRom;
 			extern bool useBios;
 			extern bool inBios;
@@ -964,6 +774,17 @@ namespace Emulator
 				return;
 			}
 
+			if(ReadRawStateFile(stream))
+			{
+				stream.close();
+				if(cheatsTmp != nullptr)
+				{
+					LoadCheats(cheatsTmp);
+					cheatsTmp = nullptr;
+				}
+				return;
+			}
+
 			extern Gb_Apu *gb_apu;
 			extern gb_apu_state_ss state;
 			extern variable_desc saveGameStruct[116];
@@ -1122,6 +943,136 @@ namespace Emulator
 		});
 	}
 
+	// Copies the battery backed memory of the game into data in the layout of
+	// its .sav file. Returns the size, or 0 if the game has nothing to save.
+	static size_t GetGBSRAMData(u8 *data, size_t size)
+	{
+		size_t length = 0;
+		auto append = [&](const void *src, size_t count)
+		{
+			if(length + count <= size)
+			{
+				memcpy(data + length, src, count);
+			}
+			length += count;
+		};
+
+		if(gbBattery)
+		{
+			switch(gbRomType)
+			{
+			case 0xff:
+			case 0x03:
+				// MBC1
+			case 0x0d:
+				// MMM01
+			case 0x13:
+			case 0xfc:
+				// MBC3 - 2
+			case 0x1b:
+			case 0x1e:
+				// MBC5
+				if(gbRam)
+				{
+					append(gbRam, gbRamSizeMask + 1);
+				}
+				break;
+			case 0x06:
+				// MBC2
+				if(gbRam)
+				{
+					append(gbMemoryMap[0x0a], 512);
+				}
+				break;
+			case 0x0f:
+			case 0x10:
+				// MBC3
+				if(gbRam)
+				{
+					append(gbRam, gbRamSizeMask + 1);
+				}
+				append(&gbDataMBC3.mapperSeconds, 10 * sizeof(int) + sizeof(time_t));
+				break;
+			case 0x22:
+				// MBC7
+				if(gbRam)
+				{
+					append(&gbMemory[0xa000], 256);
+				}
+				break;
+			case 0xfd:
+				if(gbRam)
+				{
+					append(gbRam, gbRamSizeMask + 1);
+				}
+				append(gbTAMA5ram, gbTAMA5ramSize);
+				append(&gbDataTAMA5.mapperSeconds, 14 * sizeof(int) + sizeof(time_t));
+				break;
+			}
+		}
+
+		return (length <= size) ? length : 0;
+	}
+
+	static size_t GetGBASRAMData(u8 *data, size_t size)
+	{
+		if(gbaSaveType == 0) {
+			if(eepromInUse)
+				gbaSaveType = 3;
+			else switch(saveType) {
+			case 1:
+				gbaSaveType = 1;
+				break;
+			case 2:
+				gbaSaveType = 2;
+				break;
+			}
+		}
+
+		// only save if Flash/Sram in use or EEprom in use
+		const u8 *src = nullptr;
+		size_t length = 0;
+		if((gbaSaveType) && (gbaSaveType!=5)) 
+		{
+			if(gbaSaveType != 3) 
+			{
+				src = flashSaveMemory;
+				length = (gbaSaveType == 2) ? flashSize : 0x10000;
+			} 
+			else 
+			{
+				src = eepromData;
+				length = eepromSize;
+			}
+		}
+
+		if(length > size)
+		{
+			return 0;
+		}
+		if(length)
+		{
+			memcpy(data, src, length);
+		}
+		return length;
+	}
+
+	static size_t GetSRAMData(u8 *data, size_t size)
+	{
+		return gbaROMLoaded ? GetGBASRAMData(data, size) : GetGBSRAMData(data, size);
+	}
+
+	static void WriteSRAMFile(StorageFile ^file, size_t (*getData)(u8 *, size_t))
+	{
+		u8 *data = new u8[SRAM_MAX];
+		size_t size = getData(data, SRAM_MAX);
+		if(size)
+		{
+			SaveBytesToFileAsync(file, data, size).wait();
+		}
+		delete [] data;
+	}
+
 	task<void> SaveSRAMAsync ()
 	{
 		if(gbaROMLoaded)
@@ -1156,99 +1107,7 @@ namespace Emulator
 			return saveFolder->CreateFileAsync(sramName, CreationCollisionOption::OpenIfExists);
 		}).then([](StorageFile ^file)
 		{
-			if(gbBattery)
-			{
-				switch(gbRomType)
-				{
-				case 0xff:
-				case 0x03:
-					// MBC1
-					if(gbRam)
-					{
-						SaveBytesToFileAsync(file, gbRam, gbRamSizeMask + 1).wait();
-					}
-					break;
-				case 0x06:
-					// MBC2
-					if(gbRam)
-					{
-						SaveBytesToFileAsync(file, gbMemoryMap[0x0a], 512).wait();
-					}
-					break;
-				case 0x0d:
-					// MMM01
-					if(gbRam)
-					{
-						SaveBytesToFileAsync(file, gbRam, gbRamSizeMask + 1).wait();
-					}
-					break;
-				case 0x0f:
-				case 0x10:
-					// MBC3
-					if(gbRam)
-					{
-						int tmpSize = gbRamSizeMask + 1 + 10 * sizeof(int) + sizeof(time_t);
-						u8 *tmp = new u8[tmpSize];
-						memcpy_s(tmp, gbRamSizeMask + 1, gbRam, gbRamSizeMask + 1);
-						memcpy_s(tmp + gbRamSizeMask + 1, 10 * sizeof(int) + sizeof(time_t), &gbDataMBC3.mapperSeconds, 10 * sizeof(int) + sizeof(time_t));
-
-						SaveBytesToFileAsync(file, tmp, tmpSize).wait();
-
-						delete [] tmp;
-					}else
-					{
-						SaveBytesToFileAsync(file, (u8 *) &gbDataMBC3.mapperSeconds, 10 * sizeof(int) + sizeof(time_t)).wait();
-					}
-					break;
-				case 0x13:
-				case 0xfc:
-					// MBC3 - 2
-					if(gbRam)
-					{
-						SaveBytesToFileAsync(file, gbRam, gbRamSizeMask + 1).wait();
-					}
-					break;
-				case 0x1b:
-				case 0x1e:
-					// MBC5
-					if(gbRam)
-					{
-						SaveBytesToFileAsync(file, gbRam, gbRamSizeMask + 1).wait();
-					}
-					break;
-				case 0x22:
-					// MBC7
-					if(gbRam)
-					{
-						SaveBytesToFileAsync(file, &gbMemory[0xa000], 256).wait();
-					}
-					break;
-				case 0xfd:
-					if(gbRam)
-					{
-						int tmpSize = gbRamSizeMask + 1 + gbTAMA5ramSize + 14 * sizeof(int) + sizeof(time_t);
-						u8 *tmp = new u8[tmpSize];
-						memcpy_s(tmp, gbRamSizeMask + 1, gbRam, gbRamSizeMask + 1);
-						memcpy_s(tmp + gbRamSizeMask + 1, gbTAMA5ramSize, gbTAMA5ram, gbTAMA5ramSize);
-						memcpy_s(tmp + gbRamSizeMask + 1 + gbTAMA5ramSize, 14 * sizeof(int) + sizeof(time_t), &gbDataTAMA5.mapperSeconds, 14 * sizeof(int) + sizeof(time_t));
-
-						SaveBytesToFileAsync(file, tmp, tmpSize).wait();
-
-						delete [] tmp;
-					}else
-					{
-						int tmpSize = gbTAMA5ramSize + 14 * sizeof(int) + sizeof(time_t);
-						u8 *tmp = new u8[tmpSize];
-						memcpy_s(tmp, gbTAMA5ramSize, gbTAMA5ram, gbTAMA5ramSize);
-						memcpy_s(tmp + gbTAMA5ramSize, 14 * sizeof(int) + sizeof(time_t), &gbDataTAMA5.mapperSeconds, 14 * sizeof(int) + sizeof(time_t));
-
-						SaveBytesToFileAsync(file, tmp, tmpSize).wait();
-
-						delete [] tmp;
-					}
-					break;
-				}
-			}
+			WriteSRAMFile(file, GetGBSRAMData);
 		}).then([sramName](task<void> t)
 		{
 			try
@@ -1285,39 +1144,7 @@ namespace Emulator
 			return saveFolder->CreateFileAsync(sramName, CreationCollisionOption::OpenIfExists);
 		}).then([](StorageFile ^file)
 		{
-			if(gbaSaveType == 0) {
-				if(eepromInUse)
-					gbaSaveType = 3;
-				else switch(saveType) {
-				case 1:
-					gbaSaveType = 1;
-					break;
-				case 2:
-					gbaSaveType = 2;
-					break;
-				}
-			}
-
-			if((gbaSaveType) && (gbaSaveType!=5)) 
-			{
-				// only save if Flash/Sram in use or EEprom in use
-				if(gbaSaveType != 3) 
-				{
-					if(gbaSaveType == 2) 
-					{
-						SaveBytesToFileAsync(file, flashSaveMemory, flashSize).wait();
-					} 
-					else 
-					{
-						SaveBytesToFileAsync(file, flashSaveMemory, 0x10000).wait();
-					}
-				} 
-				else 
-				{
-					SaveBytesToFileAsync(file, eepromData, eepromSize).wait();
-				}
-			}
-
+			WriteSRAMFile(file, GetGBASRAMData);
 		}).then([sramName](task<void> t)
 		{
 			try
@@ -1335,6 +1162,105 @@ namespace Emulator
 		});
 	}
 
+	// Autosave. The renderer asks for one with RequestAutosave() and the
+	// emulation thread answers in AutosaveFrame() between two frames: it
+	// copies the battery memory and, if asked, the state into preallocated
+	// buffers, and a background task writes the files while the game runs on.
+	enum
+	{
+		AUTOSAVE_NONE,
+		AUTOSAVE_SRAM,
+		AUTOSAVE_STATE
+	};
+
+	static std::atomic<int> autosaveRequest(AUTOSAVE_NONE);
+	static std::atomic<bool> autosaveBusy(false);
+	static u8 *autosaveSRAM = nullptr;
+	static u8 *autosaveState = nullptr;
+	static size_t autosaveSRAMSize = 0;
+	static size_t autosaveStateSize = 0;
+
+	static wstring GetROMBaseName(StorageFile ^file)
+	{
+		Platform::String ^name = file->Name;
+		const wchar_t *end = name->End();
+		while(end != name->Begin() && *end != '.') end--;
+		if(end == name->Begin())
+		{
+			end = name->End();
+		}
+		return wstring(name->Begin(), end);
+	}
+
+	void RequestAutosave(bool saveState)
+	{
+		if(!autosaveBusy)
+		{
+			autosaveRequest = saveState ? AUTOSAVE_STATE : AUTOSAVE_SRAM;
+		}
+	}
+
+	void AutosaveFrame(void)
+	{
+		if(autosaveRequest == AUTOSAVE_NONE)
+		{
+			return;
+		}
+		int request = autosaveRequest.exchange(AUTOSAVE_NONE);
+		if(autosaveBusy || ROMFile == nullptr || ROMFolder == nullptr)
+		{
+			return;
+		}
+
+		if(!autosaveSRAM)
+		{
+			autosaveSRAM = new u8[SRAM_MAX];
+			autosaveState = new u8[RAW_STATE_MAX];
+		}
+		autosaveSRAMSize = GetSRAMData(autosaveSRAM, SRAM_MAX);
+		autosaveStateSize = 0;
+		if(request == AUTOSAVE_STATE)
+		{
+			autosaveStateSize = utilWriteRawState(EmulatorGame::emulator, autosaveState, RAW_STATE_MAX);
+		}
+		if(!autosaveSRAMSize && !autosaveStateSize)
+		{
+			return;
+		}
+		autosaveBusy = true;
+
+		wstring romName = GetROMBaseName(ROMFile);
+		create_task(ROMFolder->CreateFolderAsync(SAVE_FOLDER, CreationCollisionOption::OpenIfExists))
+			.then([romName](StorageFolder ^folder)
+		{
+			if(autosaveStateSize)
+			{
+				wstringstream statePath;
+				statePath << folder->Path->Data() << L"\\" << romName << AUTOSAVE_SLOT << L".sgm";
+				WriteStateFile(statePath.str(), autosaveState, autosaveStateSize);
+			}
+			if(autosaveSRAMSize)
+			{
+				Platform::String ^sramName = ref new Platform::String((romName + L".sav").c_str());
+				StorageFile ^file = create_task(folder->CreateFileAsync(sramName, CreationCollisionOption::OpenIfExists)).get();
+				SaveBytesToFileAsync(file, autosaveSRAM, autosaveSRAMSize).wait();
+			}
+		}).then([](task<void> t)
+		{
+			try
+			{
+				t.get();
+			}catch(Exception ^ex)
+			{
+#if _DEBUG
+				wstring str(ex->Message->Begin(), ex->Message->End());
+				OutputDebugStringW((L"Autosave: " + str).c_str());
+#endif
+			}
+			autosaveBusy = false;
+		});
+	}
+
 	task<void> LoadSRAMAsync ()
 	{
 		if(gbaROMLoaded)
@@ -1678,13 +1604,10 @@ namespace Emulator
 			.then([=](IBuffer ^buffer)
 		{			
 			DataReader ^reader = DataReader::FromBuffer(buffer);
-			Array<BYTE> ^bytes = ref new Array<BYTE>(buffer->Length);
-			reader->ReadBytes(bytes);
 			BYTE *rawBytes = new BYTE[buffer->Length];
-			for (int i = 0; i < buffer->Length; i++)
-			{
-				rawBytes[i] = bytes[i]; 
-			}
+			// read straight into the native buffer rather than through a
+			// managed array
+			reader->ReadBytes(ArrayReference<BYTE>(rawBytes, buffer->Length));
 
 			ROMData data;
 			data.Length = buffer->Length;
@@ -1878,90 +1801,10 @@ namespace Emulator
 			return GetROMBytesFromFileAsync(file);
 		}).then([emulator, file, folder](ROMData data)
 		{
-			int size = 0x2000000;
-
-			systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
-
-			rom = (u8 *)malloc(0x2000000);
-			if(rom == NULL) {
-				systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-					"ROM");
-			}
-			workRAM = (u8 *)calloc(1, 0x40000);
-			if(workRAM == NULL) {
-				systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-					"WRAM");
-			}
-
-			u8 *whereToLoad = rom;
-			if(cpuIsMultiBoot)
-				whereToLoad = workRAM;
-
-			int read = size = data.Length < size ? data.Length : size;
-			memcpy_s(whereToLoad, read, data.ROM, read);
-
-			u16 *temp = (u16 *)(rom+((size+1)&~1));
-			int i;
-			for(i = (size+1)&~1; i < 0x2000000; i+=2) {
-				WRITE16LE(temp, (i >> 1) & 0xFFFF);
-				temp++;
-			}
-
-			bios = (u8 *)calloc(1,0x4000);
-			if(bios == NULL) {
-				systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-					"BIOS");
-				CPUCleanUp();
-			}    
-			internalRAM = (u8 *)calloc(1,0x8000);
-			if(internalRAM == NULL) {
-				systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-					"IRAM");
-				CPUCleanUp();
-			}    
-			paletteRAM = (u8 *)calloc(1,0x400);
-			if(paletteRAM == NULL) {
-				systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-					"PRAM");
-				CPUCleanUp();
-			}      
-			vram = (u8 *)calloc(1, 0x20000);
-			if(vram == NULL) {
-				systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-					"VRAM");
-				CPUCleanUp();
-			}      
-			oam = (u8 *)calloc(1, 0x400);
-			if(oam == NULL) {
-				systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-					"OAM");
-				CPUCleanUp();
-			}      
-
-			/*pix = (u8 *)calloc(1, 4 * 241 * 162);
-			if(pix == NULL) {
-			systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-			"PIX");
-			CPUCleanUp();
-			}      
-			extern size_t gbaPitch;
-			gbaPitch = 964;*/
-
-			ioMem = (u8 *)calloc(1, 0x400);
-			if(ioMem == NULL) {
-				systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-					"IO");
-				CPUCleanUp();
-			}      
-
-			memset(flashSaveMemory, 0xff, sizeof(flashSaveMemory));
-			memset(eepromData, 255, sizeof(eepromData));
-
-			extern void CPUUpdateRenderBuffers(bool);
-			CPUUpdateRenderBuffers(true);
+			// the core keeps its own right-sized copy of the image
+			int read = CPULoadRomData((const char *)data.ROM, data.Length);
 
 			ROMSize = read;
-			romSize = read;
 
 			if(data.ROM)
 			{
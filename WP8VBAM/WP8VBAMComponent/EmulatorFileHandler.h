@@ -47,6 +47,10 @@ namespace Emulator
 	task<void> LoadSRAMAsync(void);
 	task<void> LoadGBASRAMAsync(void);
 	task<void> LoadGBSRAMAsync(void);
+	// Non-blocking autosave: the request is served at the next frame boundary
+	// by AutosaveFrame(), which the emulation thread calls between frames.
+	void RequestAutosave(bool saveState);
+	void AutosaveFrame(void);
 	void LoadCheatsOnROMLoad(Windows::Foundation::Collections::IVector<PhoneDirect3DXamlAppComponent::CheatData ^> ^cheats);
 	void LoadCheats(Windows::Foundation::Collections::IVector<PhoneDirect3DXamlAppComponent::CheatData ^> ^cheats);
 	void LoadCheatsGBA(Windows::Foundation::Collections::IVector<PhoneDirect3DXamlAppComponent::CheatData ^> ^cheats);
@@ -4,6 +4,10 @@
 #include "Vector4.h"
 #include "TextureLoader.h"
 #include "WP8VBAMComponent.h"
+#include "FrameQueue.h"
+#include "vbam/common/FramePacer.h"
+#include "vbam/gba/Sound.h"
+#include <Util.h>
 #include <math.h>
 #include <stdio.h>
 #include <chrono>
@@ -15,12 +19,24 @@ using namespace Windows::UI::Core;
 using namespace Windows::Graphics::Display;
 
 
-HANDLE swapEvent = NULL;
-HANDLE updateEvent = NULL;
+// Frames travel from the emulation thread to Render() through frameQueue,
+// whose three slots are the frame textures. The core draws straight into the
+// mapped back texture; only the front texture is unmapped so it can be drawn.
+// frameTickEvent is set on every Render() call and paces the emulation
+// thread to the display refresh.
+FrameQueue frameQueue;
+HANDLE frameTickEvent = NULL;
 //CRITICAL_SECTION swapCS;
 //bool csInit = false;
 
-bool lastSkipped = false;
+// framePacer picks the frame skip and whether a drawn frame waits for
+// frameTickEvent from the audio fill and the time spent emulating; see
+// systemFrame() and systemDrawScreen(). Update() only requests the skip
+// range from the settings; the emulation thread applies it in frameDone().
+FramePacer framePacer;
+LARGE_INTEGER paceFrequency;
+LARGE_INTEGER paceLastFrame;
+LONGLONG paceWaited = 0;
 
 namespace Emulator
 {
@@ -29,50 +45,36 @@ namespace Emulator
 
 void ContinueEmulation(void)
 {
-	if(swapEvent && updateEvent)
+	if(frameTickEvent)
 	{
-		ResetEvent(swapEvent);
-		SetEvent(updateEvent);
+		SetEvent(frameTickEvent);
 	}
 }
 
-extern u8 *pix;
-size_t gbaPitch;
+extern CORE_LOCAL u8 *pix;
+extern CORE_LOCAL bool speedup;
+extern CORE_LOCAL size_t gbaPitch;
 int turboSkip = 5;
 
 int framesNotRendered = 0;
 
 //u8 tmpBuf[241 * 162 * 4];
 
-inline void cpyImg32( unsigned char *dst, unsigned int dstPitch, unsigned char *src, unsigned int srcPitch, unsigned short width, unsigned short height )
-{
-	// fast, iterative C version
-	// copies an width*height array of visible pixels from src to dst
-	// srcPitch and dstPitch are the number of garbage bytes after a scanline
-	register unsigned short lineSize = width<<2;
-
-	while( height-- ) {
-		memcpy( dst, src, lineSize );
-		src += srcPitch;
-		dst += dstPitch;
-	}
-}
-
 EmulatorRenderer::EmulatorRenderer()
 { 
 	emulator = EmulatorGame::GetInstance();
 	frontbuffer = 0;
 	controller = nullptr;
-	autosaving = false;
 	elapsedTime = 0.0f;
 	settings = EmulatorSettings::Current;
 	frames = 0;
 	should_show_resume_text = false;
 
-	this->waitEvent = CreateEventEx(NULL, NULL, NULL, EVENT_ALL_ACCESS);
+	frameTickEvent = CreateEventEx(NULL, NULL, NULL, EVENT_ALL_ACCESS);
 
-	swapEvent = CreateEventEx(NULL, NULL, NULL, EVENT_ALL_ACCESS);
-	updateEvent = CreateEventEx(NULL, NULL, NULL, EVENT_ALL_ACCESS);
+	QueryPerformanceFrequency(&paceFrequency);
+	QueryPerformanceCounter(&paceLastFrame);
+	framePacer.reset();
 
 	/*if(!csInit)
 	{
@@ -86,12 +88,17 @@ EmulatorRenderer::~EmulatorRenderer(void)
 {
 	if(this->m_d3dContext)
 	{
-		this->m_d3dContext->Unmap(this->buffers[(this->frontbuffer + 1) % 2].Get(), 0);
+		for(int i = 0; i < 3; i++)
+		{
+			if(i != frameQueue.GetReadIndex())
+			{
+				this->m_d3dContext->Unmap(this->buffers[i].Get(), 0);
+			}
+		}
 	}
 
-	CloseHandle(this->waitEvent);
-	CloseHandle(swapEvent);
-	CloseHandle(updateEvent);
+	CloseHandle(frameTickEvent);
+	frameTickEvent = NULL;
 
 	delete this->dxSpriteBatch;
 	this->dxSpriteBatch = nullptr;
@@ -100,13 +107,32 @@ EmulatorRenderer::~EmulatorRenderer(void)
 void EmulatorRenderer::CreateDeviceResources()
 {
 	Renderer::CreateDeviceResources();
-	
 
+	// This runs on the render thread whenever the device changes, so hold
+	// the emulation thread outside its frame (it waits for pauseSync in
+	// systemDrawScreen) while the queue and the core's target are replaced.
+	bool wasPaused = this->emulator->IsPaused();
+	this->emulator->Pause();
 
-	// Map backbuffer so it can be unmapped on first update
-	int backbuffer = (this->frontbuffer + 1) % 2;
-	this->backbufferPtr = (uint8 *) this->MapBuffer(backbuffer, &this->pitch);
-	pix = this->backbufferPtr;
+	// Keep the back and middle textures mapped for the core and leave the
+	// front one unmapped to be drawn.
+	frameQueue.Reset();
+	for(int i = 0; i < 3; i++)
+	{
+		if(i != frameQueue.GetReadIndex())
+		{
+			size_t rowPitch;
+			uint8 *buffer = (uint8 *) this->MapBuffer(i, &rowPitch);
+			frameQueue.SetFrame(i, buffer, rowPitch);
+		}
+	}
+	this->frontbuffer = frameQueue.GetReadIndex();
+	utilSetFrameTarget(frameQueue.GetWriteBuffer(), frameQueue.GetWritePitch());
+
+	if(!wasPaused)
+	{
+		this->emulator->Unpause();
+	}
 }
 
 void EmulatorRenderer::CreateWindowSizeDependentResources()
@@ -167,8 +193,8 @@ void EmulatorRenderer::SetVirtualController(VirtualController *controller)
 
 void EmulatorRenderer::GetBackbufferData(uint8 **backbufferPtr, size_t *pitch, int *imageWidth, int *imageHeight)
 {
-	*backbufferPtr = this->backbufferPtr + this->pitch;
-	*pitch = this->pitch;
+	*backbufferPtr = pix + gbaPitch;
+	*pitch = gbaPitch;
 	if(gbaROMLoaded)
 	{
 		*imageWidth = 240;
@@ -197,28 +223,22 @@ void EmulatorRenderer::Update(float timeTotal, float timeDelta)
 	{
 		this->elapsedTime += timeDelta;
 
-		systemFrameSkip = settings->PowerFrameSkip;
-		float targetFPS = 55.0f;
+		int skip = settings->PowerFrameSkip;
 		if(/*settings->LowFrequencyModeMeasured && */settings->LowFrequencyMode)
 		{
-			systemFrameSkip = systemFrameSkip * 2 + 1;
-			targetFPS = 28.0f;
+			skip = skip * 2 + 1;
 		}
 		if(settings->FrameSkip == -1 && settings->PowerFrameSkip == 0)
 		{
-			if(!lastSkipped && (timeDelta * 1.0f) > (1.0f / targetFPS))
-			{
-				int skip = (int)((timeDelta * 1.0f) / (1.0f / targetFPS));				
-				systemFrameSkip += (skip < 2) ? skip : 2;
-				//systemFrameSkip++;
-				lastSkipped = true;
-			}else
+			// automatic: up to two more frames when the pacer falls behind
+			framePacer.setFrameSkipRange(skip, skip + 2);
+		}else
+		{
+			if(settings->FrameSkip >= 0)
 			{
-				lastSkipped = false;
+				skip += settings->FrameSkip;
 			}
-		}else if(settings->FrameSkip >= 0)
-		{
-			systemFrameSkip += settings->FrameSkip;
+			framePacer.setFrameSkipRange(skip, skip);
 		}
 	}
 	/*if(!settings->LowFrequencyModeMeasured)
@@ -240,21 +260,7 @@ void EmulatorRenderer::Update(float timeTotal, float timeDelta)
 		if(!emulator->IsPaused())
 		{
 			this->elapsedTime -= AUTOSAVE_INTERVAL;
-			autosaving = true;
-			emulator->Pause();
-			SaveSRAMAsync().then([this]()
-			{
-				if (settings->AutoSaveLoad)
-				{
-					int oldSlot = SavestateSlot;
-					SavestateSlot = AUTOSAVE_SLOT;
-					SaveStateAsync().wait();
-					SavestateSlot = oldSlot;
-					//Settings.Mute = !EmulatorSettings::Current->SoundEnabled;
-				}
-				emulator->Unpause();
-				SetEvent(this->waitEvent);
-			});
+			RequestAutosave(settings->AutoSaveLoad);
 		}else
 		{
 			this->elapsedTime = AUTOSAVE_INTERVAL;
@@ -298,11 +304,7 @@ void EmulatorRenderer::Render()
 {
 
 
-	if(autosaving)
-	{
-		WaitForSingleObjectEx(this->waitEvent, INFINITE, false);
-		autosaving = false;
-	}
+	SetEvent(frameTickEvent);
 
 	m_d3dContext->OMSetRenderTargets(
 		1,
@@ -336,20 +338,19 @@ void EmulatorRenderer::Render()
 		{
 			framesNotRendered = 0;
 
-			WaitForSingleObjectEx(swapEvent, INFINITE, false);
-
-			int backbuffer = this->frontbuffer;
-			this->frontbuffer = (this->frontbuffer + 1) % 2;
-			uint8 *buffer = (uint8 *) this->MapBuffer(backbuffer, &gbaPitch);
-			this->backbufferPtr = buffer;
-			this->pitch = gbaPitch;
-
-			pix = buffer;
-
-			this->m_d3dContext->Unmap(this->buffers[this->frontbuffer].Get(), 0);
-
-			SetEvent(updateEvent);
+			// show the newest completed frame, if any, and keep showing the
+			// previous one otherwise. The texture given up is mapped again
+			// before the core can get it back as a render target.
+			if(frameQueue.FrameAvailable())
+			{
+				size_t rowPitch;
+				uint8 *buffer = (uint8 *) this->MapBuffer(this->frontbuffer, &rowPitch);
+				frameQueue.SetFrame(this->frontbuffer, buffer, rowPitch);
+				frameQueue.Acquire();
 
+				this->frontbuffer = frameQueue.GetReadIndex();
+				this->m_d3dContext->Unmap(this->buffers[this->frontbuffer].Get(), 0);
+			}
 		}else
 		{
 			framesNotRendered++;
@@ -541,15 +542,52 @@ void *EmulatorRenderer::MapBuffer(int index, size_t *rowPitch)
 	return map.pData;
 }
 
+void systemFrame()
+{
+	// everything since the last frame except waiting in systemDrawScreen()
+	LARGE_INTEGER now;
+	QueryPerformanceCounter(&now);
+	LONGLONG cost = now.QuadPart - paceLastFrame.QuadPart - paceWaited;
+	paceLastFrame = now;
+	paceWaited = 0;
+
+	framePacer.frameDone((float) cost / paceFrequency.QuadPart, soundGetFill());
+	systemFrameSkip = framePacer.getFrameSkip();
+}
+
 void systemDrawScreen() 
 { 
+	// hand the frame to the renderer and continue in a free texture
+	frameQueue.Publish();
+	utilSetFrameTarget(frameQueue.GetWriteBuffer(), frameQueue.GetWritePitch());
 
-	LeaveCriticalSection(&pauseSync);
+	// the only point where no frame is half done; autosaves are taken here
+	AutosaveFrame();
+
+	FramePacerAction action = framePacer.frameDrawn();
+
+	LARGE_INTEGER start;
+	QueryPerformanceCounter(&start);
 
-	SetEvent(swapEvent);
+	LeaveCriticalSection(&pauseSync);
 
-	WaitForSingleObjectEx(updateEvent, INFINITE, false);
+	// Pace to the display refresh. This returns at once if Render() ran
+	// since the last frame, so a slow frame never waits for presentation.
+	// While the audio runs low the next frame starts at once instead, and
+	// while it is well ahead the thread waits for one more refresh.
+	if(action != PACE_RUN_AHEAD)
+	{
+		WaitForSingleObjectEx(frameTickEvent, INFINITE, false);
+	}
+	if(action == PACE_SLEEP && !speedup)
+	{
+		WaitForSingleObjectEx(frameTickEvent, (DWORD) (framePacer.getFramePeriod() * 1000.0f), false);
+	}
 
 	EnterCriticalSection(&pauseSync);
 
+	// the time paused counts as waiting too
+	LARGE_INTEGER end;
+	QueryPerformanceCounter(&end);
+	paceWaited += end.QuadPart - start.QuadPart;
 }
\ No newline at end of file
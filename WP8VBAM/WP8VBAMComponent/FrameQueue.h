@@ -0,0 +1,103 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+// Triple-buffered single-producer/single-consumer frame queue.
+//
+// The emulation thread renders into the back frame and publishes it with
+// Publish(), which never blocks: the finished frame is swapped into the
+// middle slot and the producer continues in whatever frame was there. The
+// render thread calls Acquire() to swap the middle slot with its front
+// frame when a newer one is available, so it always shows the most
+// recently completed frame and intermediate frames are dropped.
+//
+// The queue does not own the frame memory. The owner attaches a buffer and
+// pitch to each of the three slots with SetFrame(), which lets the frames
+// live in mapped textures; the consumer may replace the buffer of its front
+// slot before Acquire() hands that slot back to the producer.
+class FrameQueue
+{
+public:
+	FrameQueue(void)
+		: back(0), front(1), middle(2)
+	{
+		for(int i = 0; i < 3; i++)
+		{
+			this->frames[i].buffer = nullptr;
+			this->frames[i].pitch = 0;
+		}
+	}
+
+	// Not thread safe; call while neither side is using the queue.
+	void Reset(void)
+	{
+		this->back = 0;
+		this->front = 1;
+		this->middle = 2;
+	}
+
+	void SetFrame(int index, unsigned char *buffer, size_t pitch)
+	{
+		this->frames[index].buffer = buffer;
+		this->frames[index].pitch = pitch;
+	}
+
+	// Producer side.
+	unsigned char *GetWriteBuffer(void) const
+	{
+		return this->frames[this->back].buffer;
+	}
+
+	size_t GetWritePitch(void) const
+	{
+		return this->frames[this->back].pitch;
+	}
+
+	int GetWriteIndex(void) const
+	{
+		return this->back;
+	}
+
+	void Publish(void)
+	{
+		this->back = this->middle.exchange(this->back | FRESH) & INDEX;
+	}
+
+	// Consumer side. FrameAvailable() tells whether Acquire() would replace
+	// the front frame, so the consumer can prepare the slot it gives up.
+	bool FrameAvailable(void) const
+	{
+		return (this->middle.load() & FRESH) != 0;
+	}
+
+	bool Acquire(void)
+	{
+		if(!this->FrameAvailable())
+		{
+			return false;
+		}
+		this->front = this->middle.exchange(this->front) & INDEX;
+		return true;
+	}
+
+	int GetReadIndex(void) const
+	{
+		return this->front;
+	}
+
+private:
+	static const int INDEX = 3;
+	static const int FRESH = 4;
+
+	struct Frame
+	{
+		unsigned char *buffer;
+		size_t pitch;
+	};
+
+	Frame frames[3];
+	int back;
+	int front;
+	std::atomic<int> middle;
+};
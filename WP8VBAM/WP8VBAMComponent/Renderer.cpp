@@ -295,7 +295,7 @@ void Renderer::CreateDeviceResources()
 			this->rButtonSRV.GetAddressOf()
 			);
 	}
-	// Create Textures and SRVs for front and backbuffer
+	// Create Textures and SRVs for the three frame buffers
 	D3D11_TEXTURE2D_DESC desc;
 	ZeroMemory(&desc, sizeof(D3D11_TEXTURE2D_DESC));
 
@@ -310,12 +310,12 @@ void Renderer::CreateDeviceResources()
 	desc.SampleDesc.Quality = 0;
 	desc.Usage = D3D11_USAGE_DYNAMIC;
 
-	DX::ThrowIfFailed(
-		this->m_d3dDevice->CreateTexture2D(&desc, nullptr, this->buffers[0].GetAddressOf())
-		);
-	DX::ThrowIfFailed(
-		this->m_d3dDevice->CreateTexture2D(&desc, nullptr, this->buffers[1].GetAddressOf())
-		);
+	for(int i = 0; i < 3; i++)
+	{
+		DX::ThrowIfFailed(
+			this->m_d3dDevice->CreateTexture2D(&desc, nullptr, this->buffers[i].GetAddressOf())
+			);
+	}
 
 	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
 	ZeroMemory(&srvDesc, sizeof(D3D11_SHADER_RESOURCE_VIEW_DESC));
@@ -324,12 +324,12 @@ void Renderer::CreateDeviceResources()
 	srvDesc.Texture2D.MostDetailedMip = 0;
 	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
 
-	DX::ThrowIfFailed(
-		this->m_d3dDevice->CreateShaderResourceView(this->buffers[0].Get(), &srvDesc, this->bufferSRVs[0].GetAddressOf())
-		);
-	DX::ThrowIfFailed(
-		this->m_d3dDevice->CreateShaderResourceView(this->buffers[1].Get(), &srvDesc, this->bufferSRVs[1].GetAddressOf())
-		);
+	for(int i = 0; i < 3; i++)
+	{
+		DX::ThrowIfFailed(
+			this->m_d3dDevice->CreateShaderResourceView(this->buffers[i].Get(), &srvDesc, this->bufferSRVs[i].GetAddressOf())
+			);
+	}
 
 
 	
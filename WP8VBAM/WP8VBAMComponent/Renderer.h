@@ -77,8 +77,6 @@ internal:
 	size_t pitch;
 	uint8 *backbufferPtr;
 	float elapsedTime;
-	bool autosaving;
-	HANDLE waitEvent;
 	int frames;
 
 
@@ -112,8 +110,8 @@ internal:
 
 	DXSpriteBatch						*dxSpriteBatch;
 	EmulatorGame						*emulator;
-	ComPtr<ID3D11Texture2D>				buffers[2];
-	ComPtr<ID3D11ShaderResourceView>	bufferSRVs[2];
+	ComPtr<ID3D11Texture2D>				buffers[3];
+	ComPtr<ID3D11ShaderResourceView>	bufferSRVs[3];
 	ComPtr<ID3D11BlendState>			alphablend;
 
 	ComPtr<ID3D11Resource>				stickCenterResource;
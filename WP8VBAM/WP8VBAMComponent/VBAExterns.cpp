@@ -1,9 +1,9 @@
 #include "VBAM/System.h"
 
-int systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
+CORE_LOCAL int systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
 u32 systemColorMap32[0x10000];
 u16 systemColorMap16[0x10000];
-int emulating = 0;
+CORE_LOCAL int emulating = 0;
 int systemFrameSkip = 0;
 int systemRedShift = 0;
 int systemBlueShift = 0;
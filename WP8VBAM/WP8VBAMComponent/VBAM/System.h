@@ -24,8 +24,8 @@ struct EmulatedSystem {
   bool (*emuWriteState)(const char *);
   // load memory state (rewind)
   bool (*emuReadMemState)(char *, int);
-  // write memory state (rewind)
-  bool (*emuWriteMemState)(char *, int);
+  // write memory state (rewind), returning its size in the last argument
+  bool (*emuWriteMemState)(char *, int, long &);
   // write PNG file
   bool (*emuWritePNG)(const char *);
   // write BMP file
@@ -87,7 +87,7 @@ extern int systemColorDepth;
 extern int systemDebug;
 extern int systemVerbose;
 extern int systemFrameSkip;
-extern int systemSaveUpdateCounter;
+extern CORE_LOCAL int systemSaveUpdateCounter;
 extern int systemSpeed;
 
 #define SYSTEM_SAVE_UPDATED 30
@@ -36,10 +36,12 @@ extern int systemBlueShift;
 extern u16 systemColorMap16[0x10000];
 extern u32 systemColorMap32[0x10000];
 
-static int (ZEXPORT *utilGzWriteFunc)(gzFile, const voidp, unsigned int) = NULL;
-static int (ZEXPORT *utilGzReadFunc)(gzFile, voidp, unsigned int) = NULL;
-static int (ZEXPORT *utilGzCloseFunc)(gzFile) = NULL;
-static z_off_t (ZEXPORT *utilGzSeekFunc)(gzFile, z_off_t, int) = NULL;
+extern void gbUpdatePaletteColors();
+
+static CORE_LOCAL int (ZEXPORT *utilGzWriteFunc)(gzFile, const voidp, unsigned int) = NULL;
+static CORE_LOCAL int (ZEXPORT *utilGzReadFunc)(gzFile, voidp, unsigned int) = NULL;
+static CORE_LOCAL int (ZEXPORT *utilGzCloseFunc)(gzFile) = NULL;
+static CORE_LOCAL z_off_t (ZEXPORT *utilGzSeekFunc)(gzFile, z_off_t, int) = NULL;
 
 bool utilWritePNGFile(const char *fileName, int w, int h, u8 *pix)
 {
@@ -312,7 +314,7 @@ bool utilWriteBMPFile(const char *fileName, int w, int h, u8 *pix)
   return true;
 }
 
-extern bool cpuIsMultiBoot;
+extern CORE_LOCAL bool cpuIsMultiBoot;
 
 bool utilIsGBAImage(const char * file)
 {
@@ -482,8 +484,76 @@ z_off_t utilGzSeek(gzFile file, z_off_t offset, int whence)
 	return utilGzSeekFunc(file, offset, whence);
 }
 
+// Uncompressed memory stream behind the utilGz* calls. The rewind history
+// takes a state every frame, where compressing it would cost more than
+// emulating the frame. Like the gzip streams, one is open at a time.
+static CORE_LOCAL struct {
+  char *memory;
+  int available;
+  int pos;
+} utilMemRaw;
+
+static int ZEXPORT utilMemRawWrite(gzFile, const voidp buffer, unsigned int len)
+{
+  // keep counting past the end so the caller can tell the state was cut
+  int pos = utilMemRaw.pos;
+  utilMemRaw.pos += len;
+  if(pos >= utilMemRaw.available)
+    return 0;
+  if(len > (unsigned int)(utilMemRaw.available - pos))
+    len = utilMemRaw.available - pos;
+  memcpy(utilMemRaw.memory + pos, buffer, len);
+  return len;
+}
+
+static int ZEXPORT utilMemRawRead(gzFile, voidp buffer, unsigned int len)
+{
+  int left = utilMemRaw.available - utilMemRaw.pos;
+  if(left < 0)
+    left = 0;
+  if(len > (unsigned int)left) {
+    memset((u8 *)buffer + left, 0, len - left);
+    len = left;
+  }
+  memcpy(buffer, utilMemRaw.memory + utilMemRaw.pos, len);
+  utilMemRaw.pos += len;
+  return len;
+}
+
+static int ZEXPORT utilMemRawClose(gzFile)
+{
+  utilMemRaw.memory = NULL;
+  return 0;
+}
+
+static z_off_t ZEXPORT utilMemRawSeek(gzFile, z_off_t offset, int whence)
+{
+  if(whence == SEEK_CUR)
+    offset += utilMemRaw.pos;
+  if(offset < 0 || offset > utilMemRaw.available)
+    return -1;
+  utilMemRaw.pos = offset;
+  return offset;
+}
+
+gzFile utilMemRawOpen(char *memory, int available, const char *mode)
+{
+  utilGzWriteFunc = utilMemRawWrite;
+  utilGzReadFunc = utilMemRawRead;
+  utilGzCloseFunc = utilMemRawClose;
+  utilGzSeekFunc = utilMemRawSeek;
+
+  utilMemRaw.memory = memory;
+  utilMemRaw.available = available;
+  utilMemRaw.pos = 0;
+
+  return (gzFile)&utilMemRaw;
+}
+
 long utilGzMemTell(gzFile file)
 {
+  if(file == (gzFile)&utilMemRaw)
+    return utilMemRaw.pos;
   return memtell(file);
 }
 
@@ -535,8 +605,29 @@ void utilGBAFindSave(const u8 *data, const int size)
   flashSetSize(flashSize);
 }
 
+// LCD filter the colour maps were last built with
+static bool utilLcdFilter = false;
+
+u16 utilColor16(u16 color)
+{
+  u16 pix = ((color & 0x1f) << systemRedShift) |
+    (((color & 0x3e0) >> 5) << systemGreenShift) |
+    (((color & 0x7c00) >> 10) << systemBlueShift);
+  return utilLcdFilter ? gbafilter_pixel16(pix) : pix;
+}
+
+u32 utilColor32(u16 color)
+{
+  u32 pix = ((color & 0x1f) << systemRedShift) |
+    (((color & 0x3e0) >> 5) << systemGreenShift) |
+    (((color & 0x7c00) >> 10) << systemBlueShift);
+  return utilLcdFilter ? gbafilter_pixel32(pix) : pix;
+}
+
 void utilUpdateSystemColorMaps(bool lcd)
 {
+  utilLcdFilter = lcd;
+
   switch(systemColorDepth) {
   case 16:
     {
@@ -560,6 +651,61 @@ void utilUpdateSystemColorMaps(bool lcd)
     }
     break;
   }
+
+  // the palette shadows are kept in the output format
+  CPUUpdatePaletteColors();
+  gbUpdatePaletteColors();
+}
+
+// Point the 32bpp line writers at a caller-owned buffer, e.g. a mapped
+// texture, so a frame needs no copy before it is shown. Line N of the
+// picture goes to row N+1 of the target, pitch bytes apart; the target needs
+// 162 rows for the GBA and 145 for the GB and stays owned by the caller. It
+// may be changed between frames.
+void utilSetFrameTarget(u8 *target, size_t pitch)
+{
+  pix = target;
+  gbaPitch = pitch;
+}
+
+// Returns the size of the state written to data, or 0 if it did not fit.
+size_t utilWriteRawState(const EmulatedSystem &system, u8 *data, size_t size)
+{
+  if(size < sizeof(RawStateHeader))
+    return 0;
+
+  long len = 0;
+  if(!system.emuWriteMemState((char *)data + sizeof(RawStateHeader),
+                              size - sizeof(RawStateHeader), len))
+    return 0;
+
+  RawStateHeader *header = (RawStateHeader *)data;
+  header->magic = RAW_STATE_MAGIC;
+  header->version = RAW_STATE_VERSION;
+  header->size = len;
+  header->reserved = 0;
+  return sizeof(RawStateHeader) + len;
+}
+
+bool utilIsRawState(const u8 *data, size_t size)
+{
+  const RawStateHeader *header = (const RawStateHeader *)data;
+  return size >= sizeof(RawStateHeader) &&
+    header->magic == RAW_STATE_MAGIC &&
+    header->version == RAW_STATE_VERSION &&
+    header->size <= size - sizeof(RawStateHeader);
+}
+
+// The state itself carries the save game version and the ROM title, which
+// the system checks before it changes anything.
+bool utilReadRawState(const EmulatedSystem &system, const u8 *data, size_t size)
+{
+  if(!utilIsRawState(data, size))
+    return false;
+
+  const RawStateHeader *header = (const RawStateHeader *)data;
+  return system.emuReadMemState((char *)data + sizeof(RawStateHeader),
+                                header->size);
 }
 
 // Check for existence of file.
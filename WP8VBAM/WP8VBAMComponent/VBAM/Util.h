@@ -10,11 +10,29 @@ enum IMAGE_TYPE {
 };
 
 // save game
+// Tables of these are built at run time by the functions returning them:
+// the addresses of CORE_LOCAL variables differ from one thread to the next.
 typedef struct {
   void *address;
   int size;
 } variable_desc;
 
+// Raw save state: this header followed by the uncompressed memory state of
+// the running system, so a state is saved with a single write and loaded
+// with plain copies into the emulated memory.
+#define RAW_STATE_MAGIC   0x53524256 // "VBRS"
+#define RAW_STATE_VERSION 1
+// The picture is left out of the memory state. Upper bound for a state
+// including the header: a GBA state with 128 KB of flash is about 580 KB.
+#define RAW_STATE_MAX     0x100000
+
+typedef struct {
+  u32 magic;
+  u32 version;
+  u32 size; // bytes following the header
+  u32 reserved;
+} RawStateHeader;
+
 bool utilWritePNGFile(const char *, int, int, u8 *);
 bool utilWriteBMPFile(const char *, int, int, u8 *);
 void utilApplyIPS(const char *ips, u8 **rom, int *size);
@@ -32,6 +50,7 @@ int utilReadInt(gzFile);
 void utilWriteInt(gzFile, int);
 gzFile utilGzOpen(const char *file, const char *mode);
 gzFile utilMemGzOpen(char *memory, int available, const char *mode);
+gzFile utilMemRawOpen(char *memory, int available, const char *mode);
 int utilGzWrite(gzFile file, const voidp buffer, unsigned int len);
 int utilGzRead(gzFile file, voidp buffer, unsigned int len);
 int utilGzClose(gzFile file);
@@ -39,7 +58,14 @@ z_off_t utilGzSeek(gzFile file, z_off_t offset, int whence);
 long utilGzMemTell(gzFile file);
 void utilGBAFindSave(const u8 *, const int);
 void utilUpdateSystemColorMaps(bool lcd = false);
+// One BGR555 colour in the output format of the last utilUpdateSystemColorMaps
+u16 utilColor16(u16 color);
+u32 utilColor32(u16 color);
+void utilSetFrameTarget(u8 *target, size_t pitch);
 bool utilFileExists( const char *filename );
+size_t utilWriteRawState(const EmulatedSystem &, u8 *data, size_t size);
+bool utilIsRawState(const u8 *data, size_t size);
+bool utilReadRawState(const EmulatedSystem &, const u8 *data, size_t size);
 
 enum RTCSTATE { IDLE, COMMAND, DATA, READDATA };
 
@@ -1,6 +1,7 @@
 // Blip_Buffer 0.4.1. http://www.slack.net/~ant/
 
 #include "Blip_Buffer.h"
+#include "Blip_Simd.h"
 
 #include <assert.h>
 #include <limits.h>
@@ -389,6 +390,16 @@ long Blip_Buffer::read_samples( blip_sample_t* out_, long max_samples, int stere
 	{
 		int const bass = BLIP_READER_BASS( *this );
 		BLIP_READER_BEGIN( reader, *this );
+
+		if ( blip_simd_t const* simd = blip_simd() )
+		{
+			simd->read_mono( reader_reader_buf, (int) count, bass, &reader_reader_accum,
+					out_, stereo ? blip_out_left : blip_out_mono );
+			BLIP_READER_END( reader, *this );
+			remove_samples( count );
+			return count;
+		}
+
 		BLIP_READER_ADJ_( reader, count );
 		blip_sample_t* BLIP_RESTRICT out = out_ + count;
 		blip_long offset = (blip_long) -count;
@@ -406,6 +417,8 @@ long Blip_Buffer::read_samples( blip_sample_t* out_, long max_samples, int stere
 		}
 		else
 		{
+			// out [offset * 2] has to end at out_ [count * 2]
+			out += count;
 			do
 			{
 				blip_long s = BLIP_READER_READ( reader );
@@ -433,6 +446,12 @@ void Blip_Buffer::mix_samples( blip_sample_t const* in, long count )
 
 	buf_t_* out = buffer_ + (offset_ >> BLIP_BUFFER_ACCURACY) + blip_widest_impulse_ / 2;
 
+	if ( blip_simd_t const* simd = blip_simd() )
+	{
+		simd->mix_samples( out, in, (int) count );
+		return;
+	}
+
 	int const sample_shift = blip_sample_bits - 16;
 	int prev = 0;
 	while ( count-- )
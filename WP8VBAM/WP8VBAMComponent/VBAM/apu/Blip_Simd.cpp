@@ -0,0 +1,435 @@
+// Vector versions of the Blip_Buffer sample loops
+
+#include "Blip_Simd.h"
+
+#if defined (_M_ARM) || defined (_M_ARM64) || defined (__ARM_NEON) || defined (__ARM_NEON__)
+	#define BLIP_NEON
+	#include <arm_neon.h>
+#elif defined (_M_X64) || defined (_M_IX86) || defined (__SSE2__)
+	#define BLIP_SSE2
+	#include <emmintrin.h>
+	#if defined (_MSC_VER)
+		#include <intrin.h>
+	#elif !defined (__x86_64__)
+		#include <cpuid.h>
+	#endif
+#endif
+
+bool blip_simd_enabled = true;
+
+int const blip_read_shift = blip_sample_bits - 16;
+
+// One integrator step, keeping the value read in a
+#define BLIP_SIMD_STEP( a, accum, in, bass ) {\
+	a = accum;\
+	accum -= accum >> (bass);\
+	accum += in;\
+}
+
+// Four steps of a single buffer, where the vector loops have to go back to
+// scalar code
+#define BLIP_SIMD_STEP4( a, accum, in, bass ) {\
+	BLIP_SIMD_STEP( a [0], accum, (in) [0], bass );\
+	BLIP_SIMD_STEP( a [1], accum, (in) [1], bass );\
+	BLIP_SIMD_STEP( a [2], accum, (in) [2], bass );\
+	BLIP_SIMD_STEP( a [3], accum, (in) [3], bass );\
+}
+
+// Scalar versions, used for the samples left over after the vector loops
+
+static void read_mono_scalar( blip_long const* in, int count, int bass, blip_long* accum_,
+		blip_sample_t* out, blip_simd_out_t mode )
+{
+	blip_long accum = *accum_;
+	for ( int i = 0; i < count; i++ )
+	{
+		blip_long s = accum >> blip_read_shift;
+		accum -= accum >> bass;
+		accum += in [i];
+		BLIP_CLAMP( s, s );
+		if ( mode == blip_out_mono )
+		{
+			out [i] = (blip_sample_t) s;
+		}
+		else
+		{
+			out [i * 2] = (blip_sample_t) s;
+			if ( mode == blip_out_both )
+				out [i * 2 + 1] = (blip_sample_t) s;
+		}
+	}
+	*accum_ = accum;
+}
+
+static void read_stereo_scalar( blip_long const* left, blip_long const* right,
+		blip_long const* center, int count, int bass, blip_long accum [3],
+		blip_sample_t* out )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		blip_long l = (accum [0] + accum [2]) >> blip_read_shift;
+		blip_long r = (accum [1] + accum [2]) >> blip_read_shift;
+		accum [0] -= accum [0] >> bass;
+		accum [0] += left [i];
+		accum [1] -= accum [1] >> bass;
+		accum [1] += right [i];
+		accum [2] -= accum [2] >> bass;
+		accum [2] += center [i];
+		BLIP_CLAMP( l, l );
+		BLIP_CLAMP( r, r );
+		out [i * 2]     = (blip_sample_t) l;
+		out [i * 2 + 1] = (blip_sample_t) r;
+	}
+}
+
+static void mix_effect_scalar( blip_long const* in, int count, int bass, blip_long* accum_,
+		blip_long const vol [2], blip_long* out )
+{
+	blip_long accum = *accum_;
+	for ( int i = 0; i < count; i++ )
+	{
+		blip_long s = accum >> blip_read_shift;
+		accum -= accum >> bass;
+		accum += in [i];
+		out [i * 2]     += s * vol [0];
+		out [i * 2 + 1] += s * vol [1];
+	}
+	*accum_ = accum;
+}
+
+static void clamp_scalar( blip_long const* in, int count, int shift, blip_sample_t* out )
+{
+	for ( int i = 0; i < count; i++ )
+	{
+		blip_long s = in [i] >> shift;
+		BLIP_CLAMP( s, s );
+		out [i] = (blip_sample_t) s;
+	}
+}
+
+#ifdef BLIP_SSE2
+
+static void read_mono_sse2( blip_long const* in, int count, int bass, blip_long* accum_,
+		blip_sample_t* out, blip_simd_out_t mode )
+{
+	__m128i const zero = _mm_setzero_si128();
+	__m128i const right = _mm_set1_epi32( (int) 0xFFFF0000 );
+	blip_long accum = *accum_;
+	int i = 0;
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		blip_long a [4];
+		BLIP_SIMD_STEP4( a, accum, (in + i), bass );
+		__m128i s = _mm_srai_epi32( _mm_set_epi32( a [3], a [2], a [1], a [0] ), blip_read_shift );
+		__m128i p = _mm_packs_epi32( s, s );
+		if ( mode == blip_out_mono )
+		{
+			_mm_storel_epi64( (__m128i*) (out + i), p );
+		}
+		else if ( mode == blip_out_both )
+		{
+			_mm_storeu_si128( (__m128i*) (out + i * 2), _mm_unpacklo_epi16( p, p ) );
+		}
+		else
+		{
+			__m128i* o = (__m128i*) (out + i * 2);
+			__m128i keep = _mm_and_si128( _mm_loadu_si128( o ), right );
+			_mm_storeu_si128( o, _mm_or_si128( keep, _mm_unpacklo_epi16( p, zero ) ) );
+		}
+	}
+	*accum_ = accum;
+	read_mono_scalar( in + i, count - i, bass, accum_,
+			out + (mode == blip_out_mono ? i : i * 2), mode );
+}
+
+static void read_stereo_sse2( blip_long const* left, blip_long const* right,
+		blip_long const* center, int count, int bass, blip_long accum [3],
+		blip_sample_t* out )
+{
+	__m128i const zero = _mm_setzero_si128();
+	__m128i const shift = _mm_cvtsi32_si128( bass );
+	// lanes: left, right, center, unused
+	__m128i acc = _mm_set_epi32( 0, accum [2], accum [1], accum [0] );
+	int i = 0;
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		__m128i l = _mm_loadu_si128( (__m128i const*) (left   + i) );
+		__m128i r = _mm_loadu_si128( (__m128i const*) (right  + i) );
+		__m128i c = _mm_loadu_si128( (__m128i const*) (center + i) );
+
+		// transpose to one vector of (left, right, center, 0) per sample
+		__m128i lr_lo = _mm_unpacklo_epi32( l, r );
+		__m128i lr_hi = _mm_unpackhi_epi32( l, r );
+		__m128i c_lo  = _mm_unpacklo_epi32( c, zero );
+		__m128i c_hi  = _mm_unpackhi_epi32( c, zero );
+		__m128i t [4];
+		t [0] = _mm_unpacklo_epi64( lr_lo, c_lo );
+		t [1] = _mm_unpackhi_epi64( lr_lo, c_lo );
+		t [2] = _mm_unpacklo_epi64( lr_hi, c_hi );
+		t [3] = _mm_unpackhi_epi64( lr_hi, c_hi );
+
+		__m128i sum [4];
+		for ( int n = 0; n < 4; n++ )
+		{
+			sum [n] = _mm_add_epi32( acc, _mm_shuffle_epi32( acc, _MM_SHUFFLE( 2, 2, 2, 2 ) ) );
+			acc = _mm_add_epi32( _mm_sub_epi32( acc, _mm_sra_epi32( acc, shift ) ), t [n] );
+		}
+
+		__m128i s01 = _mm_srai_epi32( _mm_unpacklo_epi64( sum [0], sum [1] ), blip_read_shift );
+		__m128i s23 = _mm_srai_epi32( _mm_unpacklo_epi64( sum [2], sum [3] ), blip_read_shift );
+		_mm_storeu_si128( (__m128i*) (out + i * 2), _mm_packs_epi32( s01, s23 ) );
+	}
+	accum [0] = _mm_cvtsi128_si32( acc );
+	accum [1] = _mm_cvtsi128_si32( _mm_srli_si128( acc, 4 ) );
+	accum [2] = _mm_cvtsi128_si32( _mm_srli_si128( acc, 8 ) );
+	read_stereo_scalar( left + i, right + i, center + i, count - i, bass, accum, out + i * 2 );
+}
+
+static void mix_samples_sse2( blip_long* out, blip_sample_t const* in, int count )
+{
+	__m128i prev = _mm_setzero_si128();
+	int i = 0;
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		__m128i x = _mm_loadl_epi64( (__m128i const*) (in + i) );
+		__m128i s = _mm_slli_epi32( _mm_srai_epi32( _mm_unpacklo_epi16( x, x ), 16 ), blip_read_shift );
+		// (previous sample, s [0], s [1], s [2])
+		__m128i p = _mm_or_si128( _mm_slli_si128( s, 4 ), _mm_srli_si128( prev, 12 ) );
+		__m128i* o = (__m128i*) (out + i);
+		_mm_storeu_si128( o, _mm_add_epi32( _mm_loadu_si128( o ), _mm_sub_epi32( s, p ) ) );
+		prev = s;
+	}
+	blip_long last = _mm_cvtsi128_si32( _mm_srli_si128( prev, 12 ) );
+	for ( ; i < count; i++ )
+	{
+		blip_long s = (blip_long) in [i] << blip_read_shift;
+		out [i] += s - last;
+		last = s;
+	}
+	out [count] -= last;
+}
+
+// Low 32 bits of the products, which SSE2 only has for unsigned pairs
+static inline __m128i mullo_sse2( __m128i a, __m128i b )
+{
+	__m128i even = _mm_mul_epu32( a, b );
+	__m128i odd  = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) );
+	return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+			_mm_shuffle_epi32( odd, _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+}
+
+static void mix_effect_sse2( blip_long const* in, int count, int bass, blip_long* accum_,
+		blip_long const vol [2], blip_long* out )
+{
+	__m128i const vols = _mm_set_epi32( vol [1], vol [0], vol [1], vol [0] );
+	blip_long accum = *accum_;
+	int i = 0;
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		blip_long a [4];
+		BLIP_SIMD_STEP4( a, accum, (in + i), bass );
+		__m128i s = _mm_srai_epi32( _mm_set_epi32( a [3], a [2], a [1], a [0] ), blip_read_shift );
+		__m128i* o = (__m128i*) (out + i * 2);
+		_mm_storeu_si128( o,     _mm_add_epi32( _mm_loadu_si128( o ),
+				mullo_sse2( _mm_unpacklo_epi32( s, s ), vols ) ) );
+		_mm_storeu_si128( o + 1, _mm_add_epi32( _mm_loadu_si128( o + 1 ),
+				mullo_sse2( _mm_unpackhi_epi32( s, s ), vols ) ) );
+	}
+	*accum_ = accum;
+	mix_effect_scalar( in + i, count - i, bass, accum_, vol, out + i * 2 );
+}
+
+static void clamp_sse2( blip_long const* in, int count, int shift, blip_sample_t* out )
+{
+	__m128i const n = _mm_cvtsi32_si128( shift );
+	int i = 0;
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		__m128i a = _mm_sra_epi32( _mm_loadu_si128( (__m128i const*) (in + i) ), n );
+		__m128i b = _mm_sra_epi32( _mm_loadu_si128( (__m128i const*) (in + i + 4) ), n );
+		_mm_storeu_si128( (__m128i*) (out + i), _mm_packs_epi32( a, b ) );
+	}
+	clamp_scalar( in + i, count - i, shift, out + i );
+}
+
+static blip_simd_t const blip_simd_sse2 = {
+	read_mono_sse2,
+	read_stereo_sse2,
+	mix_samples_sse2,
+	mix_effect_sse2,
+	clamp_sse2
+};
+
+static bool blip_has_sse2()
+{
+	#if defined (_M_X64) || defined (__x86_64__)
+		return true;
+	#elif defined (_MSC_VER)
+		int info [4];
+		__cpuid( info, 1 );
+		return (info [3] & (1 << 26)) != 0;
+	#else
+		unsigned int eax, ebx, ecx, edx;
+		if ( !__get_cpuid( 1, &eax, &ebx, &ecx, &edx ) )
+			return false;
+		return (edx & (1 << 26)) != 0;
+	#endif
+}
+
+#endif // BLIP_SSE2
+
+#ifdef BLIP_NEON
+
+static void read_mono_neon( blip_long const* in, int count, int bass, blip_long* accum_,
+		blip_sample_t* out, blip_simd_out_t mode )
+{
+	blip_long accum = *accum_;
+	int i = 0;
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		int32_t a [4];
+		BLIP_SIMD_STEP4( a, accum, (in + i), bass );
+		int16x4_t p = vqmovn_s32( vshrq_n_s32( vld1q_s32( a ), blip_read_shift ) );
+		if ( mode == blip_out_mono )
+		{
+			vst1_s16( out + i, p );
+		}
+		else if ( mode == blip_out_both )
+		{
+			int16x4x2_t z = vzip_s16( p, p );
+			vst1q_s16( out + i * 2, vcombine_s16( z.val [0], z.val [1] ) );
+		}
+		else
+		{
+			int16x4x2_t o = vld2_s16( out + i * 2 );
+			o.val [0] = p;
+			vst2_s16( out + i * 2, o );
+		}
+	}
+	*accum_ = accum;
+	read_mono_scalar( in + i, count - i, bass, accum_,
+			out + (mode == blip_out_mono ? i : i * 2), mode );
+}
+
+static void read_stereo_neon( blip_long const* left, blip_long const* right,
+		blip_long const* center, int count, int bass, blip_long accum [3],
+		blip_sample_t* out )
+{
+	int32x4_t const zero = vdupq_n_s32( 0 );
+	int32x4_t const shift = vdupq_n_s32( -bass );
+	// lanes: left, right, center, unused
+	int32_t init [4] = { accum [0], accum [1], accum [2], 0 };
+	int32x4_t acc = vld1q_s32( init );
+	int i = 0;
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		// transpose to one vector of (left, right, center, 0) per sample
+		int32x4x2_t lr = vzipq_s32( vld1q_s32( (int32_t const*) left + i ), vld1q_s32( (int32_t const*) right + i ) );
+		int32x4x2_t cz = vzipq_s32( vld1q_s32( (int32_t const*) center + i ), zero );
+		int32x4_t t [4];
+		t [0] = vcombine_s32( vget_low_s32 ( lr.val [0] ), vget_low_s32 ( cz.val [0] ) );
+		t [1] = vcombine_s32( vget_high_s32( lr.val [0] ), vget_high_s32( cz.val [0] ) );
+		t [2] = vcombine_s32( vget_low_s32 ( lr.val [1] ), vget_low_s32 ( cz.val [1] ) );
+		t [3] = vcombine_s32( vget_high_s32( lr.val [1] ), vget_high_s32( cz.val [1] ) );
+
+		int32x2_t sum [4];
+		for ( int n = 0; n < 4; n++ )
+		{
+			sum [n] = vadd_s32( vget_low_s32( acc ), vdup_lane_s32( vget_high_s32( acc ), 0 ) );
+			acc = vaddq_s32( vsubq_s32( acc, vshlq_s32( acc, shift ) ), t [n] );
+		}
+
+		int16x4_t p01 = vqmovn_s32( vshrq_n_s32( vcombine_s32( sum [0], sum [1] ), blip_read_shift ) );
+		int16x4_t p23 = vqmovn_s32( vshrq_n_s32( vcombine_s32( sum [2], sum [3] ), blip_read_shift ) );
+		vst1q_s16( out + i * 2, vcombine_s16( p01, p23 ) );
+	}
+	accum [0] = vgetq_lane_s32( acc, 0 );
+	accum [1] = vgetq_lane_s32( acc, 1 );
+	accum [2] = vgetq_lane_s32( acc, 2 );
+	read_stereo_scalar( left + i, right + i, center + i, count - i, bass, accum, out + i * 2 );
+}
+
+static void mix_samples_neon( blip_long* out, blip_sample_t const* in, int count )
+{
+	int32x4_t prev = vdupq_n_s32( 0 );
+	int i = 0;
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		int32x4_t s = vshlq_n_s32( vmovl_s16( vld1_s16( in + i ) ), blip_read_shift );
+		// (previous sample, s [0], s [1], s [2])
+		int32x4_t p = vextq_s32( prev, s, 3 );
+		vst1q_s32( (int32_t*) out + i, vaddq_s32( vld1q_s32( (int32_t*) out + i ), vsubq_s32( s, p ) ) );
+		prev = s;
+	}
+	blip_long last = vgetq_lane_s32( prev, 3 );
+	for ( ; i < count; i++ )
+	{
+		blip_long s = (blip_long) in [i] << blip_read_shift;
+		out [i] += s - last;
+		last = s;
+	}
+	out [count] -= last;
+}
+
+static void mix_effect_neon( blip_long const* in, int count, int bass, blip_long* accum_,
+		blip_long const vol [2], blip_long* out )
+{
+	int32x2_t const v = vld1_s32( (int32_t const*) vol );
+	int32x4_t const vols = vcombine_s32( v, v );
+	blip_long accum = *accum_;
+	int i = 0;
+	for ( ; i + 4 <= count; i += 4 )
+	{
+		int32_t a [4];
+		BLIP_SIMD_STEP4( a, accum, (in + i), bass );
+		int32x4_t s = vshrq_n_s32( vld1q_s32( a ), blip_read_shift );
+		int32x4x2_t ss = vzipq_s32( s, s );
+		int32_t* o = (int32_t*) out + i * 2;
+		vst1q_s32( o,     vmlaq_s32( vld1q_s32( o ),     ss.val [0], vols ) );
+		vst1q_s32( o + 4, vmlaq_s32( vld1q_s32( o + 4 ), ss.val [1], vols ) );
+	}
+	*accum_ = accum;
+	mix_effect_scalar( in + i, count - i, bass, accum_, vol, out + i * 2 );
+}
+
+static void clamp_neon( blip_long const* in, int count, int shift, blip_sample_t* out )
+{
+	int32x4_t const n = vdupq_n_s32( -shift );
+	int i = 0;
+	for ( ; i + 8 <= count; i += 8 )
+	{
+		int16x4_t a = vqmovn_s32( vshlq_s32( vld1q_s32( (int32_t const*) in + i ), n ) );
+		int16x4_t b = vqmovn_s32( vshlq_s32( vld1q_s32( (int32_t const*) in + i + 4 ), n ) );
+		vst1q_s16( out + i, vcombine_s16( a, b ) );
+	}
+	clamp_scalar( in + i, count - i, shift, out + i );
+}
+
+static blip_simd_t const blip_simd_neon = {
+	read_mono_neon,
+	read_stereo_neon,
+	mix_samples_neon,
+	mix_effect_neon,
+	clamp_neon
+};
+
+#endif // BLIP_NEON
+
+static blip_simd_t const* blip_simd_detect()
+{
+	#ifdef BLIP_NEON
+		return &blip_simd_neon;
+	#endif
+	#ifdef BLIP_SSE2
+		if ( blip_has_sse2() )
+			return &blip_simd_sse2;
+	#endif
+	return 0;
+}
+
+static blip_simd_t const* const blip_simd_vector = blip_simd_detect();
+
+blip_simd_t const* blip_simd()
+{
+	return blip_simd_enabled ? blip_simd_vector : 0;
+}
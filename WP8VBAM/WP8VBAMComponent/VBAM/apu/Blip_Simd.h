@@ -0,0 +1,54 @@
+// Vector versions of the Blip_Buffer sample loops
+
+#ifndef BLIP_SIMD_H
+#define BLIP_SIMD_H
+
+#include "Blip_Buffer.h"
+
+// The integrator (accum += in - (accum >> bass)) is a recurrence in time, so
+// a single buffer is still integrated one sample at a time; the vector code
+// instead runs the integrators of the stereo buffers side by side and does
+// the shift, clamp and conversion to 16 bits on whole vectors. All versions
+// give the same output as the scalar loops in Blip_Buffer, Multi_Buffer and
+// Effects_Buffer.
+
+// Set to false to use the scalar loops
+extern bool blip_simd_enabled;
+
+enum blip_simd_out_t {
+	blip_out_mono,  // out [i]
+	blip_out_left,  // out [i * 2], leaving out [i * 2 + 1] alone
+	blip_out_both   // out [i * 2] and out [i * 2 + 1]
+};
+
+struct blip_simd_t
+{
+	// Integrates count samples of in and writes them clamped to out
+	void (*read_mono)( blip_long const* in, int count, int bass, blip_long* accum,
+			blip_sample_t* out, blip_simd_out_t mode );
+
+	// Integrates left, right and center and writes count pairs of
+	// (left + center, right + center), clamped, to out. accum holds the
+	// left, right and center integrators.
+	void (*read_stereo)( blip_long const* left, blip_long const* right,
+			blip_long const* center, int count, int bass, blip_long accum [3],
+			blip_sample_t* out );
+
+	// Adds the differences of count samples of in, scaled to the
+	// internal resolution, to out [0] to out [count]
+	void (*mix_samples)( blip_long* out, blip_sample_t const* in, int count );
+
+	// Integrates count samples of in and adds each one times vol [0] and
+	// vol [1] to a pair of out
+	void (*mix_effect)( blip_long const* in, int count, int bass, blip_long* accum,
+			blip_long const vol [2], blip_long* out );
+
+	// Writes count samples of in >> shift, clamped, to out
+	void (*clamp)( blip_long const* in, int count, int shift, blip_sample_t* out );
+};
+
+// Vector loops for this CPU, or NULL if there are none or blip_simd_enabled
+// is false
+blip_simd_t const* blip_simd();
+
+#endif
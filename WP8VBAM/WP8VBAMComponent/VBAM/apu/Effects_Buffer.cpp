@@ -1,6 +1,7 @@
 // Game_Music_Emu $vers. http://www.slack.net/~ant/
 
 #include "Effects_Buffer.h"
+#include "Blip_Simd.h"
 
 #include <string.h>
 
@@ -495,6 +496,8 @@ void Effects_Buffer::mix_effects( blip_sample_t* out_, int pair_count )
 {
 	typedef fixed_t stereo_fixed_t [stereo];
 
+	blip_simd_t const* const simd = blip_simd();
+
 	// add channels with echo, do echo, add channels without echo, then convert to 16-bit and output
 	int echo_phase = 1;
 	do
@@ -521,6 +524,15 @@ void Effects_Buffer::mix_effects( blip_sample_t* out_, int pair_count )
 					do
 					{
 						remain -= count;
+						if ( simd )
+						{
+							simd->mix_effect( in_reader_buf, count, bass, &in_reader_accum,
+									buf->vol, out [0] );
+							BLIP_READER_ADJ_( in, count );
+							out = (stereo_fixed_t*) echo.begin();
+							count = remain;
+							continue;
+						}
 						BLIP_READER_ADJ_( in, count );
 
 						out += count;
@@ -614,6 +626,14 @@ void Effects_Buffer::mix_effects( blip_sample_t* out_, int pair_count )
 		do
 		{
 			remain -= count;
+			if ( simd )
+			{
+				simd->clamp( in [0], count * stereo, fixed_shift, out [0] );
+				in  = (stereo_fixed_t*) echo.begin();
+				out += count;
+				count = remain;
+				continue;
+			}
 			in  += count;
 			out += count;
 			int offset = -count;
@@ -1,6 +1,7 @@
 // Blip_Buffer 0.4.1. http://www.slack.net/~ant/
 
 #include "Multi_Buffer.h"
+#include "Blip_Simd.h"
 
 /* Copyright (C) 2003-2007 Shay Green. This module is free software; you
 can redistribute it and/or modify it under the terms of the GNU Lesser
@@ -220,6 +221,14 @@ void Stereo_Mixer::mix_mono( blip_sample_t* out_, int count )
 	BLIP_READER_BEGIN( center, *bufs [2] );
 	BLIP_READER_ADJ_( center, samples_read );
 
+	if ( blip_simd_t const* simd = blip_simd() )
+	{
+		simd->read_mono( center_reader_buf - count, count, bass, &center_reader_accum,
+				out_, blip_out_both );
+		BLIP_READER_END( center, *bufs [2] );
+		return;
+	}
+
 	typedef blip_sample_t stereo_blip_sample_t [stereo];
 	stereo_blip_sample_t* BLIP_RESTRICT out = (stereo_blip_sample_t*) out_ + count;
 	int offset = -count;
@@ -239,6 +248,28 @@ void Stereo_Mixer::mix_mono( blip_sample_t* out_, int count )
 
 void Stereo_Mixer::mix_stereo( blip_sample_t* out_, int count )
 {
+	if ( blip_simd_t const* simd = blip_simd() )
+	{
+		// all three integrators at once, rather than center once per side
+		int const bass = BLIP_READER_BASS( *bufs [2] );
+		BLIP_READER_BEGIN( left,   *bufs [0] );
+		BLIP_READER_BEGIN( right,  *bufs [1] );
+		BLIP_READER_BEGIN( center, *bufs [2] );
+
+		blip_long accum [3] = { left_reader_accum, right_reader_accum, center_reader_accum };
+		int const start = samples_read - count;
+		simd->read_stereo( left_reader_buf + start, right_reader_buf + start,
+				center_reader_buf + start, count, bass, accum, out_ );
+		left_reader_accum   = accum [0];
+		right_reader_accum  = accum [1];
+		center_reader_accum = accum [2];
+
+		BLIP_READER_END( left,   *bufs [0] );
+		BLIP_READER_END( right,  *bufs [1] );
+		BLIP_READER_END( center, *bufs [2] );
+		return;
+	}
+
 	blip_sample_t* BLIP_RESTRICT out = out_ + count * stereo;
 
 	// do left + center and right + center separately to reduce register load
@@ -0,0 +1,111 @@
+#include "AudioQueue.h"
+
+#include <string.h>
+
+AudioQueue::AudioQueue()
+	: targetFrames(1), discarding(false)
+{
+	init(44100, 50);
+}
+
+void AudioQueue::init(long sampleRate, int latency)
+{
+	targetFrames = (int)(sampleRate * latency / 1000);
+	if(targetFrames < 1)
+		targetFrames = 1;
+	ring.reset(targetFrames * 4 * 2);
+
+	discarding = false;
+	current[0] = current[1] = 0;
+	next[0] = next[1] = 0;
+	position = 0;
+	drift = 0;
+	blockPos = blockLen = 0;
+}
+
+int AudioQueue::space() const
+{
+	return (int)(ring.avail() / 2);
+}
+
+int AudioQueue::queued() const
+{
+	return (int)(ring.used() / 2);
+}
+
+int AudioQueue::write(const u16 *samples, int frames)
+{
+	int free = space();
+	if(frames > free)
+		frames = free;
+	if(frames > 0)
+		ring.write(samples, frames * 2);
+	return frames;
+}
+
+void AudioQueue::discard()
+{
+	discarding = true;
+}
+
+bool AudioQueue::pop(s16 *frame)
+{
+	if(blockPos == blockLen) {
+		int frames = queued();
+		if(frames == 0)
+			return false;
+		if(frames > (int)(sizeof(block) / sizeof(block[0]) / 2))
+			frames = sizeof(block) / sizeof(block[0]) / 2;
+		ring.read(block, frames * 2);
+		blockPos = 0;
+		blockLen = frames * 2;
+	}
+	frame[0] = (s16)block[blockPos++];
+	frame[1] = (s16)block[blockPos++];
+	return true;
+}
+
+void AudioQueue::read(s16 *out, int frames)
+{
+	if(discarding) {
+		int samples;
+		while((samples = (int)ring.used()) > 0) {
+			if(samples > (int)(sizeof(block) / sizeof(block[0])))
+				samples = sizeof(block) / sizeof(block[0]);
+			ring.read(block, samples);
+		}
+		blockPos = blockLen = 0;
+		discarding = false;
+	}
+
+	// proportional-integral control of the rate around the target latency;
+	// the integral term absorbs a steady clock mismatch between the core
+	// and the device so the fill level ends up on the target
+	int fill = queued() + (blockLen - blockPos) / 2;
+	double error = (double)(fill - targetFrames) / targetFrames;
+	drift += AUDIO_QUEUE_MAX_DRIFT * error / 256;
+	if(drift > AUDIO_QUEUE_MAX_DRIFT)
+		drift = AUDIO_QUEUE_MAX_DRIFT;
+	else if(drift < -AUDIO_QUEUE_MAX_DRIFT)
+		drift = -AUDIO_QUEUE_MAX_DRIFT;
+	double rate = drift + AUDIO_QUEUE_MAX_DRIFT * error;
+	if(rate > AUDIO_QUEUE_MAX_DRIFT)
+		rate = AUDIO_QUEUE_MAX_DRIFT;
+	else if(rate < -AUDIO_QUEUE_MAX_DRIFT)
+		rate = -AUDIO_QUEUE_MAX_DRIFT;
+	u32 step = (u32)(65536.0 * (1.0 + rate));
+
+	for(int i = 0; i < frames; i++) {
+		while(position >= 0x10000) {
+			current[0] = next[0];
+			current[1] = next[1];
+			pop(next);
+			position -= 0x10000;
+		}
+		// 15-bit weight so the product fits in an int
+		int frac = (int)(position >> 1);
+		*out++ = (s16)(current[0] + (((next[0] - current[0]) * frac) >> 15));
+		*out++ = (s16)(current[1] + (((next[1] - current[1]) * frac) >> 15));
+		position += step;
+	}
+}
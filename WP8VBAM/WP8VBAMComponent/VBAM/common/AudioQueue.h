@@ -0,0 +1,68 @@
+#ifndef AUDIOQUEUE_H
+#define AUDIOQUEUE_H
+
+#include "Types.h"
+#include "RingBuffer.h"
+
+#include <atomic>
+
+// Largest playback rate change used to hold the latency target: 0.5% is
+// well under an audible pitch change.
+#define AUDIO_QUEUE_MAX_DRIFT 0.005
+
+/**
+ * Stereo sample queue between the emulation thread and an audio output.
+ *
+ * The core pushes whatever samples it has with write(); the output pulls
+ * exactly the number of frames the device wants with read(), on its own
+ * thread. read() resamples with a rate that is nudged by up to
+ * AUDIO_QUEUE_MAX_DRIFT, so the amount of queued audio settles at the
+ * target latency: the queue drains a little faster while the core runs
+ * ahead and a little slower while it falls behind, instead of dropping or
+ * repeating whole blocks.
+ */
+class AudioQueue
+{
+public:
+	AudioQueue();
+
+	/**
+	 * Set up the queue. It holds up to four times the target latency.
+	 * @param latency Target amount of queued audio in milliseconds
+	 */
+	void init(long sampleRate, int latency);
+
+	// Producer side. Returns the number of frames queued, which is less
+	// than frames if the queue is full.
+	int write(const u16 *samples, int frames);
+	int space() const;
+	// Ask the consumer to drop everything queued so far.
+	void discard();
+
+	// Consumer side. Always produces frames stereo frames; once the queue
+	// runs dry the last sample is held.
+	void read(s16 *out, int frames);
+
+	int queued() const;
+	int target() const { return targetFrames; }
+
+private:
+	bool pop(s16 *frame);
+
+	RingBuffer<u16> ring;
+	int targetFrames;
+	std::atomic<bool> discarding;
+
+	// consumer state: the two input frames being interpolated, the 16.16
+	// position between them, the integral of the rate control and a block
+	// of frames read from the ring
+	s16 current[2];
+	s16 next[2];
+	u32 position;
+	double drift;
+	u16 block[512];
+	int blockPos;
+	int blockLen;
+};
+
+#endif // AUDIOQUEUE_H
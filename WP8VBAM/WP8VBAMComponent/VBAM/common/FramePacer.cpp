@@ -0,0 +1,114 @@
+#include "FramePacer.h"
+
+#include <string.h>
+
+// Weight of the newest frame in the average cost
+#define COST_SMOOTHING 0.125f
+// Skip cycles to measure before the skip changes again
+#define SETTLE_CYCLES 8
+
+FramePacer::FramePacer()
+	: framePeriod(1.0f / 60.0f), requestedRange(2 << 16), minSkip(0),
+	  maxSkip(2), frameSkip(0)
+{
+	reset();
+}
+
+void FramePacer::reset()
+{
+	memset(&stats, 0, sizeof(stats));
+	stats.fill = -1.0f;
+	stats.frameSkip = frameSkip;
+	settle = 0;
+}
+
+void FramePacer::setFramePeriod(float seconds)
+{
+	framePeriod = seconds;
+}
+
+void FramePacer::setFrameSkipRange(int minSkip, int maxSkip)
+{
+	if(maxSkip < minSkip)
+		maxSkip = minSkip;
+	requestedRange.store((maxSkip << 16) | (minSkip & 0xffff));
+}
+
+// Called on the emulation thread, which owns everything but requestedRange
+void FramePacer::applyFrameSkipRange()
+{
+	int range = requestedRange.load();
+	minSkip = range & 0xffff;
+	maxSkip = range >> 16;
+
+	if(frameSkip < minSkip)
+		frameSkip = minSkip;
+	if(frameSkip > maxSkip)
+		frameSkip = maxSkip;
+	stats.frameSkip = frameSkip;
+}
+
+void FramePacer::frameDone(float cost, float fill)
+{
+	applyFrameSkipRange();
+
+	// a frame much longer than the period is a stall (loading a state,
+	// the thread being descheduled) rather than what frames cost
+	if(cost < 0.0f)
+		cost = 0.0f;
+	if(cost > framePeriod * 4)
+		cost = framePeriod * 4;
+
+	if(stats.frames == 0)
+		stats.averageCost = cost;
+	else
+		stats.averageCost += (cost - stats.averageCost) * COST_SMOOTHING;
+	stats.frames++;
+
+	stats.fill = fill;
+	if(fill == 0.0f)
+		stats.underruns++;
+
+	if(settle > 0) {
+		settle--;
+		return;
+	}
+
+	bool behind, ahead;
+	if(fill >= 0.0f) {
+		// running ahead refills the queue as long as a frame takes less
+		// than a period; only skip drawing once it does not
+		behind = fill < FRAME_PACER_LOW_FILL &&
+			stats.averageCost > framePeriod * 0.9f;
+		ahead = fill >= 1.0f && stats.averageCost < framePeriod * 0.75f;
+	} else {
+		behind = stats.averageCost > framePeriod;
+		ahead = stats.averageCost < framePeriod * 0.75f;
+	}
+
+	if(behind && frameSkip < maxSkip)
+		frameSkip++;
+	else if(ahead && frameSkip > minSkip)
+		frameSkip--;
+	else
+		return;
+
+	stats.frameSkip = frameSkip;
+	settle = (frameSkip + 1) * SETTLE_CYCLES;
+}
+
+FramePacerAction FramePacer::frameDrawn()
+{
+	stats.drawn++;
+
+	if(stats.fill >= 0.0f && stats.fill < FRAME_PACER_LOW_FILL) {
+		stats.ranAhead++;
+		return PACE_RUN_AHEAD;
+	}
+	if(stats.fill > FRAME_PACER_HIGH_FILL) {
+		stats.slept++;
+		return PACE_SLEEP;
+	}
+	stats.waited++;
+	return PACE_WAIT;
+}
@@ -0,0 +1,98 @@
+#ifndef FRAMEPACER_H
+#define FRAMEPACER_H
+
+#include "Types.h"
+
+#include <atomic>
+
+// Audio fill, relative to the latency target, below which the emulation
+// is falling behind the output and above which it is too far ahead.
+#define FRAME_PACER_LOW_FILL  0.5f
+#define FRAME_PACER_HIGH_FILL 1.5f
+
+// What the emulation thread does after drawing a frame
+enum FramePacerAction
+{
+	PACE_WAIT,       // wait for the display refresh
+	PACE_RUN_AHEAD,  // start the next frame at once, the audio is running low
+	PACE_SLEEP       // wait for the display refresh and up to one frame more
+};
+
+struct FramePacerStats
+{
+	u32 frames;         // frames emulated since the last reset
+	u32 drawn;          // frames drawn; the others were skipped
+	u32 waited;         // drawn frames followed by PACE_WAIT
+	u32 ranAhead;       // drawn frames followed by PACE_RUN_AHEAD
+	u32 slept;          // drawn frames followed by PACE_SLEEP
+	u32 underruns;      // frames that found the audio queue empty
+	float averageCost;  // seconds spent emulating a frame, smoothed
+	float fill;         // last audio fill, negative if unknown
+	int frameSkip;      // frames currently skipped after each drawn one
+};
+
+/**
+ * Decides how the emulation thread keeps up with the audio output.
+ *
+ * The audio queue is the clock: as long as its fill stays near the latency
+ * target the sound plays without gaps, whatever the display does. After
+ * every frame the pacer is given the time spent emulating it and the fill,
+ * and from those picks
+ *  - the number of frames not drawn after each drawn one, raised while the
+ *    audio runs low and a frame costs about a whole frame period, and
+ *    lowered again once the queue is back on target;
+ *  - whether a drawn frame waits for the display refresh, runs straight
+ *    into the next frame to refill the queue, or sleeps a little longer
+ *    because the queue is well ahead.
+ * Without a fill (no sound, or a driver with no queue) the skip follows
+ * the frame cost alone and drawn frames always wait.
+ */
+class FramePacer
+{
+public:
+	FramePacer();
+
+	// Forget the statistics and the measured cost, e.g. after a pause.
+	void reset();
+
+	// Length of one emulated frame in seconds
+	void setFramePeriod(float seconds);
+	float getFramePeriod() const { return framePeriod; }
+
+	// Range the frame skip is chosen from; setting both to the same value
+	// gives a fixed skip. Safe to call from any thread: the emulation thread
+	// picks the range up in its next frameDone().
+	void setFrameSkipRange(int minSkip, int maxSkip);
+
+	/**
+	 * Account for an emulated frame.
+	 * @param cost Seconds spent emulating it, not counting waits
+	 * @param fill Audio queued relative to the latency target, or a
+	 *             negative value if unknown
+	 */
+	void frameDone(float cost, float fill);
+
+	// Called for drawn frames; returns what to do before the next one.
+	FramePacerAction frameDrawn();
+
+	// Frames to skip after each drawn one, for systemFrameSkip
+	int getFrameSkip() const { return frameSkip; }
+
+	const FramePacerStats &getStats() const { return stats; }
+
+private:
+	void applyFrameSkipRange();
+
+	float framePeriod;
+	// the range last set, minSkip in the low and maxSkip in the high 16 bits
+	std::atomic<int> requestedRange;
+	int minSkip;
+	int maxSkip;
+	int frameSkip;
+	// frames left before the skip may change again, so that the cost of a
+	// whole skip cycle is measured first
+	int settle;
+	FramePacerStats stats;
+};
+
+#endif // FRAMEPACER_H
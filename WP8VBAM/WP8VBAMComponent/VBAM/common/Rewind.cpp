@@ -0,0 +1,298 @@
+#include "Rewind.h"
+#include "../System.h"
+#include "../Util.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+struct RewindEntry {
+  size_t offset;
+  size_t length;
+};
+
+// The history of one core instance, with the worker thread encoding it.
+struct RewindHistory {
+  EmulatedSystem *system;
+
+  // Deltas, newest at the back, stored back to back in ring.
+  u8 *ring;
+  size_t budget;
+  size_t head;
+  size_t used;
+  std::deque<RewindEntry> entries;
+
+  // base is the newest state, which the next delta is taken against.
+  // pending is filled by the emulation thread and swapped with work by the
+  // worker, so a capture only waits when the encoder is a whole frame behind.
+  u8 *base;
+  long baseSize;
+  u8 *work;
+  u8 *pending;
+  long pendingSize;
+  bool pendingFull;
+  bool busy;
+  bool quit;
+  u8 *delta;
+
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable idle;
+  std::thread thread;
+};
+
+static CORE_LOCAL RewindHistory *rewindHistory = NULL;
+
+// A delta is the XOR of two states coded as runs of 32-bit words: a count of
+// unchanged words, a count of literal words and the literals. A literal run
+// only ends on two unchanged words in a row, so the output is at most two
+// words longer than the state.
+static size_t rewindEncode(const u32 *cur, const u32 *prev, int words, u32 *out)
+{
+  u32 *o = out;
+  int i = 0;
+  while(i < words) {
+    int start = i;
+    while(i < words && cur[i] == prev[i])
+      i++;
+    u32 *run = o;
+    o += 2;
+    run[0] = i - start;
+    start = i;
+    while(i < words) {
+      if(cur[i] == prev[i] && (i + 1 == words || cur[i + 1] == prev[i + 1]))
+        break;
+      *o++ = cur[i] ^ prev[i];
+      i++;
+    }
+    run[1] = i - start;
+  }
+  return (o - out) * sizeof(u32);
+}
+
+static void rewindDecode(const u32 *in, size_t length, u32 *state)
+{
+  const u32 *end = in + length / sizeof(u32);
+  while(in < end) {
+    state += in[0];
+    u32 count = in[1];
+    in += 2;
+    while(count--)
+      *state++ ^= *in++;
+  }
+}
+
+static void rewindClear(RewindHistory *h)
+{
+  h->entries.clear();
+  h->head = 0;
+  h->used = 0;
+}
+
+// Called with h->mutex held.
+static void rewindStore(RewindHistory *h, const u8 *delta, size_t length)
+{
+  if(length > h->budget) {
+    // the older deltas cannot be reached without this one
+    rewindClear(h);
+    return;
+  }
+
+  size_t offset = h->head;
+  if(offset + length > h->budget)
+    offset = 0;
+
+  // drop the oldest entries up to the newest one the delta overwrites
+  size_t drop = 0;
+  for(size_t i = h->entries.size(); i > 0; i--) {
+    const RewindEntry &entry = h->entries[i - 1];
+    if(entry.offset < offset + length && offset < entry.offset + entry.length) {
+      drop = i;
+      break;
+    }
+  }
+  while(drop--) {
+    h->used -= h->entries.front().length;
+    h->entries.pop_front();
+  }
+
+  memcpy(h->ring + offset, delta, length);
+  RewindEntry entry = { offset, length };
+  h->entries.push_back(entry);
+  h->head = offset + length;
+  h->used += length;
+}
+
+static void rewindWorker(RewindHistory *h)
+{
+  std::unique_lock<std::mutex> lock(h->mutex);
+  for(;;) {
+    h->wake.wait(lock, [h] { return h->pendingFull || h->quit; });
+    if(h->quit)
+      break;
+
+    std::swap(h->pending, h->work);
+    long size = h->pendingSize;
+    h->pendingFull = false;
+    h->busy = true;
+    h->idle.notify_all();
+    lock.unlock();
+
+    // a state of another size starts a new history
+    bool chained = size == h->baseSize;
+    size_t length = 0;
+    if(chained)
+      length = rewindEncode((const u32 *)h->work, (const u32 *)h->base,
+                            (size + 3) / 4, (u32 *)h->delta);
+
+    lock.lock();
+    if(chained)
+      rewindStore(h, h->delta, length);
+    else
+      rewindClear(h);
+    std::swap(h->work, h->base);
+    h->baseSize = size;
+    h->busy = false;
+    h->idle.notify_all();
+  }
+}
+
+// Waits until the worker has taken in every capture.
+static void rewindWaitIdle(RewindHistory *h, std::unique_lock<std::mutex> &lock)
+{
+  h->idle.wait(lock, [h] { return !h->pendingFull && !h->busy; });
+}
+
+bool rewindInit(EmulatedSystem *system, size_t budget)
+{
+  rewindCleanUp();
+
+  RewindHistory *h = new RewindHistory();
+  // states are padded to whole words for the encoder
+  h->ring = (u8 *)malloc(budget);
+  h->base = (u8 *)calloc(1, RAW_STATE_MAX + 4);
+  h->work = (u8 *)calloc(1, RAW_STATE_MAX + 4);
+  h->pending = (u8 *)calloc(1, RAW_STATE_MAX + 4);
+  h->delta = (u8 *)malloc(RAW_STATE_MAX + 4 + 2 * sizeof(u32));
+  rewindHistory = h;
+  if(!h->ring || !h->base || !h->work || !h->pending || !h->delta) {
+    rewindCleanUp();
+    return false;
+  }
+
+  h->budget = budget;
+  h->baseSize = 0;
+  h->pendingFull = false;
+  h->busy = false;
+  h->quit = false;
+  rewindClear(h);
+  h->system = system;
+  h->thread = std::thread(rewindWorker, h);
+  return true;
+}
+
+void rewindCleanUp()
+{
+  RewindHistory *h = rewindHistory;
+  if(h == NULL)
+    return;
+
+  if(h->thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(h->mutex);
+      h->quit = true;
+    }
+    h->wake.notify_one();
+    h->thread.join();
+  }
+
+  free(h->ring);
+  free(h->base);
+  free(h->work);
+  free(h->pending);
+  free(h->delta);
+  delete h;
+  rewindHistory = NULL;
+}
+
+void rewindReset()
+{
+  RewindHistory *h = rewindHistory;
+  if(h == NULL)
+    return;
+  std::unique_lock<std::mutex> lock(h->mutex);
+  rewindWaitIdle(h, lock);
+  rewindClear(h);
+  h->baseSize = 0;
+}
+
+bool rewindCapture()
+{
+  RewindHistory *h = rewindHistory;
+  if(h == NULL)
+    return false;
+
+  {
+    // the worker has not taken the previous frame yet; wait for it rather
+    // than drop this one, so that rewindStep() goes back a single frame
+    std::unique_lock<std::mutex> lock(h->mutex);
+    h->idle.wait(lock, [h] { return !h->pendingFull; });
+  }
+
+  long size = 0;
+  if(!h->system->emuWriteMemState((char *)h->pending, RAW_STATE_MAX, size))
+    return false;
+  memset(h->pending + size, 0, 4);
+
+  {
+    std::lock_guard<std::mutex> lock(h->mutex);
+    h->pendingSize = size;
+    h->pendingFull = true;
+  }
+  h->wake.notify_one();
+  return true;
+}
+
+bool rewindStep()
+{
+  RewindHistory *h = rewindHistory;
+  if(h == NULL)
+    return false;
+
+  std::unique_lock<std::mutex> lock(h->mutex);
+  rewindWaitIdle(h, lock);
+  if(h->entries.empty())
+    return false;
+
+  // the base becomes the state the newest delta was taken against
+  const RewindEntry &entry = h->entries.back();
+  rewindDecode((const u32 *)(h->ring + entry.offset), entry.length,
+               (u32 *)h->base);
+  h->head = entry.offset;
+  h->used -= entry.length;
+  h->entries.pop_back();
+
+  return h->system->emuReadMemState((char *)h->base, h->baseSize);
+}
+
+int rewindCount()
+{
+  RewindHistory *h = rewindHistory;
+  if(h == NULL)
+    return 0;
+  std::lock_guard<std::mutex> lock(h->mutex);
+  return (int)h->entries.size();
+}
+
+size_t rewindSize()
+{
+  RewindHistory *h = rewindHistory;
+  if(h == NULL)
+    return 0;
+  std::lock_guard<std::mutex> lock(h->mutex);
+  return h->used;
+}
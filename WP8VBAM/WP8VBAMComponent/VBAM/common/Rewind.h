@@ -0,0 +1,25 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include "Types.h"
+#include <stddef.h>
+
+struct EmulatedSystem;
+
+// In-memory rewind history. The emulation thread takes an uncompressed
+// memory state once per frame with rewindCapture(); a background thread
+// turns it into an XOR delta against the previous state and keeps the
+// deltas in a ring of budget bytes, dropping the oldest when it is full.
+// No frame is skipped: a capture waits for the worker if it is still on the
+// frame before. rewindStep() goes back one captured frame. Each core instance has a
+// history of its own, with its own worker; call these on its thread.
+bool rewindInit(EmulatedSystem *system, size_t budget);
+void rewindCleanUp();
+// Forget the history, e.g. after a reset or a state was loaded.
+void rewindReset();
+bool rewindCapture();
+bool rewindStep();
+int rewindCount();
+size_t rewindSize();
+
+#endif // REWIND_H
@@ -22,20 +22,27 @@
 #include "Array.h"
 #include <cstddef>
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 
+// Safe for one writer thread and one reader thread running at the same
+// time: write() only moves wpos and read() only moves rpos, and each side
+// publishes its position after the data. clear(), fill() and reset() must
+// not race with either side.
 template<typename T>
 class RingBuffer {
 	Array<T> buf;
 	std::size_t sz;
-	std::size_t rpos;
-	std::size_t wpos;
+	std::atomic<std::size_t> rpos;
+	std::atomic<std::size_t> wpos;
 
 public:
 	RingBuffer(const std::size_t sz_in = 0) : sz(0), rpos(0), wpos(0) { reset(sz_in); }
 
 	std::size_t avail() const {
-		return (wpos < rpos ? 0 : sz) + rpos - wpos - 1;
+		const std::size_t r = rpos.load(std::memory_order_acquire);
+		const std::size_t w = wpos.load(std::memory_order_acquire);
+		return (w < r ? 0 : sz) + r - w - 1;
 	}
 
 	void clear() {
@@ -53,7 +60,9 @@ public:
 	}
 
 	std::size_t used() const {
-		return (wpos < rpos ? sz : 0) + wpos - rpos;
+		const std::size_t r = rpos.load(std::memory_order_acquire);
+		const std::size_t w = wpos.load(std::memory_order_acquire);
+		return (w < r ? sz : 0) + w - r;
 	}
 
 	void write(const T *in, std::size_t num);
@@ -68,20 +77,24 @@ void RingBuffer<T>::fill(const T value) {
 
 template<typename T>
 void RingBuffer<T>::read(T *out, std::size_t num) {
-	if (rpos + num > sz) {
-		const std::size_t n = sz - rpos;
+	std::size_t pos = rpos.load(std::memory_order_relaxed);
 
-		std::memcpy(out, buf + rpos, n * sizeof(T));
+	if (pos + num > sz) {
+		const std::size_t n = sz - pos;
 
-		rpos = 0;
+		std::memcpy(out, buf + pos, n * sizeof(T));
+
+		pos = 0;
 		num -= n;
 		out += n;
 	}
 
-	std::memcpy(out, buf + rpos, num * sizeof(T));
+	std::memcpy(out, buf + pos, num * sizeof(T));
+
+	if ((pos += num) == sz)
+		pos = 0;
 
-	if ((rpos += num) == sz)
-		rpos = 0;
+	rpos.store(pos, std::memory_order_release);
 }
 
 template<typename T>
@@ -93,20 +106,24 @@ void RingBuffer<T>::reset(const std::size_t sz_in) {
 
 template<typename T>
 void RingBuffer<T>::write(const T *in, std::size_t num) {
-	if (wpos + num > sz) {
-		const std::size_t n = sz - wpos;
+	std::size_t pos = wpos.load(std::memory_order_relaxed);
 
-		std::memcpy(buf + wpos, in, n * sizeof(T));
+	if (pos + num > sz) {
+		const std::size_t n = sz - pos;
 
-		wpos = 0;
+		std::memcpy(buf + pos, in, n * sizeof(T));
+
+		pos = 0;
 		num -= n;
 		in += n;
 	}
 
-	std::memcpy(buf + wpos, in, num * sizeof(T));
+	std::memcpy(buf + pos, in, num * sizeof(T));
+
+	if ((pos += num) == sz)
+		pos = 0;
 
-	if ((wpos += num) == sz)
-		wpos = 0;
+	wpos.store(pos, std::memory_order_release);
 }
 
 #endif
@@ -65,6 +65,12 @@ public:
 	virtual void write(u16 * finalWave, int length) = 0;
 
 	virtual void setThrottle(unsigned short throttle) { };
+
+	/**
+	 * Amount of audio queued for output relative to the latency target,
+	 * where 1.0 is on target, or a negative value if the driver has no queue.
+	 */
+	virtual float getFill() { return -1.0f; };
 };
 
 #endif // __VBA_SOUND_DRIVER_H__
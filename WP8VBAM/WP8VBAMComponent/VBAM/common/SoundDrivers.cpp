@@ -0,0 +1,183 @@
+#include "SoundDrivers.h"
+#include "Port.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#ifndef NO_XAUDIO2
+extern SoundDriver *newXAudio2_Output();
+#endif
+
+
+// Driver that accepts and drops everything, for timing the sound core on
+// its own.
+class NullSoundDriver : public SoundDriver
+{
+public:
+	bool init(long sampleRate) { return true; }
+	void pause() { }
+	void reset() { }
+	void resume() { }
+	void close() { }
+	void write(u16 * finalWave, int length) { }
+};
+
+
+// Driver that writes 16-bit stereo PCM to a WAV file. The sizes in the
+// header are filled in when the driver is closed.
+class WavSoundDriver : public SoundDriver
+{
+public:
+	WavSoundDriver(const char *fileName);
+	~WavSoundDriver();
+
+	bool init(long sampleRate);
+	void pause() { }
+	void reset() { }
+	void resume() { }
+	void close();
+	void write(u16 * finalWave, int length);
+
+private:
+	void writeHeader();
+
+	std::string fileName;
+	FILE *file;
+	long sampleRate;
+	u32 dataLength;
+};
+
+WavSoundDriver::WavSoundDriver(const char *fileName)
+	: fileName(fileName), file(NULL), sampleRate(0), dataLength(0)
+{
+}
+
+WavSoundDriver::~WavSoundDriver()
+{
+	close();
+}
+
+bool WavSoundDriver::init(long sampleRate)
+{
+	close();
+	file = fopen(fileName.c_str(), "wb");
+	if(!file)
+		return false;
+	this->sampleRate = sampleRate;
+	dataLength = 0;
+	writeHeader();
+	return true;
+}
+
+void WavSoundDriver::writeHeader()
+{
+	u8 header[44];
+	memcpy(header, "RIFF", 4);
+	WRITE32LE(&header[4], 36 + dataLength);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	WRITE32LE(&header[16], 16);
+	WRITE16LE(&header[20], 1);               // PCM
+	WRITE16LE(&header[22], 2);               // channels
+	WRITE32LE(&header[24], (u32)sampleRate);
+	WRITE32LE(&header[28], (u32)sampleRate * 4);
+	WRITE16LE(&header[32], 4);               // bytes per frame
+	WRITE16LE(&header[34], 16);              // bits per sample
+	memcpy(header + 36, "data", 4);
+	WRITE32LE(&header[40], dataLength);
+
+	fseek(file, 0, SEEK_SET);
+	fwrite(header, 1, sizeof(header), file);
+	fseek(file, 0, SEEK_END);
+}
+
+void WavSoundDriver::close()
+{
+	if(!file)
+		return;
+	writeHeader();
+	fclose(file);
+	file = NULL;
+}
+
+void WavSoundDriver::write(u16 * finalWave, int length)
+{
+	if(!file)
+		return;
+#ifdef WORDS_BIGENDIAN
+	for(int i = 0; i < length / 2; i++) {
+		u8 sample[2];
+		WRITE16LE(sample, finalWave[i]);
+		fwrite(sample, 1, 2, file);
+	}
+#else
+	fwrite(finalWave, 1, length, file);
+#endif
+	dataLength += length;
+}
+
+
+MemorySoundDriver::MemorySoundDriver()
+	: sampleRate(0)
+{
+}
+
+bool MemorySoundDriver::init(long sampleRate)
+{
+	this->sampleRate = sampleRate;
+	samples.clear();
+	return true;
+}
+
+void MemorySoundDriver::write(u16 * finalWave, int length)
+{
+	samples.insert(samples.end(), finalWave, finalWave + length / 2);
+}
+
+
+#ifndef NO_XAUDIO2
+static SoundDriver *newXAudio2Driver(const char *)
+{
+	return newXAudio2_Output();
+}
+#endif
+
+static SoundDriver *newNullDriver(const char *)
+{
+	return new NullSoundDriver();
+}
+
+static SoundDriver *newWavDriver(const char *arg)
+{
+	if(!arg || !*arg)
+		return NULL;
+	return new WavSoundDriver(arg);
+}
+
+static SoundDriver *newMemoryDriver(const char *)
+{
+	return new MemorySoundDriver();
+}
+
+const SoundDriverInfo soundDrivers[] =
+{
+#ifndef NO_XAUDIO2
+	{ "xaudio2", "XAudio2 device output", newXAudio2Driver },
+#endif
+	{ "null", "discard the samples", newNullDriver },
+	{ "wav", "write the samples to the WAV file named by the argument", newWavDriver },
+	{ "memory", "keep the samples in memory", newMemoryDriver },
+	{ NULL, NULL, NULL }
+};
+
+SoundDriver *soundDriverCreate(const char *spec)
+{
+	const char *colon = strchr(spec, ':');
+	size_t length = colon ? (size_t)(colon - spec) : strlen(spec);
+
+	for(const SoundDriverInfo *info = soundDrivers; info->name; info++) {
+		if(strlen(info->name) == length && !strncmp(info->name, spec, length))
+			return info->create(colon ? colon + 1 : NULL);
+	}
+	return NULL;
+}
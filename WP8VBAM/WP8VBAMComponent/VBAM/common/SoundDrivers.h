@@ -0,0 +1,61 @@
+#ifndef SOUNDDRIVERS_H
+#define SOUNDDRIVERS_H
+
+#include "SoundDriver.h"
+
+#include <vector>
+
+/**
+ * Factory of a registered sound driver.
+ * @param arg Text after the colon in "name:arg", or NULL
+ */
+typedef SoundDriver *(*SoundDriverFactory)(const char *arg);
+
+struct SoundDriverInfo
+{
+	const char *name;
+	const char *description;
+	SoundDriverFactory create;
+};
+
+/**
+ * The sound drivers built into this binary, terminated by an entry with a
+ * NULL name. Besides the device output there are drivers that need no
+ * device: "null" discards the samples, "wav:<file>" writes them to a WAV
+ * file and "memory" keeps them for the caller to inspect.
+ */
+extern const SoundDriverInfo soundDrivers[];
+
+/**
+ * Create a driver by name, optionally followed by ":arg".
+ * Returns NULL for an unknown name or when the driver could not be set up.
+ */
+SoundDriver *soundDriverCreate(const char *spec);
+
+/**
+ * Sound driver that appends every sample written to it to an in-memory
+ * buffer, so the output of the sound core can be checked without a device.
+ */
+class MemorySoundDriver : public SoundDriver
+{
+public:
+	MemorySoundDriver();
+
+	bool init(long sampleRate);
+	void pause() { }
+	void reset() { }
+	void resume() { }
+	void close() { }
+	void write(u16 * finalWave, int length);
+
+	long getSampleRate() const { return sampleRate; }
+	// interleaved left/right samples
+	const std::vector<u16> &getSamples() const { return samples; }
+	void clear() { samples.clear(); }
+
+private:
+	long sampleRate;
+	std::vector<u16> samples;
+};
+
+#endif // SOUNDDRIVERS_H
@@ -30,4 +30,21 @@ typedef int16_t s16;
 typedef int32_t s32;
 typedef int64_t s64;
 
+// Storage class of the emulator state. Built with VBAM_MULTI_INSTANCE every
+// thread gets its own copy, so each thread runs an independent core
+// instance: load a ROM, emulate and clean up on the same thread. Read-only
+// tables and the frontend settings outside the core state (colour maps and
+// shifts, sound rate, SIMD and cache switches) stay shared by all
+// instances; the options in gba/Globals.cpp belong to the instance and are
+// set on its thread.
+#ifdef VBAM_MULTI_INSTANCE
+#ifdef _MSC_VER
+#define CORE_LOCAL __declspec(thread)
+#else
+#define CORE_LOCAL __thread
+#endif
+#else
+#define CORE_LOCAL
+#endif
+
 #endif // __VBA_TYPES_H__
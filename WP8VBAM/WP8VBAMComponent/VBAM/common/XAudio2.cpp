@@ -2,6 +2,7 @@
 
 // Interface
 #include "../common/SoundDriver.h"
+#include "../common/AudioQueue.h"
 
 // XAudio2
 #include <xaudio2.h>
@@ -13,6 +14,7 @@
 // Internals
 #include "../System.h" // for systemMessage()
 #include "../gba/Globals.h"
+#include "../gba/Sound.h"
 
 
 class XAudio2_Output;
@@ -25,10 +27,12 @@ class XAudio2_BufferNotify : public IXAudio2VoiceCallback
 {
 public:
 	HANDLE hBufferEndEvent;
+	XAudio2_Output *output;
 
 	XAudio2_BufferNotify() {
 		hBufferEndEvent = NULL;
 		hBufferEndEvent = CreateEventEx( NULL, FALSE, FALSE, NULL );
+		output = NULL;
 	}
 
 	~XAudio2_BufferNotify() {
@@ -36,9 +40,7 @@ public:
 		hBufferEndEvent = NULL;
 	}
 
-    STDMETHOD_( void, OnBufferEnd ) ( void *pBufferContext ) {
-		SetEvent( hBufferEndEvent );
-	}
+	STDMETHOD_( void, OnBufferEnd ) ( void *pBufferContext );
 
 
 	// dummies:
@@ -74,6 +76,11 @@ public:
 
 	// Configuration Changes
 	void setThrottle( unsigned short throttle );
+	float getFill();
+
+	// Refill the next buffer from the queue and submit it; called from the
+	// XAudio2 thread whenever a buffer has finished playing
+	void submit();
 
 private:
 	bool   failed;
@@ -84,6 +91,7 @@ private:
 	BYTE  *buffers;
 	int    currentBuffer;
 	int    soundBufferLen;
+	AudioQueue queue;
 
 	volatile bool device_changed;
 
@@ -96,6 +104,15 @@ private:
 };
 
 
+STDMETHODIMP_( void ) XAudio2_BufferNotify::OnBufferEnd( void *pBufferContext )
+{
+	if( output ) {
+		output->submit();
+	}
+	SetEvent( hBufferEndEvent );
+}
+
+
 // Class Implementation
 XAudio2_Output::XAudio2_Output()
 {
@@ -103,7 +120,7 @@ XAudio2_Output::XAudio2_Output()
 	initialized = false;
 	playing = false;
 	freq = 0;
-	bufferCount = 2;//theApp.xa2BufferCount;
+	bufferCount = 3;//theApp.xa2BufferCount;
 	buffers = NULL;
 	currentBuffer = 0;
 	device_changed = false;
@@ -113,6 +130,7 @@ XAudio2_Output::XAudio2_Output()
 	sVoice = NULL;
 	ZeroMemory( &buf, sizeof( buf ) );
 	ZeroMemory( &vState, sizeof( vState ) );
+	notify.output = this;
 
 	//g_notifier.do_register( this );
 }
@@ -181,9 +199,11 @@ bool XAudio2_Output::init(long sampleRate)
 
 	freq = sampleRate;
 
-	// calculate the number of samples per frame first
-	// then multiply it with the size of a sample frame (16 bit * stereo)
-	soundBufferLen = ( freq / 60 ) * 4;
+	// the voice plays short buffers of 10 ms which are refilled from the
+	// queue as they finish, so the latency is set by the queue target
+	// (16 bit * stereo per sample frame)
+	soundBufferLen = ( freq / 100 ) * 4;
+	queue.init( freq, soundGetLatency() );
 
 	// create own buffers to store sound data because it must not be
 	// manipulated while the voice plays from it
@@ -293,14 +313,19 @@ bool XAudio2_Output::init(long sampleRate)
 	//}
 
 
+	currentBuffer = 0;
+	device_changed = false;
+	initialized = true;
+
+	// queue silence; each finished buffer submits the next one
+	for( UINT32 i = 0; i < bufferCount; i++ ) {
+		submit();
+	}
+
 	hr = sVoice->Start( 0 );
 	//ASSERT( hr == S_OK );
 	playing = true;
 
-	currentBuffer = 0;
-	device_changed = false;
-
-	initialized = true;
 	return true;
 }
 
@@ -309,60 +334,52 @@ void XAudio2_Output::write(u16 * finalWave, int length)
 {
 	if( !initialized || failed ) return;
 
+	if ( device_changed ) 
+	{
+		close();
+		if (!init(freq)) return;
+	}
 
+	int frames = length / 4;
 
-	while( true ) 
-	{
-		if ( device_changed ) 
-		{
-			close();
-			if (!init(freq)) return;
+	if( synchronize && !speedup/* && !theApp.throttle*/ ) {
+		// wait until the voice has played enough to make room
+		while( queue.space() < frames ) {
+			if (WaitForSingleObjectEx( notify.hBufferEndEvent, 10000, false ) == WAIT_TIMEOUT) {
+				device_changed = true;
+				return;
+			}
 		}
+	}
 
+	// whatever does not fit is dropped
+	queue.write( finalWave, frames );
+}
 
-		sVoice->GetState( &vState );
 
-		//ASSERT( vState.BuffersQueued <= bufferCount );
+void XAudio2_Output::submit()
+{
+	if( !initialized ) return;
 
-		if( vState.BuffersQueued < bufferCount ) 
-		{
-			if( vState.BuffersQueued == 0 ) {
-				// buffers ran dry
-				if( systemVerbose & VERBOSE_SOUNDOUTPUT ) {
-					static unsigned int i = 0;
-					log( "XAudio2: Buffers were not refilled fast enough (i=%i)\n", i++ );
-				}
-			}
-			// there is at least one free buffer
-			break;
-		} else {
-			//synchronize = false;
-			// the maximum number of buffers is currently queued
-			if( synchronize && !speedup/* && !theApp.throttle*/ ) {
-				// wait for one buffer to finish playing
-				if (WaitForSingleObjectEx( notify.hBufferEndEvent, 10000, false ) == WAIT_TIMEOUT) {
-					device_changed = true;
-				}
-			} else {
-				// drop current audio frame
-				return;
-			}
+	if( queue.queued() == 0 ) {
+		// buffers ran dry
+		if( systemVerbose & VERBOSE_SOUNDOUTPUT ) {
+			static unsigned int i = 0;
+			log( "XAudio2: Buffers were not refilled fast enough (i=%i)\n", i++ );
 		}
-		
 	}
 
-	// copy & protect the audio data in own memory area while playing it
-	CopyMemory( &buffers[ currentBuffer * soundBufferLen ], finalWave, soundBufferLen );
+	BYTE *data = &buffers[ currentBuffer * soundBufferLen ];
+	queue.read( (s16 *)data, soundBufferLen / 4 );
 
 	buf.AudioBytes = soundBufferLen;
-	buf.pAudioData = &buffers[ currentBuffer * soundBufferLen ];
+	buf.pAudioData = data;
 
 	currentBuffer++;
 	currentBuffer %= ( bufferCount + 1 ); // + 1 because we need one temporary buffer
 
 	HRESULT hr = sVoice->SubmitSourceBuffer( &buf ); // send buffer to queue
 	//ASSERT( hr == S_OK );
-
 }
 
 
@@ -399,6 +416,7 @@ void XAudio2_Output::reset()
 		//ASSERT( hr == S_OK );
 	}
 
+	queue.discard();
 	sVoice->FlushSourceBuffers();
 	sVoice->Start( 0 );
 	playing = true;
@@ -414,6 +432,13 @@ void XAudio2_Output::setThrottle( unsigned short throttle )
 	//ASSERT( hr == S_OK );
 }
 
+float XAudio2_Output::getFill()
+{
+	if( !initialized || failed ) return -1.0f;
+
+	return (float)queue.queued() / queue.target();
+}
+
 void xaudio2_device_changed( XAudio2_Output * instance )
 {
 	instance->device_change();
@@ -11,6 +11,7 @@
 #include "gbCheats.h"
 #include "gbGlobals.h"
 #include "gbMemory.h"
+#include "gbOpcodeCache.h"
 #include "gbSGB.h"
 #include "gbSound.h"
 #include "../Util.h"
@@ -19,191 +20,198 @@
 #define _stricmp strcasecmp
 #endif
 
-extern u8 *pix;
-extern bool speedup;
+extern CORE_LOCAL u8 *pix;
+extern CORE_LOCAL size_t gbaPitch;
+extern CORE_LOCAL bool speedup;
 
 
 
 bool gbUpdateSizes();
-bool inBios = false;
+CORE_LOCAL bool inBios = false;
 
 // debugging
-bool memorydebug = false;
-char gbBuffer[2048];
+CORE_LOCAL bool memorydebug = false;
+CORE_LOCAL char gbBuffer[2048];
 
-extern u16 gbLineMix[160];
+extern CORE_LOCAL u16 gbLineMix[160];
 
 // mappers
-void(*mapper)(u16, u8) = NULL;
-void(*mapperRAM)(u16, u8) = NULL;
-u8(*mapperReadRAM)(u16) = NULL;
-void(*mapperUpdateClock)() = NULL;
+CORE_LOCAL void(*mapper)(u16, u8) = NULL;
+CORE_LOCAL void(*mapperRAM)(u16, u8) = NULL;
+CORE_LOCAL u8(*mapperReadRAM)(u16) = NULL;
+CORE_LOCAL void(*mapperUpdateClock)() = NULL;
 
 // registers
-gbRegister PC;
-gbRegister SP;
-gbRegister AF;
-gbRegister BC;
-gbRegister DE;
-gbRegister HL;
-u16 IFF = 0;
+CORE_LOCAL gbRegister PC;
+CORE_LOCAL gbRegister SP;
+CORE_LOCAL gbRegister AF;
+CORE_LOCAL gbRegister BC;
+CORE_LOCAL gbRegister DE;
+CORE_LOCAL gbRegister HL;
+CORE_LOCAL u16 IFF = 0;
 // 0xff04
-u8 register_DIV = 0;
+CORE_LOCAL u8 register_DIV = 0;
 // 0xff05
-u8 register_TIMA = 0;
+CORE_LOCAL u8 register_TIMA = 0;
 // 0xff06
-u8 register_TMA = 0;
+CORE_LOCAL u8 register_TMA = 0;
 // 0xff07
-u8 register_TAC = 0;
+CORE_LOCAL u8 register_TAC = 0;
 // 0xff0f
-u8 register_IF = 0;
+CORE_LOCAL u8 register_IF = 0;
 // 0xff40
-u8 register_LCDC = 0;
+CORE_LOCAL u8 register_LCDC = 0;
 // 0xff41
-u8 register_STAT = 0;
+CORE_LOCAL u8 register_STAT = 0;
 // 0xff42
-u8 register_SCY = 0;
+CORE_LOCAL u8 register_SCY = 0;
 // 0xff43
-u8 register_SCX = 0;
+CORE_LOCAL u8 register_SCX = 0;
 // 0xff44
-u8 register_LY = 0;
+CORE_LOCAL u8 register_LY = 0;
 // 0xff45
-u8 register_LYC = 0;
+CORE_LOCAL u8 register_LYC = 0;
 // 0xff46
-u8 register_DMA = 0;
+CORE_LOCAL u8 register_DMA = 0;
 // 0xff4a
-u8 register_WY = 0;
+CORE_LOCAL u8 register_WY = 0;
 // 0xff4b
-u8 register_WX = 0;
+CORE_LOCAL u8 register_WX = 0;
 // 0xff4f
-u8 register_VBK = 0;
+CORE_LOCAL u8 register_VBK = 0;
 // 0xff51
-u8 register_HDMA1 = 0;
+CORE_LOCAL u8 register_HDMA1 = 0;
 // 0xff52
-u8 register_HDMA2 = 0;
+CORE_LOCAL u8 register_HDMA2 = 0;
 // 0xff53
-u8 register_HDMA3 = 0;
+CORE_LOCAL u8 register_HDMA3 = 0;
 // 0xff54
-u8 register_HDMA4 = 0;
+CORE_LOCAL u8 register_HDMA4 = 0;
 // 0xff55
-u8 register_HDMA5 = 0;
+CORE_LOCAL u8 register_HDMA5 = 0;
 // 0xff70
-u8 register_SVBK = 0;
+CORE_LOCAL u8 register_SVBK = 0;
 // 0xffff
-u8 register_IE = 0;
+CORE_LOCAL u8 register_IE = 0;
 
 // ticks definition
-int GBDIV_CLOCK_TICKS = 64;
-int GBLCD_MODE_0_CLOCK_TICKS = 51;
-int GBLCD_MODE_1_CLOCK_TICKS = 1140;
-int GBLCD_MODE_2_CLOCK_TICKS = 20;
-int GBLCD_MODE_3_CLOCK_TICKS = 43;
-int GBLY_INCREMENT_CLOCK_TICKS = 114;
-int GBTIMER_MODE_0_CLOCK_TICKS = 256;
-int GBTIMER_MODE_1_CLOCK_TICKS = 4;
-int GBTIMER_MODE_2_CLOCK_TICKS = 16;
-int GBTIMER_MODE_3_CLOCK_TICKS = 64;
-int GBSERIAL_CLOCK_TICKS = 128;
-int GBSYNCHRONIZE_CLOCK_TICKS = 52920;
+CORE_LOCAL int GBDIV_CLOCK_TICKS = 64;
+CORE_LOCAL int GBLCD_MODE_0_CLOCK_TICKS = 51;
+CORE_LOCAL int GBLCD_MODE_1_CLOCK_TICKS = 1140;
+CORE_LOCAL int GBLCD_MODE_2_CLOCK_TICKS = 20;
+CORE_LOCAL int GBLCD_MODE_3_CLOCK_TICKS = 43;
+CORE_LOCAL int GBLY_INCREMENT_CLOCK_TICKS = 114;
+CORE_LOCAL int GBTIMER_MODE_0_CLOCK_TICKS = 256;
+CORE_LOCAL int GBTIMER_MODE_1_CLOCK_TICKS = 4;
+CORE_LOCAL int GBTIMER_MODE_2_CLOCK_TICKS = 16;
+CORE_LOCAL int GBTIMER_MODE_3_CLOCK_TICKS = 64;
+CORE_LOCAL int GBSERIAL_CLOCK_TICKS = 128;
+CORE_LOCAL int GBSYNCHRONIZE_CLOCK_TICKS = 52920;
 
 // state variables
 
 // general
-int clockTicks = 0;
-bool gbSystemMessage = false;
-int gbGBCColorType = 0;
-int gbHardware = 0;
-bool gbexecute = false;
-
-int gbRomType = 0;
-int gbRemainingClockTicks = 0;
-int gbOldClockTicks = 0;
-int gbIntBreak = 0;
-int gbInterruptLaunched = 0;
-u8 gbCheatingDevice = 0; // 1 = GS, 2 = GG
+CORE_LOCAL int clockTicks = 0;
+CORE_LOCAL bool gbSystemMessage = false;
+CORE_LOCAL int gbGBCColorType = 0;
+CORE_LOCAL int gbHardware = 0;
+CORE_LOCAL bool gbexecute = false;
+
+CORE_LOCAL int gbRomType = 0;
+CORE_LOCAL int gbRemainingClockTicks = 0;
+CORE_LOCAL int gbOldClockTicks = 0;
+CORE_LOCAL int gbIntBreak = 0;
+CORE_LOCAL int gbInterruptLaunched = 0;
+CORE_LOCAL u8 gbCheatingDevice = 0; // 1 = GS, 2 = GG
 // breakpoint
-bool breakpoint = false;
+CORE_LOCAL bool breakpoint = false;
 // interrupt
-int gbInt48Signal = 0;
-int gbInterruptWait = 0;
+CORE_LOCAL int gbInt48Signal = 0;
+CORE_LOCAL int gbInterruptWait = 0;
 // serial
-int gbSerialOn = 0;
-int gbSerialTicks = 0;
-int gbSerialBits = 0;
+CORE_LOCAL int gbSerialOn = 0;
+CORE_LOCAL int gbSerialTicks = 0;
+CORE_LOCAL int gbSerialBits = 0;
 // timer
-bool gbTimerOn = false;
-int gbTimerTicks = GBTIMER_MODE_0_CLOCK_TICKS;
-int gbTimerClockTicks = GBTIMER_MODE_0_CLOCK_TICKS;
-int gbTimerMode = 0;
-bool gbIncreased = false;
+CORE_LOCAL bool gbTimerOn = false;
+CORE_LOCAL int gbTimerTicks = 256;
+CORE_LOCAL int gbTimerClockTicks = 256;
+CORE_LOCAL int gbTimerMode = 0;
+CORE_LOCAL bool gbIncreased = false;
 // The internal timer is always active, and it is
 // not reset by writing to register_TIMA/TMA, but by
 // writing to register_DIV...
-int gbInternalTimer = 0x55;
+CORE_LOCAL int gbInternalTimer = 0x55;
 const u8 gbTimerMask[4] = { 0xff, 0x3, 0xf, 0x3f };
 const u8 gbTimerBug[8] = { 0x80, 0x80, 0x02, 0x02, 0x0, 0xff, 0x0, 0xff };
-bool gbTimerModeChange = false;
-bool gbTimerOnChange = false;
+CORE_LOCAL bool gbTimerModeChange = false;
+CORE_LOCAL bool gbTimerOnChange = false;
 // lcd
-bool gbScreenOn = true;
-int gbLcdMode = 2;
-int gbLcdModeDelayed = 2;
-int gbLcdTicks = GBLCD_MODE_2_CLOCK_TICKS - 1;
-int gbLcdTicksDelayed = GBLCD_MODE_2_CLOCK_TICKS;
-int gbLcdLYIncrementTicks = 114;
-int gbLcdLYIncrementTicksDelayed = 115;
-int gbScreenTicks = 0;
-u8 gbSCYLine[300];
-u8 gbSCXLine[300];
-u8 gbBgpLine[300];
-u8 gbObp0Line[300];
-u8 gbObp1Line[300];
-u8 gbSpritesTicks[300];
-u8 oldRegister_WY;
-bool gbLYChangeHappened = false;
-bool gbLCDChangeHappened = false;
-int gbLine99Ticks = 1;
-int gbRegisterLYLCDCOffOn = 0;
-int inUseRegister_WY = 0;
+CORE_LOCAL bool gbScreenOn = true;
+CORE_LOCAL int gbLcdMode = 2;
+CORE_LOCAL int gbLcdModeDelayed = 2;
+CORE_LOCAL int gbLcdTicks = 20 - 1;
+CORE_LOCAL int gbLcdTicksDelayed = 20;
+CORE_LOCAL int gbLcdLYIncrementTicks = 114;
+CORE_LOCAL int gbLcdLYIncrementTicksDelayed = 115;
+CORE_LOCAL int gbScreenTicks = 0;
+CORE_LOCAL u8 gbSCYLine[300];
+CORE_LOCAL u8 gbSCXLine[300];
+CORE_LOCAL u8 gbBgpLine[300];
+CORE_LOCAL u8 gbObp0Line[300];
+CORE_LOCAL u8 gbObp1Line[300];
+CORE_LOCAL u8 gbSpritesTicks[300];
+CORE_LOCAL u8 oldRegister_WY;
+CORE_LOCAL bool gbLYChangeHappened = false;
+CORE_LOCAL bool gbLCDChangeHappened = false;
+CORE_LOCAL int gbLine99Ticks = 1;
+CORE_LOCAL int gbRegisterLYLCDCOffOn = 0;
+CORE_LOCAL int inUseRegister_WY = 0;
 
 // Used to keep track of the line that ellapse
 // when screen is off
-int gbWhiteScreen = 0;
-bool gbBlackScreen = false;
-int register_LCDCBusy = 0;
+CORE_LOCAL int gbWhiteScreen = 0;
+CORE_LOCAL bool gbBlackScreen = false;
+CORE_LOCAL int register_LCDCBusy = 0;
 
 // div
-int gbDivTicks = GBDIV_CLOCK_TICKS;
+CORE_LOCAL int gbDivTicks = 64;
 // cgb
-int gbVramBank = 0;
-int gbWramBank = 1;
+CORE_LOCAL int gbVramBank = 0;
+CORE_LOCAL int gbWramBank = 1;
 //sgb
-bool gbSgbResetFlag = false;
+CORE_LOCAL bool gbSgbResetFlag = false;
 // gbHdmaDestination is 0x99d0 on startup (tested on HW)
 // but I'm not sure what gbHdmaSource is...
-int gbHdmaSource = 0x99d0;
-int gbHdmaDestination = 0x99d0;
-int gbHdmaBytes = 0x0000;
-int gbHdmaOn = 0;
-int gbSpeed = 0;
+CORE_LOCAL int gbHdmaSource = 0x99d0;
+CORE_LOCAL int gbHdmaDestination = 0x99d0;
+CORE_LOCAL int gbHdmaBytes = 0x0000;
+CORE_LOCAL int gbHdmaOn = 0;
+CORE_LOCAL int gbSpeed = 0;
 // frame counting
-int gbFrameCount = 0;
-int gbFrameSkip = 0;
-int gbFrameSkipCount = 0;
+CORE_LOCAL int gbFrameCount = 0;
+CORE_LOCAL int gbFrameSkip = 0;
+CORE_LOCAL int gbFrameSkipCount = 0;
+// Set for a frame that is skipped: no line is rendered or converted, but
+// the LCD modes, LY, the STAT interrupts and HDMA run as usual. Sprite
+// evaluation is kept too, since it sets the length of mode 3. It is
+// decided once per frame, at V-Blank, so a frame is drawn or skipped as a
+// whole.
+CORE_LOCAL bool gbFrameNoDraw = false;
 // timing
-u32 gbLastTime = 0;
-u32 gbElapsedTime = 0;
-u32 gbTimeNow = 0;
-int gbSynchronizeTicks = GBSYNCHRONIZE_CLOCK_TICKS;
+CORE_LOCAL u32 gbLastTime = 0;
+CORE_LOCAL u32 gbElapsedTime = 0;
+CORE_LOCAL u32 gbTimeNow = 0;
+CORE_LOCAL int gbSynchronizeTicks = 52920;
 // emulator features
-int gbBattery = 0;
-bool gbBatteryError = false;
-int gbCaptureNumber = 0;
-bool gbCapture = false;
-bool gbCapturePrevious = false;
-int gbJoymask[4] = { 0, 0, 0, 0 };
+CORE_LOCAL int gbBattery = 0;
+CORE_LOCAL bool gbBatteryError = false;
+CORE_LOCAL int gbCaptureNumber = 0;
+CORE_LOCAL bool gbCapture = false;
+CORE_LOCAL bool gbCapturePrevious = false;
+CORE_LOCAL int gbJoymask[4] = { 0, 0, 0, 0 };
 
-u8 gbRamFill = 0xff;
+CORE_LOCAL u8 gbRamFill = 0xff;
 
 int gbRomSizes[] = { 0x00008000, // 32K
 					 0x00010000, // 64K
@@ -1320,6 +1328,7 @@ void  gbWriteMemory(register u16 address, register u8 value)
 			gbMemoryMap[0x00] = &gbRom[0x0000];
 			memcpy((u8 *)(gbRom + 0x100), (u8 *)(gbMemory + 0x100), 0xF00);
 			inBios = false;
+			gbOpcodeCacheFlush();
 		}
 	}
 
@@ -1456,6 +1465,7 @@ void  gbWriteMemory(register u16 address, register u8 value)
 				gbPalette[paletteIndex] = (paletteHiLo ?
 					((value << 8) | (gbPalette[paletteIndex] & 0xff)) :
 					((gbPalette[paletteIndex] & 0xff00) | (value))) & 0x7fff;
+				gbUpdatePaletteColor(paletteIndex);
 			}
 
 
@@ -1510,6 +1520,7 @@ void  gbWriteMemory(register u16 address, register u8 value)
 				gbPalette[paletteIndex] = (paletteHiLo ?
 					((value << 8) | (gbPalette[paletteIndex] & 0xff)) :
 					((gbPalette[paletteIndex] & 0xff00) | (value))) & 0x7fff;
+				gbUpdatePaletteColor(paletteIndex);
 			}
 
 			if (gbMemory[0xff6a] & 0x80) {
@@ -2190,6 +2201,8 @@ void gbGetHardwareType()
 void gbReset()
 {
 	gbGetHardwareType();
+	gbOpcodeCacheFlush();
+	gbFrameNoDraw = false;
 
 	oldRegister_WY = 146;
 	gbInterruptLaunched = 0;
@@ -2611,6 +2624,7 @@ void gbReset()
 		for (i = 0; i < 8; i++)
 			gbPalette[i] = systemGbPalette[gbPaletteOption * 8 + i];
 	}
+	gbUpdatePaletteColors();
 
 	GBTIMER_MODE_0_CLOCK_TICKS = 256;
 	GBTIMER_MODE_1_CLOCK_TICKS = 4;
@@ -3460,86 +3474,92 @@ bool gbReadGSASnapshot(const char *fileName)
 	return true;
 }
 
-variable_desc gbSaveGameStruct[] = {
-  { &PC.W, sizeof(u16) },
-  { &SP.W, sizeof(u16) },
-  { &AF.W, sizeof(u16) },
-  { &BC.W, sizeof(u16) },
-  { &DE.W, sizeof(u16) },
-  { &HL.W, sizeof(u16) },
-  { &IFF,  sizeof(u8) },
-  { &GBLCD_MODE_0_CLOCK_TICKS, sizeof(int) },
-  { &GBLCD_MODE_1_CLOCK_TICKS, sizeof(int) },
-  { &GBLCD_MODE_2_CLOCK_TICKS, sizeof(int) },
-  { &GBLCD_MODE_3_CLOCK_TICKS, sizeof(int) },
-  { &GBDIV_CLOCK_TICKS, sizeof(int) },
-  { &GBLY_INCREMENT_CLOCK_TICKS, sizeof(int) },
-  { &GBTIMER_MODE_0_CLOCK_TICKS, sizeof(int) },
-  { &GBTIMER_MODE_1_CLOCK_TICKS, sizeof(int) },
-  { &GBTIMER_MODE_2_CLOCK_TICKS, sizeof(int) },
-  { &GBTIMER_MODE_3_CLOCK_TICKS, sizeof(int) },
-  { &GBSERIAL_CLOCK_TICKS, sizeof(int) },
-  { &GBSYNCHRONIZE_CLOCK_TICKS, sizeof(int) },
-  { &gbDivTicks, sizeof(int) },
-  { &gbLcdMode, sizeof(int) },
-  { &gbLcdTicks, sizeof(int) },
-  { &gbLcdLYIncrementTicks, sizeof(int) },
-  { &gbTimerTicks, sizeof(int) },
-  { &gbTimerClockTicks, sizeof(int) },
-  { &gbSerialTicks, sizeof(int) },
-  { &gbSerialBits, sizeof(int) },
-  { &gbInt48Signal, sizeof(int) },
-  { &gbInterruptWait, sizeof(int) },
-  { &gbSynchronizeTicks, sizeof(int) },
-  { &gbTimerOn, sizeof(int) },
-  { &gbTimerMode, sizeof(int) },
-  { &gbSerialOn, sizeof(int) },
-  { &gbWindowLine, sizeof(int) },
-  { &gbCgbMode, sizeof(int) },
-  { &gbVramBank, sizeof(int) },
-  { &gbWramBank, sizeof(int) },
-  { &gbHdmaSource, sizeof(int) },
-  { &gbHdmaDestination, sizeof(int) },
-  { &gbHdmaBytes, sizeof(int) },
-  { &gbHdmaOn, sizeof(int) },
-  { &gbSpeed, sizeof(int) },
-  { &gbSgbMode, sizeof(int) },
-  { &register_DIV, sizeof(u8) },
-  { &register_TIMA, sizeof(u8) },
-  { &register_TMA, sizeof(u8) },
-  { &register_TAC, sizeof(u8) },
-  { &register_IF, sizeof(u8) },
-  { &register_LCDC, sizeof(u8) },
-  { &register_STAT, sizeof(u8) },
-  { &register_SCY, sizeof(u8) },
-  { &register_SCX, sizeof(u8) },
-  { &register_LY, sizeof(u8) },
-  { &register_LYC, sizeof(u8) },
-  { &register_DMA, sizeof(u8) },
-  { &register_WY, sizeof(u8) },
-  { &register_WX, sizeof(u8) },
-  { &register_VBK, sizeof(u8) },
-  { &register_HDMA1, sizeof(u8) },
-  { &register_HDMA2, sizeof(u8) },
-  { &register_HDMA3, sizeof(u8) },
-  { &register_HDMA4, sizeof(u8) },
-  { &register_HDMA5, sizeof(u8) },
-  { &register_SVBK, sizeof(u8) },
-  { &register_IE , sizeof(u8) },
-  { &gbBgp[0], sizeof(u8) },
-  { &gbBgp[1], sizeof(u8) },
-  { &gbBgp[2], sizeof(u8) },
-  { &gbBgp[3], sizeof(u8) },
-  { &gbObp0[0], sizeof(u8) },
-  { &gbObp0[1], sizeof(u8) },
-  { &gbObp0[2], sizeof(u8) },
-  { &gbObp0[3], sizeof(u8) },
-  { &gbObp1[0], sizeof(u8) },
-  { &gbObp1[1], sizeof(u8) },
-  { &gbObp1[2], sizeof(u8) },
-  { &gbObp1[3], sizeof(u8) },
-  { NULL, 0 }
-};
+static variable_desc *gbSaveGameStruct()
+{
+  variable_desc data[] = {
+    { &PC.W, sizeof(u16) },
+    { &SP.W, sizeof(u16) },
+    { &AF.W, sizeof(u16) },
+    { &BC.W, sizeof(u16) },
+    { &DE.W, sizeof(u16) },
+    { &HL.W, sizeof(u16) },
+    { &IFF,  sizeof(u8) },
+    { &GBLCD_MODE_0_CLOCK_TICKS, sizeof(int) },
+    { &GBLCD_MODE_1_CLOCK_TICKS, sizeof(int) },
+    { &GBLCD_MODE_2_CLOCK_TICKS, sizeof(int) },
+    { &GBLCD_MODE_3_CLOCK_TICKS, sizeof(int) },
+    { &GBDIV_CLOCK_TICKS, sizeof(int) },
+    { &GBLY_INCREMENT_CLOCK_TICKS, sizeof(int) },
+    { &GBTIMER_MODE_0_CLOCK_TICKS, sizeof(int) },
+    { &GBTIMER_MODE_1_CLOCK_TICKS, sizeof(int) },
+    { &GBTIMER_MODE_2_CLOCK_TICKS, sizeof(int) },
+    { &GBTIMER_MODE_3_CLOCK_TICKS, sizeof(int) },
+    { &GBSERIAL_CLOCK_TICKS, sizeof(int) },
+    { &GBSYNCHRONIZE_CLOCK_TICKS, sizeof(int) },
+    { &gbDivTicks, sizeof(int) },
+    { &gbLcdMode, sizeof(int) },
+    { &gbLcdTicks, sizeof(int) },
+    { &gbLcdLYIncrementTicks, sizeof(int) },
+    { &gbTimerTicks, sizeof(int) },
+    { &gbTimerClockTicks, sizeof(int) },
+    { &gbSerialTicks, sizeof(int) },
+    { &gbSerialBits, sizeof(int) },
+    { &gbInt48Signal, sizeof(int) },
+    { &gbInterruptWait, sizeof(int) },
+    { &gbSynchronizeTicks, sizeof(int) },
+    { &gbTimerOn, sizeof(int) },
+    { &gbTimerMode, sizeof(int) },
+    { &gbSerialOn, sizeof(int) },
+    { &gbWindowLine, sizeof(int) },
+    { &gbCgbMode, sizeof(int) },
+    { &gbVramBank, sizeof(int) },
+    { &gbWramBank, sizeof(int) },
+    { &gbHdmaSource, sizeof(int) },
+    { &gbHdmaDestination, sizeof(int) },
+    { &gbHdmaBytes, sizeof(int) },
+    { &gbHdmaOn, sizeof(int) },
+    { &gbSpeed, sizeof(int) },
+    { &gbSgbMode, sizeof(int) },
+    { &register_DIV, sizeof(u8) },
+    { &register_TIMA, sizeof(u8) },
+    { &register_TMA, sizeof(u8) },
+    { &register_TAC, sizeof(u8) },
+    { &register_IF, sizeof(u8) },
+    { &register_LCDC, sizeof(u8) },
+    { &register_STAT, sizeof(u8) },
+    { &register_SCY, sizeof(u8) },
+    { &register_SCX, sizeof(u8) },
+    { &register_LY, sizeof(u8) },
+    { &register_LYC, sizeof(u8) },
+    { &register_DMA, sizeof(u8) },
+    { &register_WY, sizeof(u8) },
+    { &register_WX, sizeof(u8) },
+    { &register_VBK, sizeof(u8) },
+    { &register_HDMA1, sizeof(u8) },
+    { &register_HDMA2, sizeof(u8) },
+    { &register_HDMA3, sizeof(u8) },
+    { &register_HDMA4, sizeof(u8) },
+    { &register_HDMA5, sizeof(u8) },
+    { &register_SVBK, sizeof(u8) },
+    { &register_IE , sizeof(u8) },
+    { &gbBgp[0], sizeof(u8) },
+    { &gbBgp[1], sizeof(u8) },
+    { &gbBgp[2], sizeof(u8) },
+    { &gbBgp[3], sizeof(u8) },
+    { &gbObp0[0], sizeof(u8) },
+    { &gbObp0[1], sizeof(u8) },
+    { &gbObp0[2], sizeof(u8) },
+    { &gbObp0[3], sizeof(u8) },
+    { &gbObp1[0], sizeof(u8) },
+    { &gbObp1[1], sizeof(u8) },
+    { &gbObp1[2], sizeof(u8) },
+    { &gbObp1[3], sizeof(u8) },
+    { NULL, 0 }
+  };
+  static CORE_LOCAL variable_desc table[sizeof(data) / sizeof(data[0])];
+  memcpy(table, data, sizeof(data));
+  return table;
+}
 
 
 static bool gbWriteSaveState(gzFile gzFile)
@@ -3552,7 +3572,7 @@ static bool gbWriteSaveState(gzFile gzFile)
 	utilWriteInt(gzFile, useBios);
 	utilWriteInt(gzFile, inBios);
 
-	utilWriteData(gzFile, gbSaveGameStruct);
+	utilWriteData(gzFile, gbSaveGameStruct());
 
 	utilGzWrite(gzFile, &IFF, 2);
 
@@ -3605,9 +3625,9 @@ static bool gbWriteSaveState(gzFile gzFile)
 	return true;
 }
 
-bool gbWriteMemSaveState(char *memory, int available)
+bool gbWriteMemSaveState(char *memory, int available, long &size)
 {
-	gzFile gzFile = utilMemGzOpen(memory, available, "w");
+	gzFile gzFile = utilMemRawOpen(memory, available, "w");
 
 	if (gzFile == NULL) {
 		return false;
@@ -3615,9 +3635,9 @@ bool gbWriteMemSaveState(char *memory, int available)
 
 	bool res = gbWriteSaveState(gzFile);
 
-	long pos = utilGzMemTell(gzFile) + 8;
+	size = utilGzMemTell(gzFile);
 
-	if (pos >= (available))
+	if (size > available)
 		res = false;
 
 	utilGzClose(gzFile);
@@ -3683,7 +3703,7 @@ static bool gbReadSaveState(gzFile gzFile)
 
 	inBios = ib;
 
-	utilReadData(gzFile, gbSaveGameStruct);
+	utilReadData(gzFile, gbSaveGameStruct());
 
 
 	// Correct crash when loading color gameboy save in regular gameboy type.
@@ -3752,7 +3772,10 @@ static bool gbReadSaveState(gzFile gzFile)
 	if (version < GBSAVE_GAME_VERSION_5) {
 		utilGzRead(gzFile, pix, 256 * 224 * sizeof(u16));
 	}
-	memset(pix, 0, 257 * 226 * sizeof(u32));
+	if (systemColorDepth == 32)
+		memset(pix, 0, gbaPitch * 145);
+	else
+		memset(pix, 0, 257 * 226 * sizeof(u32));
 
 	if (version < GBSAVE_GAME_VERSION_6) {
 		utilGzRead(gzFile, gbPalette, 64 * sizeof(u16));
@@ -3769,6 +3792,7 @@ static bool gbReadSaveState(gzFile gzFile)
 				gbPalette[i] = systemGbPalette[gbPaletteOption * 8 + i];
 		}
 	}
+	gbUpdatePaletteColors();
 
 	utilGzRead(gzFile, &gbMemory[0x8000], 0x8000);
 
@@ -3804,6 +3828,7 @@ static bool gbReadSaveState(gzFile gzFile)
 		(gbObp1[3] << 6)), sizeof(gbObp1Line));
 	memset(gbSpritesTicks, 0x0, sizeof(gbSpritesTicks));
 
+	gbOpcodeCacheFlush();
 	if (inBios)
 	{
 		gbMemoryMap[0x00] = &gbMemory[0x0000];
@@ -4013,7 +4038,7 @@ static bool gbReadSaveState(gzFile gzFile)
 
 bool gbReadMemSaveState(char *memory, int available)
 {
-	gzFile gzFile = utilMemGzOpen(memory, available, "r");
+	gzFile gzFile = utilMemRawOpen(memory, available, "r");
 
 	bool res = gbReadSaveState(gzFile);
 
@@ -4133,6 +4158,35 @@ bool gbLoadRom(const char *szFile)
 	return gbUpdateSizes();
 }
 
+bool gbLoadRomData(const char *data, unsigned int size)
+{
+	if (gbRom != NULL) {
+		gbCleanUp();
+	}
+
+	systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
+
+	gbRom = (u8 *)calloc(1, size);
+	if (gbRom == NULL) {
+		systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
+			"ROM");
+		return false;
+	}
+
+	memcpy(gbRom, data, size);
+	gbRomSize = size;
+
+	gbBatteryError = false;
+
+	if (bios != NULL) {
+		free(bios);
+		bios = NULL;
+	}
+	bios = (u8 *)calloc(1, 0x100);
+
+	return gbUpdateSizes();
+}
+
 bool gbUpdateSizes()
 {
 	if (gbRom[0x148] > 8) {
@@ -4359,6 +4413,7 @@ bool gbUpdateSizes()
 	}
 
 	gbInit();
+	gbOpcodeCacheFlush();
 
 	//gbReset();
 
@@ -4414,25 +4469,25 @@ void gbDrawLine()
 			(gbBorderLineSkip + 2) * (register_LY + gbBorderRowSkip + 1)
 			+ gbBorderColumnSkip;
 		for (int x = 0; x < 160; ) {
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-			*dest++ = systemColorMap16[gbLineMix[x++]];
-			*dest++ = systemColorMap16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
+			*dest++ = gbPaletteColor16[gbLineMix[x++]];
 		}
 		if (gbBorderOn)
 			dest += gbBorderColumnSkip;
@@ -4446,40 +4501,40 @@ void gbDrawLine()
 			3 * (gbBorderLineSkip * (register_LY + gbBorderRowSkip) +
 				gbBorderColumnSkip);
 		for (int x = 0; x < 160;) {
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
 
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
 
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
 
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
-			*((u32 *)dest) = systemColorMap32[gbLineMix[x++]];
+			*((u32 *)dest) = gbPaletteColor32[gbLineMix[x++]];
 			dest += 3;
 		}
 	}
@@ -4487,7 +4542,6 @@ void gbDrawLine()
 
 	case 32:
 	{
-		extern size_t gbaPitch;
 		size_t rowPitch = gbaPitch / 4;
 		//u32 *dest = (u32 *)pix + 241 * (VCOUNT+1);
 		//u32 *dest = (u32 *)pix + rowPitch * (VCOUNT+1);
@@ -4498,31 +4552,36 @@ void gbDrawLine()
 		u32 * dest = (u32 *)pix +
 			(rowPitch) * (register_LY + 1);
 		for (int x = 0; x < 160;) {
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-			*dest++ = systemColorMap32[gbLineMix[x++]];
-			*dest++ = systemColorMap32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
+			*dest++ = gbPaletteColor32[gbLineMix[x++]];
 		}
 	}
 	break;
 	}
 }
 
+// Operand fetch for gbCodes.h. Instructions dispatched from the opcode cache
+// carry their immediates, found by their offset from the opcode at oldPCW.
+#define gbReadOperand(address) \
+	(cached ? cached->operands[(u16)((address) - oldPCW) - 1] : gbReadOpcode(address))
+
 void gbEmulate(int ticksToStop)
 {
 	gbRegister tempRegister;
@@ -4538,6 +4597,9 @@ void gbEmulate(int ticksToStop)
 	int opcode2 = 0;
 	gbexecute = false;
 
+	// Set when the current instruction was dispatched from the opcode cache.
+	const gbCachedOpcode *cached = NULL;
+
 	while (1)
 	{
 #ifndef FINAL_VERSION
@@ -4595,24 +4657,40 @@ void gbEmulate(int ticksToStop)
 			opcode2 = 0;
 			gbexecute = true;
 
-			opcode2 = opcode1 = opcode = gbReadOpcode(PC.W++);
+			// ROM code is dispatched from the pre-decoded cache; the HALT bug
+			// below re-reads the opcode byte, so it takes the slow path.
+			cached = NULL;
+			if (gbOpcodeCacheEnabled && !(IFF & 2))
+				cached = gbOpcodeCacheFind(PC.W);
 
-			// If HALT state was launched while IME = 0 and (register_IF & register_IE & 0x1F),
-			// PC.W is not incremented for the first byte of the next instruction.
-			if (IFF & 2)
+			if (cached)
 			{
-				PC.W--;
-				IFF &= ~2;
+				opcode1 = cached->opcode1;
+				opcode2 = opcode = cached->opcode2;
+				clockTicks = cached->ticks;
+				PC.W += cached->length;
 			}
+			else
+			{
+				opcode2 = opcode1 = opcode = gbReadOpcode(PC.W++);
 
-			clockTicks = gbCycles[opcode];
+				// If HALT state was launched while IME = 0 and (register_IF & register_IE & 0x1F),
+				// PC.W is not incremented for the first byte of the next instruction.
+				if (IFF & 2)
+				{
+					PC.W--;
+					IFF &= ~2;
+				}
 
-			switch (opcode) {
-			case 0xCB:
-				// extended opcode
-				opcode2 = opcode = gbReadOpcode(PC.W++);
-				clockTicks = gbCyclesCB[opcode];
-				break;
+				clockTicks = gbCycles[opcode];
+
+				switch (opcode) {
+				case 0xCB:
+					// extended opcode
+					opcode2 = opcode = gbReadOpcode(PC.W++);
+					clockTicks = gbCyclesCB[opcode];
+					break;
+				}
 			}
 			gbOldClockTicks = clockTicks - 1;
 			gbIntBreak = 1;
@@ -4918,10 +4996,7 @@ void gbEmulate(int ticksToStop)
 
 
 				if ((gbLcdTicksDelayed <= 0) && (gbLCDChangeHappened)) {
-					int framesToSkip = systemFrameSkip;
 					extern int turboSkip;
-					if (speedup)
-						framesToSkip = turboSkip;
 
 					//gbLcdTicksDelayed = gbLcdTicks+1;
 					gbLCDChangeHappened = false;
@@ -5015,7 +5090,7 @@ void gbEmulate(int ticksToStop)
 							}
 							gbCapturePrevious = gbCapture;
 
-							if (gbFrameSkipCount >= framesToSkip) {
+							if (!gbFrameNoDraw) {
 
 								if (!gbSgbMask)
 								{
@@ -5030,6 +5105,8 @@ void gbEmulate(int ticksToStop)
 							}
 							else
 								gbFrameSkipCount++;
+							// systemFrame() and the joypad may have changed the skip
+							gbFrameNoDraw = gbFrameSkipCount < (speedup ? turboSkip : systemFrameSkip);
 
 						}
 						else {
@@ -5071,7 +5148,7 @@ void gbEmulate(int ticksToStop)
 						// next mode is H-Blank
 						if ((register_LY < 144) && (register_LCDC & 0x80) && gbScreenOn) {
 							if (!gbSgbMask) {
-								if (gbFrameSkipCount >= framesToSkip) {
+								if (!gbFrameNoDraw) {
 									if (!gbBlackScreen)
 									{
 										gbRenderLine();
@@ -5079,10 +5156,9 @@ void gbEmulate(int ticksToStop)
 									}
 									else if (gbBlackScreen)
 									{
-										u16 color = gbColorOption ? gbColorFilter[0] : 0;
+										u16 color = GB_COLOR_BLACK;
 										if (!gbCgbMode)
-											color = gbColorOption ? gbColorFilter[gbPalette[3] & 0x7FFF] :
-											gbPalette[3] & 0x7FFF;
+											color = GB_COLOR_PALETTE + 3;
 										for (int i = 0; i < 160; i++)
 										{
 											gbLineMix[i] = color;
@@ -5158,11 +5234,9 @@ void gbEmulate(int ticksToStop)
 					u8 register_LYLcdOff = ((register_LY + 154) % 154);
 					for (register_LY = 0; register_LY <= 0x90; register_LY++)
 					{
-						u16 color = gbColorOption ? gbColorFilter[0x7FFF] :
-							0x7FFF;
+						u16 color = GB_COLOR_WHITE;
 						if (!gbCgbMode)
-							color = gbColorOption ? gbColorFilter[gbPalette[0] & 0x7FFF] :
-							gbPalette[0] & 0x7FFF;
+							color = GB_COLOR_PALETTE;
 						for (int i = 0; i < 160; i++)
 						{
 							gbLineMix[i] = color;
@@ -5184,25 +5258,25 @@ void gbEmulate(int ticksToStop)
 					gbLcdLYIncrementTicks += GBLY_INCREMENT_CLOCK_TICKS;
 					if (register_LY < 144)
 					{
-
-						u16 color = gbColorOption ? gbColorFilter[0x7FFF] :
-							0x7FFF;
-						if (!gbCgbMode)
-							color = gbColorOption ? gbColorFilter[gbPalette[0] & 0x7FFF] :
-							gbPalette[0] & 0x7FFF;
-						for (int i = 0; i < 160; i++)
+						if (!gbFrameNoDraw)
 						{
-							gbLineMix[i] = color;
-							gbLineBuffer[i] = 0;
+							u16 color = GB_COLOR_WHITE;
+							if (!gbCgbMode)
+								color = GB_COLOR_PALETTE;
+							for (int i = 0; i < 160; i++)
+							{
+								gbLineMix[i] = color;
+								gbLineBuffer[i] = 0;
+							}
+							gbDrawLine();
 						}
-						gbDrawLine();
 					}
-					else if ((register_LY == 144) && (!systemFrameSkip))
+					else if (register_LY == 144)
 					{
 						int framesToSkip = systemFrameSkip;
 						if (speedup)
 							framesToSkip = 9; // try 6 FPS during speedup
-						if ((gbFrameSkipCount >= framesToSkip) || (gbWhiteScreen == 1)) {
+						if (!gbFrameNoDraw || (gbWhiteScreen == 1)) {
 							gbWhiteScreen = 2;
 
 							if (!gbSgbMask)
@@ -5214,7 +5288,11 @@ void gbEmulate(int ticksToStop)
 								if (systemPauseOnFrame())
 									ticksToStop = 0;
 							}
+							gbFrameSkipCount = 0;
 						}
+						else
+							gbFrameSkipCount++;
+						gbFrameNoDraw = gbFrameSkipCount < framesToSkip;
 						if (systemReadJoypads()) {
 							// read joystick
 							if (gbSgbMode && gbSgbMultiplayer) {
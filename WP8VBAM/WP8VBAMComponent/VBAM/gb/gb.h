@@ -17,12 +17,13 @@ typedef union {
   u16 W;
 } gbRegister;
 
-extern gbRegister AF, BC, DE, HL, SP, PC;
-extern u16 IFF;
+extern CORE_LOCAL gbRegister AF, BC, DE, HL, SP, PC;
+extern CORE_LOCAL u16 IFF;
 int gbDis(char *, u16);
 
 
 bool gbLoadRom(const char *);
+bool gbLoadRomData(const char *data, unsigned int size);
 bool gbUpdateSizes();
 void gbEmulate(int);
 void gbWriteMemory(register u16, register u8);
@@ -36,7 +37,7 @@ bool gbWriteBatteryFile(const char *);
 bool gbWriteBatteryFile(const char *, bool);
 bool gbReadBatteryFile(const char *);
 bool gbWriteSaveState(const char *);
-bool gbWriteMemSaveState(char *, int);
+bool gbWriteMemSaveState(char *, int, long &);
 bool gbReadSaveState(const char *);
 bool gbReadMemSaveState(char *, int);
 void gbSgbRenderBorder();
@@ -44,9 +45,9 @@ bool gbWritePNGFile(const char *);
 bool gbWriteBMPFile(const char *);
 bool gbReadGSASnapshot(const char *);
 
-extern int gbHardware;
+extern CORE_LOCAL int gbHardware;
 
-extern bool gbexecute;
+extern CORE_LOCAL bool gbexecute;
 
 extern struct EmulatedSystem GBSystem;
 
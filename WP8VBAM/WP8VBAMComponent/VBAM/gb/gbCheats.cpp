@@ -8,27 +8,45 @@
 #include "../Util.h"
 
 #include "gbCheats.h"
+#include "gbOpcodeCache.h"
 #include "gbGlobals.h"
 #include "gb.h"
 
-gbCheat gbCheatList[100];
-int gbCheatNumber = 0;
-int gbNextCheat = 0;
-bool gbCheatMap[0x10000];
+CORE_LOCAL gbCheat gbCheatList[100];
+CORE_LOCAL int gbCheatNumber = 0;
+CORE_LOCAL int gbNextCheat = 0;
+CORE_LOCAL bool gbCheatMap[0x10000];
 
-extern bool cheatsEnabled;
+// GameGenie codes by address: one more than the index of the first enabled
+// code of each bucket, and of the next one in list order, 0 ending a chain.
+#define GBCHEAT_HASH_SIZE 128
+#define GBCHEAT_HASH(a) (((a) ^ ((a) >> 7)) & (GBCHEAT_HASH_SIZE - 1))
+
+static CORE_LOCAL u8 gbCheatHash[GBCHEAT_HASH_SIZE];
+static CORE_LOCAL u8 gbCheatNext[100];
+
+extern CORE_LOCAL bool cheatsEnabled;
 
 #define GBCHEAT_IS_HEX(a) ( ((a)>='A' && (a) <='F') || ((a) >='0' && (a) <= '9'))
 #define GBCHEAT_HEX_VALUE(a) ( (a) >= 'A' ? (a) - 'A' + 10 : (a) - '0')
 
+// Only GameGenie codes intercept reads; GameShark codes are written by
+// gbCheatWrite and leave their address on the normal read path.
 void gbCheatUpdateMap()
 {
   memset(gbCheatMap, 0, 0x10000);
-
-  for(int i = 0; i < gbCheatNumber; i++) {
-    if(gbCheatList[i].enabled)
-      gbCheatMap[gbCheatList[i].address] = true;
+  memset(gbCheatHash, 0, sizeof(gbCheatHash));
+
+  for(int i = gbCheatNumber - 1; i >= 0; i--) {
+    if(gbCheatList[i].enabled &&
+       (gbCheatList[i].code == 0x100 || gbCheatList[i].code == 0x101)) {
+      u16 address = gbCheatList[i].address;
+      gbCheatMap[address] = true;
+      gbCheatNext[i] = gbCheatHash[GBCHEAT_HASH(address)];
+      gbCheatHash[GBCHEAT_HASH(address)] = i + 1;
+    }
   }
+  gbOpcodeCacheFlush();
 }
 
 void gbCheatsSaveGame(gzFile gzFile)
@@ -365,10 +383,10 @@ bool gbAddGgCheat(const char *code, const char *desc)
 
   gbCheatList[i].enabled = true;
 
-  gbCheatMap[gbCheatList[i].address] = true;
-
   gbCheatNumber++;
 
+  gbCheatUpdateMap();
+
   return true;
 }
 
@@ -455,8 +473,9 @@ u8 gbCheatRead(u16 address)
   if(!cheatsEnabled)
     return gbMemoryMap[address>>12][address & 0xFFF];
 
-  for(int i = 0; i < gbCheatNumber; i++) {
-    if(gbCheatList[i].enabled && gbCheatList[i].address == address) {
+  for(int n = gbCheatHash[GBCHEAT_HASH(address)]; n; n = gbCheatNext[n - 1]) {
+    int i = n - 1;
+    if(gbCheatList[i].address == address) {
       switch(gbCheatList[i].code) {
       case 0x100: // GameGenie support
         if(gbMemoryMap[address>>12][address&0xFFF] == gbCheatList[i].compare)
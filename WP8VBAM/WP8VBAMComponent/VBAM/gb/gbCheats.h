@@ -37,8 +37,8 @@ bool gbVerifyGsCode(const char *code);
 bool gbVerifyGgCode(const char *code);
 void gbCheatUpdateMap();
 
-extern int gbCheatNumber;
-extern gbCheat gbCheatList[100];
-extern bool gbCheatMap[0x10000];
+extern CORE_LOCAL int gbCheatNumber;
+extern CORE_LOCAL gbCheat gbCheatList[100];
+extern CORE_LOCAL bool gbCheatMap[0x10000];
 
 #endif // GBCHEATS_H
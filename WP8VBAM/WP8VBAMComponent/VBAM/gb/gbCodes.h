@@ -3,8 +3,8 @@
    break;
  case 0x01:
    // LD BC, NNNN
-   BC.B.B0=gbReadOpcode(PC.W++);
-   BC.B.B1=gbReadOpcode(PC.W++);
+   BC.B.B0=gbReadOperand(PC.W++);
+   BC.B.B1=gbReadOperand(PC.W++);
    break;
  case 0x02:
    // LD (BC),A
@@ -27,7 +27,7 @@
    break;
  case 0x06:
    // LD B, NN
-   BC.B.B1=gbReadOpcode(PC.W++);
+   BC.B.B1=gbReadOperand(PC.W++);
    break;
  case 0x07:
    // RLCA
@@ -37,8 +37,8 @@
    break;
  case 0x08:
    // LD (NNNN), SP
-   tempRegister.B.B0=gbReadOpcode(PC.W++);
-   tempRegister.B.B1=gbReadOpcode(PC.W++);
+   tempRegister.B.B0=gbReadOperand(PC.W++);
+   tempRegister.B.B1=gbReadOperand(PC.W++);
    gbWriteMemory(tempRegister.W++,SP.B.B0);
    gbWriteMemory(tempRegister.W,SP.B.B1);
    break;
@@ -70,7 +70,7 @@
    break;
  case 0x0e:
    // LD C, NN
-   BC.B.B0=gbReadOpcode(PC.W++);
+   BC.B.B0=gbReadOperand(PC.W++);
    break;
  case 0x0f:
    // RRCA
@@ -80,7 +80,7 @@
    break;
  case 0x10:
    // STOP
-   opcode = gbReadOpcode(PC.W++);
+   opcode = gbReadOperand(PC.W++);
    if(gbCgbMode) {
      if(gbMemory[0xff4d] & 1) {
 
@@ -96,8 +96,8 @@
    break;
  case 0x11:
    // LD DE, NNNN
-   DE.B.B0=gbReadOpcode(PC.W++);
-   DE.B.B1=gbReadOpcode(PC.W++);
+   DE.B.B0=gbReadOperand(PC.W++);
+   DE.B.B1=gbReadOperand(PC.W++);
    break;
  case 0x12:
    // LD (DE),A
@@ -120,7 +120,7 @@
    break;
  case 0x16:
    //  LD D,NN
-   DE.B.B1=gbReadOpcode(PC.W++);
+   DE.B.B1=gbReadOperand(PC.W++);
    break;
  case 0x17:
    // RLA
@@ -130,7 +130,7 @@
    break;
  case 0x18:
    // JR NN
-   PC.W+=(s8)gbReadOpcode(PC.W)+1;
+   PC.W+=(s8)gbReadOperand(PC.W)+1;
    break;
  case 0x19:
    // ADD HL,DE
@@ -160,7 +160,7 @@
    break;
  case 0x1e:
    // LD E,NN
-   DE.B.B0=gbReadOpcode(PC.W++);
+   DE.B.B0=gbReadOperand(PC.W++);
    break;
  case 0x1f:
    // RRA
@@ -173,14 +173,14 @@
    if(AF.B.B0&Z_FLAG)
      PC.W++;
    else {
-     PC.W+=(s8)gbReadOpcode(PC.W)+1;
+     PC.W+=(s8)gbReadOperand(PC.W)+1;
      clockTicks++;
    }
    break;
  case 0x21:
    // LD HL,NNNN
-   HL.B.B0=gbReadOpcode(PC.W++);
-   HL.B.B1=gbReadOpcode(PC.W++);
+   HL.B.B0=gbReadOperand(PC.W++);
+   HL.B.B1=gbReadOperand(PC.W++);
    break;
  case 0x22:
    // LDI (HL),A
@@ -203,7 +203,7 @@
    break;
  case 0x26:
    // LD H,NN
-   HL.B.B1=gbReadOpcode(PC.W++);
+   HL.B.B1=gbReadOperand(PC.W++);
    break;
  case 0x27:
    // DAA
@@ -214,7 +214,7 @@
  case 0x28:
    // JR Z,NN
    if(AF.B.B0&Z_FLAG) {
-     PC.W+=(s8)gbReadOpcode(PC.W)+1;
+     PC.W+=(s8)gbReadOperand(PC.W)+1;
      clockTicks++;
    } else
      PC.W++;
@@ -247,7 +247,7 @@
    break;
  case 0x2e:
    // LD L,NN
-   HL.B.B0=gbReadOpcode(PC.W++);
+   HL.B.B0=gbReadOperand(PC.W++);
    break;
  case 0x2f:
    // CPL
@@ -259,14 +259,14 @@
    if(AF.B.B0&C_FLAG)
      PC.W++;
    else {
-     PC.W+=(s8)gbReadOpcode(PC.W)+1;
+     PC.W+=(s8)gbReadOperand(PC.W)+1;
      clockTicks++;
    }
    break;
  case 0x31:
    // LD SP,NNNN
-   SP.B.B0=gbReadOpcode(PC.W++);
-   SP.B.B1=gbReadOpcode(PC.W++);
+   SP.B.B0=gbReadOperand(PC.W++);
+   SP.B.B1=gbReadOperand(PC.W++);
    break;
  case 0x32:
    // LDD (HL),A
@@ -290,7 +290,7 @@
    break;
  case 0x36:
    // LD (HL),NN
-   gbWriteMemory(HL.W,gbReadOpcode(PC.W++));
+   gbWriteMemory(HL.W,gbReadOperand(PC.W++));
    break;
  case 0x37:
    // SCF
@@ -299,7 +299,7 @@
 case 0x38:
   // JR C,NN
   if(AF.B.B0&C_FLAG) {
-    PC.W+=(s8)gbReadOpcode(PC.W)+1;
+    PC.W+=(s8)gbReadOperand(PC.W)+1;
     clockTicks ++;
   } else
     PC.W++;
@@ -332,7 +332,7 @@ case 0x38:
    break;
  case 0x3e:
    // LD A,NN
-   AF.B.B1=gbReadOpcode(PC.W++);
+   AF.B.B1=gbReadOperand(PC.W++);
    break;
  case 0x3f:
    // CCF
@@ -1025,16 +1025,16 @@ case 0x38:
    if(AF.B.B0&Z_FLAG)
      PC.W+=2;
    else {
-     tempRegister.B.B0=gbReadOpcode(PC.W++);
-     tempRegister.B.B1=gbReadOpcode(PC.W);
+     tempRegister.B.B0=gbReadOperand(PC.W++);
+     tempRegister.B.B1=gbReadOperand(PC.W);
      PC.W=tempRegister.W;
      clockTicks++;
    }
    break;
  case 0xc3:
    // JP NNNN
-   tempRegister.B.B0=gbReadOpcode(PC.W++);
-   tempRegister.B.B1=gbReadOpcode(PC.W);
+   tempRegister.B.B0=gbReadOperand(PC.W++);
+   tempRegister.B.B1=gbReadOperand(PC.W);
    PC.W=tempRegister.W;
    break;
  case 0xc4:
@@ -1042,8 +1042,8 @@ case 0x38:
    if(AF.B.B0&Z_FLAG)
      PC.W+=2;
    else {
-     tempRegister.B.B0=gbReadOpcode(PC.W++);
-     tempRegister.B.B1=gbReadOpcode(PC.W++);
+     tempRegister.B.B0=gbReadOperand(PC.W++);
+     tempRegister.B.B1=gbReadOperand(PC.W++);
      gbWriteMemory(--SP.W,PC.B.B1);
      gbWriteMemory(--SP.W,PC.B.B0);
      PC.W=tempRegister.W;
@@ -1057,7 +1057,7 @@ case 0x38:
    break;
  case 0xc6:
    // ADD NN
-   tempValue=gbReadOpcode(PC.W++);
+   tempValue=gbReadOperand(PC.W++);
    tempRegister.W=AF.B.B1+tempValue;
    AF.B.B0= (tempRegister.B.B1?C_FLAG:0)|ZeroTable[tempRegister.B.B0]|
      ((AF.B.B1^tempValue^tempRegister.B.B0)&0x10 ? H_FLAG:0);
@@ -1085,8 +1085,8 @@ case 0x38:
  case 0xca:
    // JP Z,NNNN
    if(AF.B.B0&Z_FLAG) {
-     tempRegister.B.B0=gbReadOpcode(PC.W++);
-     tempRegister.B.B1=gbReadOpcode(PC.W);
+     tempRegister.B.B0=gbReadOperand(PC.W++);
+     tempRegister.B.B1=gbReadOperand(PC.W);
      PC.W=tempRegister.W;
      clockTicks++;
    } else
@@ -1096,8 +1096,8 @@ case 0x38:
  case 0xcc:
    // CALL Z,NNNN
    if(AF.B.B0&Z_FLAG) {
-     tempRegister.B.B0=gbReadOpcode(PC.W++);
-     tempRegister.B.B1=gbReadOpcode(PC.W++);
+     tempRegister.B.B0=gbReadOperand(PC.W++);
+     tempRegister.B.B1=gbReadOperand(PC.W++);
      gbWriteMemory(--SP.W,PC.B.B1);
      gbWriteMemory(--SP.W,PC.B.B0);
      PC.W=tempRegister.W;
@@ -1107,15 +1107,15 @@ case 0x38:
    break;
  case 0xcd:
    // CALL NNNN
-   tempRegister.B.B0=gbReadOpcode(PC.W++);
-   tempRegister.B.B1=gbReadOpcode(PC.W++);
+   tempRegister.B.B0=gbReadOperand(PC.W++);
+   tempRegister.B.B1=gbReadOperand(PC.W++);
    gbWriteMemory(--SP.W,PC.B.B1);
    gbWriteMemory(--SP.W,PC.B.B0);
    PC.W=tempRegister.W;
    break;
  case 0xce:
    // ADC NN
-   tempValue=gbReadOpcode(PC.W++);
+   tempValue=gbReadOperand(PC.W++);
    tempRegister.W=AF.B.B1+tempValue+(AF.B.B0&C_FLAG ? 1 : 0);
    AF.B.B0= (tempRegister.B.B1?C_FLAG:0)|ZeroTable[tempRegister.B.B0]|
      ((AF.B.B1^tempValue^tempRegister.B.B0)&0x10?H_FLAG:0);
@@ -1145,8 +1145,8 @@ case 0x38:
    if(AF.B.B0&C_FLAG)
      PC.W+=2;
    else {
-     tempRegister.B.B0=gbReadOpcode(PC.W++);
-     tempRegister.B.B1=gbReadOpcode(PC.W);
+     tempRegister.B.B0=gbReadOperand(PC.W++);
+     tempRegister.B.B1=gbReadOperand(PC.W);
      PC.W=tempRegister.W;
      clockTicks++;
    }
@@ -1161,8 +1161,8 @@ case 0x38:
    if(AF.B.B0&C_FLAG)
      PC.W+=2;
    else {
-     tempRegister.B.B0=gbReadOpcode(PC.W++);
-     tempRegister.B.B1=gbReadOpcode(PC.W++);
+     tempRegister.B.B0=gbReadOperand(PC.W++);
+     tempRegister.B.B1=gbReadOperand(PC.W++);
      gbWriteMemory(--SP.W,PC.B.B1);
      gbWriteMemory(--SP.W,PC.B.B0);
      PC.W=tempRegister.W;
@@ -1176,7 +1176,7 @@ case 0x38:
    break;
  case 0xd6:
    // SUB NN
-   tempValue=gbReadOpcode(PC.W++);
+   tempValue=gbReadOperand(PC.W++);
    tempRegister.W=AF.B.B1-tempValue;
    AF.B.B0= N_FLAG|(tempRegister.B.B1?C_FLAG:0)|ZeroTable[tempRegister.B.B0]|
      ((AF.B.B1^tempValue^tempRegister.B.B0)&0x10?H_FLAG:0);
@@ -1205,8 +1205,8 @@ case 0x38:
  case 0xda:
    // JP C,NNNN
    if(AF.B.B0&C_FLAG) {
-     tempRegister.B.B0=gbReadOpcode(PC.W++);
-     tempRegister.B.B1=gbReadOpcode(PC.W);
+     tempRegister.B.B0=gbReadOperand(PC.W++);
+     tempRegister.B.B1=gbReadOperand(PC.W);
      PC.W=tempRegister.W;
      clockTicks++;
    } else
@@ -1220,8 +1220,8 @@ case 0x38:
  case 0xdc:
    // CALL C,NNNN
    if(AF.B.B0&C_FLAG) {
-     tempRegister.B.B0=gbReadOpcode(PC.W++);
-     tempRegister.B.B1=gbReadOpcode(PC.W++);
+     tempRegister.B.B0=gbReadOperand(PC.W++);
+     tempRegister.B.B1=gbReadOperand(PC.W++);
      gbWriteMemory(--SP.W,PC.B.B1);
      gbWriteMemory(--SP.W,PC.B.B0);
      PC.W=tempRegister.W;
@@ -1236,7 +1236,7 @@ case 0x38:
    break;
  case 0xde:
    // SBC NN
-   tempValue=gbReadOpcode(PC.W++);
+   tempValue=gbReadOperand(PC.W++);
    tempRegister.W=AF.B.B1-tempValue-(AF.B.B0&C_FLAG ? 1 : 0);
    AF.B.B0= N_FLAG|(tempRegister.B.B1?C_FLAG:0)|ZeroTable[tempRegister.B.B0]|
      ((AF.B.B1^tempValue^tempRegister.B.B0)&0x10?H_FLAG:0);
@@ -1250,7 +1250,7 @@ case 0x38:
    break;
  case 0xe0:
    // LD (FF00+NN),A
-   gbWriteMemory(0xff00 + gbReadOpcode(PC.W++),AF.B.B1);
+   gbWriteMemory(0xff00 + gbReadOperand(PC.W++),AF.B.B1);
    break;
  case 0xe1:
    // POP HL
@@ -1275,7 +1275,7 @@ case 0x38:
    break;
  case 0xe6:
    // AND NN
-   tempValue=gbReadOpcode(PC.W++);
+   tempValue=gbReadOperand(PC.W++);
    AF.B.B1&=tempValue;
    AF.B.B0=H_FLAG|ZeroTable[AF.B.B1];
    break;
@@ -1287,7 +1287,7 @@ case 0x38:
    break;
  case 0xe8:
    // ADD SP,NN
-   offset = (s8)gbReadOpcode(PC.W++);
+   offset = (s8)gbReadOperand(PC.W++);
    tempRegister.W = SP.W + offset;
    AF.B.B0 = ((SP.W^offset^tempRegister.W)&0x100? C_FLAG : 0) |
              ((SP.W^offset^tempRegister.W)& 0x10? H_FLAG : 0);
@@ -1299,8 +1299,8 @@ case 0x38:
    break;
  case 0xea:
    // LD (NNNN),A
-   tempRegister.B.B0=gbReadOpcode(PC.W++);
-   tempRegister.B.B1=gbReadOpcode(PC.W++);
+   tempRegister.B.B0=gbReadOperand(PC.W++);
+   tempRegister.B.B1=gbReadOperand(PC.W++);
    gbWriteMemory(tempRegister.W,AF.B.B1);
    break;
    // EB illegal
@@ -1314,7 +1314,7 @@ case 0x38:
    break;
  case 0xee:
    // XOR NN
-   tempValue=gbReadOpcode(PC.W++);
+   tempValue=gbReadOperand(PC.W++);
    AF.B.B1^=tempValue;
    AF.B.B0=ZeroTable[AF.B.B1];
    break;
@@ -1326,7 +1326,7 @@ case 0x38:
    break;
  case 0xf0:
    // LD A,(FF00+NN)
-   AF.B.B1 = gbReadMemory(0xff00+gbReadOpcode(PC.W++));
+   AF.B.B1 = gbReadMemory(0xff00+gbReadOperand(PC.W++));
    break;
  case 0xf1:
    // POP AF
@@ -1354,7 +1354,7 @@ case 0x38:
    break;
  case 0xf6:
    // OR NN
-   tempValue=gbReadOpcode(PC.W++);
+   tempValue=gbReadOperand(PC.W++);
    AF.B.B1|=tempValue;
    AF.B.B0=ZeroTable[AF.B.B1];
    break;
@@ -1366,7 +1366,7 @@ case 0x38:
    break;
  case 0xf8:
    // LD HL,SP+NN
-   offset = (s8)gbReadOpcode(PC.W++);
+   offset = (s8)gbReadOperand(PC.W++);
    tempRegister.W = SP.W + offset;
    AF.B.B0 = ((SP.W^offset^tempRegister.W)&0x100? C_FLAG : 0) |
              ((SP.W^offset^tempRegister.W)& 0x10? H_FLAG : 0);
@@ -1378,8 +1378,8 @@ case 0x38:
    break;
  case 0xfa:
    // LD A,(NNNN)
-   tempRegister.B.B0=gbReadOpcode(PC.W++);
-   tempRegister.B.B1=gbReadOpcode(PC.W++);
+   tempRegister.B.B0=gbReadOperand(PC.W++);
+   tempRegister.B.B1=gbReadOperand(PC.W++);
    AF.B.B1=gbReadMemory(tempRegister.W);
    break;
  case 0xfb:
@@ -1403,7 +1403,7 @@ case 0x38:
    break;
  case 0xfe:
    // CP NN
-   tempValue=gbReadOpcode(PC.W++);
+   tempValue=gbReadOperand(PC.W++);
    tempRegister.W=AF.B.B1-tempValue;
    AF.B.B0= N_FLAG|(tempRegister.B.B1?C_FLAG:0)|ZeroTable[tempRegister.B.B0]|
      ((AF.B.B1^tempValue^tempRegister.B.B0)&0x10?H_FLAG:0);
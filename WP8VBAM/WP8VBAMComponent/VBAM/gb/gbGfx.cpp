@@ -40,10 +40,144 @@ u8 gbInvertTab[256] = {
   0x1f,0x9f,0x5f,0xdf,0x3f,0xbf,0x7f,0xff
 };
 
-u16 gbLineMix[160];
-u16 gbWindowColor[160];
-extern int inUseRegister_WY;
-extern int layerSettings;
+CORE_LOCAL u16 gbLineMix[160];
+CORE_LOCAL u16 gbWindowColor[160];
+CORE_LOCAL u16 gbPaletteColor16[GB_COLOR_COUNT];
+CORE_LOCAL u32 gbPaletteColor32[GB_COLOR_COUNT];
+extern CORE_LOCAL int inUseRegister_WY;
+extern CORE_LOCAL int layerSettings;
+extern int systemColorDepth;
+
+bool gbFastLineEnabled = true;
+
+// gbTileExpand[b] holds one byte per pixel of the tile row byte b, leftmost
+// pixel first, so a 2bpp row decodes with two lookups and an or.
+static CORE_LOCAL u64 gbTileExpand[256];
+static CORE_LOCAL bool gbTileExpandInit = false;
+
+static void gbInitTileExpand()
+{
+  for(int b = 0; b < 256; b++) {
+    u8 *pixels = (u8 *)&gbTileExpand[b];
+    for(int i = 0; i < 8; i++)
+      pixels[i] = (b >> (7 - i)) & 1;
+  }
+  gbTileExpandInit = true;
+}
+
+// The SCX/SCY/BGP line arrays are filled from the write position to the
+// end, so a line with no mid-line write holds a single value.
+static bool gbLineStable(const u8 *line)
+{
+  return memcmp(line, line + 1, 299) == 0;
+}
+
+static inline u16 gbFilterColor(u16 color)
+{
+  return gbColorOption ? gbColorFilter[color & 0x7FFF] : color & 0x7FFF;
+}
+
+static void gbSetPaletteColor(int index, u16 color)
+{
+  if(systemColorDepth == 16)
+    gbPaletteColor16[index] = utilColor16(color);
+  else
+    gbPaletteColor32[index] = utilColor32(color);
+}
+
+// Called whenever gbPalette[index] changes
+void gbUpdatePaletteColor(int index)
+{
+  gbSetPaletteColor(GB_COLOR_PALETTE + index, gbFilterColor(gbPalette[index]));
+}
+
+// Called after bulk gbPalette changes and when the colour maps are rebuilt
+void gbUpdatePaletteColors()
+{
+  gbSetPaletteColor(GB_COLOR_CLEAR, 0);
+  gbSetPaletteColor(GB_COLOR_WHITE, gbFilterColor(0x7FFF));
+  gbSetPaletteColor(GB_COLOR_BLACK, gbFilterColor(0));
+  for(int i = 0; i < 128; i++)
+    gbUpdatePaletteColor(i);
+}
+
+// Background layer of a line without mid-line scroll or palette writes:
+// the palette indices are resolved once for the line and each tile row is decoded
+// through gbTileExpand. Produces the same gbLineMix/gbLineBuffer as the
+// per-pixel loop in gbRenderLine.
+static void gbRenderBackgroundLine(u8 *bank0, u8 *bank1, int tile_map,
+                                   int tile_pattern, int y)
+{
+  if(!gbTileExpandInit)
+    gbInitTileExpand();
+
+  int sx = gbSCXLine[0];
+  int sy = (gbSCYLine[0] + y) & 255;
+  int by = sy & 7;
+  int tile_map_line_y = tile_map + (sy >> 3) * 32;
+  bool sgb = gbSgbMode && !gbCgbMode;
+
+  u16 colors[32];
+  if(gbCgbMode) {
+    for(int i = 0; i < 32; i++)
+      colors[i] = GB_COLOR_PALETTE + i;
+  } else {
+    int bgp = gbBgpLine[0];
+    int palettes = sgb ? 4 : 1;
+    for(int p = 0; p < palettes; p++) {
+      for(int c = 0; c < 4; c++) {
+        int shade = (bgp >> (c << 1)) & 3;
+        colors[p * 4 + c] = GB_COLOR_PALETTE + (shade ? shade + 4 * p : 0);
+      }
+    }
+  }
+
+  const u8 *atf = &gbSgbATF[(y >> 3) * 20];
+  int tx = sx >> 3;
+  int x = -(sx & 7);
+  while(x < 160) {
+    int tile_map_address = tile_map_line_y + tx;
+    u8 attrs = 0;
+    if(bank1 != NULL)
+      attrs = bank1[tile_map_address];
+    u8 tile = bank0[tile_map_address];
+    if(!(register_LCDC & 0x10))
+      tile ^= 0x80;
+
+    const u8 *bank = (attrs & 0x08) ? bank1 : bank0;
+    int tile_pattern_address = tile_pattern + tile * 16 +
+      ((attrs & 0x40) ? 7 - by : by) * 2;
+    u8 tile_a = bank[tile_pattern_address];
+    u8 tile_b = bank[tile_pattern_address + 1];
+    if(attrs & 0x20) {
+      tile_a = gbInvertTab[tile_a];
+      tile_b = gbInvertTab[tile_b];
+    }
+
+    u64 row = gbTileExpand[tile_a] | (gbTileExpand[tile_b] << 1);
+    const u8 *pixels = (const u8 *)&row;
+    u16 prio = (attrs & 0x80) ? 0x300 : 0;
+    const u16 *pal = &colors[(attrs & 7) * 4];
+    int start = x < 0 ? -x : 0;
+    int end = x > 152 ? 160 - x : 8;
+    if(sgb) {
+      for(int i = start; i < end; i++) {
+        u8 c = pixels[i];
+        gbLineBuffer[x + i] = c;
+        gbLineMix[x + i] = colors[atf[(x + i) >> 3] * 4 + c];
+      }
+    } else {
+      for(int i = start; i < end; i++) {
+        u8 c = pixels[i];
+        gbLineBuffer[x + i] = c | prio;
+        gbLineMix[x + i] = pal[c];
+      }
+    }
+
+    x += 8;
+    tx = (tx + 1) & 0x1f;
+  }
+}
 
 void gbRenderLine()
 {
@@ -106,6 +240,13 @@ void gbRenderLine()
 
   if(register_LCDC & 0x80) {
     if((register_LCDC & 0x01 || gbCgbMode) && (layerSettings & 0x0100)) {
+      // the per-pixel loop below is only needed for mid-line writes
+      if(gbFastLineEnabled && gbLineStable(gbSCXLine) &&
+         gbLineStable(gbSCYLine) && gbLineStable(gbBgpLine)) {
+        gbRenderBackgroundLine(bank0, bank1, tile_map, tile_pattern, y);
+        x = 160;
+      }
+
       while(x < 160) {
 
 
@@ -155,8 +296,7 @@ void gbRenderLine()
               c = c + 4*palette;
             }
           }
-          gbLineMix[x] = gbColorOption ? gbColorFilter[gbPalette[c] & 0x7FFF] :
-            gbPalette[c] & 0x7FFF;
+          gbLineMix[x] = GB_COLOR_PALETTE + c;
           x++;
           if(x >= 160)
             break;
@@ -204,11 +344,9 @@ void gbRenderLine()
       // Also added the gbColorOption (fixes Dracula Densetsu II color problems)
       for(int i = 0; i < 160; i++)
       {
-        u16 color = gbColorOption ? gbColorFilter[0x7FFF] :
-                    0x7FFF;
+        u16 color = GB_COLOR_WHITE;
         if (!gbCgbMode)
-        color = gbColorOption ? gbColorFilter[gbPalette[gbBgpLine[i+(gbSpeed ? 5 : 11)+gbSpritesTicks[i]*(gbSpeed ? 2 : 4)]&3] & 0x7FFF] :
-                gbPalette[gbBgpLine[i+(gbSpeed ? 5 : 11)+gbSpritesTicks[i]*(gbSpeed ? 2 : 4)]&3] & 0x7FFF;
+        color = GB_COLOR_PALETTE + (gbBgpLine[i+(gbSpeed ? 5 : 11)+gbSpritesTicks[i]*(gbSpeed ? 2 : 4)]&3);
         gbLineMix[i] = color;
         gbLineBuffer[i] = 0;
       }
@@ -352,8 +490,7 @@ void gbRenderLine()
                   c = c + 4*palette;
                 }
               }
-              gbLineMix[x] = gbColorOption ? gbColorFilter[gbPalette[c] & 0x7FFF] :
-                gbPalette[c] & 0x7FFF;
+              gbLineMix[x] = GB_COLOR_PALETTE + c;
               }
               x++;
               if(x >= 160)
@@ -390,11 +527,9 @@ void gbRenderLine()
         gbWindowLine = 0;
     }
   } else {
-    u16 color = gbColorOption ? gbColorFilter[0x7FFF] :
-                0x7FFF;
+    u16 color = GB_COLOR_WHITE;
     if (!gbCgbMode)
-    color = gbColorOption ? gbColorFilter[gbPalette[0] & 0x7FFF] :
-            gbPalette[0] & 0x7FFF;
+    color = GB_COLOR_PALETTE;
     for(int i = 0; i < 160; i++)
     {
       gbLineMix[i] = color;
@@ -521,8 +656,7 @@ void gbDrawSpriteTile(int tile, int x,int y,int t, int flags,
       }
     }
 
-    gbLineMix[xxx] = gbColorOption ? gbColorFilter[gbPalette[c] & 0x7FFF] :
-      gbPalette[c] & 0x7FFF;
+    gbLineMix[xxx] = GB_COLOR_PALETTE + c;
   }
 }
 
@@ -1,40 +1,40 @@
 #include <cstdlib>
 #include "../common/Types.h"
 
-u8 *gbMemoryMap[16];
+CORE_LOCAL u8 *gbMemoryMap[16];
 
-int gbRomSizeMask = 0;
-int gbRomSize = 0;
-int gbRamSizeMask = 0;
-int gbRamSize = 0;
-int gbTAMA5ramSize = 0;
+CORE_LOCAL int gbRomSizeMask = 0;
+CORE_LOCAL int gbRomSize = 0;
+CORE_LOCAL int gbRamSizeMask = 0;
+CORE_LOCAL int gbRamSize = 0;
+CORE_LOCAL int gbTAMA5ramSize = 0;
 
-u8 *gbMemory = NULL;
-u8 *gbVram = NULL;
-u8 *gbRom = NULL;
-u8 *gbRam = NULL;
-u8 *gbWram = NULL;
-u16 *gbLineBuffer = NULL;
-u8 *gbTAMA5ram = NULL;
+CORE_LOCAL u8 *gbMemory = NULL;
+CORE_LOCAL u8 *gbVram = NULL;
+CORE_LOCAL u8 *gbRom = NULL;
+CORE_LOCAL u8 *gbRam = NULL;
+CORE_LOCAL u8 *gbWram = NULL;
+CORE_LOCAL u16 *gbLineBuffer = NULL;
+CORE_LOCAL u8 *gbTAMA5ram = NULL;
 
-u16 gbPalette[128];
-u8 gbBgp[4]  = { 0, 1, 2, 3};
-u8 gbObp0[4] = { 0, 1, 2, 3};
-u8 gbObp1[4] = { 0, 1, 2, 3};
-int gbWindowLine = -1;
+CORE_LOCAL u16 gbPalette[128];
+CORE_LOCAL u8 gbBgp[4]  = { 0, 1, 2, 3};
+CORE_LOCAL u8 gbObp0[4] = { 0, 1, 2, 3};
+CORE_LOCAL u8 gbObp1[4] = { 0, 1, 2, 3};
+CORE_LOCAL int gbWindowLine = -1;
 
-bool genericflashcardEnable = false;
-int gbCgbMode = 0;
+CORE_LOCAL bool genericflashcardEnable = false;
+CORE_LOCAL int gbCgbMode = 0;
 
 u16 gbColorFilter[32768];
-int gbColorOption = 0;
-int gbPaletteOption = 0;
-int gbEmulatorType = 0;
-int gbBorderOn = 0;
-int gbBorderAutomatic = 0;
-int gbBorderLineSkip = 160;
-int gbBorderRowSkip = 0;
-int gbBorderColumnSkip = 0;
-int gbDmaTicks = 0;
+CORE_LOCAL int gbColorOption = 0;
+CORE_LOCAL int gbPaletteOption = 0;
+CORE_LOCAL int gbEmulatorType = 0;
+CORE_LOCAL int gbBorderOn = 0;
+CORE_LOCAL int gbBorderAutomatic = 0;
+CORE_LOCAL int gbBorderLineSkip = 160;
+CORE_LOCAL int gbBorderRowSkip = 0;
+CORE_LOCAL int gbBorderColumnSkip = 0;
+CORE_LOCAL int gbDmaTicks = 0;
 
-u8 (*gbSerialFunction)(u8) = NULL;
+CORE_LOCAL u8 (*gbSerialFunction)(u8) = NULL;
@@ -1,78 +1,93 @@
 #ifndef GBGLOBALS_H
 #define GBGLOBALS_H
 
-extern int gbRomSizeMask;
-extern int gbRomSize;
-extern int gbRamSize;
-extern int gbRamSizeMask;
-extern int gbTAMA5ramSize;
+extern CORE_LOCAL int gbRomSizeMask;
+extern CORE_LOCAL int gbRomSize;
+extern CORE_LOCAL int gbRamSize;
+extern CORE_LOCAL int gbRamSizeMask;
+extern CORE_LOCAL int gbTAMA5ramSize;
 
-extern bool useBios;
-extern bool skipBios;
-extern u8 *bios;
-extern bool skipSaveGameBattery;
-extern bool skipSaveGameCheats;
+extern CORE_LOCAL bool useBios;
+extern CORE_LOCAL bool skipBios;
+extern CORE_LOCAL u8 *bios;
+extern CORE_LOCAL bool skipSaveGameBattery;
+extern CORE_LOCAL bool skipSaveGameCheats;
 
-extern u8 *gbRom;
-extern u8 *gbRam;
-extern u8 *gbVram;
-extern u8 *gbWram;
-extern u8 *gbMemory;
-extern u16 *gbLineBuffer;
-extern u8 *gbTAMA5ram;
+extern CORE_LOCAL u8 *gbRom;
+extern CORE_LOCAL u8 *gbRam;
+extern CORE_LOCAL u8 *gbVram;
+extern CORE_LOCAL u8 *gbWram;
+extern CORE_LOCAL u8 *gbMemory;
+extern CORE_LOCAL u16 *gbLineBuffer;
+extern CORE_LOCAL u8 *gbTAMA5ram;
 
-extern u8 *gbMemoryMap[16];
+extern CORE_LOCAL u8 *gbMemoryMap[16];
 
-extern int gbFrameSkip;
+extern CORE_LOCAL int gbFrameSkip;
 extern u16 gbColorFilter[32768];
-extern int gbColorOption;
-extern int gbPaletteOption;
-extern int gbEmulatorType;
-extern int gbBorderOn;
-extern int gbBorderAutomatic;
-extern int gbCgbMode;
-extern int gbSgbMode;
-extern int gbWindowLine;
-extern int gbSpeed;
-extern u8 gbBgp[4];
-extern u8 gbObp0[4];
-extern u8 gbObp1[4];
-extern u16 gbPalette[128];
-extern bool gbScreenOn;
+extern CORE_LOCAL int gbColorOption;
+extern CORE_LOCAL int gbPaletteOption;
+extern CORE_LOCAL int gbEmulatorType;
+extern CORE_LOCAL int gbBorderOn;
+extern CORE_LOCAL int gbBorderAutomatic;
+extern CORE_LOCAL int gbCgbMode;
+extern CORE_LOCAL int gbSgbMode;
+extern CORE_LOCAL int gbWindowLine;
+extern CORE_LOCAL int gbSpeed;
+extern CORE_LOCAL u8 gbBgp[4];
+extern CORE_LOCAL u8 gbObp0[4];
+extern CORE_LOCAL u8 gbObp1[4];
+extern CORE_LOCAL u16 gbPalette[128];
+extern CORE_LOCAL bool gbScreenOn;
 extern bool gbDrawWindow;
-extern u8 gbSCYLine[300];
+extern CORE_LOCAL u8 gbSCYLine[300];
 // gbSCXLine is used for the emulation (bug) of the SX change
 // found in the Artic Zone game.
-extern u8 gbSCXLine[300];
+extern CORE_LOCAL u8 gbSCXLine[300];
 // gbBgpLine is used for the emulation of the
 // Prehistorik Man's title screen scroller.
-extern u8 gbBgpLine[300];
-extern u8 gbObp0Line [300];
-extern u8 gbObp1Line [300];
+extern CORE_LOCAL u8 gbBgpLine[300];
+extern CORE_LOCAL u8 gbObp0Line [300];
+extern CORE_LOCAL u8 gbObp1Line [300];
 // gbSpritesTicks is used for the emulation of Parodius' Laser Beam.
-extern u8 gbSpritesTicks[300];
+extern CORE_LOCAL u8 gbSpritesTicks[300];
 
-extern u8 register_LCDC;
-extern u8 register_LY;
-extern u8 register_SCY;
-extern u8 register_SCX;
-extern u8 register_WY;
-extern u8 register_WX;
-extern u8 register_VBK;
-extern u8 oldRegister_WY;
+extern CORE_LOCAL u8 register_LCDC;
+extern CORE_LOCAL u8 register_LY;
+extern CORE_LOCAL u8 register_SCY;
+extern CORE_LOCAL u8 register_SCX;
+extern CORE_LOCAL u8 register_WY;
+extern CORE_LOCAL u8 register_WX;
+extern CORE_LOCAL u8 register_VBK;
+extern CORE_LOCAL u8 oldRegister_WY;
 
-extern int emulating;
-extern bool genericflashcardEnable;
+extern CORE_LOCAL int emulating;
+extern CORE_LOCAL bool genericflashcardEnable;
 
-extern int gbBorderLineSkip;
-extern int gbBorderRowSkip;
-extern int gbBorderColumnSkip;
-extern int gbDmaTicks;
+extern CORE_LOCAL int gbBorderLineSkip;
+extern CORE_LOCAL int gbBorderRowSkip;
+extern CORE_LOCAL int gbBorderColumnSkip;
+extern CORE_LOCAL int gbDmaTicks;
 
+extern bool gbFastLineEnabled;
 extern void gbRenderLine();
 extern void gbDrawSprites(bool);
 
-extern u8 (*gbSerialFunction)(u8);
+// gbLineMix holds indices into gbPaletteColor16/32: the gbPalette entries in
+// the output format, with gbColorFilter and the LCD filter applied, after the
+// fixed colours the renderer uses. Only the table of the current
+// systemColorDepth is kept up to date.
+#define GB_COLOR_CLEAR   0  // black, unfiltered
+#define GB_COLOR_WHITE   1
+#define GB_COLOR_BLACK   2
+#define GB_COLOR_PALETTE 3  // gbPalette[0]
+#define GB_COLOR_COUNT   (GB_COLOR_PALETTE + 128)
+extern CORE_LOCAL u16 gbPaletteColor16[GB_COLOR_COUNT];
+extern CORE_LOCAL u32 gbPaletteColor32[GB_COLOR_COUNT];
+extern void gbUpdatePaletteColor(int index);
+extern void gbUpdatePaletteColors();
+
+extern CORE_LOCAL u8 (*gbSerialFunction)(u8);
 
 
 #endif // GBGLOBALS_H
@@ -5,10 +5,10 @@
 #include "gb.h"
 u8 gbDaysinMonth [12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
 const u8 gbDisabledRam [8] = {0x80, 0xff, 0xf0, 0x00, 0x30, 0xbf, 0xbf, 0xbf};
-extern int gbGBCColorType;
-extern gbRegister PC;
+extern CORE_LOCAL int gbGBCColorType;
+extern CORE_LOCAL gbRegister PC;
 
-mapperMBC1 gbDataMBC1 = {
+CORE_LOCAL mapperMBC1 gbDataMBC1 = {
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -244,7 +244,7 @@ void memoryUpdateMapMBC1()
   }
 }
 
-mapperMBC2 gbDataMBC2 = {
+CORE_LOCAL mapperMBC2 gbDataMBC2 = {
   0, // RAM enable
   1  // ROM bank
 };
@@ -304,7 +304,7 @@ void memoryUpdateMapMBC2()
   gbMemoryMap[0x07] = &gbRom[tmpAddress + 0x3000];
 }
 
-mapperMBC3 gbDataMBC3 = {
+CORE_LOCAL mapperMBC3 gbDataMBC3 = {
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -530,7 +530,7 @@ void memoryUpdateMapMBC3()
   }
 }
 
-mapperMBC5 gbDataMBC5 = {
+CORE_LOCAL mapperMBC5 gbDataMBC5 = {
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -661,7 +661,7 @@ void memoryUpdateMapMBC5()
   }
 }
 
-mapperMBC7 gbDataMBC7 = {
+CORE_LOCAL mapperMBC7 gbDataMBC7 = {
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -925,7 +925,7 @@ void memoryUpdateMapMBC7()
   gbMemoryMap[0x07] = &gbRom[tmpAddress + 0x3000];
 }
 
-mapperHuC1 gbDataHuC1 = {
+CORE_LOCAL mapperHuC1 gbDataHuC1 = {
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -1019,7 +1019,7 @@ void memoryUpdateMapHuC1()
   }
 }
 
-mapperHuC3 gbDataHuC3 = {
+CORE_LOCAL mapperHuC3 gbDataHuC3 = {
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -1167,7 +1167,7 @@ void memoryUpdateMapHuC3()
 
 // TAMA5 (for Tamagotchi 3 (gb)).
 // Very basic (and ugly :p) support, only rom bank switching is actually working...
-mapperTAMA5 gbDataTAMA5 = {
+CORE_LOCAL mapperTAMA5 gbDataTAMA5 = {
   1, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -1520,7 +1520,7 @@ void memoryUpdateMapTAMA5()
 }
 
 // MMM01 Used in Momotarou collection (however the rom is corrupted)
-mapperMMM01 gbDataMMM01 ={
+CORE_LOCAL mapperMMM01 gbDataMMM01 ={
   0, // RAM enable
   1, // ROM bank
   0, // RAM bank
@@ -1660,7 +1660,7 @@ void mapperGGROM(u16 address, u8 value)
 
 
 // GS3 Used to emulate the GS V3.0 rom bank switching
-mapperGS3 gbDataGS3 = { 1 }; // ROM bank
+CORE_LOCAL mapperGS3 gbDataGS3 = { 1 }; // ROM bank
 
 void mapperGS3ROM(u16 address, u8 value)
 {
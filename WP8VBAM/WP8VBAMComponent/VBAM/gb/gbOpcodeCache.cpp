@@ -0,0 +1,88 @@
+#include "gbOpcodeCache.h"
+#include "gbCheats.h"
+
+extern int gbCycles[];
+extern int gbCyclesCB[];
+
+bool gbOpcodeCacheEnabled = true;
+// starts at 1 so the zero-filled table never matches
+CORE_LOCAL u32 gbOpcodeCacheFlushes = 1;
+CORE_LOCAL gbCachedOpcode gbOpcodeCache[GB_OPCODE_CACHE_SIZE];
+
+// Immediate operand bytes following each opcode (CB instructions have none).
+static const u8 gbOperandBytes[256] = {
+//0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f
+  0, 2, 0, 0, 0, 0, 1, 0, 2, 0, 0, 0, 0, 0, 1, 0, // 0
+  1, 2, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1, 0, // 1
+  1, 2, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1, 0, // 2
+  1, 2, 0, 0, 0, 0, 1, 0, 1, 0, 0, 0, 0, 0, 1, 0, // 3
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 4
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 5
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 6
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 7
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 8
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 9
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // a
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // b
+  0, 0, 2, 2, 2, 0, 1, 0, 0, 0, 2, 0, 2, 2, 1, 0, // c
+  0, 0, 2, 0, 2, 0, 1, 0, 0, 0, 2, 0, 2, 0, 1, 0, // d
+  1, 0, 0, 0, 0, 0, 1, 0, 1, 0, 2, 0, 0, 0, 1, 0, // e
+  1, 0, 0, 0, 0, 0, 1, 0, 1, 0, 2, 0, 0, 0, 1, 0  // f
+};
+
+// Called whenever ROM contents may have changed under a mapped page: a new
+// ROM, a reset, a loaded state, the boot ROM unmapping itself or a change
+// to the cheat map.
+void gbOpcodeCacheFlush()
+{
+  gbOpcodeCacheFlushes++;
+}
+
+static bool gbOpcodeCacheable(u16 address)
+{
+  const u8 *page = gbMemoryMap[address >> 12];
+  return address < 0x8000 && gbRom != NULL && page >= gbRom &&
+         page < gbRom + gbRomSize && !gbCheatMap[address];
+}
+
+gbCachedOpcode *gbOpcodeCacheBuild(u16 address)
+{
+  if(!gbOpcodeCacheable(address))
+    return NULL;
+
+  const u8 *page = gbMemoryMap[address >> 12];
+  u8 opcode = page[address & 0x0fff];
+  u8 opcode2 = opcode;
+  int length = 1;
+  int ticks = gbCycles[opcode];
+  if(opcode == 0xCB) {
+    // the extended opcode must come from the same page
+    u16 next = address + 1;
+    if((next >> 12) != (address >> 12) || gbCheatMap[next])
+      return NULL;
+    opcode2 = page[next & 0x0fff];
+    length = 2;
+    ticks = gbCyclesCB[opcode2];
+  }
+
+  // the operands must come from the same page, unpatched
+  u8 operands[2] = { 0, 0 };
+  for(int i = 0; i < gbOperandBytes[opcode]; i++) {
+    u16 next = address + 1 + i;
+    if((next >> 12) != (address >> 12) || gbCheatMap[next])
+      return NULL;
+    operands[i] = page[next & 0x0fff];
+  }
+
+  gbCachedOpcode *entry = &gbOpcodeCache[address & (GB_OPCODE_CACHE_SIZE - 1)];
+  entry->page = page;
+  entry->flushes = gbOpcodeCacheFlushes;
+  entry->address = address;
+  entry->opcode1 = opcode;
+  entry->opcode2 = opcode2;
+  entry->length = length;
+  entry->ticks = ticks;
+  entry->operands[0] = operands[0];
+  entry->operands[1] = operands[1];
+  return entry;
+}
@@ -0,0 +1,50 @@
+#ifndef GBOPCODECACHE_H
+#define GBOPCODECACHE_H
+
+#include "../common/Types.h"
+#include "gbGlobals.h"
+
+// Pre-decoded opcodes for code running from cartridge ROM.
+//
+// Each entry holds what gbEmulate needs to dispatch an instruction: the
+// switch keys (0xCB plus the extended opcode for CB instructions), the
+// opcode length, the cycle count and the immediate operand bytes, which
+// gbCodes.h reads through gbReadOperand instead of gbReadOpcode. Entries are tagged with the
+// gbMemoryMap page they were decoded from, so an MBC bank switch, which
+// remaps the page, makes them miss without any hook in the mappers.
+//
+// Only pages that point into gbRom are cached. Code in WRAM/HRAM, the boot
+// ROM, addresses patched by Game Genie codes and instructions whose operands
+// run into the next page take the gbReadOpcode path.
+
+#define GB_OPCODE_CACHE_SIZE 4096
+
+struct gbCachedOpcode {
+  const u8 *page;
+  u32 flushes;
+  u16 address;
+  u8 opcode1;
+  u8 opcode2;
+  u8 length;
+  u8 ticks;
+  u8 operands[2];
+};
+
+extern bool gbOpcodeCacheEnabled;
+extern CORE_LOCAL u32 gbOpcodeCacheFlushes;
+extern CORE_LOCAL gbCachedOpcode gbOpcodeCache[GB_OPCODE_CACHE_SIZE];
+
+extern void gbOpcodeCacheFlush();
+extern gbCachedOpcode *gbOpcodeCacheBuild(u16 address);
+
+// Returns NULL if the instruction at address cannot be cached.
+static inline gbCachedOpcode *gbOpcodeCacheFind(u16 address)
+{
+  gbCachedOpcode *entry = &gbOpcodeCache[address & (GB_OPCODE_CACHE_SIZE - 1)];
+  if(entry->address == address && entry->page == gbMemoryMap[address >> 12] &&
+     entry->flushes == gbOpcodeCacheFlushes)
+    return entry;
+  return gbOpcodeCacheBuild(address);
+}
+
+#endif // GBOPCODECACHE_H
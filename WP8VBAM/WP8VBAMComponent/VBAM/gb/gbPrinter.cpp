@@ -2,14 +2,14 @@
 #include <memory.h>
 #include "../System.h"
 
-u8 gbPrinterStatus = 0;
-int gbPrinterState = 0;
-u8 gbPrinterData[0x280*9];
-u8 gbPrinterPacket[0x400];
-int gbPrinterCount = 0;
-int gbPrinterDataCount = 0;
-int gbPrinterDataSize = 0;
-int gbPrinterResult = 0;
+CORE_LOCAL u8 gbPrinterStatus = 0;
+CORE_LOCAL int gbPrinterState = 0;
+CORE_LOCAL u8 gbPrinterData[0x280*9];
+CORE_LOCAL u8 gbPrinterPacket[0x400];
+CORE_LOCAL int gbPrinterCount = 0;
+CORE_LOCAL int gbPrinterDataCount = 0;
+CORE_LOCAL int gbPrinterDataSize = 0;
+CORE_LOCAL int gbPrinterResult = 0;
 
 bool gbPrinterCheckCRC()
 {
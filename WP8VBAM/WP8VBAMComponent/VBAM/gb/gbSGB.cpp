@@ -7,36 +7,36 @@
 #include "gb.h"
 #include "gbGlobals.h"
 
-extern u8 *pix;
-extern bool speedup;
-extern bool gbSgbResetFlag;
+extern CORE_LOCAL u8 *pix;
+extern CORE_LOCAL bool speedup;
+extern CORE_LOCAL bool gbSgbResetFlag;
 
 #define GBSGB_NONE            0
 #define GBSGB_RESET           1
 #define GBSGB_PACKET_TRANSMIT 2
 
-u8 *gbSgbBorderChar = NULL;
-u8 *gbSgbBorder = NULL;
-
-int gbSgbCGBSupport        = 0;
-int gbSgbMask              = 0;
-int gbSgbMode              = 0;
-int gbSgbPacketState       = GBSGB_NONE;
-int gbSgbBit               = 0;
-int gbSgbPacketTimeout     = 0;
-int GBSGB_PACKET_TIMEOUT   = 66666;
-u8  gbSgbPacket[16*7];
-int gbSgbPacketNBits       = 0;
-int gbSgbPacketByte        = 0;
-int gbSgbPacketNumber      = 0;
-int gbSgbMultiplayer       = 0;
-int gbSgbFourPlayers       = 0;
-u8  gbSgbNextController    = 0x0f;
-u8  gbSgbReadingController = 0;
-u16 gbSgbSCPPalette[4*512];
-u8  gbSgbATF[20 * 18];
-u8  gbSgbATFList[45 * 20 * 18];
-u8  gbSgbScreenBuffer[4160];
+CORE_LOCAL u8 *gbSgbBorderChar = NULL;
+CORE_LOCAL u8 *gbSgbBorder = NULL;
+
+CORE_LOCAL int gbSgbCGBSupport        = 0;
+CORE_LOCAL int gbSgbMask              = 0;
+CORE_LOCAL int gbSgbMode              = 0;
+CORE_LOCAL int gbSgbPacketState       = GBSGB_NONE;
+CORE_LOCAL int gbSgbBit               = 0;
+CORE_LOCAL int gbSgbPacketTimeout     = 0;
+CORE_LOCAL int GBSGB_PACKET_TIMEOUT   = 66666;
+CORE_LOCAL u8  gbSgbPacket[16*7];
+CORE_LOCAL int gbSgbPacketNBits       = 0;
+CORE_LOCAL int gbSgbPacketByte        = 0;
+CORE_LOCAL int gbSgbPacketNumber      = 0;
+CORE_LOCAL int gbSgbMultiplayer       = 0;
+CORE_LOCAL int gbSgbFourPlayers       = 0;
+CORE_LOCAL u8  gbSgbNextController    = 0x0f;
+CORE_LOCAL u8  gbSgbReadingController = 0;
+CORE_LOCAL u16 gbSgbSCPPalette[4*512];
+CORE_LOCAL u8  gbSgbATF[20 * 18];
+CORE_LOCAL u8  gbSgbATFList[45 * 20 * 18];
+CORE_LOCAL u8  gbSgbScreenBuffer[4160];
 
 inline void gbSgbDraw24Bit(u8 *p, u16 v)
 {
@@ -85,6 +85,7 @@ void gbSgbReset()
     gbPalette[i*4+2] = (0x0c) | (0x0c << 5) | (0x0c << 10);
     gbPalette[i*4+3] = 0;
   }
+  gbUpdatePaletteColors();
 }
 
 void gbSgbInit()
@@ -303,6 +304,7 @@ void gbSgbPicture()
   for(int i = 64; i < 128; i++) {
     gbPalette[i] = READ16LE(paletteAddr++);
   }
+  gbUpdatePaletteColors();
 
   gbSgbCGBSupport |= 4;
 
@@ -340,6 +342,7 @@ void gbSgbSetPalette(int a,int b,u16 *p)
   }
 
   gbPalette[0] = gbPalette[4] = gbPalette[8] = gbPalette[12] = bit00;
+  gbUpdatePaletteColors();
   if(gbBorderOn && !gbSgbMask)
     gbSgbRenderBorder();
 }
@@ -383,6 +386,7 @@ void gbSgbSetPalette()
 
   pal = READ16LE((((u16 *)&gbSgbPacket[7])))&511;
   memcpy(&gbPalette[12], &gbSgbSCPPalette[pal*4], 4 * sizeof(u16));
+  gbUpdatePaletteColors();
 
   u8 atf = gbSgbPacket[9];
 
@@ -844,36 +848,48 @@ void gbSgbDoBitTransfer(u8 value)
   }
 }
 
-variable_desc gbSgbSaveStruct[] = {
-  { &gbSgbMask, sizeof(int) },
-  { &gbSgbPacketState, sizeof(int) },
-  { &gbSgbBit, sizeof(int) },
-  { &gbSgbPacketNBits, sizeof(int) },
-  { &gbSgbPacketByte, sizeof(int) },
-  { &gbSgbPacketNumber, sizeof(int) },
-  { &gbSgbMultiplayer, sizeof(int) },
-  { &gbSgbNextController, sizeof(u8) },
-  { &gbSgbReadingController, sizeof(u8) },
-  { NULL, 0 }
-};
-
-variable_desc gbSgbSaveStructV3[] = {
-  { &gbSgbMask, sizeof(int) },
-  { &gbSgbPacketState, sizeof(int) },
-  { &gbSgbBit, sizeof(int) },
-  { &gbSgbPacketNBits, sizeof(int) },
-  { &gbSgbPacketByte, sizeof(int) },
-  { &gbSgbPacketNumber, sizeof(int) },
-  { &gbSgbMultiplayer, sizeof(int) },
-  { &gbSgbNextController, sizeof(u8) },
-  { &gbSgbReadingController, sizeof(u8) },
-  { &gbSgbFourPlayers, sizeof(int) },
-  { NULL, 0 }
-};
+static variable_desc *gbSgbSaveStruct()
+{
+  variable_desc data[] = {
+    { &gbSgbMask, sizeof(int) },
+    { &gbSgbPacketState, sizeof(int) },
+    { &gbSgbBit, sizeof(int) },
+    { &gbSgbPacketNBits, sizeof(int) },
+    { &gbSgbPacketByte, sizeof(int) },
+    { &gbSgbPacketNumber, sizeof(int) },
+    { &gbSgbMultiplayer, sizeof(int) },
+    { &gbSgbNextController, sizeof(u8) },
+    { &gbSgbReadingController, sizeof(u8) },
+    { NULL, 0 }
+  };
+  static CORE_LOCAL variable_desc table[sizeof(data) / sizeof(data[0])];
+  memcpy(table, data, sizeof(data));
+  return table;
+}
+
+static variable_desc *gbSgbSaveStructV3()
+{
+  variable_desc data[] = {
+    { &gbSgbMask, sizeof(int) },
+    { &gbSgbPacketState, sizeof(int) },
+    { &gbSgbBit, sizeof(int) },
+    { &gbSgbPacketNBits, sizeof(int) },
+    { &gbSgbPacketByte, sizeof(int) },
+    { &gbSgbPacketNumber, sizeof(int) },
+    { &gbSgbMultiplayer, sizeof(int) },
+    { &gbSgbNextController, sizeof(u8) },
+    { &gbSgbReadingController, sizeof(u8) },
+    { &gbSgbFourPlayers, sizeof(int) },
+    { NULL, 0 }
+  };
+  static CORE_LOCAL variable_desc table[sizeof(data) / sizeof(data[0])];
+  memcpy(table, data, sizeof(data));
+  return table;
+}
 
 void gbSgbSaveGame(gzFile gzFile)
 {
-  utilWriteData(gzFile, gbSgbSaveStructV3);
+  utilWriteData(gzFile, gbSgbSaveStructV3());
 
   utilGzWrite(gzFile, gbSgbBorder, 2048);
   utilGzWrite(gzFile, gbSgbBorderChar, 32*256);
@@ -888,9 +904,9 @@ void gbSgbSaveGame(gzFile gzFile)
 void gbSgbReadGame(gzFile gzFile, int version)
 {
   if(version >= 3)
-    utilReadData(gzFile, gbSgbSaveStructV3);
+    utilReadData(gzFile, gbSgbSaveStructV3());
   else {
-    utilReadData(gzFile, gbSgbSaveStruct);
+    utilReadData(gzFile, gbSgbSaveStruct());
     gbSgbFourPlayers = 0;
   }
 
@@ -11,13 +11,13 @@ void gbSgbSaveGame(gzFile);
 void gbSgbReadGame(gzFile, int version);
 void gbSgbRenderBorder();
 
-extern u8  gbSgbATF[20*18];
-extern int gbSgbMode;
-extern int gbSgbMask;
-extern int gbSgbMultiplayer;
-extern u8  gbSgbNextController;
-extern int gbSgbPacketTimeout;
-extern u8  gbSgbReadingController;
-extern int gbSgbFourPlayers;
+extern CORE_LOCAL u8  gbSgbATF[20*18];
+extern CORE_LOCAL int gbSgbMode;
+extern CORE_LOCAL int gbSgbMask;
+extern CORE_LOCAL int gbSgbMultiplayer;
+extern CORE_LOCAL u8  gbSgbNextController;
+extern CORE_LOCAL int gbSgbPacketTimeout;
+extern CORE_LOCAL u8  gbSgbReadingController;
+extern CORE_LOCAL int gbSgbFourPlayers;
 
 #endif // GBSGB_H
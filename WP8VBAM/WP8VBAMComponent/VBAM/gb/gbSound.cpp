@@ -13,13 +13,13 @@ extern long soundSampleRate; // current sound quality
 
 gb_effects_config_t gb_effects_config = { false, 0.20f, 0.15f, false };
 
-static gb_effects_config_t    gb_effects_config_current;
-static Simple_Effects_Buffer* stereo_buffer;
-static Gb_Apu*                gb_apu;
+static CORE_LOCAL gb_effects_config_t    gb_effects_config_current;
+static CORE_LOCAL Simple_Effects_Buffer* stereo_buffer;
+static CORE_LOCAL Gb_Apu*                gb_apu;
 
-static float soundVolume_  = -1;
-static int prevSoundEnable = -1;
-static bool declicking     = false;
+static CORE_LOCAL float soundVolume_  = -1;
+static CORE_LOCAL int prevSoundEnable = -1;
+static CORE_LOCAL bool declicking     = false;
 
 int const chan_count = 4;
 int const ticks_to_time = 2 * GB_APU_OVERCLOCK;
@@ -235,12 +235,12 @@ void gbSoundSetSampleRate( long sampleRate )
 	}
 }
 
-static struct {
+static CORE_LOCAL struct {
 	int version;
 	gb_apu_state_t apu;
 } state;
 
-static char dummy_state [735 * 2];
+static CORE_LOCAL char dummy_state [735 * 2];
 
 #define SKIP( type, name ) { dummy_state, sizeof (type) }
 
@@ -248,89 +248,107 @@ static char dummy_state [735 * 2];
 
 // Old save state support
 
-static variable_desc gbsound_format [] =
+static variable_desc *gbsound_format()
 {
-	SKIP( int, soundPaused ),
-	SKIP( int, soundPlay ),
-	SKIP( int, soundTicks ),
-	SKIP( int, SOUND_CLOCK_TICKS ),
-	SKIP( int, soundLevel1 ),
-	SKIP( int, soundLevel2 ),
-	SKIP( int, soundBalance ),
-	SKIP( int, soundMasterOn ),
-	SKIP( int, soundIndex ),
-	SKIP( int, soundVIN ),
-	SKIP( int, soundOn [0] ),
-	SKIP( int, soundATL [0] ),
-	SKIP( int, sound1Skip ),
-	SKIP( int, soundIndex [0] ),
-	SKIP( int, sound1Continue ),
-	SKIP( int, soundEnvelopeVolume [0] ),
-	SKIP( int, soundEnvelopeATL [0] ),
-	SKIP( int, sound1EnvelopeATLReload ),
-	SKIP( int, sound1EnvelopeUpDown ),
-	SKIP( int, sound1SweepATL ),
-	SKIP( int, sound1SweepATLReload ),
-	SKIP( int, sound1SweepSteps ),
-	SKIP( int, sound1SweepUpDown ),
-	SKIP( int, sound1SweepStep ),
-	SKIP( int, soundOn [1] ),
-	SKIP( int, soundATL [1] ),
-	SKIP( int, sound2Skip ),
-	SKIP( int, soundIndex [1] ),
-	SKIP( int, sound2Continue ),
-	SKIP( int, soundEnvelopeVolume [1] ),
-	SKIP( int, soundEnvelopeATL [1] ),
-	SKIP( int, sound2EnvelopeATLReload ),
-	SKIP( int, sound2EnvelopeUpDown ),
-	SKIP( int, soundOn [2] ),
-	SKIP( int, soundATL [2] ),
-	SKIP( int, sound3Skip ),
-	SKIP( int, soundIndex [2] ),
-	SKIP( int, sound3Continue ),
-	SKIP( int, sound3OutputLevel ),
-	SKIP( int, soundOn [3] ),
-	SKIP( int, soundATL [3] ),
-	SKIP( int, sound4Skip ),
-	SKIP( int, soundIndex [3] ),
-	SKIP( int, sound4Clock ),
-	SKIP( int, sound4ShiftRight ),
-	SKIP( int, sound4ShiftSkip ),
-	SKIP( int, sound4ShiftIndex ),
-	SKIP( int, sound4NSteps ),
-	SKIP( int, sound4CountDown ),
-	SKIP( int, sound4Continue ),
-	SKIP( int, soundEnvelopeVolume [2] ),
-	SKIP( int, soundEnvelopeATL [2] ),
-	SKIP( int, sound4EnvelopeATLReload ),
-	SKIP( int, sound4EnvelopeUpDown ),
-	SKIP( int, soundEnableFlag ),
-	{ NULL, 0 }
-};
+	variable_desc data [] =
+	{
+		SKIP( int, soundPaused ),
+		SKIP( int, soundPlay ),
+		SKIP( int, soundTicks ),
+		SKIP( int, SOUND_CLOCK_TICKS ),
+		SKIP( int, soundLevel1 ),
+		SKIP( int, soundLevel2 ),
+		SKIP( int, soundBalance ),
+		SKIP( int, soundMasterOn ),
+		SKIP( int, soundIndex ),
+		SKIP( int, soundVIN ),
+		SKIP( int, soundOn [0] ),
+		SKIP( int, soundATL [0] ),
+		SKIP( int, sound1Skip ),
+		SKIP( int, soundIndex [0] ),
+		SKIP( int, sound1Continue ),
+		SKIP( int, soundEnvelopeVolume [0] ),
+		SKIP( int, soundEnvelopeATL [0] ),
+		SKIP( int, sound1EnvelopeATLReload ),
+		SKIP( int, sound1EnvelopeUpDown ),
+		SKIP( int, sound1SweepATL ),
+		SKIP( int, sound1SweepATLReload ),
+		SKIP( int, sound1SweepSteps ),
+		SKIP( int, sound1SweepUpDown ),
+		SKIP( int, sound1SweepStep ),
+		SKIP( int, soundOn [1] ),
+		SKIP( int, soundATL [1] ),
+		SKIP( int, sound2Skip ),
+		SKIP( int, soundIndex [1] ),
+		SKIP( int, sound2Continue ),
+		SKIP( int, soundEnvelopeVolume [1] ),
+		SKIP( int, soundEnvelopeATL [1] ),
+		SKIP( int, sound2EnvelopeATLReload ),
+		SKIP( int, sound2EnvelopeUpDown ),
+		SKIP( int, soundOn [2] ),
+		SKIP( int, soundATL [2] ),
+		SKIP( int, sound3Skip ),
+		SKIP( int, soundIndex [2] ),
+		SKIP( int, sound3Continue ),
+		SKIP( int, sound3OutputLevel ),
+		SKIP( int, soundOn [3] ),
+		SKIP( int, soundATL [3] ),
+		SKIP( int, sound4Skip ),
+		SKIP( int, soundIndex [3] ),
+		SKIP( int, sound4Clock ),
+		SKIP( int, sound4ShiftRight ),
+		SKIP( int, sound4ShiftSkip ),
+		SKIP( int, sound4ShiftIndex ),
+		SKIP( int, sound4NSteps ),
+		SKIP( int, sound4CountDown ),
+		SKIP( int, sound4Continue ),
+		SKIP( int, soundEnvelopeVolume [2] ),
+		SKIP( int, soundEnvelopeATL [2] ),
+		SKIP( int, sound4EnvelopeATLReload ),
+		SKIP( int, sound4EnvelopeUpDown ),
+		SKIP( int, soundEnableFlag ),
+		{ NULL, 0 }
+	};
+	static CORE_LOCAL variable_desc table [sizeof data / sizeof *data];
+	memcpy( table, data, sizeof data );
+	return table;
+}
 
-static variable_desc gbsound_format2 [] =
+static variable_desc *gbsound_format2()
 {
-	SKIP( int, sound1ATLreload ),
-	SKIP( int, freq1low ),
-	SKIP( int, freq1high ),
-	SKIP( int, sound2ATLreload ),
-	SKIP( int, freq2low ),
-	SKIP( int, freq2high ),
-	SKIP( int, sound3ATLreload ),
-	SKIP( int, freq3low ),
-	SKIP( int, freq3high ),
-	SKIP( int, sound4ATLreload ),
-	SKIP( int, freq4 ),
-	{ NULL, 0 }
-};
+	variable_desc data [] =
+	{
+		SKIP( int, sound1ATLreload ),
+		SKIP( int, freq1low ),
+		SKIP( int, freq1high ),
+		SKIP( int, sound2ATLreload ),
+		SKIP( int, freq2low ),
+		SKIP( int, freq2high ),
+		SKIP( int, sound3ATLreload ),
+		SKIP( int, freq3low ),
+		SKIP( int, freq3high ),
+		SKIP( int, sound4ATLreload ),
+		SKIP( int, freq4 ),
+		{ NULL, 0 }
+	};
+	static CORE_LOCAL variable_desc table [sizeof data / sizeof *data];
+	memcpy( table, data, sizeof data );
+	return table;
+}
 
-static variable_desc gbsound_format3 [] =
+static variable_desc *gbsound_format3()
 {
-	SKIP( u8[2*735], soundBuffer ),
-	SKIP( u8[2*735], soundBuffer ),
-	SKIP( u16[735], soundFinalWave ),
-	{ NULL, 0 }
-};
+	variable_desc data [] =
+	{
+		SKIP( u8[2*735], soundBuffer ),
+		SKIP( u8[2*735], soundBuffer ),
+		SKIP( u16[735], soundFinalWave ),
+		{ NULL, 0 }
+	};
+	static CORE_LOCAL variable_desc table [sizeof data / sizeof *data];
+	memcpy( table, data, sizeof data );
+	return table;
+}
 
 enum {
 	nr10 = 0,
@@ -354,12 +372,12 @@ static void gbSoundReadGameOld(int version,gzFile gzFile)
 	}
 
 	// Load state
-	utilReadData( gzFile, gbsound_format );
+	utilReadData( gzFile, gbsound_format() );
 
 	if ( version >= 11 ) // TODO: never executed; remove?
-		utilReadData( gzFile, gbsound_format2 );
+		utilReadData( gzFile, gbsound_format2() );
 
-	utilReadData( gzFile, gbsound_format3 );
+	utilReadData( gzFile, gbsound_format3() );
 
 	int quality = 1;
 	if ( version >= 7 )
@@ -382,38 +400,44 @@ static void gbSoundReadGameOld(int version,gzFile gzFile)
 
 // New state format
 
-variable_desc gb_state [] =
+static variable_desc *gb_state()
 {
-	LOAD( int, state.version ),				// room_for_expansion will be used by later versions
+	variable_desc data [] =
+	{
+		LOAD( int, state.version ),				// room_for_expansion will be used by later versions
 
-	// APU
-	LOAD( u8 [0x40], state.apu.regs ),      // last values written to registers and wave RAM (both banks)
-	LOAD( int, state.apu.frame_time ),      // clocks until next frame sequencer action
-	LOAD( int, state.apu.frame_phase ),     // next step frame sequencer will run
+		// APU
+		LOAD( u8 [0x40], state.apu.regs ),      // last values written to registers and wave RAM (both banks)
+		LOAD( int, state.apu.frame_time ),      // clocks until next frame sequencer action
+		LOAD( int, state.apu.frame_phase ),     // next step frame sequencer will run
 
-	LOAD( int, state.apu.sweep_freq ),      // sweep's internal frequency register
-	LOAD( int, state.apu.sweep_delay ),     // clocks until next sweep action
-	LOAD( int, state.apu.sweep_enabled ),
-	LOAD( int, state.apu.sweep_neg ),       // obscure internal flag
-	LOAD( int, state.apu.noise_divider ),
-	LOAD( int, state.apu.wave_buf ),        // last read byte of wave RAM
+		LOAD( int, state.apu.sweep_freq ),      // sweep's internal frequency register
+		LOAD( int, state.apu.sweep_delay ),     // clocks until next sweep action
+		LOAD( int, state.apu.sweep_enabled ),
+		LOAD( int, state.apu.sweep_neg ),       // obscure internal flag
+		LOAD( int, state.apu.noise_divider ),
+		LOAD( int, state.apu.wave_buf ),        // last read byte of wave RAM
 
-	LOAD( int [4], state.apu.delay ),       // clocks until next channel action
-	LOAD( int [4], state.apu.length_ctr ),
-	LOAD( int [4], state.apu.phase ),       // square/wave phase, noise LFSR
-	LOAD( int [4], state.apu.enabled ),     // internal enabled flag
+		LOAD( int [4], state.apu.delay ),       // clocks until next channel action
+		LOAD( int [4], state.apu.length_ctr ),
+		LOAD( int [4], state.apu.phase ),       // square/wave phase, noise LFSR
+		LOAD( int [4], state.apu.enabled ),     // internal enabled flag
 
-	LOAD( int [3], state.apu.env_delay ),   // clocks until next envelope action
-	LOAD( int [3], state.apu.env_volume ),
-	LOAD( int [3], state.apu.env_enabled ),
+		LOAD( int [3], state.apu.env_delay ),   // clocks until next envelope action
+		LOAD( int [3], state.apu.env_volume ),
+		LOAD( int [3], state.apu.env_enabled ),
 
-	SKIP( int [13], room_for_expansion ),
+		SKIP( int [13], room_for_expansion ),
 
-	// Emulator
-	SKIP( int [16], room_for_expansion ),
+		// Emulator
+		SKIP( int [16], room_for_expansion ),
 
-	{ NULL, 0 }
-};
+		{ NULL, 0 }
+	};
+	static CORE_LOCAL variable_desc table [sizeof data / sizeof *data];
+	memcpy( table, data, sizeof data );
+	return table;
+}
 
 void gbSoundSaveGame( gzFile out )
 {
@@ -423,7 +447,7 @@ void gbSoundSaveGame( gzFile out )
 	memset( dummy_state, 0, sizeof dummy_state );
 
 	state.version = 1;
-	utilWriteData( out, gb_state );
+	utilWriteData( out, gb_state() );
 }
 
 void gbSoundSaveGame2( )
@@ -443,7 +467,7 @@ void gbSoundReadGame( int version, gzFile in )
 	gb_apu->save_state( &state.apu );
 
 	if ( version > 11 )
-		utilReadData( in, gb_state );
+		utilReadData( in, gb_state() );
 	else
 		gbSoundReadGameOld( version, in );
 
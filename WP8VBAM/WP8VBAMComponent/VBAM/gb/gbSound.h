@@ -66,8 +66,8 @@ u8 gbSoundRead( u16 address );
 
 // Notifies emulator that SOUND_CLOCK_TICKS clocks have passed
 void gbSoundTick();
-extern int SOUND_CLOCK_TICKS;   // Number of 16.8 MHz clocks between calls to gbSoundTick()
-extern int soundTicks;          // Number of 16.8 MHz clocks until gbSoundTick() will be called
+extern CORE_LOCAL int SOUND_CLOCK_TICKS;   // Number of 16.8 MHz clocks between calls to gbSoundTick()
+extern CORE_LOCAL int soundTicks;          // Number of 16.8 MHz clocks until gbSoundTick() will be called
 
 // Saves/loads emulator state
 void gbSoundSaveGame( gzFile out );
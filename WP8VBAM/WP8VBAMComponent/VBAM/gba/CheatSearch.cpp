@@ -3,6 +3,31 @@
 
 #include "CheatSearch.h"
 
+// The vector searches take 16 bytes of a block at a time: the values are
+// compared lane by lane, one bit per byte of the compare masks lines up
+// with the candidate bitmap, and the two bitmap bytes are updated at once.
+// Bitmap words with no candidates left are skipped, so every search after
+// the first few only touches what is still in the running. Unsigned values
+// are compared as signed ones with their top bit flipped. The results are
+// the same as the scalar loops, which are kept for blocks whose size is not
+// a multiple of 16, constants that do not fit the search size and CPUs
+// without vectors.
+
+#if defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define CHEAT_SEARCH_NEON
+#include <arm_neon.h>
+#elif defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define CHEAT_SEARCH_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif !defined(__x86_64__)
+#include <cpuid.h>
+#endif
+#endif
+
+bool cheatSearchSIMD = true;
+
 CheatSearchBlock cheatSearchBlocks[4];
 
 CheatSearchData cheatSearchData = {
@@ -145,156 +170,385 @@ u32 cheatSearchRead(u8 *data, int off, int size)
   return res;
 }
 
-void cheatSearch(const CheatSearchData *cs, int compare, int size,
-                 bool isSigned)
+// what a search compares the current values against
+enum {
+  CHEAT_SEARCH_SAVED,   // the snapshot
+  CHEAT_SEARCH_VALUE,   // a constant
+  CHEAT_SEARCH_CHANGE   // a constant, after subtracting the snapshot
+};
+
+// bitmap bits of the first byte of every value, for 32 bits of bitmap
+static const u32 cheatSearchFirst[] = {
+  0xffffffff,
+  0x55555555,
+  0x11111111
+};
+
+// Cuts v to the search size, sign extended if isSigned.
+static u32 cheatSearchTrim(u32 v, int size, bool isSigned)
 {
-  if(compare < 0 || compare > SEARCH_GE)
-    return;
-  int inc = 1;
-  if(size == BITS_16)
-    inc = 2;
-  else if(size == BITS_32)
-    inc = 4;
-
-  if(isSigned) {
-    bool (*func)(s32,s32) = cheatSearchSignedFunc[compare];
-
-    for(int i = 0; i < cs->count; i++) {
-      CheatSearchBlock *block = &cs->blocks[i];
-      int size2 = block->size;
-      u8 *bits = block->bits;
-      u8 *data = block->data;
-      u8 *saved = block->saved;
-
-      for(int j = 0; j < size2; j += inc) {
-	if(IS_BIT_SET(bits, j)) {
-	  s32 a = cheatSearchSignedRead(data, j, size);
-	  s32 b = cheatSearchSignedRead(saved,j, size);
-
-	  if(!func(a, b)) {
-	    CLEAR_BIT(bits, j);
-	    if(size == BITS_16)
-	      CLEAR_BIT(bits, j+1);
-	    if(size == BITS_32) {
-	      CLEAR_BIT(bits, j+2);
-	      CLEAR_BIT(bits, j+3);
-	    }
-	  }
-	}
+  switch(size) {
+  case BITS_8:
+    return isSigned ? (u32)(s32)(s8)v : (v & 0xff);
+  case BITS_16:
+    return isSigned ? (u32)(s32)(s16)v : (v & 0xffff);
+  }
+  return v;
+}
+
+static void cheatSearchBlockScalar(const CheatSearchBlock *block, int compare,
+                                   int size, bool isSigned, int mode, u32 value)
+{
+  int inc = 1 << size;
+  int size2 = block->size;
+  u8 *bits = block->bits;
+  u8 *data = block->data;
+  u8 *saved = block->saved;
+
+  for(int j = 0; j < size2; j += inc) {
+    if(IS_BIT_SET(bits, j)) {
+      bool keep;
+      if(isSigned) {
+        s32 a = cheatSearchSignedRead(data, j, size);
+        s32 b = (s32)value;
+        if(mode == CHEAT_SEARCH_SAVED)
+          b = cheatSearchSignedRead(saved, j, size);
+        else if(mode == CHEAT_SEARCH_CHANGE) {
+          u32 change = (u32)a - (u32)cheatSearchSignedRead(saved, j, size);
+          a = (s32)cheatSearchTrim(change, size, true);
+        }
+        keep = cheatSearchSignedFunc[compare](a, b);
+      } else {
+        u32 a = cheatSearchRead(data, j, size);
+        u32 b = value;
+        if(mode == CHEAT_SEARCH_SAVED)
+          b = cheatSearchRead(saved, j, size);
+        else if(mode == CHEAT_SEARCH_CHANGE)
+          a = cheatSearchTrim(a - cheatSearchRead(saved, j, size), size, false);
+        keep = cheatSearchFunc[compare](a, b);
       }
-    }
-  } else {
-    bool (*func)(u32,u32) = cheatSearchFunc[compare];
-
-    for(int i = 0; i < cs->count; i++) {
-      CheatSearchBlock *block = &cs->blocks[i];
-      int size2 = block->size;
-      u8 *bits = block->bits;
-      u8 *data = block->data;
-      u8 *saved = block->saved;
-
-      for(int j = 0; j < size2; j += inc) {
-	if(IS_BIT_SET(bits, j)) {
-	  u32 a = cheatSearchRead(data, j, size);
-	  u32 b = cheatSearchRead(saved,j, size);
-
-	  if(!func(a, b)) {
-	    CLEAR_BIT(bits, j);
-	    if(size == BITS_16)
-	      CLEAR_BIT(bits, j+1);
-	    if(size == BITS_32) {
-	      CLEAR_BIT(bits, j+2);
-	      CLEAR_BIT(bits, j+3);
-	    }
-	  }
-	}
+
+      if(!keep) {
+        for(int k = 0; k < inc; k++)
+          CLEAR_BIT(bits, j+k);
       }
     }
   }
 }
 
-void cheatSearchValue(const CheatSearchData *cs, int compare, int size,
-		      bool isSigned, u32 value)
+#ifdef CHEAT_SEARCH_SSE2
+#define CHEAT_SEARCH_VECTOR
+typedef __m128i cheatvec_t;
+
+static inline cheatvec_t cheatSearchLoad(const u8 *p)
 {
-  if(compare < 0 || compare > SEARCH_GE)
-    return;
-  int inc = 1;
-  if(size == BITS_16)
-    inc = 2;
-  else if(size == BITS_32)
-    inc = 4;
-
-  if(isSigned) {
-    bool (*func)(s32,s32) = cheatSearchSignedFunc[compare];
-
-    for(int i = 0; i < cs->count; i++) {
-      CheatSearchBlock *block = &cs->blocks[i];
-      int size2 = block->size;
-      u8 *bits = block->bits;
-      u8 *data = block->data;
-
-      for(int j = 0; j < size2; j += inc) {
-	if(IS_BIT_SET(bits, j)) {
-	  s32 a = cheatSearchSignedRead(data, j, size);
-	  s32 b = (s32)value;
-
-	  if(!func(a, b)) {
-	    CLEAR_BIT(bits, j);
-	    if(size == BITS_16)
-	      CLEAR_BIT(bits, j+1);
-	    if(size == BITS_32) {
-	      CLEAR_BIT(bits, j+2);
-	      CLEAR_BIT(bits, j+3);
-	    }
-	  }
-	}
+  return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline cheatvec_t cheatSearchXor(cheatvec_t a, cheatvec_t b)
+{
+  return _mm_xor_si128(a, b);
+}
+
+template<int size>
+static inline cheatvec_t cheatSearchSplat(u32 v)
+{
+  switch(size) {
+  case BITS_8:
+    return _mm_set1_epi8((char)v);
+  case BITS_16:
+    return _mm_set1_epi16((short)v);
+  }
+  return _mm_set1_epi32((int)v);
+}
+
+template<int size>
+static inline cheatvec_t cheatSearchSub(cheatvec_t a, cheatvec_t b)
+{
+  switch(size) {
+  case BITS_8:
+    return _mm_sub_epi8(a, b);
+  case BITS_16:
+    return _mm_sub_epi16(a, b);
+  }
+  return _mm_sub_epi32(a, b);
+}
+
+// one bit per byte of the lanes where the signed a < b
+template<int size>
+static inline u32 cheatSearchLess(cheatvec_t a, cheatvec_t b)
+{
+  switch(size) {
+  case BITS_8:
+    return _mm_movemask_epi8(_mm_cmplt_epi8(a, b));
+  case BITS_16:
+    return _mm_movemask_epi8(_mm_cmplt_epi16(a, b));
+  }
+  return _mm_movemask_epi8(_mm_cmplt_epi32(a, b));
+}
+
+template<int size>
+static inline u32 cheatSearchEqual(cheatvec_t a, cheatvec_t b)
+{
+  switch(size) {
+  case BITS_8:
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+  case BITS_16:
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(a, b));
+  }
+  return _mm_movemask_epi8(_mm_cmpeq_epi32(a, b));
+}
+
+static bool cheatSearchHasVector()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+  return true;
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[3] & (1 << 26)) != 0;
+#else
+  unsigned int eax, ebx, ecx, edx;
+  if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return false;
+  return (edx & (1 << 26)) != 0;
+#endif
+}
+#endif // CHEAT_SEARCH_SSE2
+
+#ifdef CHEAT_SEARCH_NEON
+#define CHEAT_SEARCH_VECTOR
+typedef uint8x16_t cheatvec_t;
+
+static inline cheatvec_t cheatSearchLoad(const u8 *p)
+{
+  return vld1q_u8(p);
+}
+
+static inline cheatvec_t cheatSearchXor(cheatvec_t a, cheatvec_t b)
+{
+  return veorq_u8(a, b);
+}
+
+// Packs a byte mask to one bit per byte, as _mm_movemask_epi8 does.
+static inline u32 cheatSearchMask(uint8x16_t m)
+{
+  static const u8 weights[16] = {
+    1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128
+  };
+  uint8x16_t w = vandq_u8(m, vld1q_u8(weights));
+  uint8x8_t s = vpadd_u8(vget_low_u8(w), vget_high_u8(w));
+  s = vpadd_u8(s, s);
+  s = vpadd_u8(s, s);
+  return vget_lane_u8(s, 0) | (vget_lane_u8(s, 1) << 8);
+}
+
+template<int size>
+static inline cheatvec_t cheatSearchSplat(u32 v)
+{
+  switch(size) {
+  case BITS_8:
+    return vdupq_n_u8((u8)v);
+  case BITS_16:
+    return vreinterpretq_u8_u16(vdupq_n_u16((u16)v));
+  }
+  return vreinterpretq_u8_u32(vdupq_n_u32(v));
+}
+
+template<int size>
+static inline cheatvec_t cheatSearchSub(cheatvec_t a, cheatvec_t b)
+{
+  switch(size) {
+  case BITS_8:
+    return vsubq_u8(a, b);
+  case BITS_16:
+    return vreinterpretq_u8_u16(vsubq_u16(vreinterpretq_u16_u8(a),
+                                          vreinterpretq_u16_u8(b)));
+  }
+  return vreinterpretq_u8_u32(vsubq_u32(vreinterpretq_u32_u8(a),
+                                        vreinterpretq_u32_u8(b)));
+}
+
+// one bit per byte of the lanes where the signed a < b
+template<int size>
+static inline u32 cheatSearchLess(cheatvec_t a, cheatvec_t b)
+{
+  switch(size) {
+  case BITS_8:
+    return cheatSearchMask(vcltq_s8(vreinterpretq_s8_u8(a),
+                                    vreinterpretq_s8_u8(b)));
+  case BITS_16:
+    return cheatSearchMask(vreinterpretq_u8_u16(vcltq_s16(vreinterpretq_s16_u8(a),
+                                                          vreinterpretq_s16_u8(b))));
+  }
+  return cheatSearchMask(vreinterpretq_u8_u32(vcltq_s32(vreinterpretq_s32_u8(a),
+                                                        vreinterpretq_s32_u8(b))));
+}
+
+template<int size>
+static inline u32 cheatSearchEqual(cheatvec_t a, cheatvec_t b)
+{
+  switch(size) {
+  case BITS_8:
+    return cheatSearchMask(vceqq_u8(a, b));
+  case BITS_16:
+    return cheatSearchMask(vreinterpretq_u8_u16(vceqq_u16(vreinterpretq_u16_u8(a),
+                                                          vreinterpretq_u16_u8(b))));
+  }
+  return cheatSearchMask(vreinterpretq_u8_u32(vceqq_u32(vreinterpretq_u32_u8(a),
+                                                        vreinterpretq_u32_u8(b))));
+}
+
+static bool cheatSearchHasVector()
+{
+  return true;
+}
+#endif // CHEAT_SEARCH_NEON
+
+#ifdef CHEAT_SEARCH_VECTOR
+static bool cheatSearchVector = cheatSearchHasVector();
+
+// Bits of the values that pass, from the masks of a < b and a == b.
+static inline u32 cheatSearchPass(int compare, u32 lt, u32 eq)
+{
+  switch(compare) {
+  case SEARCH_EQ:
+    return eq;
+  case SEARCH_NE:
+    return ~eq;
+  case SEARCH_LT:
+    return lt;
+  case SEARCH_LE:
+    return lt | eq;
+  case SEARCH_GT:
+    return ~(lt | eq);
+  }
+  return ~lt;
+}
+
+template<int size>
+static void cheatSearchBlockVector(const CheatSearchBlock *block, int compare,
+                                   bool isSigned, int mode, u32 value)
+{
+  int size2 = block->size;
+  u8 *bits = block->bits;
+  const u8 *data = block->data;
+  const u8 *saved = block->saved;
+  cheatvec_t flip = cheatSearchSplat<size>(isSigned ? 0 : 1u << ((8 << size) - 1));
+  cheatvec_t constant = cheatSearchSplat<size>(value);
+  u32 first = cheatSearchFirst[size] & 0xffff;
+
+  for(int j = 0; j < size2; j += 16) {
+    u32 old = bits[j >> 3] | (bits[(j >> 3) + 1] << 8);
+    if(!old)
+      continue;
+
+    cheatvec_t a = cheatSearchLoad(data + j);
+    cheatvec_t b = constant;
+    if(mode != CHEAT_SEARCH_VALUE) {
+      b = cheatSearchLoad(saved + j);
+      if(mode == CHEAT_SEARCH_CHANGE) {
+        a = cheatSearchSub<size>(a, b);
+        b = constant;
       }
     }
-  } else {
-    bool (*func)(u32,u32) = cheatSearchFunc[compare];
-
-    for(int i = 0; i < cs->count; i++) {
-      CheatSearchBlock *block = &cs->blocks[i];
-      int size2 = block->size;
-      u8 *bits = block->bits;
-      u8 *data = block->data;
-
-      for(int j = 0; j < size2; j += inc) {
-	if(IS_BIT_SET(bits, j)) {
-	  u32 a = cheatSearchRead(data, j, size);
-
-	  if(!func(a, value)) {
-	    CLEAR_BIT(bits, j);
-	    if(size == BITS_16)
-	      CLEAR_BIT(bits, j+1);
-	    if(size == BITS_32) {
-	      CLEAR_BIT(bits, j+2);
-	      CLEAR_BIT(bits, j+3);
-	    }
-	  }
-	}
-      }
+    a = cheatSearchXor(a, flip);
+    b = cheatSearchXor(b, flip);
+
+    // a failing value clears its bits only if its first one is still set,
+    // as the scalar loops leave the others alone otherwise
+    u32 fail = ~cheatSearchPass(compare, cheatSearchLess<size>(a, b),
+                                cheatSearchEqual<size>(a, b)) & old & first;
+    if(size == BITS_16)
+      fail |= fail << 1;
+    else if(size == BITS_32)
+      fail *= 15;
+
+    if(fail) {
+      u32 now = old & ~fail;
+      bits[j >> 3] = (u8)now;
+      bits[(j >> 3) + 1] = (u8)(now >> 8);
     }
   }
 }
+#endif // CHEAT_SEARCH_VECTOR
+
+static void cheatSearchBlock(const CheatSearchBlock *block, int compare,
+                             int size, bool isSigned, int mode, u32 value)
+{
+#ifdef CHEAT_SEARCH_VECTOR
+  // the lanes hold constants of the search size only
+  bool fits = (mode == CHEAT_SEARCH_SAVED ||
+               cheatSearchTrim(value, size, isSigned) == value);
+
+  if(cheatSearchSIMD && cheatSearchVector && fits && !(block->size & 15)) {
+    switch(size) {
+    case BITS_8:
+      cheatSearchBlockVector<BITS_8>(block, compare, isSigned, mode, value);
+      return;
+    case BITS_16:
+      cheatSearchBlockVector<BITS_16>(block, compare, isSigned, mode, value);
+      return;
+    case BITS_32:
+      cheatSearchBlockVector<BITS_32>(block, compare, isSigned, mode, value);
+      return;
+    }
+  }
+#endif
+  cheatSearchBlockScalar(block, compare, size, isSigned, mode, value);
+}
+
+static void cheatSearchAll(const CheatSearchData *cs, int compare, int size,
+                              bool isSigned, int mode, u32 value)
+{
+  if(compare < 0 || compare > SEARCH_GE || size < BITS_8 || size > BITS_32)
+    return;
+
+  for(int i = 0; i < cs->count; i++)
+    cheatSearchBlock(&cs->blocks[i], compare, size, isSigned, mode, value);
+}
+
+void cheatSearch(const CheatSearchData *cs, int compare, int size,
+                 bool isSigned)
+{
+  cheatSearchAll(cs, compare, size, isSigned, CHEAT_SEARCH_SAVED, 0);
+}
+
+void cheatSearchValue(const CheatSearchData *cs, int compare, int size,
+		      bool isSigned, u32 value)
+{
+  cheatSearchAll(cs, compare, size, isSigned, CHEAT_SEARCH_VALUE, value);
+}
+
+void cheatSearchChange(const CheatSearchData *cs, int compare, int size,
+                       bool isSigned, u32 value)
+{
+  cheatSearchAll(cs, compare, size, isSigned, CHEAT_SEARCH_CHANGE, value);
+}
 
 int cheatSearchGetCount(const CheatSearchData *cs, int size)
 {
   int res = 0;
-  int inc = 1;
-  if(size == BITS_16)
-    inc = 2;
-  else if(size == BITS_32)
-    inc = 4;
+  u32 first = cheatSearchFirst[(size == BITS_16 || size == BITS_32) ? size : BITS_8];
 
+  // counts the first bit of every value, 32 bits of the bitmap at a time
   for(int i = 0; i < cs->count; i++) {
     CheatSearchBlock *block = &cs->blocks[i];
 
-    int size2 = block->size;
-    u8 *bits = block->bits;
-    for(int j = 0; j < size2; j += inc) {
-      if(IS_BIT_SET(bits, j))
-	res++;
+    int count = block->size >> 3;
+    const u8 *bits = block->bits;
+    for(int j = 0; j < count; j += 4) {
+      u32 v = bits[j];
+      if(j + 1 < count)
+        v |= bits[j+1] << 8;
+      if(j + 2 < count)
+        v |= bits[j+2] << 16;
+      if(j + 3 < count)
+        v |= (u32)bits[j+3] << 24;
+      v &= first;
+      v -= (v >> 1) & 0x55555555;
+      v = (v & 0x33333333) + ((v >> 2) & 0x33333333);
+      res += (((v + (v >> 4)) & 0x0f0f0f0f) * 0x01010101) >> 24;
     }
   }
   return res;
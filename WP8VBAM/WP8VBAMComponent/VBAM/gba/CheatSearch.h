@@ -42,10 +42,17 @@ enum {
 
 extern CheatSearchData cheatSearchData;
 
+// Set to false to search with the scalar loops
+extern bool cheatSearchSIMD;
+
 void cheatSearchCleanup(CheatSearchData *cs);
 void cheatSearchStart(const CheatSearchData *cs);
 void cheatSearch(const CheatSearchData *cs, int compare, int size, bool isSigned);
 void cheatSearchValue(const CheatSearchData *cs, int compare, int size, bool isSigned, u32 value);
+// Compares how much each value changed since the snapshot (data - saved,
+// wrapped to the search size) against value; SEARCH_EQ keeps the ones
+// changed by exactly value.
+void cheatSearchChange(const CheatSearchData *cs, int compare, int size, bool isSigned, u32 value);
 int cheatSearchGetCount(const CheatSearchData *cs, int size);
 void cheatSearchUpdateValues(const CheatSearchData *cs);
 s32 cheatSearchSignedRead(u8 *data, int off, int size);
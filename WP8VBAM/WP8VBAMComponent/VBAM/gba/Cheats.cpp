@@ -9,7 +9,9 @@
 #include "Globals.h"
 #include "../NLS.h"
 #include "../Util.h"
+#ifdef _WINRT_DLL
 #include "WP8VBAMComponent.h"
+#endif
 
 /**
  * Gameshark code types: (based on AR v1.0)
@@ -179,28 +181,47 @@
 #define CHEATS_16_BIT_WRITE           114
 #define CHEATS_32_BIT_WRITE           115
 
-CheatsData cheatsList[100];
-int cheatsNumber = 0;
-u32 rompatch2addr [4];
-u16 rompatch2val [4];
-u16 rompatch2oldval [4];
-
-u8 cheatsCBASeedBuffer[0x30];
-u32 cheatsCBASeed[4];
-u32 cheatsCBATemporaryValue = 0;
-u16 cheatsCBATable[256];
-bool cheatsCBATableGenerated = false;
-u16 super = 0;
-extern u32 mastercode;
-
-u8 cheatsCBACurrentSeed[12] = {
+CORE_LOCAL CheatsData cheatsList[100];
+CORE_LOCAL int cheatsNumber = 0;
+CORE_LOCAL u32 rompatch2addr [4];
+CORE_LOCAL u16 rompatch2val [4];
+CORE_LOCAL u16 rompatch2oldval [4];
+
+// Compiled form of cheatsList. When every enabled code is a constant write
+// (or the master code), cheatsCheckKeys runs this write list instead of
+// interpreting the list; anything else falls back to the interpreter. The
+// writes keep the list order, as writes to IO registers have side effects.
+// Rebuilt on the first cheatsCheckKeys after the list changes.
+struct CheatWrite {
+  u32 address;
+  u32 value;
+  u8 size;
+  bool rom;  // CHEATS_16/32_BIT_WRITE patching the image
+  bool keys; // GSA button write, needs the slowdown button
+};
+
+static CORE_LOCAL CheatWrite cheatsWrites[100];
+static CORE_LOCAL int cheatsWriteCount = 0;
+static CORE_LOCAL u32 cheatsWriteMaster = 0;
+static CORE_LOCAL bool cheatsWriteOnly = false;
+static CORE_LOCAL bool cheatsProgramValid = false;
+
+CORE_LOCAL u8 cheatsCBASeedBuffer[0x30];
+CORE_LOCAL u32 cheatsCBASeed[4];
+CORE_LOCAL u32 cheatsCBATemporaryValue = 0;
+CORE_LOCAL u16 cheatsCBATable[256];
+CORE_LOCAL bool cheatsCBATableGenerated = false;
+CORE_LOCAL u16 super = 0;
+extern CORE_LOCAL u32 mastercode;
+
+CORE_LOCAL u8 cheatsCBACurrentSeed[12] = {
   0x00, 0x00, 0x00, 0x00,
   0x00, 0x00, 0x00, 0x00,
   0x00, 0x00, 0x00, 0x00
 };
 
-u32 seeds_v1[4];
-u32 seeds_v3[4];
+CORE_LOCAL u32 seeds_v1[4];
+CORE_LOCAL u32 seeds_v3[4];
 
 u32 seed_gen(u8 upper, u8 seed, u8 *deadtable1, u8 *deadtable2);
 
@@ -301,11 +322,19 @@ u8 v3_deadtable2[256] = {
 
 #define CHEAT_IS_HEX(a) ( ((a)>='A' && (a) <='F') || ((a) >='0' && (a) <= '9'))
 
+// patches past the end of the image have nothing to patch, and the
+// decoded blocks only go stale when a patch changes the image
 #define CHEAT_PATCH_ROM_16BIT(a,v) \
-  WRITE16LE(((u16 *)&rom[(a) & 0x1ffffff]), v);
+  do { u32 o = CPURomOffset(a); \
+    if(o <= romMask && READ16LE(((u16 *)&rom[o])) != (u16)(v)) { \
+      WRITE16LE(((u16 *)&rom[o]), v); \
+      blockCacheFlush(); } } while(0)
 
 #define CHEAT_PATCH_ROM_32BIT(a,v) \
-  WRITE32LE(((u32 *)&rom[(a) & 0x1ffffff]), v);
+  do { u32 o = CPURomOffset(a); \
+    if(o <= romMask && READ32LE(((u32 *)&rom[o])) != (u32)(v)) { \
+      WRITE32LE(((u32 *)&rom[o]), v); \
+      blockCacheFlush(); } } while(0)
 
 static bool isMultilineWithData(int i)
 {
@@ -565,6 +594,84 @@ static int getCodeLength(int num)
   return 1;
 }
 
+static void cheatsCompile()
+{
+  cheatsWriteCount = 0;
+  cheatsWriteMaster = 0;
+  cheatsWriteOnly = false;
+  cheatsProgramValid = true;
+
+  for(int i = 0; i < cheatsNumber; i++) {
+    if(!cheatsList[i].enabled) {
+      i += getCodeLength(i)-1;
+      continue;
+    }
+    CheatWrite *w = &cheatsWrites[cheatsWriteCount];
+    w->address = cheatsList[i].address;
+    w->value = cheatsList[i].value;
+    w->rom = false;
+    w->keys = false;
+    switch(cheatsList[i].size) {
+    case GSA_8_BIT_GS_WRITE:
+      w->keys = true;
+    case INT_8_BIT_WRITE:
+      w->size = 1;
+      break;
+    case GSA_16_BIT_GS_WRITE:
+      w->keys = true;
+    case INT_16_BIT_WRITE:
+      w->size = 2;
+      break;
+    case GSA_32_BIT_GS_WRITE:
+      w->keys = true;
+    case INT_32_BIT_WRITE:
+      w->size = 4;
+      break;
+    case CHEATS_16_BIT_WRITE:
+      w->size = 2;
+      w->rom = (w->address>>24) >= 0x08;
+      break;
+    case CHEATS_32_BIT_WRITE:
+      w->size = 4;
+      w->rom = (w->address>>24) >= 0x08;
+      break;
+    case MASTER_CODE:
+      cheatsWriteMaster = cheatsList[i].address;
+      continue;
+    default:
+      return;
+    }
+    cheatsWriteCount++;
+  }
+  cheatsWriteOnly = true;
+}
+
+static void cheatsRunWrites(u32 extended)
+{
+  for(int i = 0; i < cheatsWriteCount; i++) {
+    const CheatWrite *w = &cheatsWrites[i];
+    if(w->keys && !(extended & 4))
+      continue;
+    switch(w->size) {
+    case 1:
+      CPUWriteByte(w->address, w->value);
+      break;
+    case 2:
+      if(w->rom)
+        CHEAT_PATCH_ROM_16BIT(w->address, w->value);
+      else
+        CPUWriteHalfWord(w->address, w->value);
+      break;
+    case 4:
+      if(w->rom)
+        CHEAT_PATCH_ROM_32BIT(w->address, w->value);
+      else
+        CPUWriteMemory(w->address, w->value);
+      break;
+    }
+  }
+}
+
 int cheatsCheckKeys(u32 keys, u32 extended)
 {
   bool onoff = true;
@@ -578,6 +685,14 @@ int cheatsCheckKeys(u32 keys, u32 extended)
       rompatch2addr [i] = 0;
     }
 
+  if(!cheatsProgramValid)
+    cheatsCompile();
+  if(cheatsWriteOnly) {
+    mastercode = cheatsWriteMaster;
+    cheatsRunWrites(extended);
+    return 0;
+  }
+
   for (i = 0; i < cheatsNumber; i++) {
     if(!cheatsList[i].enabled) {
       // make sure we skip other lines in this code
@@ -1317,6 +1432,7 @@ void cheatsAdd(const char *codeStr,
 {
   if(cheatsNumber < 100) {
     int x = cheatsNumber;
+    cheatsProgramValid = false;
     cheatsList[x].code = code;
     cheatsList[x].size = size;
     cheatsList[x].rawaddress = rawaddress;
@@ -1356,6 +1472,7 @@ void cheatsDelete(int number, bool restore)
 {
   if(number < cheatsNumber && number >= 0) {
     int x = number;
+    cheatsProgramValid = false;
 
     if(restore) {
       switch(cheatsList[x].size) {
@@ -1420,6 +1537,7 @@ void cheatsEnable(int i)
 {
   if(i >= 0 && i < cheatsNumber) {
     cheatsList[i].enabled = true;
+    cheatsProgramValid = false;
     mastercode = 0;
   }
 }
@@ -1448,6 +1566,7 @@ void cheatsDisable(int i)
       break;
     }
     cheatsList[i].enabled = false;
+    cheatsProgramValid = false;
   }
 }
 
@@ -1619,14 +1738,14 @@ void cheatsAddGSACode(const char *code, const char *desc, bool v3)
       *((u32 *)buffer) = address;
       buffer[4] = 0; 
 
-	  wchar_t wbuffer[5 ];
-	  mbstowcs( wbuffer, buffer, 5 );
-
-
       char buffer2[5];
       *((u32 *)buffer2) = READ32LE(((u32 *)&rom[0xac]));
       buffer2[4] = 0;
 
+#ifdef _WINRT_DLL
+	  wchar_t wbuffer[5 ];
+	  mbstowcs( wbuffer, buffer, 5 );
+
 	  wchar_t wbuffer2[5 ];
 	  mbstowcs( wbuffer2, buffer2, 5 );
 
@@ -1638,8 +1757,10 @@ void cheatsAddGSACode(const char *code, const char *desc, bool v3)
 	 {
 		Direct3DBackground::WrongCheatVersion(ref new Platform::String(wcode), ref new Platform::String(wbuffer), ref new Platform::String(wbuffer2));
 	 }
-      /*systemMessage(MSG_GBA_CODE_WARNING, N_("Warning: cheats are for game %s. Current game is %s.\nCodes may not work correctly."),
-                    buffer, buffer2);*/
+#else
+      systemMessage(MSG_GBA_CODE_WARNING, N_("Warning: cheats are for game %s. Current game is %s.\nCodes may not work correctly."),
+                    buffer, buffer2);
+#endif
     }
     cheatsAdd(code, desc, address, address & 0x0FFFFFFF, value, v3 ? 257 : 256,
               UNKNOWN_CODE);
@@ -2621,6 +2742,7 @@ void cheatsSaveGame(gzFile file)
 void cheatsReadGame(gzFile file, int version)
 {
   cheatsNumber = 0;
+  cheatsProgramValid = false;
 
   cheatsNumber = utilReadInt(file);
 
@@ -2833,11 +2955,12 @@ bool cheatsLoadCheatList(const char *file)
     }
   }
   cheatsNumber = count;
+  cheatsProgramValid = false;
   fclose(f);
   return true;
 }
 
-extern int cpuNextEvent;
+extern CORE_LOCAL int cpuNextEvent;
 
 extern void debuggerBreakOnWrite(u32 , u32, u32, int, int);
 
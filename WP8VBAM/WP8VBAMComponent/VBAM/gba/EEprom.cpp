@@ -3,27 +3,33 @@
 #include "EEprom.h"
 #include "../Util.h"
 
-extern int cpuDmaCount;
+extern CORE_LOCAL int cpuDmaCount;
 
-int eepromMode = EEPROM_IDLE;
-int eepromByte = 0;
-int eepromBits = 0;
-int eepromAddress = 0;
-u8 eepromData[0x2000];
-u8 eepromBuffer[16];
-bool eepromInUse = false;
-int eepromSize = 512;
+CORE_LOCAL int eepromMode = EEPROM_IDLE;
+CORE_LOCAL int eepromByte = 0;
+CORE_LOCAL int eepromBits = 0;
+CORE_LOCAL int eepromAddress = 0;
+CORE_LOCAL u8 eepromData[0x2000];
+CORE_LOCAL u8 eepromBuffer[16];
+CORE_LOCAL bool eepromInUse = false;
+CORE_LOCAL int eepromSize = 512;
 
-variable_desc eepromSaveData[] = {
-  { &eepromMode, sizeof(int) },
-  { &eepromByte, sizeof(int) },
-  { &eepromBits , sizeof(int) },
-  { &eepromAddress , sizeof(int) },
-  { &eepromInUse, sizeof(bool) },
-  { &eepromData[0], 512 },
-  { &eepromBuffer[0], 16 },
-  { NULL, 0 }
-};
+static variable_desc *eepromSaveData()
+{
+  variable_desc data[] = {
+    { &eepromMode, sizeof(int) },
+    { &eepromByte, sizeof(int) },
+    { &eepromBits , sizeof(int) },
+    { &eepromAddress , sizeof(int) },
+    { &eepromInUse, sizeof(bool) },
+    { &eepromData[0], 512 },
+    { &eepromBuffer[0], 16 },
+    { NULL, 0 }
+  };
+  static CORE_LOCAL variable_desc table[sizeof(data) / sizeof(data[0])];
+  memcpy(table, data, sizeof(data));
+  return table;
+}
 
 void eepromInit()
 {
@@ -42,14 +48,14 @@ void eepromReset()
 
 void eepromSaveGame(gzFile gzFile)
 {
-  utilWriteData(gzFile, eepromSaveData);
+  utilWriteData(gzFile, eepromSaveData());
   utilWriteInt(gzFile, eepromSize);
   utilGzWrite(gzFile, eepromData, 0x2000);
 }
 
 void eepromReadGame(gzFile gzFile, int version)
 {
-  utilReadData(gzFile, eepromSaveData);
+  utilReadData(gzFile, eepromSaveData());
   if(version >= SAVE_GAME_VERSION_3) {
     eepromSize = utilReadInt(gzFile);
     utilGzRead(gzFile, eepromData, 0x2000);
@@ -62,7 +68,7 @@ void eepromReadGame(gzFile gzFile, int version)
 void eepromReadGameSkip(gzFile gzFile, int version)
 {
   // skip the eeprom data in a save game
-  utilReadDataSkip(gzFile, eepromSaveData);
+  utilReadDataSkip(gzFile, eepromSaveData());
   if(version >= SAVE_GAME_VERSION_3) {
     utilGzSeek(gzFile, sizeof(int), SEEK_CUR);
     utilGzSeek(gzFile, 0x2000, SEEK_CUR);
@@ -8,9 +8,9 @@ extern int eepromRead(u32 address);
 extern void eepromWrite(u32 address, u8 value);
 extern void eepromInit();
 extern void eepromReset();
-extern u8 eepromData[0x2000];
-extern bool eepromInUse;
-extern int eepromSize;
+extern CORE_LOCAL u8 eepromData[0x2000];
+extern CORE_LOCAL bool eepromInUse;
+extern CORE_LOCAL int eepromSize;
 
 #define EEPROM_IDLE           0
 #define EEPROM_READADDRESS    1
@@ -17,37 +17,55 @@
 #define FLASH_PROGRAM            8
 #define FLASH_SETBANK            9
 
-u8 flashSaveMemory[FLASH_128K_SZ];
-int flashState = FLASH_READ_ARRAY;
-int flashReadState = FLASH_READ_ARRAY;
-int flashSize = 0x10000;
-int flashDeviceID = 0x1b;
-int flashManufacturerID = 0x32;
-int flashBank = 0;
+CORE_LOCAL u8 flashSaveMemory[FLASH_128K_SZ];
+CORE_LOCAL int flashState = FLASH_READ_ARRAY;
+CORE_LOCAL int flashReadState = FLASH_READ_ARRAY;
+CORE_LOCAL int flashSize = 0x10000;
+CORE_LOCAL int flashDeviceID = 0x1b;
+CORE_LOCAL int flashManufacturerID = 0x32;
+CORE_LOCAL int flashBank = 0;
 
-variable_desc flashSaveData[] = {
-  { &flashState, sizeof(int) },
-  { &flashReadState, sizeof(int) },
-  { &flashSaveMemory[0], 0x10000 },
-  { NULL, 0 }
-};
+static variable_desc *flashSaveData()
+{
+  variable_desc data[] = {
+    { &flashState, sizeof(int) },
+    { &flashReadState, sizeof(int) },
+    { &flashSaveMemory[0], 0x10000 },
+    { NULL, 0 }
+  };
+  static CORE_LOCAL variable_desc table[sizeof(data) / sizeof(data[0])];
+  memcpy(table, data, sizeof(data));
+  return table;
+}
 
-variable_desc flashSaveData2[] = {
-  { &flashState, sizeof(int) },
-  { &flashReadState, sizeof(int) },
-  { &flashSize, sizeof(int) },
-  { &flashSaveMemory[0], 0x20000 },
-  { NULL, 0 }
-};
+static variable_desc *flashSaveData2()
+{
+  variable_desc data[] = {
+    { &flashState, sizeof(int) },
+    { &flashReadState, sizeof(int) },
+    { &flashSize, sizeof(int) },
+    { &flashSaveMemory[0], 0x20000 },
+    { NULL, 0 }
+  };
+  static CORE_LOCAL variable_desc table[sizeof(data) / sizeof(data[0])];
+  memcpy(table, data, sizeof(data));
+  return table;
+}
 
-variable_desc flashSaveData3[] = {
-  { &flashState, sizeof(int) },
-  { &flashReadState, sizeof(int) },
-  { &flashSize, sizeof(int) },
-  { &flashBank, sizeof(int) },
-  { &flashSaveMemory[0], 0x20000 },
-  { NULL, 0 }
-};
+static variable_desc *flashSaveData3()
+{
+  variable_desc data[] = {
+    { &flashState, sizeof(int) },
+    { &flashReadState, sizeof(int) },
+    { &flashSize, sizeof(int) },
+    { &flashBank, sizeof(int) },
+    { &flashSaveMemory[0], 0x20000 },
+    { NULL, 0 }
+  };
+  static CORE_LOCAL variable_desc table[sizeof(data) / sizeof(data[0])];
+  memcpy(table, data, sizeof(data));
+  return table;
+}
 
 void flashInit()
 {
@@ -63,19 +81,19 @@ void flashReset()
 
 void flashSaveGame(gzFile gzFile)
 {
-  utilWriteData(gzFile, flashSaveData3);
+  utilWriteData(gzFile, flashSaveData3());
 }
 
 void flashReadGame(gzFile gzFile, int version)
 {
   if(version < SAVE_GAME_VERSION_5)
-    utilReadData(gzFile, flashSaveData);
+    utilReadData(gzFile, flashSaveData());
   else if(version < SAVE_GAME_VERSION_7) {
-    utilReadData(gzFile, flashSaveData2);
+    utilReadData(gzFile, flashSaveData2());
     flashBank = 0;
     flashSetSize(flashSize);
   } else {
-    utilReadData(gzFile, flashSaveData3);
+    utilReadData(gzFile, flashSaveData3());
   }
 }
 
@@ -83,11 +101,11 @@ void flashReadGameSkip(gzFile gzFile, int version)
 {
   // skip the flash data in a save game
   if(version < SAVE_GAME_VERSION_5)
-    utilReadDataSkip(gzFile, flashSaveData);
+    utilReadDataSkip(gzFile, flashSaveData());
   else if(version < SAVE_GAME_VERSION_7) {
-    utilReadDataSkip(gzFile, flashSaveData2);
+    utilReadDataSkip(gzFile, flashSaveData2());
   } else {
-    utilReadDataSkip(gzFile, flashSaveData3);
+    utilReadDataSkip(gzFile, flashSaveData3());
   }
 }
 
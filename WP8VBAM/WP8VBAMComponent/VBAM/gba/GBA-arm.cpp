@@ -7,6 +7,7 @@
 #include "GBA.h"
 #include "GBAcpu.h"
 #include "GBAinline.h"
+#include "GBABlockCache.h"
 #include "Globals.h"
 #include "EEprom.h"
 #include "Flash.h"
@@ -33,7 +34,7 @@
 
 ///////////////////////////////////////////////////////////////////////////
 
-static int clockTicks;
+static CORE_LOCAL int clockTicks;
 
 static INSN_REGPARM void armUnknownInsn(u32 opcode)
 {
@@ -2863,11 +2864,165 @@ static void tester(void) {
 }
 #endif
 
+static inline bool armCondition(int cond)
+{
+    bool res;
+    switch(cond) {
+      case 0x00: // EQ
+        res = Z_FLAG;
+        break;
+      case 0x01: // NE
+        res = !Z_FLAG;
+        break;
+      case 0x02: // CS
+        res = C_FLAG;
+        break;
+      case 0x03: // CC
+        res = !C_FLAG;
+        break;
+      case 0x04: // MI
+        res = N_FLAG;
+        break;
+      case 0x05: // PL
+        res = !N_FLAG;
+        break;
+      case 0x06: // VS
+        res = V_FLAG;
+        break;
+      case 0x07: // VC
+        res = !V_FLAG;
+        break;
+      case 0x08: // HI
+        res = C_FLAG && !Z_FLAG;
+        break;
+      case 0x09: // LS
+        res = !C_FLAG || Z_FLAG;
+        break;
+      case 0x0A: // GE
+        res = N_FLAG == V_FLAG;
+        break;
+      case 0x0B: // LT
+        res = N_FLAG != V_FLAG;
+        break;
+      case 0x0C: // GT
+        res = !Z_FLAG &&(N_FLAG == V_FLAG);
+        break;
+      case 0x0D: // LE
+        res = Z_FLAG || (N_FLAG != V_FLAG);
+        break;
+      case 0x0E: // AL (impossible, checked above)
+        res = true;
+        break;
+      case 0x0F:
+      default:
+        // ???
+        res = false;
+        break;
+    }
+    return res;
+}
+
+// Block cache ////////////////////////////////////////////////////////////
+
+static blockinsn_t armDecode(u32 opcode)
+{
+    return armInsnTable[((opcode>>16)&0xFF0) | ((opcode>>4)&0x0F)];
+}
+
+// Unconditional B/BL, BX, SWI, LDM with pc and writes to pc leave the block
+static bool armEndsBlock(u32 opcode)
+{
+    if ((opcode >> 28) != 0x0E)
+        return false;
+    return (opcode & 0x0E000000) == 0x0A000000 ||
+           (opcode & 0x0FFFFFF0) == 0x012FFF10 ||
+           (opcode & 0x0F000000) == 0x0F000000 ||
+           (opcode & 0x0E108000) == 0x08108000 ||
+           (opcode & 0x0C00F000) == 0x0000F000;
+}
+
+// Runs the cached block starting at armNextPC, if any, with the same
+// per-instruction bookkeeping as the loop below. Returns -1 if no block
+// could be used, otherwise the value armExecute should return, or 2 to
+// keep going.
+static inline int armExecuteBlock()
+{
+    CachedBlock *block = blockCacheFind(armNextPC, false);
+    if (block == NULL)
+        block = blockCacheBuild(armNextPC, false, armDecode, armEndsBlock);
+    // the prefetch queue may predate a store to the block (DMA, state load)
+    if (block == NULL || block->opcodes[0] != cpuPrefetch[0] ||
+        block->opcodes[1] != cpuPrefetch[1])
+        return -1;
+
+    u32 invalidations = blockCacheInvalidations;
+    // tight loops branch back to the start of their own block
+    for (;;) {
+        const u32 *op = block->opcodes;
+        blockinsn_t *handler = block->handlers;
+        blockinsn_t *end = handler + block->count;
+        u32 nextPC;
+        do {
+            if ((armNextPC & 0x0803FFFF) == 0x08020000)
+              busPrefetchCount = 0x100;
+
+            u32 opcode = *op++;
+            cpuPrefetch[0] = op[0];
+            cpuPrefetch[1] = op[1];
+
+            busPrefetch = false;
+            if (busPrefetchCount & 0xFFFFFE00)
+                busPrefetchCount = 0x100 | (busPrefetchCount & 0xFF);
+
+            clockTicks = 0;
+            int oldArmNextPC = armNextPC;
+
+#ifndef FINAL_VERSION
+            if (armNextPC == stop) {
+                armNextPC++;
+            }
+#endif
+
+            armNextPC = reg[15].I;
+            reg[15].I += 4;
+            nextPC = reg[15].I;
+
+            int cond = opcode >> 28;
+            bool cond_res = true;
+            if (UNLIKELY(cond != 0x0E))
+                cond_res = armCondition(cond);
+
+            if (cond_res)
+                (**handler)(opcode);
+#ifdef INSN_COUNTER
+            count(opcode, cond_res);
+#endif
+            if (clockTicks < 0)
+                return 0;
+            if (clockTicks == 0)
+                clockTicks = 1 + codeTicksAccessSeq32(oldArmNextPC);
+            cpuTotalTicks += clockTicks;
+
+            if (!(cpuTotalTicks<cpuNextEvent && armState && !holdState && !SWITicks))
+                return 1;
+        } while (++handler < end && reg[15].I == nextPC &&
+                 blockCacheInvalidations == invalidations);
+        if (armNextPC != block->pc || blockCacheInvalidations != invalidations)
+            return 2;
+    }
+}
+
 int armExecute()
 {
     do {
-		if( cheatsEnabled ) {
+		if( blockCacheHooked(armNextPC) ) {
 			cpuMasterCodeCheck();
+		} else if (blockCacheEnabled) {
+            int res = armExecuteBlock();
+            if (res == 0 || res == 1)
+                return res;
+            if (res == 2)
+                continue;
 		}
 
         if ((armNextPC & 0x0803FFFF) == 0x08020000)
@@ -2895,60 +3050,8 @@ int armExecute()
 
         int cond = opcode >> 28;
         bool cond_res = true;
-        if (UNLIKELY(cond != 0x0E)) {  // most opcodes are AL (always)
-            switch(cond) {
-              case 0x00: // EQ
-                cond_res = Z_FLAG;
-                break;
-              case 0x01: // NE
-                cond_res = !Z_FLAG;
-                break;
-              case 0x02: // CS
-                cond_res = C_FLAG;
-                break;
-              case 0x03: // CC
-                cond_res = !C_FLAG;
-                break;
-              case 0x04: // MI
-                cond_res = N_FLAG;
-                break;
-              case 0x05: // PL
-                cond_res = !N_FLAG;
-                break;
-              case 0x06: // VS
-                cond_res = V_FLAG;
-                break;
-              case 0x07: // VC
-                cond_res = !V_FLAG;
-                break;
-              case 0x08: // HI
-                cond_res = C_FLAG && !Z_FLAG;
-                break;
-              case 0x09: // LS
-                cond_res = !C_FLAG || Z_FLAG;
-                break;
-              case 0x0A: // GE
-                cond_res = N_FLAG == V_FLAG;
-                break;
-              case 0x0B: // LT
-                cond_res = N_FLAG != V_FLAG;
-                break;
-              case 0x0C: // GT
-                cond_res = !Z_FLAG &&(N_FLAG == V_FLAG);
-                break;
-              case 0x0D: // LE
-                cond_res = Z_FLAG || (N_FLAG != V_FLAG);
-                break;
-              case 0x0E: // AL (impossible, checked above)
-                cond_res = true;
-                break;
-              case 0x0F:
-              default:
-                // ???
-                cond_res = false;
-                break;
-            }
-        }
+        if (UNLIKELY(cond != 0x0E))  // most opcodes are AL (always)
+            cond_res = armCondition(cond);
 
         if (cond_res)
             (*armInsnTable[((opcode>>16)&0xFF0) | ((opcode>>4)&0x0F)])(opcode);
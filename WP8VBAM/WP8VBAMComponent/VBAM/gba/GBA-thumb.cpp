@@ -7,6 +7,7 @@
 #include "GBA.h"
 #include "GBAcpu.h"
 #include "GBAinline.h"
+#include "GBABlockCache.h"
 #include "Globals.h"
 #include "EEprom.h"
 #include "Flash.h"
@@ -29,7 +30,7 @@
 
 ///////////////////////////////////////////////////////////////////////////
 
-static int clockTicks;
+static CORE_LOCAL int clockTicks;
 
 static INSN_REGPARM void thumbUnknownInsn(u32 opcode)
 {
@@ -2287,13 +2288,92 @@ static insnfunc_t thumbInsnTable[1024] = {
   thumbF8,thumbF8,thumbF8,thumbF8,thumbF8,thumbF8,thumbF8,thumbF8,
 };
 
+// Block cache ////////////////////////////////////////////////////////////
+
+static blockinsn_t thumbDecode(u32 opcode)
+{
+  return thumbInsnTable[opcode>>6];
+}
+
+// B, BX/BLX, BL (second half), SWI and POP {pc} always leave the block
+static bool thumbEndsBlock(u32 opcode)
+{
+  return (opcode & 0xF800) == 0xE000 || (opcode & 0xFF00) == 0x4700 ||
+         (opcode & 0xF800) == 0xF800 || (opcode & 0xFF00) == 0xDF00 ||
+         (opcode & 0xFF00) == 0xBD00;
+}
+
+// Runs the cached block starting at armNextPC, if any, with the same
+// per-instruction bookkeeping as the loop below. Returns -1 if no block
+// could be used, otherwise the value thumbExecute should return, or 2 to
+// keep going.
+static inline int thumbExecuteBlock()
+{
+  CachedBlock *block = blockCacheFind(armNextPC, true);
+  if (block == NULL)
+    block = blockCacheBuild(armNextPC, true, thumbDecode, thumbEndsBlock);
+  // the prefetch queue may predate a store to the block (DMA, state load)
+  if (block == NULL || block->opcodes[0] != cpuPrefetch[0] ||
+      block->opcodes[1] != cpuPrefetch[1])
+    return -1;
+
+  u32 invalidations = blockCacheInvalidations;
+  // tight loops branch back to the start of their own block
+  for (;;) {
+    const u32 *op = block->opcodes;
+    blockinsn_t *handler = block->handlers;
+    blockinsn_t *end = handler + block->count;
+    u32 nextPC;
+    do {
+      u32 opcode = *op++;
+      cpuPrefetch[0] = op[0];
+      cpuPrefetch[1] = op[1];
+
+      busPrefetch = false;
+      if (busPrefetchCount & 0xFFFFFF00)
+        busPrefetchCount = 0x100 | (busPrefetchCount & 0xFF);
+      clockTicks = 0;
+      u32 oldArmNextPC = armNextPC;
+#ifndef FINAL_VERSION
+      if(armNextPC == stop) {
+        armNextPC++;
+      }
+#endif
+
+      armNextPC = reg[15].I;
+      reg[15].I += 2;
+      nextPC = reg[15].I;
+
+      (**handler)(opcode);
+
+      if (clockTicks < 0)
+        return 0;
+      if (clockTicks==0)
+        clockTicks = codeTicksAccessSeq16(oldArmNextPC) + 1;
+      cpuTotalTicks += clockTicks;
+
+      if (!(cpuTotalTicks < cpuNextEvent && !armState && !holdState && !SWITicks))
+        return 1;
+    } while (++handler < end && reg[15].I == nextPC &&
+             blockCacheInvalidations == invalidations);
+    if (armNextPC != block->pc || blockCacheInvalidations != invalidations)
+      return 2;
+  }
+}
+
 // Wrapper routine (execution loop) ///////////////////////////////////////
 
 int thumbExecute()
 {
   do {
-	  if( cheatsEnabled ) {
+	  if( blockCacheHooked(armNextPC) ) {
 		  cpuMasterCodeCheck();
+	  } else if (blockCacheEnabled) {
+      int res = thumbExecuteBlock();
+      if (res == 0 || res == 1)
+        return res;
+      if (res == 2)
+        continue;
 	  }
 
     //if ((armNextPC & 0x0803FFFF) == 0x08020000)
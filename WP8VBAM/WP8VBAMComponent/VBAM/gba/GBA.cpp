@@ -21,6 +21,7 @@
 #include "../System.h"
 #include "agbprint.h"
 #include "GBALink.h"
+#include "GBALinkLocal.h"
 
 #ifdef PROFILING
 #include "prof/prof.h"
@@ -30,38 +31,38 @@
 #define _stricmp strcasecmp
 #endif
 
-extern int emulating;
-
-int SWITicks = 0;
-int IRQTicks = 0;
-
-u32 mastercode = 0;
-int layerEnableDelay = 0;
-bool busPrefetch = false;
-bool busPrefetchEnable = false;
-u32 busPrefetchCount = 0;
-int cpuDmaTicksToUpdate = 0;
-int cpuDmaCount = 0;
-bool cpuDmaHack = false;
-u32 cpuDmaLast = 0;
-int dummyAddress = 0;
-
-bool cpuBreakLoop = false;
-int cpuNextEvent = 0;
-
-int gbaSaveType = 0; // used to remember the save type on reset
-bool intState = false;
-bool stopState = false;
-bool holdState = false;
-int holdType = 0;
-bool cpuSramEnabled = true;
-bool cpuFlashEnabled = true;
-bool cpuEEPROMEnabled = true;
-bool cpuEEPROMSensorEnabled = false;
-
-u32 cpuPrefetch[2];
-
-int cpuTotalTicks = 0;
+extern CORE_LOCAL int emulating;
+
+CORE_LOCAL int SWITicks = 0;
+CORE_LOCAL int IRQTicks = 0;
+
+CORE_LOCAL u32 mastercode = 0;
+CORE_LOCAL int layerEnableDelay = 0;
+CORE_LOCAL bool busPrefetch = false;
+CORE_LOCAL bool busPrefetchEnable = false;
+CORE_LOCAL u32 busPrefetchCount = 0;
+CORE_LOCAL int cpuDmaTicksToUpdate = 0;
+CORE_LOCAL int cpuDmaCount = 0;
+CORE_LOCAL bool cpuDmaHack = false;
+CORE_LOCAL u32 cpuDmaLast = 0;
+CORE_LOCAL int dummyAddress = 0;
+
+CORE_LOCAL bool cpuBreakLoop = false;
+CORE_LOCAL int cpuNextEvent = 0;
+
+CORE_LOCAL int gbaSaveType = 0; // used to remember the save type on reset
+CORE_LOCAL bool intState = false;
+CORE_LOCAL bool stopState = false;
+CORE_LOCAL bool holdState = false;
+CORE_LOCAL int holdType = 0;
+CORE_LOCAL bool cpuSramEnabled = true;
+CORE_LOCAL bool cpuFlashEnabled = true;
+CORE_LOCAL bool cpuEEPROMEnabled = true;
+CORE_LOCAL bool cpuEEPROMSensorEnabled = false;
+
+CORE_LOCAL u32 cpuPrefetch[2];
+
+CORE_LOCAL int cpuTotalTicks = 0;
 #ifdef PROFILING
 int profilingTicks = 0;
 int profilingTicksReload = 0;
@@ -69,59 +70,66 @@ static profile_segment *profilSegment = NULL;
 #endif
 
 #ifdef BKPT_SUPPORT
-u8 freezeWorkRAM[0x40000];
-u8 freezeInternalRAM[0x8000];
-u8 freezeVRAM[0x18000];
-u8 freezePRAM[0x400];
-u8 freezeOAM[0x400];
-bool debugger_last;
+CORE_LOCAL u8 freezeWorkRAM[0x40000];
+CORE_LOCAL u8 freezeInternalRAM[0x8000];
+CORE_LOCAL u8 freezeVRAM[0x18000];
+CORE_LOCAL u8 freezePRAM[0x400];
+CORE_LOCAL u8 freezeOAM[0x400];
+CORE_LOCAL bool debugger_last;
+// set once the debugger freezes memory; stores then always take the checked path
+CORE_LOCAL bool cpuMemoryFrozen = false;
 #endif
 
-int lcdTicks = (useBios && !skipBios) ? 1008 : 208;
-u8 timerOnOffDelay = 0;
-u16 timer0Value = 0;
-bool timer0On = false;
-int timer0Ticks = 0;
-int timer0Reload = 0;
-int timer0ClockReload  = 0;
-u16 timer1Value = 0;
-bool timer1On = false;
-int timer1Ticks = 0;
-int timer1Reload = 0;
-int timer1ClockReload  = 0;
-u16 timer2Value = 0;
-bool timer2On = false;
-int timer2Ticks = 0;
-int timer2Reload = 0;
-int timer2ClockReload  = 0;
-u16 timer3Value = 0;
-bool timer3On = false;
-int timer3Ticks = 0;
-int timer3Reload = 0;
-int timer3ClockReload  = 0;
-u32 dma0Source = 0;
-u32 dma0Dest = 0;
-u32 dma1Source = 0;
-u32 dma1Dest = 0;
-u32 dma2Source = 0;
-u32 dma2Dest = 0;
-u32 dma3Source = 0;
-u32 dma3Dest = 0;
-void (*cpuSaveGameFunc)(u32,u8) = flashSaveDecide;
-void (*renderLine)() = mode0RenderLine;
-bool fxOn = false;
-bool windowOn = false;
-int frameCount = 0;
-char buffer[1024];
-u32 lastTime = 0;
-int count = 0;
-
-int capture = 0;
-int capturePrevious = 0;
-int captureNumber = 0;
-
-int armOpcodeCount = 0;
-int thumbOpcodeCount = 0;
+CORE_LOCAL int lcdTicks = 208; // set by CPUReset from useBios and skipBios
+CORE_LOCAL u8 timerOnOffDelay = 0;
+CORE_LOCAL u16 timer0Value = 0;
+CORE_LOCAL bool timer0On = false;
+CORE_LOCAL int timer0Ticks = 0;
+CORE_LOCAL int timer0Reload = 0;
+CORE_LOCAL int timer0ClockReload  = 0;
+CORE_LOCAL u16 timer1Value = 0;
+CORE_LOCAL bool timer1On = false;
+CORE_LOCAL int timer1Ticks = 0;
+CORE_LOCAL int timer1Reload = 0;
+CORE_LOCAL int timer1ClockReload  = 0;
+CORE_LOCAL u16 timer2Value = 0;
+CORE_LOCAL bool timer2On = false;
+CORE_LOCAL int timer2Ticks = 0;
+CORE_LOCAL int timer2Reload = 0;
+CORE_LOCAL int timer2ClockReload  = 0;
+CORE_LOCAL u16 timer3Value = 0;
+CORE_LOCAL bool timer3On = false;
+CORE_LOCAL int timer3Ticks = 0;
+CORE_LOCAL int timer3Reload = 0;
+CORE_LOCAL int timer3ClockReload  = 0;
+CORE_LOCAL u32 dma0Source = 0;
+CORE_LOCAL u32 dma0Dest = 0;
+CORE_LOCAL u32 dma1Source = 0;
+CORE_LOCAL u32 dma1Dest = 0;
+CORE_LOCAL u32 dma2Source = 0;
+CORE_LOCAL u32 dma2Dest = 0;
+CORE_LOCAL u32 dma3Source = 0;
+CORE_LOCAL u32 dma3Dest = 0;
+CORE_LOCAL void (*cpuSaveGameFunc)(u32,u8) = flashSaveDecide;
+CORE_LOCAL void (*renderLine)() = mode0RenderLine;
+CORE_LOCAL bool fxOn = false;
+CORE_LOCAL bool windowOn = false;
+CORE_LOCAL int frameCount = 0;
+// Set for a frame that is skipped: no line is rendered or converted, but
+// VCOUNT, DISPSTAT, the interrupts and the DMAs run as usual. It is decided
+// once, at the end of the previous frame, so a frame is always drawn or
+// skipped as a whole even if systemFrameSkip changes halfway through.
+CORE_LOCAL bool frameNoDraw = false;
+CORE_LOCAL char buffer[1024];
+CORE_LOCAL u32 lastTime = 0;
+CORE_LOCAL int count = 0;
+
+CORE_LOCAL int capture = 0;
+CORE_LOCAL int capturePrevious = 0;
+CORE_LOCAL int captureNumber = 0;
+
+CORE_LOCAL int armOpcodeCount = 0;
+CORE_LOCAL int thumbOpcodeCount = 0;
 
 const int TIMER_TICKS[4] = {
   0,
@@ -140,13 +148,13 @@ const bool isInRom [16]=
   { false, false, false, false, false, false, false, false,
     true, true, true, true, true, true, false, false };
 
-u8 memoryWait[16] =
+CORE_LOCAL u8 memoryWait[16] =
   { 0, 0, 2, 0, 0, 0, 0, 0, 4, 4, 4, 4, 4, 4, 4, 0 };
-u8 memoryWait32[16] =
+CORE_LOCAL u8 memoryWait32[16] =
   { 0, 0, 5, 0, 0, 1, 1, 0, 7, 7, 9, 9, 13, 13, 4, 0 };
-u8 memoryWaitSeq[16] =
+CORE_LOCAL u8 memoryWaitSeq[16] =
   { 0, 0, 2, 0, 0, 0, 0, 0, 2, 2, 4, 4, 8, 8, 4, 0 };
-u8 memoryWaitSeq32[16] =
+CORE_LOCAL u8 memoryWaitSeq32[16] =
   { 0, 0, 5, 0, 0, 1, 1, 0, 5, 5, 9, 9, 17, 17, 4, 0 };
 
 // The videoMemoryWait constants are used to add some waitstates
@@ -157,7 +165,7 @@ u8 memoryWaitSeq32[16] =
 //  {0, 0, 0, 0, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0};
 
 
-u8 biosProtected[4];
+CORE_LOCAL u8 biosProtected[4];
 
 #ifdef WORDS_BIGENDIAN
 bool cpuBiosSwapped = false;
@@ -339,126 +347,132 @@ u32 myROM[] = {
 0x03007FE0
 };
 
-variable_desc saveGameStruct[] = {
-  { &DISPCNT  , sizeof(u16) },
-  { &DISPSTAT , sizeof(u16) },
-  { &VCOUNT   , sizeof(u16) },
-  { &BG0CNT   , sizeof(u16) },
-  { &BG1CNT   , sizeof(u16) },
-  { &BG2CNT   , sizeof(u16) },
-  { &BG3CNT   , sizeof(u16) },
-  { &BG0HOFS  , sizeof(u16) },
-  { &BG0VOFS  , sizeof(u16) },
-  { &BG1HOFS  , sizeof(u16) },
-  { &BG1VOFS  , sizeof(u16) },
-  { &BG2HOFS  , sizeof(u16) },
-  { &BG2VOFS  , sizeof(u16) },
-  { &BG3HOFS  , sizeof(u16) },
-  { &BG3VOFS  , sizeof(u16) },
-  { &BG2PA    , sizeof(u16) },
-  { &BG2PB    , sizeof(u16) },
-  { &BG2PC    , sizeof(u16) },
-  { &BG2PD    , sizeof(u16) },
-  { &BG2X_L   , sizeof(u16) },
-  { &BG2X_H   , sizeof(u16) },
-  { &BG2Y_L   , sizeof(u16) },
-  { &BG2Y_H   , sizeof(u16) },
-  { &BG3PA    , sizeof(u16) },
-  { &BG3PB    , sizeof(u16) },
-  { &BG3PC    , sizeof(u16) },
-  { &BG3PD    , sizeof(u16) },
-  { &BG3X_L   , sizeof(u16) },
-  { &BG3X_H   , sizeof(u16) },
-  { &BG3Y_L   , sizeof(u16) },
-  { &BG3Y_H   , sizeof(u16) },
-  { &WIN0H    , sizeof(u16) },
-  { &WIN1H    , sizeof(u16) },
-  { &WIN0V    , sizeof(u16) },
-  { &WIN1V    , sizeof(u16) },
-  { &WININ    , sizeof(u16) },
-  { &WINOUT   , sizeof(u16) },
-  { &MOSAIC   , sizeof(u16) },
-  { &BLDMOD   , sizeof(u16) },
-  { &COLEV    , sizeof(u16) },
-  { &COLY     , sizeof(u16) },
-  { &DM0SAD_L , sizeof(u16) },
-  { &DM0SAD_H , sizeof(u16) },
-  { &DM0DAD_L , sizeof(u16) },
-  { &DM0DAD_H , sizeof(u16) },
-  { &DM0CNT_L , sizeof(u16) },
-  { &DM0CNT_H , sizeof(u16) },
-  { &DM1SAD_L , sizeof(u16) },
-  { &DM1SAD_H , sizeof(u16) },
-  { &DM1DAD_L , sizeof(u16) },
-  { &DM1DAD_H , sizeof(u16) },
-  { &DM1CNT_L , sizeof(u16) },
-  { &DM1CNT_H , sizeof(u16) },
-  { &DM2SAD_L , sizeof(u16) },
-  { &DM2SAD_H , sizeof(u16) },
-  { &DM2DAD_L , sizeof(u16) },
-  { &DM2DAD_H , sizeof(u16) },
-  { &DM2CNT_L , sizeof(u16) },
-  { &DM2CNT_H , sizeof(u16) },
-  { &DM3SAD_L , sizeof(u16) },
-  { &DM3SAD_H , sizeof(u16) },
-  { &DM3DAD_L , sizeof(u16) },
-  { &DM3DAD_H , sizeof(u16) },
-  { &DM3CNT_L , sizeof(u16) },
-  { &DM3CNT_H , sizeof(u16) },
-  { &TM0D     , sizeof(u16) },
-  { &TM0CNT   , sizeof(u16) },
-  { &TM1D     , sizeof(u16) },
-  { &TM1CNT   , sizeof(u16) },
-  { &TM2D     , sizeof(u16) },
-  { &TM2CNT   , sizeof(u16) },
-  { &TM3D     , sizeof(u16) },
-  { &TM3CNT   , sizeof(u16) },
-  { &P1       , sizeof(u16) },
-  { &IE       , sizeof(u16) },
-  { &IF       , sizeof(u16) },
-  { &IME      , sizeof(u16) },
-  { &holdState, sizeof(bool) },
-  { &holdType, sizeof(int) },
-  { &lcdTicks, sizeof(int) },
-  { &timer0On , sizeof(bool) },
-  { &timer0Ticks , sizeof(int) },
-  { &timer0Reload , sizeof(int) },
-  { &timer0ClockReload  , sizeof(int) },
-  { &timer1On , sizeof(bool) },
-  { &timer1Ticks , sizeof(int) },
-  { &timer1Reload , sizeof(int) },
-  { &timer1ClockReload  , sizeof(int) },
-  { &timer2On , sizeof(bool) },
-  { &timer2Ticks , sizeof(int) },
-  { &timer2Reload , sizeof(int) },
-  { &timer2ClockReload  , sizeof(int) },
-  { &timer3On , sizeof(bool) },
-  { &timer3Ticks , sizeof(int) },
-  { &timer3Reload , sizeof(int) },
-  { &timer3ClockReload  , sizeof(int) },
-  { &dma0Source , sizeof(u32) },
-  { &dma0Dest , sizeof(u32) },
-  { &dma1Source , sizeof(u32) },
-  { &dma1Dest , sizeof(u32) },
-  { &dma2Source , sizeof(u32) },
-  { &dma2Dest , sizeof(u32) },
-  { &dma3Source , sizeof(u32) },
-  { &dma3Dest , sizeof(u32) },
-  { &fxOn, sizeof(bool) },
-  { &windowOn, sizeof(bool) },
-  { &N_FLAG , sizeof(bool) },
-  { &C_FLAG , sizeof(bool) },
-  { &Z_FLAG , sizeof(bool) },
-  { &V_FLAG , sizeof(bool) },
-  { &armState , sizeof(bool) },
-  { &armIrqEnable , sizeof(bool) },
-  { &armNextPC , sizeof(u32) },
-  { &armMode , sizeof(int) },
-  { &saveType , sizeof(int) },
-  { NULL, 0 }
-};
+static variable_desc *saveGameStruct()
+{
+  variable_desc data[] = {
+    { &DISPCNT  , sizeof(u16) },
+    { &DISPSTAT , sizeof(u16) },
+    { &VCOUNT   , sizeof(u16) },
+    { &BG0CNT   , sizeof(u16) },
+    { &BG1CNT   , sizeof(u16) },
+    { &BG2CNT   , sizeof(u16) },
+    { &BG3CNT   , sizeof(u16) },
+    { &BG0HOFS  , sizeof(u16) },
+    { &BG0VOFS  , sizeof(u16) },
+    { &BG1HOFS  , sizeof(u16) },
+    { &BG1VOFS  , sizeof(u16) },
+    { &BG2HOFS  , sizeof(u16) },
+    { &BG2VOFS  , sizeof(u16) },
+    { &BG3HOFS  , sizeof(u16) },
+    { &BG3VOFS  , sizeof(u16) },
+    { &BG2PA    , sizeof(u16) },
+    { &BG2PB    , sizeof(u16) },
+    { &BG2PC    , sizeof(u16) },
+    { &BG2PD    , sizeof(u16) },
+    { &BG2X_L   , sizeof(u16) },
+    { &BG2X_H   , sizeof(u16) },
+    { &BG2Y_L   , sizeof(u16) },
+    { &BG2Y_H   , sizeof(u16) },
+    { &BG3PA    , sizeof(u16) },
+    { &BG3PB    , sizeof(u16) },
+    { &BG3PC    , sizeof(u16) },
+    { &BG3PD    , sizeof(u16) },
+    { &BG3X_L   , sizeof(u16) },
+    { &BG3X_H   , sizeof(u16) },
+    { &BG3Y_L   , sizeof(u16) },
+    { &BG3Y_H   , sizeof(u16) },
+    { &WIN0H    , sizeof(u16) },
+    { &WIN1H    , sizeof(u16) },
+    { &WIN0V    , sizeof(u16) },
+    { &WIN1V    , sizeof(u16) },
+    { &WININ    , sizeof(u16) },
+    { &WINOUT   , sizeof(u16) },
+    { &MOSAIC   , sizeof(u16) },
+    { &BLDMOD   , sizeof(u16) },
+    { &COLEV    , sizeof(u16) },
+    { &COLY     , sizeof(u16) },
+    { &DM0SAD_L , sizeof(u16) },
+    { &DM0SAD_H , sizeof(u16) },
+    { &DM0DAD_L , sizeof(u16) },
+    { &DM0DAD_H , sizeof(u16) },
+    { &DM0CNT_L , sizeof(u16) },
+    { &DM0CNT_H , sizeof(u16) },
+    { &DM1SAD_L , sizeof(u16) },
+    { &DM1SAD_H , sizeof(u16) },
+    { &DM1DAD_L , sizeof(u16) },
+    { &DM1DAD_H , sizeof(u16) },
+    { &DM1CNT_L , sizeof(u16) },
+    { &DM1CNT_H , sizeof(u16) },
+    { &DM2SAD_L , sizeof(u16) },
+    { &DM2SAD_H , sizeof(u16) },
+    { &DM2DAD_L , sizeof(u16) },
+    { &DM2DAD_H , sizeof(u16) },
+    { &DM2CNT_L , sizeof(u16) },
+    { &DM2CNT_H , sizeof(u16) },
+    { &DM3SAD_L , sizeof(u16) },
+    { &DM3SAD_H , sizeof(u16) },
+    { &DM3DAD_L , sizeof(u16) },
+    { &DM3DAD_H , sizeof(u16) },
+    { &DM3CNT_L , sizeof(u16) },
+    { &DM3CNT_H , sizeof(u16) },
+    { &TM0D     , sizeof(u16) },
+    { &TM0CNT   , sizeof(u16) },
+    { &TM1D     , sizeof(u16) },
+    { &TM1CNT   , sizeof(u16) },
+    { &TM2D     , sizeof(u16) },
+    { &TM2CNT   , sizeof(u16) },
+    { &TM3D     , sizeof(u16) },
+    { &TM3CNT   , sizeof(u16) },
+    { &P1       , sizeof(u16) },
+    { &IE       , sizeof(u16) },
+    { &IF       , sizeof(u16) },
+    { &IME      , sizeof(u16) },
+    { &holdState, sizeof(bool) },
+    { &holdType, sizeof(int) },
+    { &lcdTicks, sizeof(int) },
+    { &timer0On , sizeof(bool) },
+    { &timer0Ticks , sizeof(int) },
+    { &timer0Reload , sizeof(int) },
+    { &timer0ClockReload  , sizeof(int) },
+    { &timer1On , sizeof(bool) },
+    { &timer1Ticks , sizeof(int) },
+    { &timer1Reload , sizeof(int) },
+    { &timer1ClockReload  , sizeof(int) },
+    { &timer2On , sizeof(bool) },
+    { &timer2Ticks , sizeof(int) },
+    { &timer2Reload , sizeof(int) },
+    { &timer2ClockReload  , sizeof(int) },
+    { &timer3On , sizeof(bool) },
+    { &timer3Ticks , sizeof(int) },
+    { &timer3Reload , sizeof(int) },
+    { &timer3ClockReload  , sizeof(int) },
+    { &dma0Source , sizeof(u32) },
+    { &dma0Dest , sizeof(u32) },
+    { &dma1Source , sizeof(u32) },
+    { &dma1Dest , sizeof(u32) },
+    { &dma2Source , sizeof(u32) },
+    { &dma2Dest , sizeof(u32) },
+    { &dma3Source , sizeof(u32) },
+    { &dma3Dest , sizeof(u32) },
+    { &fxOn, sizeof(bool) },
+    { &windowOn, sizeof(bool) },
+    { &N_FLAG , sizeof(bool) },
+    { &C_FLAG , sizeof(bool) },
+    { &Z_FLAG , sizeof(bool) },
+    { &V_FLAG , sizeof(bool) },
+    { &armState , sizeof(bool) },
+    { &armIrqEnable , sizeof(bool) },
+    { &armNextPC , sizeof(u32) },
+    { &armMode , sizeof(int) },
+    { &saveType , sizeof(int) },
+    { NULL, 0 }
+  };
+  static CORE_LOCAL variable_desc table[sizeof(data) / sizeof(data[0])];
+  memcpy(table, data, sizeof(data));
+  return table;
+}
 
-int romSize = 0x2000000;
+CORE_LOCAL int romSize = 0x2000000;
 
 #ifdef PROFILING
 void cpuProfil(profile_segment *seg)
@@ -503,6 +517,9 @@ inline int CPUUpdateTicks()
   }
 #endif
 
+  if(localLinkEnabled && localLinkTicks < cpuLoopTicks)
+    cpuLoopTicks = localLinkTicks;
+
   if (SWITicks) {
     if (SWITicks < cpuLoopTicks)
         cpuLoopTicks = SWITicks;
@@ -548,10 +565,10 @@ void CPUUpdateWindow1()
   }
 }
 
-extern u32 line0[240];
-extern u32 line1[240];
-extern u32 line2[240];
-extern u32 line3[240];
+extern CORE_LOCAL u32 line0[240];
+extern CORE_LOCAL u32 line1[240];
+extern CORE_LOCAL u32 line2[240];
+extern CORE_LOCAL u32 line3[240];
 
 #define CLEAR_ARRAY(a) \
   {\
@@ -577,7 +594,42 @@ void CPUUpdateRenderBuffers(bool force)
   }
 }
 
-static bool CPUWriteState(gzFile gzFile)
+// Save states keep the picture as 162 rows of 4*241 bytes, whatever the
+// pitch of the frame target. Memory states (raw states and the rewind
+// history) leave it out: the target may be a mapped texture that is slow to
+// read back, and the next frame redraws it anyway.
+#define PICTURE_PITCH (4*241)
+
+static void CPUWritePicture(gzFile gzFile)
+{
+  if(systemColorDepth != 32 || gbaPitch == PICTURE_PITCH) {
+    utilGzWrite(gzFile, pix, PICTURE_PITCH*162);
+    return;
+  }
+  u8 row[PICTURE_PITCH];
+  size_t len = gbaPitch < PICTURE_PITCH ? gbaPitch : PICTURE_PITCH;
+  memset(row, 0, PICTURE_PITCH);
+  for(int y = 0; y < 162; y++) {
+    memcpy(row, pix + gbaPitch * y, len);
+    utilGzWrite(gzFile, row, PICTURE_PITCH);
+  }
+}
+
+static void CPUReadPicture(gzFile gzFile)
+{
+  if(systemColorDepth != 32 || gbaPitch == PICTURE_PITCH) {
+    utilGzRead(gzFile, pix, PICTURE_PITCH*162);
+    return;
+  }
+  u8 row[PICTURE_PITCH];
+  size_t len = gbaPitch < PICTURE_PITCH ? gbaPitch : PICTURE_PITCH;
+  for(int y = 0; y < 162; y++) {
+    utilGzRead(gzFile, row, PICTURE_PITCH);
+    memcpy(pix + gbaPitch * y, row, len);
+  }
+}
+
+static bool CPUWriteState(gzFile gzFile, bool picture = true)
 {
   utilWriteInt(gzFile, SAVE_GAME_VERSION);
 
@@ -587,7 +639,7 @@ static bool CPUWriteState(gzFile gzFile)
 
   utilGzWrite(gzFile, &reg[0], sizeof(reg));
 
-  utilWriteData(gzFile, saveGameStruct);
+  utilWriteData(gzFile, saveGameStruct());
 
   // new to version 0.7.1
   utilWriteInt(gzFile, stopState);
@@ -599,7 +651,8 @@ static bool CPUWriteState(gzFile gzFile)
   utilGzWrite(gzFile, workRAM, 0x40000);
   utilGzWrite(gzFile, vram, 0x20000);
   utilGzWrite(gzFile, oam, 0x400);
-  utilGzWrite(gzFile, pix, 4*241*162);
+  if(picture)
+    CPUWritePicture(gzFile);
   utilGzWrite(gzFile, ioMem, 0x400);
 
   eepromSaveGame(gzFile);
@@ -630,19 +683,19 @@ bool CPUWriteState(const char *file)
   return res;
 }
 
-bool CPUWriteMemState(char *memory, int available)
+bool CPUWriteMemState(char *memory, int available, long &size)
 {
-  gzFile gzFile = utilMemGzOpen(memory, available, "w");
+  gzFile gzFile = utilMemRawOpen(memory, available, "w");
 
   if(gzFile == NULL) {
     return false;
   }
 
-  bool res = CPUWriteState(gzFile);
+  bool res = CPUWriteState(gzFile, false);
 
-  long pos = utilGzMemTell(gzFile)+8;
+  size = utilGzMemTell(gzFile);
 
-  if(pos >= (available))
+  if(size > available)
     res = false;
 
   utilGzClose(gzFile);
@@ -653,6 +706,9 @@ bool CPUWriteMemState(char *memory, int available)
 void CPUReadHelper(void)
 {
 	systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
+	blockCacheFlush();
+	tileCacheFlush();
+	CPUUpdateMemoryPages();
 	if(armState) 
 	{
 		ARM_PREFETCH;
@@ -664,7 +720,7 @@ void CPUReadHelper(void)
 	CPUUpdateRegister(0x204, CPUReadHalfWordQuick(0x4000204));
 }
 
-static bool CPUReadState(gzFile gzFile)
+static bool CPUReadState(gzFile gzFile, bool picture = true)
 {
   int version = utilReadInt(gzFile);
 
@@ -702,7 +758,7 @@ static bool CPUReadState(gzFile gzFile)
 
   utilGzRead(gzFile, &reg[0], sizeof(reg));
 
-  utilReadData(gzFile, saveGameStruct);
+  utilReadData(gzFile, saveGameStruct());
 
   if(version < SAVE_GAME_VERSION_3)
     stopState = false;
@@ -733,8 +789,8 @@ static bool CPUReadState(gzFile gzFile)
   utilGzRead(gzFile, oam, 0x400);
   if(version < SAVE_GAME_VERSION_6)
     utilGzRead(gzFile, pix, 4*240*160);
-  else
-    utilGzRead(gzFile, pix, 4*241*162);
+  else if(picture)
+    CPUReadPicture(gzFile);
   utilGzRead(gzFile, ioMem, 0x400);
 
   if(skipSaveGameBattery) {
@@ -825,6 +881,10 @@ static bool CPUReadState(gzFile gzFile)
     gbaSaveType = 3;
 
   systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
+  blockCacheFlush();
+  tileCacheFlush();
+  CPUUpdateMemoryPages();
+  CPUUpdatePaletteColors();
   if(armState) {
     ARM_PREFETCH;
   } else {
@@ -838,9 +898,9 @@ static bool CPUReadState(gzFile gzFile)
 
 bool CPUReadMemState(char *memory, int available)
 {
-  gzFile gzFile = utilMemGzOpen(memory, available, "r");
+  gzFile gzFile = utilMemRawOpen(memory, available, "r");
 
-  bool res = CPUReadState(gzFile);
+  bool res = CPUReadState(gzFile, false);
 
   utilGzClose(gzFile);
 
@@ -1297,6 +1357,11 @@ void CPUCleanUp()
     rom = NULL;
   }
 
+  if(romOpenBus != NULL) {
+    free(romOpenBus);
+    romOpenBus = NULL;
+  }
+
   if(vram != NULL) {
     free(vram);
     vram = NULL;
@@ -1322,6 +1387,8 @@ void CPUCleanUp()
     bios = NULL;
   }
 
+  CPUUpdateMemoryPages();
+
   /*if(pix != NULL) {
     free(pix);
     pix = NULL;
@@ -1346,6 +1413,112 @@ void CPUCleanUp()
   //emulating = 0;
 }
 
+// Allocates rom for an image of size bytes, rounded up to a power of two
+// so that the masked map[] reads used for opcode fetches stay inside it.
+// The rest of the cartridge space is not backed: CPUReadMemory and friends
+// synthesize its open bus, and romOpenBus holds one period of it for the
+// opcode fetches past 0x09000000.
+static bool CPUAllocRom(int size)
+{
+  u32 allocSize = 0x10000;
+  while(allocSize < (u32)size && allocSize < 0x2000000)
+    allocSize <<= 1;
+
+  romMask = allocSize - 1;
+  romMirrorSize = 0;
+  rom = (u8 *)malloc(allocSize);
+  if(allocSize <= 0x1000000)
+    romOpenBus = (u8 *)malloc(0x20000);
+  if(rom == NULL || (allocSize <= 0x1000000 && romOpenBus == NULL)) {
+    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
+                  "ROM");
+    return false;
+  }
+  return true;
+}
+
+// Fills rom from start on, and romOpenBus, with the open bus pattern
+static void CPUFillRomOpenBus(int start)
+{
+  u16 *temp = (u16 *)(rom+start);
+  for(u32 i = start; i <= romMask; i+=2) {
+    WRITE16LE(temp, (i >> 1) & 0xFFFF);
+    temp++;
+  }
+  if(romOpenBus != NULL) {
+    temp = (u16 *)romOpenBus;
+    for(int i = 0; i < 0x10000; i++) {
+      WRITE16LE(temp, i);
+      temp++;
+    }
+  }
+}
+
+// Allocates the memories other than the ROM and WRAM
+static bool CPUAllocMemory()
+{
+  bios = (u8 *)calloc(1,0x4000);
+  if(bios == NULL) {
+    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
+                  "BIOS");
+    CPUCleanUp();
+    return false;
+  }
+  internalRAM = (u8 *)calloc(1,0x8000);
+  if(internalRAM == NULL) {
+    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
+                  "IRAM");
+    CPUCleanUp();
+    return false;
+  }
+  paletteRAM = (u8 *)calloc(1,0x400);
+  if(paletteRAM == NULL) {
+    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
+                  "PRAM");
+    CPUCleanUp();
+    return false;
+  }
+  vram = (u8 *)calloc(1, 0x20000);
+  if(vram == NULL) {
+    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
+                  "VRAM");
+    CPUCleanUp();
+    return false;
+  }
+  oam = (u8 *)calloc(1, 0x400);
+  if(oam == NULL) {
+    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
+                  "OAM");
+    CPUCleanUp();
+    return false;
+  }
+  // the frontend may already have set its own frame target
+  if(pix == NULL) {
+    gbaPitch = 4 * 241;
+    pix = (u8 *)calloc(1, 4 * 241 * 162);
+  }
+  if(pix == NULL) {
+    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
+                  "PIX");
+    CPUCleanUp();
+    return false;
+  }
+  ioMem = (u8 *)calloc(1, 0x400);
+  if(ioMem == NULL) {
+    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
+                  "IO");
+    CPUCleanUp();
+    return false;
+  }
+
+  flashInit();
+  eepromInit();
+
+  CPUUpdateRenderBuffers(true);
+
+  return true;
+}
+
 int CPULoadRom(const char *szFile)
 {
   romSize = 0x2000000;
@@ -1355,12 +1528,9 @@ int CPULoadRom(const char *szFile)
 
   systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
 
-  rom = (u8 *)malloc(0x2000000);
-  if(rom == NULL) {
-    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-                  "ROM");
+  // the size of a file is only known once it is read
+  if(!CPUAllocRom(0x2000000))
     return 0;
-  }
   workRAM = (u8 *)calloc(1, 0x40000);
   if(workRAM == NULL) {
     systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
@@ -1368,8 +1538,6 @@ int CPULoadRom(const char *szFile)
     return 0;
   }
 
-  u8 *whereToLoad = cpuIsMultiBoot ? workRAM : rom;
-
 #ifndef NO_DEBUGGER
   if(CPUIsELF(szFile)) {
     FILE *f = fopen(szFile, "rb");
@@ -1407,67 +1575,44 @@ int CPULoadRom(const char *szFile)
 	  }*/
   }
 
-  u16 *temp = (u16 *)(rom+((romSize+1)&~1));
-  int i;
-  for(i = (romSize+1)&~1; i < 0x2000000; i+=2) {
-    WRITE16LE(temp, (i >> 1) & 0xFFFF);
-    temp++;
-  }
+  CPUFillRomOpenBus((romSize+1)&~1);
 
-  bios = (u8 *)calloc(1,0x4000);
-  if(bios == NULL) {
-    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-                  "BIOS");
-    CPUCleanUp();
-    return 0;
-  }
-  internalRAM = (u8 *)calloc(1,0x8000);
-  if(internalRAM == NULL) {
-    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-                  "IRAM");
-    CPUCleanUp();
+  if(!CPUAllocMemory())
     return 0;
-  }
-  paletteRAM = (u8 *)calloc(1,0x400);
-  if(paletteRAM == NULL) {
-    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-                  "PRAM");
-    CPUCleanUp();
-    return 0;
-  }
-  vram = (u8 *)calloc(1, 0x20000);
-  if(vram == NULL) {
-    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-                  "VRAM");
-    CPUCleanUp();
-    return 0;
-  }
-  oam = (u8 *)calloc(1, 0x400);
-  if(oam == NULL) {
-    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-                  "OAM");
+
+  return romSize;
+}
+
+int CPULoadRomData(const char *data, int size)
+{
+  int maxSize = cpuIsMultiBoot ? 0x40000 : 0x2000000;
+  if(size > maxSize)
+    size = maxSize;
+
+  if(rom != NULL) {
     CPUCleanUp();
-    return 0;
   }
-  pix = (u8 *)calloc(1, 4 * 241 * 162);
-  if(pix == NULL) {
-    systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-                  "PIX");
-    CPUCleanUp();
+
+  systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
+
+  // a multiboot image runs from WRAM and leaves the cartridge empty
+  if(!CPUAllocRom(cpuIsMultiBoot ? 0 : size))
     return 0;
-  }
-  ioMem = (u8 *)calloc(1, 0x400);
-  if(ioMem == NULL) {
+  workRAM = (u8 *)calloc(1, 0x40000);
+  if(workRAM == NULL) {
     systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
-                  "IO");
-    CPUCleanUp();
+                  "WRAM");
     return 0;
   }
 
-  flashInit();
-  eepromInit();
+  u8 *whereToLoad = cpuIsMultiBoot ? workRAM : rom;
+  memcpy(whereToLoad, data, size);
+  romSize = size;
 
-  CPUUpdateRenderBuffers(true);
+  CPUFillRomOpenBus(cpuIsMultiBoot ? 0 : (romSize+1)&~1);
+
+  if(!CPUAllocMemory())
+    return 0;
 
   return romSize;
 }
@@ -1475,18 +1620,35 @@ int CPULoadRom(const char *szFile)
 void doMirroring (bool b)
 {
   u32 mirroredRomSize = (((romSize)>>20) & 0x3F)<<20;
-  u32 mirroredRomAddress = romSize;
+  romMirrorSize = 0;
   if ((mirroredRomSize <=0x800000) && (b))
   {
-    mirroredRomAddress = mirroredRomSize;
     if (mirroredRomSize==0)
         mirroredRomSize=0x100000;
-    while (mirroredRomAddress<0x01000000)
-    {
-      memcpy ((u16 *)(rom+mirroredRomAddress), (u16 *)(rom), mirroredRomSize);
-      mirroredRomAddress+=mirroredRomSize;
+    romMirrorSize = mirroredRomSize;
+  }
+
+  // A mask cannot wrap at 3, 5, 6 or 7 MB, so for those the opcode fetches
+  // need the mirror copies in rom, up to 16 MB. The image past the mirror
+  // size is not reachable while mirrored and gets overwritten.
+  if(romMirrorSize & (romMirrorSize - 1)) {
+    if(romMask < 0xFFFFFF) {
+      u8 *grown = (u8 *)realloc(rom, 0x1000000);
+      if(grown == NULL) {
+        systemMessage(MSG_OUT_OF_MEMORY, N_("Failed to allocate memory for %s"),
+                      "ROM");
+        romMirrorSize = 0;
+      } else {
+        rom = grown;
+        romMask = 0xFFFFFF;
+      }
     }
+    for(u32 i = romMirrorSize; romMirrorSize && i < 0x1000000; i += romMirrorSize)
+      memcpy(rom + i, rom, 0x1000000 - i < romMirrorSize ?
+             0x1000000 - i : romMirrorSize);
   }
+  CPUUpdateMemoryPages();
+  blockCacheFlush();
 }
 
 void CPUUpdateRender()
@@ -1550,6 +1712,138 @@ void CPUUpdateRender()
   }
 }
 
+static void CPUMapPages(memoryPage *pages, u32 start, u32 end, u8 *base,
+                        u32 mask, int codePage)
+{
+  for(u32 address = start; address < end; address += CPU_PAGE_SIZE) {
+    memoryPage *page = &pages[address >> CPU_PAGE_SHIFT];
+    u32 offset = address & mask;
+    page->address = base ? &base[offset] : NULL;
+    page->mask = mask & (CPU_PAGE_SIZE - 1);
+    page->codePage = codePage < 0 ? -1 : codePage + (offset >> BLOCK_PAGE_SHIFT);
+    page->tileDirty = NULL;
+  }
+}
+
+// The upper 32K of each VRAM mirror repeats the OBJ tiles, except that its
+// first half is unmapped in the bitmap modes. Called when DISPCNT switches
+// between tile and bitmap modes.
+void CPUUpdateVRAMPages()
+{
+  if(vram == NULL)
+    return;
+
+  bool bitmap = (DISPCNT & 7) > 2;
+  bool writable = true;
+#ifdef BKPT_SUPPORT
+  writable = !cpuMemoryFrozen;
+#endif
+
+  for(u32 address = 0x06000000; address < 0x07000000; address += CPU_PAGE_SIZE) {
+    u32 offset = address & 0x1FFFF;
+    u8 *base = vram;
+    if((offset & 0x18000) == 0x18000) {
+      if(bitmap && (offset & 0x1C000) == 0x18000)
+        base = NULL;
+      offset &= 0x17FFF;
+    }
+    memoryPage *read = &cpuReadPages[address >> CPU_PAGE_SHIFT];
+    read->address = base ? &base[offset] : NULL;
+    read->mask = CPU_PAGE_SIZE - 1;
+    read->codePage = -1;
+    read->tileDirty = NULL;
+    memoryPage *write = &cpuWritePages[address >> CPU_PAGE_SHIFT];
+    *write = *read;
+    write->tileDirty = &tileCacheDirty[offset >> TILE_CACHE_SHIFT];
+    if(!writable)
+      write->address = NULL;
+  }
+}
+
+// Rebuilds the page tables used by the memory fast paths. Must be called
+// whenever the backing buffers or the mapping change (reset, state load,
+// RTC or debugger freeze changes).
+void CPUUpdateMemoryPages()
+{
+  memset(cpuReadPages, 0, sizeof(cpuReadPages));
+  memset(cpuWritePages, 0, sizeof(cpuWritePages));
+
+  if(workRAM == NULL)
+    return;
+
+  CPUMapPages(cpuReadPages, 0x02000000, 0x03000000, workRAM, 0x3FFFF, -1);
+  CPUMapPages(cpuReadPages, 0x03000000, 0x04000000, internalRAM, 0x7FFF, -1);
+  CPUMapPages(cpuReadPages, 0x05000000, 0x06000000, paletteRAM, 0x3FF, -1);
+  CPUMapPages(cpuReadPages, 0x07000000, 0x08000000, oam, 0x3FF, -1);
+  if(rom != NULL) {
+    // the opcode fetches go through map[], masked to stay inside rom. A
+    // power of two mirror wraps through the mask; doMirroring copies the
+    // others into rom.
+    u32 mask = romMask;
+    if(romMirrorSize && !(romMirrorSize & (romMirrorSize - 1)) &&
+       romMirrorSize <= romMask)
+      mask = romMirrorSize - 1;
+    map[8].address = rom;
+    map[8].mask = mask;
+    map[9].address = romOpenBus ? romOpenBus : rom;
+    map[9].mask = romOpenBus ? 0x1FFFF : mask;
+    map[10].address = rom;
+    map[10].mask = mask;
+    map[12].address = rom;
+    map[12].mask = mask;
+
+    // pages past the image are left to CPUReadMemory
+    for(u32 address = 0x08000000; address < 0x0D000000; address += CPU_PAGE_SIZE) {
+      u32 offset = CPURomOffset(address);
+      if(offset <= romMask) {
+        memoryPage *page = &cpuReadPages[address >> CPU_PAGE_SHIFT];
+        page->address = &rom[offset];
+        page->mask = CPU_PAGE_SIZE - 1;
+        page->codePage = -1;
+        page->tileDirty = NULL;
+      }
+    }
+    // the RTC registers overlay the first ROM page
+    if(rtcIsEnabled())
+      CPUMapPages(cpuReadPages, 0x08000000, 0x08000000 + CPU_PAGE_SIZE, NULL, 0, -1);
+  }
+
+#ifdef BKPT_SUPPORT
+  if(!cpuMemoryFrozen)
+#endif
+  {
+    CPUMapPages(cpuWritePages, 0x02000000, 0x03000000, workRAM, 0x3FFFF, 0);
+    CPUMapPages(cpuWritePages, 0x03000000, 0x04000000, internalRAM, 0x7FFF,
+                BLOCK_EWRAM_PAGES);
+    // palette writes go through the handlers to keep gfxPalette16/32 current
+    CPUMapPages(cpuWritePages, 0x07000000, 0x08000000, oam, 0x3FF, -1);
+  }
+
+  CPUUpdateVRAMPages();
+}
+
+// Converts palette RAM entry index (0-511) into the gfxPalette shadow of the
+// current systemColorDepth. Called on every palette write.
+void CPUUpdatePaletteColor(int index)
+{
+  u16 color = READ16LE(&((u16 *)paletteRAM)[index]);
+  if(systemColorDepth == 16)
+    gfxPalette16[index] = utilColor16(color);
+  else
+    gfxPalette32[index] = utilColor32(color);
+}
+
+// Rebuilds the whole shadow after palette RAM was replaced (reset, state
+// load) or the output format changed.
+void CPUUpdatePaletteColors()
+{
+  if(paletteRAM == NULL)
+    return;
+
+  for(int i = 0; i < 512; i++)
+    CPUUpdatePaletteColor(i);
+}
+
 void CPUUpdateCPSR()
 {
   u32 CPSR = reg[16].I & 0x40;
@@ -1755,7 +2049,7 @@ void CPUSoftwareInterrupt()
 
 void CPUSoftwareInterrupt(int comment)
 {
-  static bool disableMessage = false;
+  static CORE_LOCAL bool disableMessage = false;
   if(armState) comment >>= 16;
 #ifdef BKPT_SUPPORT
   if(comment == 0xff) {
@@ -2082,6 +2376,78 @@ void CPUCompareVCOUNT()
 
 }
 
+// Copies an incrementing transfer a run at a time while both ends are
+// directly backed: the read pages, the write pages, and palette RAM, which
+// has no write pages so that its shadows get converted here. Stops at the
+// first unit that has to go through CPUReadMemory/CPUWriteMemory (IO, save
+// chips, open bus, unmapped VRAM) and returns the units left.
+static u32 CPUDmaBlockCopy(u32 &s, u32 &d, u32 c, int transfer32)
+{
+  u32 size = transfer32 ? 4 : 2;
+
+  if(d & (size - 1))
+    return c;
+
+  while(c != 0) {
+    const memoryPage *src = CPUReadPage(s);
+    if(!src)
+      break;
+    const memoryPage *dst = CPUWritePage(d);
+    u32 smask = src->mask;
+    u32 dmask;
+    u8 *to;
+    if(dst) {
+      dmask = dst->mask;
+      to = &dst->address[d & dmask];
+    } else if((d >> 24) == 0x05
+#ifdef BKPT_SUPPORT
+              && !cpuMemoryFrozen
+#endif
+              ) {
+      dmask = 0x3FF;
+      to = &paletteRAM[d & dmask];
+    } else
+      break;
+    u8 *from = &src->address[s & smask];
+
+    // the run ends where either side wraps or changes page
+    u32 len = c * size;
+    if(len > smask + 1 - (s & smask))
+      len = smask + 1 - (s & smask);
+    if(len > dmask + 1 - (d & dmask))
+      len = dmask + 1 - (d & dmask);
+    // a forward copy onto a source just ahead of it repeats the source
+    if(to > from && to < from + len)
+      break;
+    memmove(to, from, len);
+
+    u32 offset = d & dmask;
+    if(!dst) {
+      for(u32 i = offset >> 1; i < (offset + len) >> 1; i++)
+        CPUUpdatePaletteColor(i);
+    } else if(dst->codePage >= 0) {
+      for(u32 i = offset >> BLOCK_PAGE_SHIFT;
+          i <= (offset + len - 1) >> BLOCK_PAGE_SHIFT; i++)
+        blockCacheWritePage(dst->codePage + i);
+    } else if(dst->tileDirty) {
+      memset(&dst->tileDirty[offset >> TILE_CACHE_SHIFT], 1,
+             ((offset + len - 1) >> TILE_CACHE_SHIFT) -
+             (offset >> TILE_CACHE_SHIFT) + 1);
+    }
+
+    if(transfer32)
+      cpuDmaLast = READ32LE(((u32 *)(to + len - 4)));
+    else {
+      cpuDmaLast = READ16LE(((u16 *)(to + len - 2)));
+      cpuDmaLast |= (cpuDmaLast<<16);
+    }
+    s += len;
+    d += len;
+    c -= len / size;
+  }
+  return c;
+}
+
 void doDMA(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
 {
   int sm = s >> 24;
@@ -2110,6 +2476,8 @@ void doDMA(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
         c--;
       }
     } else {
+      if(si == 4 && di == 4)
+        c = CPUDmaBlockCopy(s, d, c, transfer32);
       while(c != 0) {
         cpuDmaLast = CPUReadMemory(s);
         CPUWriteMemory(d, cpuDmaLast);
@@ -2129,6 +2497,8 @@ void doDMA(u32 &s, u32 &d, u32 si, u32 di, u32 c, int transfer32)
         c--;
       }
     } else {
+      if(si == 2 && di == 2)
+        c = CPUDmaBlockCopy(s, d, c, transfer32);
       while(c != 0) {
         cpuDmaLast = CPUReadHalfWord(s);
         CPUWriteHalfWord(d, cpuDmaLast);
@@ -2419,6 +2789,7 @@ void CPUUpdateRegister(u32 address, u16 value)
   {
   case 0x00:
     { // we need to place the following code in { } because we declare & initialize variables in a case statement
+      bool bitmapMode = (DISPCNT & 7) > 2;
       if((value & 7) > 5) {
         // display modes above 0-5 are prohibited
         DISPCNT = (value & 7);
@@ -2429,6 +2800,8 @@ void CPUUpdateRegister(u32 address, u16 value)
 
       DISPCNT = (value & 0xFFF7); // bit 3 can only be accessed by the BIOS to enable GBC mode
       UPDATE_REG(0x00, DISPCNT);
+      if(bitmapMode != ((DISPCNT & 7) > 2))
+        CPUUpdateVRAMPages();
 
       if(changeBGon) {
         layerEnableDelay = 4;
@@ -2837,12 +3210,18 @@ void CPUUpdateRegister(u32 address, u16 value)
     cpuNextEvent = cpuTotalTicks;
     break;
 
-#ifndef NO_LINK
-
   case COMM_SIOCNT:
-	  StartLink(value);
+	  if(localLinkEnabled)
+		  localLinkStart(value);
+	  else
+#ifndef NO_LINK
+		  StartLink(value);
+#else
+		  UPDATE_REG(COMM_SIOCNT, value);
+#endif
 	  break;
 
+#ifndef NO_LINK
   case COMM_SIODATA8:
 	  UPDATE_REG(COMM_SIODATA8, value);
 	  break;
@@ -2857,11 +3236,19 @@ void CPUUpdateRegister(u32 address, u16 value)
 	  UPDATE_REG(0x132, value & 0xC3FF);
 	  break;
 
-#ifndef NO_LINK
   case COMM_RCNT:
-	  StartGPLink(value);
+	  if(localLinkEnabled)
+		  localLinkStartGP(value);
+	  else
+#ifndef NO_LINK
+		  StartGPLink(value);
+#else
+		  UPDATE_REG(COMM_RCNT, value);
+#endif
 	  break;
 
+#ifndef NO_LINK
+
   case COMM_JOYCNT:
 	  {
 		  u16 cur = READ16LE(&ioMem[COMM_JOYCNT]);
@@ -3029,8 +3416,8 @@ void applyTimer ()
   timerOnOffDelay = 0;
 }
 
-u8 cpuBitsSet[256];
-u8 cpuLowestBitSet[256];
+CORE_LOCAL u8 cpuBitsSet[256];
+CORE_LOCAL u8 cpuLowestBitSet[256];
 
 void CPUInit(const char *biosFileName, bool useBiosFile)
 {
@@ -3121,8 +3508,10 @@ void CPUInit(const char *biosFileName, bool useBiosFile)
     ioReadable[i] = false;
 
   if(romSize < 0x1fe2000) {
-    *((u16 *)&rom[0x1fe209c]) = 0xdffa; // SWI 0xFA
-    *((u16 *)&rom[0x1fe209e]) = 0x4770; // BX LR
+    // for the opcode fetches; CPUReadRomOpenBus returns it to the others
+    u8 *stub = romOpenBus ? &romOpenBus[0x1fe209c & 0x1FFFF] : &rom[0x1fe209c];
+    *((u16 *)&stub[0]) = 0xdffa; // SWI 0xFA
+    *((u16 *)&stub[2]) = 0x4770; // BX LR
   } else {
     agbPrintEnable(false);
   }
@@ -3150,10 +3539,11 @@ void CPUReset()
   memset(oam, 0, 0x400);
   // clean palette
   memset(paletteRAM, 0, 0x400);
+  CPUUpdatePaletteColors();
   // clean picture
   if(pix)
   {
-	memset(pix, 0, 4*160*240);
+	memset(pix, 0, systemColorDepth == 32 ? gbaPitch*162 : 4*160*240);
   }
   // clean vram
   memset(vram, 0, 0x20000);
@@ -3319,6 +3709,7 @@ void CPUReset()
   fxOn = false;
   windowOn = false;
   frameCount = 0;
+  frameNoDraw = false;
   saveType = 0;
   layerEnable = DISPCNT & layerSettings;
 
@@ -3343,17 +3734,11 @@ void CPUReset()
   map[6].mask = 0x1FFFF;
   map[7].address = oam;
   map[7].mask = 0x3FF;
-  map[8].address = rom;
-  map[8].mask = 0x1FFFFFF;
-  map[9].address = rom;
-  map[9].mask = 0x1FFFFFF;
-  map[10].address = rom;
-  map[10].mask = 0x1FFFFFF;
-  map[12].address = rom;
-  map[12].mask = 0x1FFFFFF;
   map[14].address = flashSaveMemory;
   map[14].mask = 0xFFFF;
 
+  CPUUpdateMemoryPages();
+
   eepromReset();
   flashReset();
 
@@ -3423,6 +3808,8 @@ void CPUReset()
     break;
   }
 
+  blockCacheFlush();
+  tileCacheFlush();
   ARM_PREFETCH;
 
   systemSaveUpdateCounter = SYSTEM_SAVE_NOT_UPDATED;
@@ -3457,6 +3844,20 @@ void CPUInterrupt()
   biosProtected[3] = 0xe5;
 }
 
+// lineMix pixel to the output format: palette pixels come from the small
+// gfxPalette shadow, only blended and direct colours use systemColorMap
+static inline u16 CPUColor16(u32 pixel)
+{
+  return (pixel & GFX_PALETTE) ? gfxPalette16[pixel & 0x1FF] :
+    systemColorMap16[pixel & 0x7FFF];
+}
+
+static inline u32 CPUColor32(u32 pixel)
+{
+  return (pixel & GFX_PALETTE) ? gfxPalette32[pixel & 0x1FF] :
+    systemColorMap32[pixel & 0x7FFF];
+}
+
 void CPULoop(int ticks)
 {
   int clockTicks;
@@ -3573,10 +3974,7 @@ void CPULoop(int ticks)
             CPUCompareVCOUNT();
           }
         } else {
-          int framesToSkip = systemFrameSkip;
 		  extern int turboSkip;
-          if(speedup)
-            framesToSkip = turboSkip; 
 
           if(DISPSTAT & 2) {
             // if in H-Blank, leave it and move to drawing mode
@@ -3651,11 +4049,13 @@ void CPULoop(int ticks)
                 UPDATE_REG(0x202, IF);
               }
               CPUCheckDMA(1, 0x0f);
-              if(frameCount >= framesToSkip) {
+              if(!frameNoDraw) {
                 systemDrawScreen();
                 frameCount = 0;
               } else
                 frameCount++;
+              // systemFrame() and the joypad may have changed the skip
+              frameNoDraw = frameCount < (speedup ? turboSkip : systemFrameSkip);
               if(systemPauseOnFrame())
                 ticks = 0;
             }
@@ -3665,7 +4065,7 @@ void CPULoop(int ticks)
 
           } else {
 
-            if(frameCount >= framesToSkip)
+            if(!frameNoDraw)
             {
               (*renderLine)();
               switch(systemColorDepth) {
@@ -3673,25 +4073,25 @@ void CPULoop(int ticks)
                 {
                   u16 *dest = (u16 *)pix + 242 * (VCOUNT+1);
                   for(int x = 0; x < 240;) {
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
-                    *dest++ = systemColorMap16[lineMix[x++]&0xFFFF];
+                    *dest++ = CPUColor16(lineMix[x++]);
+                    *dest++ = CPUColor16(lineMix[x++]);
+                    *dest++ = CPUColor16(lineMix[x++]);
+                    *dest++ = CPUColor16(lineMix[x++]);
+
+                    *dest++ = CPUColor16(lineMix[x++]);
+                    *dest++ = CPUColor16(lineMix[x++]);
+                    *dest++ = CPUColor16(lineMix[x++]);
+                    *dest++ = CPUColor16(lineMix[x++]);
+
+                    *dest++ = CPUColor16(lineMix[x++]);
+                    *dest++ = CPUColor16(lineMix[x++]);
+                    *dest++ = CPUColor16(lineMix[x++]);
+                    *dest++ = CPUColor16(lineMix[x++]);
+
+                    *dest++ = CPUColor16(lineMix[x++]);
+                    *dest++ = CPUColor16(lineMix[x++]);
+                    *dest++ = CPUColor16(lineMix[x++]);
+                    *dest++ = CPUColor16(lineMix[x++]);
                   }
                   // for filters that read past the screen
                   *dest++ = 0;
@@ -3701,71 +4101,70 @@ void CPULoop(int ticks)
                 {
                   u8 *dest = (u8 *)pix + 240 * VCOUNT * 3;
                   for(int x = 0; x < 240;) {
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
 
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
 
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
 
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
-                    *((u32 *)dest) = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *((u32 *)dest) = CPUColor32(lineMix[x++]);
                     dest += 3;
                   }
                 }
                 break;
                 case 32:
                 {
-					extern size_t gbaPitch;
 					size_t rowPitch = gbaPitch / 4;
                   //u32 *dest = (u32 *)pix + 241 * (VCOUNT+1);
                   u32 *dest = (u32 *)pix + rowPitch * (VCOUNT+1);
 
                   for(int x = 0; x < 240; ) {
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
-                    *dest++ = systemColorMap32[lineMix[x++] & 0xFFFF];
+                    *dest++ = CPUColor32(lineMix[x++]);
+                    *dest++ = CPUColor32(lineMix[x++]);
+                    *dest++ = CPUColor32(lineMix[x++]);
+                    *dest++ = CPUColor32(lineMix[x++]);
+
+                    *dest++ = CPUColor32(lineMix[x++]);
+                    *dest++ = CPUColor32(lineMix[x++]);
+                    *dest++ = CPUColor32(lineMix[x++]);
+                    *dest++ = CPUColor32(lineMix[x++]);
+
+                    *dest++ = CPUColor32(lineMix[x++]);
+                    *dest++ = CPUColor32(lineMix[x++]);
+                    *dest++ = CPUColor32(lineMix[x++]);
+                    *dest++ = CPUColor32(lineMix[x++]);
+
+                    *dest++ = CPUColor32(lineMix[x++]);
+                    *dest++ = CPUColor32(lineMix[x++]);
+                    *dest++ = CPUColor32(lineMix[x++]);
+                    *dest++ = CPUColor32(lineMix[x++]);
                   }
                 }
                 break;
@@ -3923,7 +4322,8 @@ void CPULoop(int ticks)
 
       ticks -= clockTicks;
 
-
+	  if(localLinkEnabled)
+		  localLinkUpdate(clockTicks);
 
 #ifndef NO_LINK
 	  if(GetLinkMode() != LINK_DISCONNECTED)
@@ -4017,29 +4417,6 @@ void CPULoop(int ticks)
 
 
 #ifdef TILED_RENDERING
-union u8h
-{
-
-#ifdef __GNUC__
-   struct
-   {
-      /* 0*/	unsigned lo:4;
-      /* 4*/	unsigned hi:4;
-   } __attribute__ ((packed));
-#else
-#pragma pack(push)
-#pragma pack(1)
-	struct
-	{
-		/* 0*/	unsigned lo:4;
-		/* 4*/	unsigned hi:4;
-	};
-#pragma pack(pop)
-#endif
-
-   u8 val;
-};
-
 union TileEntry
 {
    struct
@@ -4111,29 +4488,29 @@ inline const TileLine gfxReadTilePal(const u16 *screenSource, const int yyy, con
    palette += tile.palette * 16;
    TileLine tileLine;
 
-   const u8h *tileBase = (u8h*) &charBase[tile.tileNum * 32 + tileY * 4];
+   const u8 *tileBase = tileCacheRow((u32)(charBase - vram) + tile.tileNum * 32, tileY);
 
    if (!tile.hFlip)
    {
-      gfxDrawPixel(&tileLine.pixels[0], tileBase[0].lo, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[1], tileBase[0].hi, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[2], tileBase[1].lo, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[3], tileBase[1].hi, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[4], tileBase[2].lo, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[5], tileBase[2].hi, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[6], tileBase[3].lo, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[7], tileBase[3].hi, palette, prio);
+      gfxDrawPixel(&tileLine.pixels[0], tileBase[0], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[1], tileBase[1], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[2], tileBase[2], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[3], tileBase[3], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[4], tileBase[4], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[5], tileBase[5], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[6], tileBase[6], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[7], tileBase[7], palette, prio);
    }
    else
    {
-      gfxDrawPixel(&tileLine.pixels[0], tileBase[3].hi, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[1], tileBase[3].lo, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[2], tileBase[2].hi, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[3], tileBase[2].lo, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[4], tileBase[1].hi, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[5], tileBase[1].lo, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[6], tileBase[0].hi, palette, prio);
-      gfxDrawPixel(&tileLine.pixels[7], tileBase[0].lo, palette, prio);
+      gfxDrawPixel(&tileLine.pixels[0], tileBase[7], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[1], tileBase[6], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[2], tileBase[5], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[3], tileBase[4], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[4], tileBase[3], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[5], tileBase[2], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[6], tileBase[1], palette, prio);
+      gfxDrawPixel(&tileLine.pixels[7], tileBase[0], palette, prio);
    }
 
    return tileLine;
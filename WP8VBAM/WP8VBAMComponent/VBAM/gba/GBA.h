@@ -20,6 +20,21 @@ typedef struct {
   u32 mask;
 } memoryMap;
 
+// Page-granular view of the directly backed regions (WRAM, IWRAM, palette,
+// VRAM, OAM and ROM) used by the CPURead*/CPUWrite* fast paths. Pages with a
+// NULL address (BIOS, IO, save memory, unmapped VRAM) go through the full
+// handlers in GBAinline.h.
+#define CPU_PAGE_SHIFT 14
+#define CPU_PAGE_SIZE (1 << CPU_PAGE_SHIFT)
+#define CPU_PAGE_COUNT (0x10000000 >> CPU_PAGE_SHIFT)
+
+typedef struct {
+  u8 *address;
+  u32 mask;
+  int codePage; // block cache page of the first byte, -1 outside WRAM/IWRAM
+  u8 *tileDirty; // tile cache flags of the first byte, NULL outside VRAM
+} memoryPage;
+
 typedef union {
   struct {
 #ifdef WORDS_BIGENDIAN
@@ -51,30 +66,34 @@ typedef union {
 } reg_pair;
 
 #ifndef NO_GBA_MAP
-extern memoryMap map[256];
+extern CORE_LOCAL memoryMap map[256];
+extern CORE_LOCAL memoryPage cpuReadPages[CPU_PAGE_COUNT];
+extern CORE_LOCAL memoryPage cpuWritePages[CPU_PAGE_COUNT];
 #endif
 
-extern reg_pair reg[45];
-extern u8 biosProtected[4];
+extern CORE_LOCAL reg_pair reg[45];
+extern CORE_LOCAL u8 biosProtected[4];
 
-extern bool N_FLAG;
-extern bool Z_FLAG;
-extern bool C_FLAG;
-extern bool V_FLAG;
-extern bool armIrqEnable;
-extern bool armState;
-extern int armMode;
-extern void (*cpuSaveGameFunc)(u32,u8);
+extern CORE_LOCAL bool N_FLAG;
+extern CORE_LOCAL bool Z_FLAG;
+extern CORE_LOCAL bool C_FLAG;
+extern CORE_LOCAL bool V_FLAG;
+extern CORE_LOCAL bool armIrqEnable;
+extern CORE_LOCAL bool armState;
+extern CORE_LOCAL int armMode;
+extern CORE_LOCAL void (*cpuSaveGameFunc)(u32,u8);
+extern CORE_LOCAL int romSize;
 
 #ifdef BKPT_SUPPORT
-extern u8 freezeWorkRAM[0x40000];
-extern u8 freezeInternalRAM[0x8000];
-extern u8 freezeVRAM[0x18000];
-extern u8 freezeOAM[0x400];
-extern u8 freezePRAM[0x400];
-extern bool debugger_last;
-extern int  oldreg[18];
-extern char oldbuffer[10];
+extern CORE_LOCAL u8 freezeWorkRAM[0x40000];
+extern CORE_LOCAL u8 freezeInternalRAM[0x8000];
+extern CORE_LOCAL u8 freezeVRAM[0x18000];
+extern CORE_LOCAL u8 freezeOAM[0x400];
+extern CORE_LOCAL u8 freezePRAM[0x400];
+extern CORE_LOCAL bool debugger_last;
+extern CORE_LOCAL bool cpuMemoryFrozen;
+extern CORE_LOCAL int  oldreg[18];
+extern CORE_LOCAL char oldbuffer[10];
 #endif
 
 extern bool CPUReadGSASnapshot(const char *);
@@ -89,8 +108,12 @@ extern bool CPUWriteBMPFile(const char *);
 extern void CPUCleanUp();
 extern void CPUUpdateRender();
 extern void CPUUpdateRenderBuffers(bool);
+extern void CPUUpdateMemoryPages();
+extern void CPUUpdateVRAMPages();
+extern void CPUUpdatePaletteColor(int);
+extern void CPUUpdatePaletteColors();
 extern bool CPUReadMemState(char *, int);
-extern bool CPUWriteMemState(char *, int);
+extern bool CPUWriteMemState(char *, int, long &);
 #ifdef __LIBRETRO__
 extern bool CPUReadState(const u8*, unsigned);
 extern unsigned int CPUWriteState(u8 *data, unsigned int size);
@@ -99,6 +122,7 @@ extern bool CPUReadState(const char *);
 extern bool CPUWriteState(const char *);
 #endif
 extern int CPULoadRom(const char *);
+extern int CPULoadRomData(const char *data, int size);
 extern void doMirroring(bool);
 extern void CPUUpdateRegister(u32, u16);
 extern void applyTimer ();
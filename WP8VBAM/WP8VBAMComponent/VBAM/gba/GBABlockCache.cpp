@@ -0,0 +1,108 @@
+#include <string.h>
+
+#include "GBA.h"
+#include "GBAinline.h"
+#include "Globals.h"
+#include "GBABlockCache.h"
+
+bool blockCacheEnabled = true;
+// starts at 1 so the zero-filled table never matches
+CORE_LOCAL u32 blockCacheFlushes = 1;
+CORE_LOCAL u32 blockCacheInvalidations = 0;
+CORE_LOCAL u8 blockCodePage[BLOCK_RAM_PAGES];
+CORE_LOCAL u32 blockPageGen[BLOCK_RAM_PAGES];
+CORE_LOCAL CachedBlock blockCache[BLOCK_CACHE_SIZE];
+
+void blockCacheFlush()
+{
+  blockCacheFlushes++;
+  blockCacheInvalidations++;
+  memset(blockCodePage, 0, sizeof(blockCodePage));
+}
+
+void blockCacheInvalidatePage(int page)
+{
+  blockCodePage[page] = 0;
+  blockPageGen[page]++;
+  blockCacheInvalidations++;
+}
+
+// Returns the RAM page holding address, or -1 if the address is not in
+// EWRAM/IWRAM.
+static int blockRamPage(u32 address)
+{
+  switch(address >> 24) {
+  case 0x02:
+    return (address & 0x3FFFF) >> BLOCK_PAGE_SHIFT;
+  case 0x03:
+    return BLOCK_EWRAM_PAGES + ((address & 0x7FFF) >> BLOCK_PAGE_SHIFT);
+  }
+  return -1;
+}
+
+static bool blockCacheable(u32 address)
+{
+  int region = address >> 24;
+  if(region == 0x00)
+    return true;
+  if(region == 0x02 || region == 0x03)
+    return true;
+  return region >= 0x08 && region <= 0x0D && map[region].address == rom;
+}
+
+CachedBlock *blockCacheBuild(u32 pc, bool thumb,
+                             blockinsn_t (*decode)(u32),
+                             bool (*endsBlock)(u32))
+{
+  if(!blockCacheable(pc))
+    return NULL;
+
+  u32 size = thumb ? 2 : 4;
+  u32 pageEnd = (pc | (BLOCK_PAGE_SIZE - 1)) + 1;
+  int count = 0;
+  u32 address = pc;
+  while(count < BLOCK_MAX_INSNS && address != pageEnd) {
+    u32 opcode = thumb ? CPUReadHalfWordQuick(address) :
+                         CPUReadMemoryQuick(address);
+    count++;
+    address += size;
+    if(endsBlock(opcode))
+      break;
+  }
+
+  // the prefetched opcodes after the block must come from the same region
+  u32 lookahead = address + size;
+  if((lookahead >> 24) != (pc >> 24))
+    return NULL;
+
+  CachedBlock *block = &blockCache[(pc >> (thumb ? 1 : 2)) & (BLOCK_CACHE_SIZE - 1)];
+  block->pc = pc;
+  block->flushes = blockCacheFlushes;
+  block->thumb = thumb;
+  block->count = count;
+  block->ram = 0;
+
+  address = pc;
+  for(int i = 0; i < count + 2; i++) {
+    u32 opcode = thumb ? CPUReadHalfWordQuick(address) :
+                         CPUReadMemoryQuick(address);
+    block->opcodes[i] = opcode;
+    if(i < count)
+      block->handlers[i] = decode(opcode);
+    address += size;
+  }
+
+  int page = blockRamPage(pc);
+  if(page >= 0) {
+    int lastPage = blockRamPage(lookahead);
+    block->ram = 1;
+    block->page[0] = page;
+    block->page[1] = lastPage;
+    block->gen[0] = blockPageGen[page];
+    block->gen[1] = blockPageGen[lastPage];
+    blockCodePage[page] = 1;
+    blockCodePage[lastPage] = 1;
+  }
+
+  return block;
+}
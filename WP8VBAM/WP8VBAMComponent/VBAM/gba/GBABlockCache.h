@@ -0,0 +1,91 @@
+#ifndef GBABLOCKCACHE_H
+#define GBABLOCKCACHE_H
+
+#include "../common/Types.h"
+#include "GBAcpu.h"
+
+// Pre-decoded basic blocks for the ARM and Thumb interpreters.
+//
+// A block is a straight run of instructions starting at a given PC and mode,
+// stored as (handler, opcode) pairs so armExecute/thumbExecute can skip the
+// opcode fetch and the table decode. Blocks never cross a BLOCK_PAGE_SIZE
+// page; the two opcodes following the last instruction are kept as well so
+// the prefetch queue can be refilled exactly as the interpreter would.
+//
+// BIOS and ROM blocks are immutable. Blocks decoded from EWRAM/IWRAM mark
+// their pages as holding code, and any store to such a page (CPU, DMA, BIOS
+// calls, cheats) bumps the page generation, which invalidates the block.
+
+#define BLOCK_CACHE_SIZE 2048
+#define BLOCK_MAX_INSNS 32
+#define BLOCK_PAGE_SHIFT 8
+#define BLOCK_PAGE_SIZE (1 << BLOCK_PAGE_SHIFT)
+#define BLOCK_EWRAM_PAGES (0x40000 >> BLOCK_PAGE_SHIFT)
+#define BLOCK_IWRAM_PAGES (0x8000 >> BLOCK_PAGE_SHIFT)
+#define BLOCK_RAM_PAGES (BLOCK_EWRAM_PAGES + BLOCK_IWRAM_PAGES)
+
+typedef INSN_REGPARM void (*blockinsn_t)(u32 opcode);
+
+struct CachedBlock {
+  u32 pc;
+  u32 flushes;
+  u8 thumb;
+  u8 ram;
+  u8 count;
+  u16 page[2];
+  u32 gen[2];
+  blockinsn_t handlers[BLOCK_MAX_INSNS];
+  u32 opcodes[BLOCK_MAX_INSNS + 2];
+};
+
+extern bool blockCacheEnabled;
+extern CORE_LOCAL bool cheatsEnabled;
+extern CORE_LOCAL u32 blockCacheFlushes;
+extern CORE_LOCAL u32 blockCacheInvalidations;
+extern CORE_LOCAL u8 blockCodePage[BLOCK_RAM_PAGES];
+extern CORE_LOCAL u32 blockPageGen[BLOCK_RAM_PAGES];
+extern CORE_LOCAL CachedBlock blockCache[BLOCK_CACHE_SIZE];
+
+extern void blockCacheFlush();
+extern void blockCacheInvalidatePage(int page);
+extern CachedBlock *blockCacheBuild(u32 pc, bool thumb,
+                                    blockinsn_t (*decode)(u32),
+                                    bool (*endsBlock)(u32));
+
+static inline CachedBlock *blockCacheFind(u32 pc, bool thumb)
+{
+  CachedBlock *block = &blockCache[(pc >> (thumb ? 1 : 2)) & (BLOCK_CACHE_SIZE - 1)];
+  if(block->pc != pc || block->thumb != thumb ||
+     block->flushes != blockCacheFlushes)
+    return NULL;
+  if(block->ram && (block->gen[0] != blockPageGen[block->page[0]] ||
+                    block->gen[1] != blockPageGen[block->page[1]]))
+    return NULL;
+  return block;
+}
+
+// Blocks never cross a page, so only the page holding the cheat (m) code
+// hook has to be run an instruction at a time to catch it.
+static inline bool blockCacheHooked(u32 pc)
+{
+  return cheatsEnabled && mastercode && !((pc ^ mastercode) >> BLOCK_PAGE_SHIFT);
+}
+
+// Store hooks, called with the unmasked bus address.
+static inline void blockCacheWritePage(int page)
+{
+  if(blockCodePage[page])
+    blockCacheInvalidatePage(page);
+}
+
+static inline void blockCacheWriteEWRAM(u32 address)
+{
+  blockCacheWritePage((address & 0x3FFFF) >> BLOCK_PAGE_SHIFT);
+}
+
+static inline void blockCacheWriteIWRAM(u32 address)
+{
+  blockCacheWritePage(BLOCK_EWRAM_PAGES + ((address & 0x7FFF) >> BLOCK_PAGE_SHIFT));
+}
+
+#endif // GBABLOCKCACHE_H
@@ -0,0 +1,585 @@
+#include "GBA.h"
+#include "Globals.h"
+#include "GBAGfx.h"
+
+// Scanline compositor shared by the mode0..mode5 render functions. It picks
+// the top two layers of every pixel (BG0-BG3, OBJ or backdrop), then applies
+// semi-transparent OBJ blending and the BLDMOD special effects. The vector
+// versions process 4 pixels at a time with the same integer arithmetic as
+// gfxAlphaBlend/gfxIncreaseBrightness/gfxDecreaseBrightness, so every
+// implementation produces the same lineMix as the scalar one. Pixels left
+// alone keep their GFX_PALETTE index; the ones blended or brightened are
+// resolved against palette RAM first and stored as colours.
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#define COMPOSE_SSE2
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif !defined(__x86_64__)
+#include <cpuid.h>
+#endif
+#endif
+
+#if defined(_M_ARM) || defined(_M_ARM64) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define COMPOSE_NEON
+#include <arm_neon.h>
+#endif
+
+bool gfxComposeSIMD = true;
+
+typedef struct {
+  const u32 *layer[5]; // BG0-BG3 then OBJ
+  u32 backdrop;
+  bool windows;
+  bool inWindow0;
+  bool inWindow1;
+  u8 mask;             // layer/effect mask when windows is false
+  u8 inWin0Mask;
+  u8 inWin1Mask;
+  u8 outMask;
+  u8 objWinMask;
+  int target1;         // BLDMOD first target layers
+  int target2;         // BLDMOD second target layers
+  int effect;
+  int ca;
+  int cb;
+  int cy;
+} ComposeLine;
+
+typedef void (*composefunc_t)(const ComposeLine &);
+
+static const u32 gfxTransparentLine[240] = {
+#define T8 0x80000000, 0x80000000, 0x80000000, 0x80000000, \
+           0x80000000, 0x80000000, 0x80000000, 0x80000000
+  T8, T8, T8, T8, T8, T8, T8, T8, T8, T8,
+  T8, T8, T8, T8, T8, T8, T8, T8, T8, T8,
+  T8, T8, T8, T8, T8, T8, T8, T8, T8, T8
+#undef T8
+};
+
+static inline u8 gfxWindowMask(const ComposeLine &c, int x)
+{
+  u8 mask = c.outMask;
+
+  if(!(lineOBJWin[x] & 0x80000000))
+    mask = c.objWinMask;
+
+  if(c.inWindow1 && gfxInWin1[x])
+    mask = c.inWin1Mask;
+
+  if(c.inWindow0 && gfxInWin0[x])
+    mask = c.inWin0Mask;
+
+  return mask;
+}
+
+// Colour of a layer pixel, with the flags and priority bits kept
+static inline u32 gfxPaletteColor(u32 value)
+{
+  if(value & GFX_PALETTE)
+    return (value & 0xFFFF0000) |
+      (READ16LE(&((u16 *)paletteRAM)[value & 0x1FF]) & 0x7FFF);
+  return value;
+}
+
+static void gfxComposeScalar(const ComposeLine &c)
+{
+  for(int x = 0; x < 240; x++) {
+    u8 mask = c.windows ? gfxWindowMask(c, x) : c.mask;
+    u32 color = c.backdrop;
+    u8 top = 0x20;
+
+    for(int i = 0; i < 5; i++) {
+      u32 value = c.layer[i][x];
+      if((mask & (1 << i)) && (u8)(value >> 24) < (u8)(color >> 24)) {
+        color = value;
+        top = 1 << i;
+      }
+    }
+
+    // second layer, used as the blend source
+    u32 back = c.backdrop;
+    u8 top2 = 0x20;
+
+    for(int i = 0; i < 5; i++) {
+      u32 value = c.layer[i][x];
+      if((mask & ~top & (1 << i)) && (u8)(value >> 24) < (u8)(back >> 24)) {
+        back = value;
+        top2 = 1 << i;
+      }
+    }
+
+    bool alpha = false;
+    bool brightness = false;
+
+    if(color & 0x00010000) {
+      // semi-transparent OBJ
+      if(top2 & c.target2)
+        alpha = true;
+      else
+        brightness = (top & c.target1) != 0;
+    } else if(mask & 32) {
+      if(top & c.target1) {
+        if(c.effect == 1)
+          alpha = (top2 & c.target2) != 0;
+        else
+          brightness = true;
+      }
+    }
+
+    if(alpha)
+      color = gfxAlphaBlend(gfxPaletteColor(color), gfxPaletteColor(back),
+                            c.ca, c.cb);
+    else if(brightness) {
+      if(c.effect == 2)
+        color = gfxIncreaseBrightness(gfxPaletteColor(color), c.cy);
+      else if(c.effect == 3)
+        color = gfxDecreaseBrightness(gfxPaletteColor(color), c.cy);
+    }
+
+    lineMix[x] = color;
+  }
+}
+
+#ifdef COMPOSE_SSE2
+static inline __m128i gfxSelect128(__m128i cond, __m128i a, __m128i b)
+{
+  return _mm_or_si128(_mm_and_si128(cond, a), _mm_andnot_si128(cond, b));
+}
+
+static inline __m128i gfxTest128(__m128i a, __m128i bits)
+{
+  return _mm_xor_si128(_mm_cmpeq_epi32(_mm_and_si128(a, bits),
+                                       _mm_setzero_si128()),
+                       _mm_set1_epi32(-1));
+}
+
+// Expands 4 bytes of a bool[240] window table to 32-bit lane masks.
+static inline __m128i gfxLoadWin128(const bool *win)
+{
+  __m128i v = _mm_cvtsi32_si128(*(const int *)win);
+  v = _mm_unpacklo_epi8(v, _mm_setzero_si128());
+  v = _mm_unpacklo_epi16(v, _mm_setzero_si128());
+  return _mm_cmpgt_epi32(v, _mm_setzero_si128());
+}
+
+// Same packing as the (color >> 16) | color fold of the scalar helpers.
+static inline __m128i gfxPack128(__m128i r, __m128i g, __m128i b)
+{
+  return _mm_or_si128(_mm_or_si128(r, _mm_slli_epi32(g, 5)),
+                      _mm_or_si128(_mm_slli_epi32(b, 10), _mm_slli_epi32(g, 21)));
+}
+
+// Channels and coefficients fit in 16 bits, so _mm_mullo_epi16 leaves the
+// full products in the low half of each lane.
+static inline __m128i gfxAlphaBlend128(__m128i color, __m128i back,
+                                       __m128i ca, __m128i cb)
+{
+  const __m128i channel = _mm_set1_epi32(0x1F);
+  __m128i r = _mm_add_epi32(_mm_mullo_epi16(_mm_and_si128(color, channel), ca),
+                            _mm_mullo_epi16(_mm_and_si128(back, channel), cb));
+  __m128i g = _mm_add_epi32(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(color, 5), channel), ca),
+                            _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(back, 5), channel), cb));
+  __m128i b = _mm_add_epi32(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(color, 10), channel), ca),
+                            _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi32(back, 10), channel), cb));
+  return gfxPack128(_mm_min_epi16(_mm_srli_epi32(r, 4), channel),
+                    _mm_min_epi16(_mm_srli_epi32(g, 4), channel),
+                    _mm_min_epi16(_mm_srli_epi32(b, 4), channel));
+}
+
+// gfxPaletteColor on the lanes that hold a palette index. Palette RAM is
+// not laid out for a gather, but only lanes being blended get here.
+static inline __m128i gfxPaletteColor128(__m128i value)
+{
+  if(!_mm_movemask_epi8(gfxTest128(value, _mm_set1_epi32(GFX_PALETTE))))
+    return value;
+
+  u32 lanes[4];
+  _mm_storeu_si128((__m128i *)lanes, value);
+  for(int i = 0; i < 4; i++)
+    lanes[i] = gfxPaletteColor(lanes[i]);
+  return _mm_loadu_si128((const __m128i *)lanes);
+}
+
+static inline __m128i gfxBrightness128(__m128i color, int effect, __m128i cy)
+{
+  const __m128i channel = _mm_set1_epi32(0x1F);
+  __m128i r = _mm_and_si128(color, channel);
+  __m128i g = _mm_and_si128(_mm_srli_epi32(color, 5), channel);
+  __m128i b = _mm_and_si128(_mm_srli_epi32(color, 10), channel);
+  if(effect == 2) {
+    r = _mm_add_epi32(r, _mm_srli_epi32(_mm_mullo_epi16(_mm_sub_epi32(channel, r), cy), 4));
+    g = _mm_add_epi32(g, _mm_srli_epi32(_mm_mullo_epi16(_mm_sub_epi32(channel, g), cy), 4));
+    b = _mm_add_epi32(b, _mm_srli_epi32(_mm_mullo_epi16(_mm_sub_epi32(channel, b), cy), 4));
+  } else {
+    r = _mm_sub_epi32(r, _mm_srli_epi32(_mm_mullo_epi16(r, cy), 4));
+    g = _mm_sub_epi32(g, _mm_srli_epi32(_mm_mullo_epi16(g, cy), 4));
+    b = _mm_sub_epi32(b, _mm_srli_epi32(_mm_mullo_epi16(b, cy), 4));
+  }
+  return gfxPack128(r, g, b);
+}
+
+template<bool windows>
+static void gfxComposeSSE2Line(const ComposeLine &c)
+{
+  const u32 *layer[5] = { c.layer[0], c.layer[1], c.layer[2], c.layer[3], c.layer[4] };
+  const int effect = c.effect;
+  const __m128i backdrop = _mm_set1_epi32(c.backdrop);
+  const __m128i backdropPrio = _mm_set1_epi32(c.backdrop >> 24);
+  const __m128i backdropTop = _mm_set1_epi32(0x20);
+  const __m128i target1 = _mm_set1_epi32(c.target1);
+  const __m128i target2 = _mm_set1_epi32(c.target2);
+  const __m128i ca = _mm_set1_epi32(c.ca);
+  const __m128i cb = _mm_set1_epi32(c.cb);
+  const __m128i cy = _mm_set1_epi32(c.cy);
+  const __m128i lineFx = _mm_set1_epi32((c.mask & 32) ? -1 : 0);
+  __m128i id[5];
+  for(int i = 0; i < 5; i++)
+    id[i] = _mm_set1_epi32(1 << i);
+
+  for(int x = 0; x < 240; x += 4) {
+    __m128i mask = _mm_setzero_si128();
+    __m128i fx = lineFx;
+    if(windows) {
+      __m128i objWin = _mm_srai_epi32(_mm_loadu_si128((const __m128i *)&lineOBJWin[x]), 31);
+      mask = gfxSelect128(objWin, _mm_set1_epi32(c.outMask), _mm_set1_epi32(c.objWinMask));
+      if(c.inWindow1)
+        mask = gfxSelect128(gfxLoadWin128(&gfxInWin1[x]), _mm_set1_epi32(c.inWin1Mask), mask);
+      if(c.inWindow0)
+        mask = gfxSelect128(gfxLoadWin128(&gfxInWin0[x]), _mm_set1_epi32(c.inWin0Mask), mask);
+      fx = gfxTest128(mask, _mm_set1_epi32(32));
+    }
+
+    __m128i value[5];
+    __m128i prio[5];
+    __m128i color = backdrop;
+    __m128i colorPrio = backdropPrio;
+    __m128i top = backdropTop;
+
+    for(int i = 0; i < 5; i++) {
+      value[i] = _mm_loadu_si128((const __m128i *)&layer[i][x]);
+      prio[i] = _mm_srli_epi32(value[i], 24);
+      // a layer hidden by the window never wins
+      if(windows)
+        prio[i] = _mm_or_si128(prio[i], _mm_andnot_si128(gfxTest128(mask, id[i]),
+                                                         _mm_set1_epi32(0xFF)));
+      __m128i take = _mm_cmplt_epi32(prio[i], colorPrio);
+      color = gfxSelect128(take, value[i], color);
+      top = gfxSelect128(take, id[i], top);
+      colorPrio = _mm_min_epi16(colorPrio, prio[i]);
+    }
+
+    __m128i semi = gfxTest128(color, _mm_set1_epi32(0x00010000));
+    __m128i isTarget1 = gfxTest128(top, target1);
+    __m128i fxTarget = _mm_and_si128(_mm_andnot_si128(semi, fx), isTarget1);
+    bool anySemi = _mm_movemask_epi8(semi) != 0;
+    bool anyFx = _mm_movemask_epi8(fxTarget) != 0;
+
+    if(!anySemi && (effect != 1 || !anyFx)) {
+      // nothing to blend, at most a brightness change
+      if(effect >= 2 && anyFx)
+        color = gfxSelect128(fxTarget, gfxBrightness128(gfxPaletteColor128(color),
+                                                        effect, cy), color);
+      _mm_storeu_si128((__m128i *)&lineMix[x], color);
+      continue;
+    }
+
+    // second layer, used as the blend source
+    __m128i back = backdrop;
+    __m128i backPrio = backdropPrio;
+    __m128i top2 = backdropTop;
+
+    for(int i = 0; i < 5; i++) {
+      __m128i take = _mm_andnot_si128(_mm_cmpeq_epi32(top, id[i]),
+                                      _mm_cmplt_epi32(prio[i], backPrio));
+      back = gfxSelect128(take, value[i], back);
+      backPrio = gfxSelect128(take, prio[i], backPrio);
+      top2 = gfxSelect128(take, id[i], top2);
+    }
+
+    __m128i isTarget2 = gfxTest128(top2, target2);
+    __m128i alpha = _mm_and_si128(semi, isTarget2);
+    __m128i brightness = _mm_setzero_si128();
+    if(effect == 1)
+      alpha = _mm_or_si128(alpha, _mm_and_si128(fxTarget, isTarget2));
+    else if(effect >= 2)
+      brightness = _mm_or_si128(_mm_and_si128(isTarget1, _mm_andnot_si128(isTarget2, semi)),
+                                fxTarget);
+    // gfxAlphaBlend leaves transparent pixels alone
+    alpha = _mm_and_si128(alpha, _mm_cmpgt_epi32(color, _mm_set1_epi32(-1)));
+
+    if(_mm_movemask_epi8(alpha))
+      color = gfxSelect128(alpha, gfxAlphaBlend128(gfxPaletteColor128(color),
+                                                   gfxPaletteColor128(back),
+                                                   ca, cb), color);
+    if(_mm_movemask_epi8(brightness))
+      color = gfxSelect128(brightness, gfxBrightness128(gfxPaletteColor128(color),
+                                                        effect, cy), color);
+
+    _mm_storeu_si128((__m128i *)&lineMix[x], color);
+  }
+}
+
+static void gfxComposeSSE2(const ComposeLine &c)
+{
+  if(c.windows)
+    gfxComposeSSE2Line<true>(c);
+  else
+    gfxComposeSSE2Line<false>(c);
+}
+
+static bool gfxHasSSE2()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+  return true;
+#elif defined(_MSC_VER)
+  int info[4];
+  __cpuid(info, 1);
+  return (info[3] & (1 << 26)) != 0;
+#else
+  unsigned int eax, ebx, ecx, edx;
+  if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    return false;
+  return (edx & (1 << 26)) != 0;
+#endif
+}
+#endif // COMPOSE_SSE2
+
+#ifdef COMPOSE_NEON
+// Expands 4 bytes of a bool[240] window table to 32-bit lane masks.
+static inline uint32x4_t gfxLoadWinNEON(const bool *win)
+{
+  uint8x8_t b = vreinterpret_u8_u32(vld1_dup_u32((const uint32_t *)win));
+  uint32x4_t v = vmovl_u16(vget_low_u16(vmovl_u8(b)));
+  return vtstq_u32(v, v);
+}
+
+static inline bool gfxAnyNEON(uint32x4_t v)
+{
+  uint32x2_t v2 = vorr_u32(vget_low_u32(v), vget_high_u32(v));
+  return vget_lane_u32(vpmax_u32(v2, v2), 0) != 0;
+}
+
+// Same packing as the (color >> 16) | color fold of the scalar helpers.
+static inline uint32x4_t gfxPackNEON(uint32x4_t r, uint32x4_t g, uint32x4_t b)
+{
+  return vorrq_u32(vorrq_u32(r, vshlq_n_u32(g, 5)),
+                   vorrq_u32(vshlq_n_u32(b, 10), vshlq_n_u32(g, 21)));
+}
+
+static inline uint32x4_t gfxAlphaBlendNEON(uint32x4_t color, uint32x4_t back,
+                                           int ca, int cb)
+{
+  const uint32x4_t channel = vdupq_n_u32(0x1F);
+  uint32x4_t r = vmlaq_n_u32(vmulq_n_u32(vandq_u32(color, channel), ca),
+                             vandq_u32(back, channel), cb);
+  uint32x4_t g = vmlaq_n_u32(vmulq_n_u32(vandq_u32(vshrq_n_u32(color, 5), channel), ca),
+                             vandq_u32(vshrq_n_u32(back, 5), channel), cb);
+  uint32x4_t b = vmlaq_n_u32(vmulq_n_u32(vandq_u32(vshrq_n_u32(color, 10), channel), ca),
+                             vandq_u32(vshrq_n_u32(back, 10), channel), cb);
+  return gfxPackNEON(vminq_u32(vshrq_n_u32(r, 4), channel),
+                     vminq_u32(vshrq_n_u32(g, 4), channel),
+                     vminq_u32(vshrq_n_u32(b, 4), channel));
+}
+
+// gfxPaletteColor on the lanes that hold a palette index
+static inline uint32x4_t gfxPaletteColorNEON(uint32x4_t value)
+{
+  if(!gfxAnyNEON(vtstq_u32(value, vdupq_n_u32(GFX_PALETTE))))
+    return value;
+
+  u32 lanes[4];
+  vst1q_u32(lanes, value);
+  for(int i = 0; i < 4; i++)
+    lanes[i] = gfxPaletteColor(lanes[i]);
+  return vld1q_u32(lanes);
+}
+
+static inline uint32x4_t gfxBrightnessNEON(uint32x4_t color, int effect, int cy)
+{
+  const uint32x4_t channel = vdupq_n_u32(0x1F);
+  uint32x4_t r = vandq_u32(color, channel);
+  uint32x4_t g = vandq_u32(vshrq_n_u32(color, 5), channel);
+  uint32x4_t b = vandq_u32(vshrq_n_u32(color, 10), channel);
+  if(effect == 2) {
+    r = vaddq_u32(r, vshrq_n_u32(vmulq_n_u32(vsubq_u32(channel, r), cy), 4));
+    g = vaddq_u32(g, vshrq_n_u32(vmulq_n_u32(vsubq_u32(channel, g), cy), 4));
+    b = vaddq_u32(b, vshrq_n_u32(vmulq_n_u32(vsubq_u32(channel, b), cy), 4));
+  } else {
+    r = vsubq_u32(r, vshrq_n_u32(vmulq_n_u32(r, cy), 4));
+    g = vsubq_u32(g, vshrq_n_u32(vmulq_n_u32(g, cy), 4));
+    b = vsubq_u32(b, vshrq_n_u32(vmulq_n_u32(b, cy), 4));
+  }
+  return gfxPackNEON(r, g, b);
+}
+
+template<bool windows>
+static void gfxComposeNEONLine(const ComposeLine &c)
+{
+  const u32 *layer[5] = { c.layer[0], c.layer[1], c.layer[2], c.layer[3], c.layer[4] };
+  const int effect = c.effect;
+  const uint32x4_t backdrop = vdupq_n_u32(c.backdrop);
+  const uint32x4_t backdropPrio = vdupq_n_u32(c.backdrop >> 24);
+  const uint32x4_t backdropTop = vdupq_n_u32(0x20);
+  const uint32x4_t target1 = vdupq_n_u32(c.target1);
+  const uint32x4_t target2 = vdupq_n_u32(c.target2);
+  const uint32x4_t lineFx = vdupq_n_u32((c.mask & 32) ? 0xFFFFFFFF : 0);
+  uint32x4_t id[5];
+  for(int i = 0; i < 5; i++)
+    id[i] = vdupq_n_u32(1 << i);
+
+  for(int x = 0; x < 240; x += 4) {
+    uint32x4_t mask = vdupq_n_u32(0);
+    uint32x4_t fx = lineFx;
+    if(windows) {
+      uint32x4_t objWin = vtstq_u32(vld1q_u32(&lineOBJWin[x]), vdupq_n_u32(0x80000000));
+      mask = vbslq_u32(objWin, vdupq_n_u32(c.outMask), vdupq_n_u32(c.objWinMask));
+      if(c.inWindow1)
+        mask = vbslq_u32(gfxLoadWinNEON(&gfxInWin1[x]), vdupq_n_u32(c.inWin1Mask), mask);
+      if(c.inWindow0)
+        mask = vbslq_u32(gfxLoadWinNEON(&gfxInWin0[x]), vdupq_n_u32(c.inWin0Mask), mask);
+      fx = vtstq_u32(mask, vdupq_n_u32(32));
+    }
+
+    uint32x4_t value[5];
+    uint32x4_t prio[5];
+    uint32x4_t color = backdrop;
+    uint32x4_t colorPrio = backdropPrio;
+    uint32x4_t top = backdropTop;
+
+    for(int i = 0; i < 5; i++) {
+      value[i] = vld1q_u32(&layer[i][x]);
+      prio[i] = vshrq_n_u32(value[i], 24);
+      // a layer hidden by the window never wins
+      if(windows)
+        prio[i] = vorrq_u32(prio[i], vbicq_u32(vdupq_n_u32(0xFF), vtstq_u32(mask, id[i])));
+      uint32x4_t take = vcltq_u32(prio[i], colorPrio);
+      color = vbslq_u32(take, value[i], color);
+      top = vbslq_u32(take, id[i], top);
+      colorPrio = vminq_u32(colorPrio, prio[i]);
+    }
+
+    uint32x4_t semi = vtstq_u32(color, vdupq_n_u32(0x00010000));
+    uint32x4_t isTarget1 = vtstq_u32(top, target1);
+    uint32x4_t fxTarget = vandq_u32(vbicq_u32(fx, semi), isTarget1);
+    bool anySemi = gfxAnyNEON(semi);
+    bool anyFx = gfxAnyNEON(fxTarget);
+
+    if(!anySemi && (effect != 1 || !anyFx)) {
+      // nothing to blend, at most a brightness change
+      if(effect >= 2 && anyFx)
+        color = vbslq_u32(fxTarget, gfxBrightnessNEON(gfxPaletteColorNEON(color),
+                                                      effect, c.cy), color);
+      vst1q_u32(&lineMix[x], color);
+      continue;
+    }
+
+    // second layer, used as the blend source
+    uint32x4_t back = backdrop;
+    uint32x4_t backPrio = backdropPrio;
+    uint32x4_t top2 = backdropTop;
+
+    for(int i = 0; i < 5; i++) {
+      uint32x4_t take = vbicq_u32(vcltq_u32(prio[i], backPrio), vceqq_u32(top, id[i]));
+      back = vbslq_u32(take, value[i], back);
+      backPrio = vbslq_u32(take, prio[i], backPrio);
+      top2 = vbslq_u32(take, id[i], top2);
+    }
+
+    uint32x4_t isTarget2 = vtstq_u32(top2, target2);
+    uint32x4_t alpha = vandq_u32(semi, isTarget2);
+    uint32x4_t brightness = vdupq_n_u32(0);
+    if(effect == 1)
+      alpha = vorrq_u32(alpha, vandq_u32(fxTarget, isTarget2));
+    else if(effect >= 2)
+      brightness = vorrq_u32(vandq_u32(isTarget1, vbicq_u32(semi, isTarget2)), fxTarget);
+    // gfxAlphaBlend leaves transparent pixels alone
+    alpha = vbicq_u32(alpha, vtstq_u32(color, vdupq_n_u32(0x80000000)));
+
+    if(gfxAnyNEON(alpha))
+      color = vbslq_u32(alpha, gfxAlphaBlendNEON(gfxPaletteColorNEON(color),
+                                                 gfxPaletteColorNEON(back),
+                                                 c.ca, c.cb), color);
+    if(gfxAnyNEON(brightness))
+      color = vbslq_u32(brightness, gfxBrightnessNEON(gfxPaletteColorNEON(color),
+                                                      effect, c.cy), color);
+
+    vst1q_u32(&lineMix[x], color);
+  }
+}
+
+static void gfxComposeNEON(const ComposeLine &c)
+{
+  if(c.windows)
+    gfxComposeNEONLine<true>(c);
+  else
+    gfxComposeNEONLine<false>(c);
+}
+#endif // COMPOSE_NEON
+
+static composefunc_t gfxComposeDetect()
+{
+#ifdef COMPOSE_NEON
+  return gfxComposeNEON;
+#endif
+#ifdef COMPOSE_SSE2
+  if(gfxHasSSE2())
+    return gfxComposeSSE2;
+#endif
+  return gfxComposeScalar;
+}
+
+static composefunc_t gfxComposeVector = gfxComposeDetect();
+
+static bool gfxInWindow(u16 winV)
+{
+  u8 v0 = winV >> 8;
+  u8 v1 = winV & 255;
+  bool inWindow = ((v0 == v1) && (v0 >= 0xe8));
+  if(v1 >= v0)
+    inWindow |= (VCOUNT >= v0 && VCOUNT < v1);
+  else
+    inWindow |= (VCOUNT >= v0 || VCOUNT < v1);
+  return inWindow;
+}
+
+void gfxComposeLine(const u32 *bg0, const u32 *bg1, const u32 *bg2,
+                    const u32 *bg3, int type)
+{
+  ComposeLine c;
+
+  c.layer[0] = bg0 ? bg0 : gfxTransparentLine;
+  c.layer[1] = bg1 ? bg1 : gfxTransparentLine;
+  c.layer[2] = bg2 ? bg2 : gfxTransparentLine;
+  c.layer[3] = bg3 ? bg3 : gfxTransparentLine;
+  c.layer[4] = lineOBJ;
+
+  if(customBackdropColor == -1) {
+    c.backdrop = (GFX_PALETTE | 0x30000000);
+  } else {
+    c.backdrop = ((customBackdropColor & 0x7FFF) | 0x30000000);
+  }
+
+  // without effects only semi-transparent OBJ are blended
+  c.mask = (type == GFX_COMPOSE_OBJ_BLEND) ? 0x1F : 0x3F;
+  c.windows = (type == GFX_COMPOSE_WINDOWS);
+  c.inWindow0 = c.windows && (layerEnable & 0x2000) && gfxInWindow(WIN0V);
+  c.inWindow1 = c.windows && (layerEnable & 0x4000) && gfxInWindow(WIN1V);
+  c.inWin0Mask = WININ & 0xFF;
+  c.inWin1Mask = WININ >> 8;
+  c.outMask = WINOUT & 0xFF;
+  c.objWinMask = WINOUT >> 8;
+
+  c.target1 = BLDMOD & 0x3F;
+  c.target2 = (BLDMOD >> 8) & 0x3F;
+  c.effect = (BLDMOD >> 6) & 3;
+  c.ca = coeff[COLEV & 0x1F];
+  c.cb = coeff[(COLEV >> 8) & 0x1F];
+  c.cy = coeff[COLY & 0x1F];
+
+  if(gfxComposeSIMD)
+    gfxComposeVector(c);
+  else
+    gfxComposeScalar(c);
+}
@@ -4,22 +4,24 @@ int coeff[32] = {
   0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
   16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16};
 
-u32 line0[240];
-u32 line1[240];
-u32 line2[240];
-u32 line3[240];
-u32 lineOBJ[240];
-u32 lineOBJWin[240];
-u32 lineMix[240];
-bool gfxInWin0[240];
-bool gfxInWin1[240];
-int lineOBJpixleft[128];
+CORE_LOCAL u32 line0[240];
+CORE_LOCAL u32 line1[240];
+CORE_LOCAL u32 line2[240];
+CORE_LOCAL u32 line3[240];
+CORE_LOCAL u32 lineOBJ[240];
+CORE_LOCAL u32 lineOBJWin[240];
+CORE_LOCAL u32 lineMix[240];
+CORE_LOCAL u16 gfxPalette16[512];
+CORE_LOCAL u32 gfxPalette32[512];
+CORE_LOCAL bool gfxInWin0[240];
+CORE_LOCAL bool gfxInWin1[240];
+CORE_LOCAL int lineOBJpixleft[128];
 
-int gfxBG2Changed = 0;
-int gfxBG3Changed = 0;
+CORE_LOCAL int gfxBG2Changed = 0;
+CORE_LOCAL int gfxBG3Changed = 0;
 
-int gfxBG2X = 0;
-int gfxBG2Y = 0;
-int gfxBG3X = 0;
-int gfxBG3Y = 0;
-int gfxLastVCOUNT = 0;
+CORE_LOCAL int gfxBG2X = 0;
+CORE_LOCAL int gfxBG2Y = 0;
+CORE_LOCAL int gfxBG3X = 0;
+CORE_LOCAL int gfxBG3Y = 0;
+CORE_LOCAL int gfxLastVCOUNT = 0;
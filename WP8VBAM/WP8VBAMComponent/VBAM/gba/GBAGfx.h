@@ -3,6 +3,7 @@
 
 #include "GBA.h"
 #include "Globals.h"
+#include "GBATileCache.h"
 
 #include "../common/Port.h"
 
@@ -74,26 +75,45 @@ void mode5RenderLine();
 void mode5RenderLineNoWindow();
 void mode5RenderLineAll();
 
+// gfxComposeLine types, matching the three render function variants
+#define GFX_COMPOSE_OBJ_BLEND 0 // semi-transparent OBJ only
+#define GFX_COMPOSE_EFFECTS   1 // BLDMOD effects, no windows
+#define GFX_COMPOSE_WINDOWS   2 // effects and windows
+
+// Layer pixels taken from palette RAM hold GFX_PALETTE | index (0-511)
+// rather than the colour, so that most of lineMix converts through the
+// gfxPalette16/32 shadow instead of the systemColorMap tables.
+// gfxComposeLine resolves the index before blending; blended and direct
+// colour (mode 3/5) pixels hold a BGR555 colour with bit 15 clear.
+#define GFX_PALETTE 0x8000
+
+extern CORE_LOCAL u16 gfxPalette16[512];
+extern CORE_LOCAL u32 gfxPalette32[512];
+
+extern bool gfxComposeSIMD;
+void gfxComposeLine(const u32 *bg0, const u32 *bg1, const u32 *bg2,
+                    const u32 *bg3, int type);
+
 extern int coeff[32];
-extern u32 line0[240];
-extern u32 line1[240];
-extern u32 line2[240];
-extern u32 line3[240];
-extern u32 lineOBJ[240];
-extern u32 lineOBJWin[240];
-extern u32 lineMix[240];
-extern bool gfxInWin0[240];
-extern bool gfxInWin1[240];
-extern int lineOBJpixleft[128];
-
-extern int gfxBG2Changed;
-extern int gfxBG3Changed;
-
-extern int gfxBG2X;
-extern int gfxBG2Y;
-extern int gfxBG3X;
-extern int gfxBG3Y;
-extern int gfxLastVCOUNT;
+extern CORE_LOCAL u32 line0[240];
+extern CORE_LOCAL u32 line1[240];
+extern CORE_LOCAL u32 line2[240];
+extern CORE_LOCAL u32 line3[240];
+extern CORE_LOCAL u32 lineOBJ[240];
+extern CORE_LOCAL u32 lineOBJWin[240];
+extern CORE_LOCAL u32 lineMix[240];
+extern CORE_LOCAL bool gfxInWin0[240];
+extern CORE_LOCAL bool gfxInWin1[240];
+extern CORE_LOCAL int lineOBJpixleft[128];
+
+extern CORE_LOCAL int gfxBG2Changed;
+extern CORE_LOCAL int gfxBG3Changed;
+
+extern CORE_LOCAL int gfxBG2X;
+extern CORE_LOCAL int gfxBG2Y;
+extern CORE_LOCAL int gfxBG3X;
+extern CORE_LOCAL int gfxBG3Y;
+extern CORE_LOCAL int gfxLastVCOUNT;
 
 static inline void gfxClearArray(u32 *array)
 {
@@ -106,8 +126,8 @@ static inline void gfxClearArray(u32 *array)
 static inline void gfxDrawTextScreen(u16 control, u16 hofs, u16 vofs,
 				     u32 *line)
 {
-  u16 *palette = (u16 *)paletteRAM;
-  u8 *charBase = &vram[((control >> 2) & 0x03) * 0x4000];
+  u32 charOffset = ((control >> 2) & 0x03) * 0x4000;
+  u8 *charBase = &vram[charOffset];
   u16 *screenBase = (u16 *)&vram[((control >> 8) & 0x1f) * 0x800];
   u32 prio = ((control & 3)<<25) + 0x1000000;
   int sizeX = 256;
@@ -154,24 +174,29 @@ static inline void gfxDrawTextScreen(u16 control, u16 hofs, u16 vofs,
   int yshift = ((yyy>>3)<<5);
   if((control) & 0x80) {
     u16 *screenSource = screenBase + 0x400 * (xxx>>8) + ((xxx & 255)>>3) + yshift;
+    // the screen entry is decoded once per tile; flipX reverses the row
+    const u8 *tileRow = NULL;
+    int flipX = 0;
     for(int x = 0; x < 240; x++) {
-      u16 data = READ16LE(screenSource);
-
-      int tile = data & 0x3FF;
       int tileX = (xxx & 7);
-      int tileY = yyy & 7;
 
-      if(tileX == 7)
-        screenSource++;
+      if(tileRow == NULL) {
+        u16 data = READ16LE(screenSource);
+        int tileY = yyy & 7;
+        if(data & 0x0800)
+          tileY = 7 - tileY;
+        flipX = (data & 0x0400) ? 7 : 0;
+        tileRow = &charBase[(data & 0x3FF) * 64 + tileY * 8];
+      }
 
-      if(data & 0x0400)
-        tileX = 7 - tileX;
-      if(data & 0x0800)
-        tileY = 7 - tileY;
+      u8 color = tileRow[tileX ^ flipX];
 
-      u8 color = charBase[tile * 64 + tileY * 8 + tileX];
+      line[x] = color ? (GFX_PALETTE | color | prio): 0x80000000;
 
-      line[x] = color ? (READ16LE(&palette[color]) | prio): 0x80000000;
+      if(tileX == 7) {
+        screenSource++;
+        tileRow = NULL;
+      }
 
       xxx++;
       if(xxx == 256) {
@@ -189,32 +214,32 @@ static inline void gfxDrawTextScreen(u16 control, u16 hofs, u16 vofs,
   } else {
     u16 *screenSource = screenBase + 0x400*(xxx>>8)+((xxx&255)>>3) +
       yshift;
+    // 4bpp rows come pre-expanded from the tile cache
+    const u8 *tileRow = NULL;
+    u32 tilePalette = GFX_PALETTE;
+    int flipX = 0;
     for(int x = 0; x < 240; x++) {
-      u16 data = READ16LE(screenSource);
-
-      int tile = data & 0x3FF;
       int tileX = (xxx & 7);
-      int tileY = yyy & 7;
 
-      if(tileX == 7)
-        screenSource++;
+      if(tileRow == NULL) {
+        u16 data = READ16LE(screenSource);
+        int tileY = yyy & 7;
+        if(data & 0x0800)
+          tileY = 7 - tileY;
+        flipX = (data & 0x0400) ? 7 : 0;
+        tilePalette = GFX_PALETTE | ((data>>8) & 0xF0);
+        tileRow = tileCacheRow(charOffset + ((data & 0x3FF)<<5), tileY);
+      }
 
-      if(data & 0x0400)
-        tileX = 7 - tileX;
-      if(data & 0x0800)
-        tileY = 7 - tileY;
+      u8 color = tileRow[tileX ^ flipX];
 
-      u8 color = charBase[(tile<<5) + (tileY<<2) + (tileX>>1)];
+      line[x] = color ? (tilePalette | color | prio): 0x80000000;
 
-      if(tileX & 1) {
-        color = (color >> 4);
-      } else {
-        color &= 0x0F;
+      if(tileX == 7) {
+        screenSource++;
+        tileRow = NULL;
       }
 
-      int pal = (data>>8) & 0xF0;
-      line[x] = color ? (READ16LE(&palette[pal + color])|prio): 0x80000000;
-
       xxx++;
       if(xxx == 256) {
         if(sizeX > 256)
@@ -254,7 +279,6 @@ static inline void gfxDrawRotScreen(u16 control,
 				    int changed,
 				    u32 *line)
 {
-  u16 *palette = (u16 *)paletteRAM;
   u8 *charBase = &vram[((control >> 2) & 0x03) * 0x4000];
   u8 *screenBase = (u8 *)&vram[((control >> 8) & 0x1f) * 0x800];
   int prio = ((control & 3) << 25) + 0x1000000;
@@ -334,7 +358,7 @@ static inline void gfxDrawRotScreen(u16 control,
 
       u8 color = charBase[(tile<<6) + (tileY<<3) + tileX];
 
-      line[x] = color ? (READ16LE(&palette[color])|prio): 0x80000000;
+      line[x] = color ? (GFX_PALETTE | color | prio): 0x80000000;
 
       realX += dx;
       realY += dy;
@@ -357,7 +381,7 @@ static inline void gfxDrawRotScreen(u16 control,
 
         u8 color = charBase[(tile<<6) + (tileY<<3) + tileX];
 
-        line[x] = color ? (READ16LE(&palette[color])|prio): 0x80000000;
+        line[x] = color ? (GFX_PALETTE | color | prio): 0x80000000;
       }
       realX += dx;
       realY += dy;
@@ -452,7 +476,7 @@ static inline void gfxDrawRotScreen16Bit(u16 control,
        yyy >= sizeY) {
       line[x] = 0x80000000;
     } else {
-      line[x] = (READ16LE(&screenBase[yyy * sizeX + xxx]) | prio);
+      line[x] = ((READ16LE(&screenBase[yyy * sizeX + xxx]) & 0x7FFF) | prio);
     }
     realX += dx;
     realY += dy;
@@ -486,7 +510,6 @@ static inline void gfxDrawRotScreen256(u16 control,
 				       int changed,
 				       u32 *line)
 {
-  u16 *palette = (u16 *)paletteRAM;
   u8 *screenBase = (DISPCNT & 0x0010) ? &vram[0xA000] : &vram[0x0000];
   int prio = ((control & 3) << 25) + 0x1000000;
   int sizeX = 240;
@@ -553,7 +576,7 @@ static inline void gfxDrawRotScreen256(u16 control,
     } else {
       u8 color = screenBase[yyy * 240 + xxx];
 
-      line[x] = color ? (READ16LE(&palette[color])|prio): 0x80000000;
+      line[x] = color ? (GFX_PALETTE | color | prio): 0x80000000;
     }
     realX += dx;
     realY += dy;
@@ -652,7 +675,7 @@ static inline void gfxDrawRotScreen16Bit160(u16 control,
        yyy >= sizeY) {
       line[x] = 0x80000000;
     } else {
-      line[x] = (READ16LE(&screenBase[yyy * sizeX + xxx]) | prio);
+      line[x] = ((READ16LE(&screenBase[yyy * sizeX + xxx]) & 0x7FFF) | prio);
     }
     realX += dx;
     realY += dy;
@@ -687,7 +710,7 @@ static inline void gfxDrawSprites(u32 *lineOBJ)
   gfxClearArray(lineOBJ);
   if(layerEnable & 0x1000) {
     u16 *sprites = (u16 *)oam;
-    u16 *spritePalette = &((u16 *)paletteRAM)[256];
+    const u32 spritePalette = GFX_PALETTE | 256;
     int mosaicY = ((MOSAIC & 0xF000)>>12) + 1;
     int mosaicX = ((MOSAIC & 0xF00)>>8) + 1;
     for(int x = 0; x < 128 ; x++) {
@@ -851,7 +874,7 @@ static inline void gfxDrawSprites(u32 *lineOBJ)
                     if((a0 & 0x1000) && m)
                       lineOBJ[sx]=(lineOBJ[sx-1] & 0xF9FFFFFF) | prio;
                   } else if((color) && (prio < (lineOBJ[sx]&0xFF000000))) {
-                    lineOBJ[sx] = READ16LE(&spritePalette[color]) | prio;
+                    lineOBJ[sx] = (spritePalette + color) | prio;
                     if((a0 & 0x1000) && m)
                       lineOBJ[sx]=(lineOBJ[sx-1] & 0xF9FFFFFF) | prio;
                   }
@@ -904,7 +927,7 @@ static inline void gfxDrawSprites(u32 *lineOBJ)
                     if((a0 & 0x1000) && m)
                       lineOBJ[sx]=(lineOBJ[sx-1] & 0xF9FFFFFF) | prio;
                   } else if((color) && (prio < (lineOBJ[sx]&0xFF000000))) {
-                    lineOBJ[sx] = READ16LE(&spritePalette[palette+color]) | prio;
+                    lineOBJ[sx] = (spritePalette + palette + color) | prio;
                     if((a0 & 0x1000) && m)
                       lineOBJ[sx]=(lineOBJ[sx-1] & 0xF9FFFFFF) | prio;
                   }
@@ -980,7 +1003,7 @@ static inline void gfxDrawSprites(u32 *lineOBJ)
                     if((a0 & 0x1000) && m)
                       lineOBJ[sx]=(lineOBJ[sx-1] & 0xF9FFFFFF) | prio;
                   } else if((color) && (prio < (lineOBJ[sx]&0xFF000000))) {
-                    lineOBJ[sx] = READ16LE(&spritePalette[color]) | prio;
+                    lineOBJ[sx] = (spritePalette + color) | prio;
                     if((a0 & 0x1000) && m)
                       lineOBJ[sx]=(lineOBJ[sx-1] & 0xF9FFFFFF) | prio;
                   }
@@ -1061,7 +1084,7 @@ static inline void gfxDrawSprites(u32 *lineOBJ)
                       if((a0 & 0x1000) && m)
                         lineOBJ[sx]=(lineOBJ[sx-1] & 0xF9FFFFFF) | prio;
                     } else if((color) && (prio < (lineOBJ[sx]&0xFF000000))) {
-                      lineOBJ[sx] = READ16LE(&spritePalette[palette + color]) | prio;
+                      lineOBJ[sx] = (spritePalette + palette + color) | prio;
                       if((a0 & 0x1000) && m)
                         lineOBJ[sx]=(lineOBJ[sx-1] & 0xF9FFFFFF) | prio;
                     }
@@ -1105,7 +1128,7 @@ static inline void gfxDrawSprites(u32 *lineOBJ)
                       if((a0 & 0x1000) && m)
                         lineOBJ[sx]=(lineOBJ[sx-1] & 0xF9FFFFFF) | prio;
                     } else if((color) && (prio < (lineOBJ[sx]&0xFF000000))) {
-                      lineOBJ[sx] = READ16LE(&spritePalette[palette + color]) | prio;
+                      lineOBJ[sx] = (spritePalette + palette + color) | prio;
                       if((a0 & 0x1000) && m)
                         lineOBJ[sx]=(lineOBJ[sx-1] & 0xF9FFFFFF) | prio;
 
@@ -0,0 +1,303 @@
+#include <atomic>
+#include <thread>
+
+#include "GBA.h"
+#include "GBAcpu.h"
+#include "Globals.h"
+#include "GBALink.h"
+#include "GBALinkLocal.h"
+#include "../common/Port.h"
+
+enum {
+  SIO_NORMAL8,
+  SIO_NORMAL32,
+  SIO_MULTIPLAYER,
+  SIO_OTHER
+};
+
+// transfer state of an instance
+enum {
+  XFER_IDLE,
+  XFER_PENDING,  // started by this instance, begins at the next window
+  XFER_ACTIVE    // completes at the next window
+};
+
+// mailbox flags
+#define POST_START  0x01  // master or internal clock starting a transfer
+#define POST_READY  0x02  // external clock waiting for a transfer
+#define POST_ACTIVE 0x04  // taking part in the current transfer
+
+// A mailbox holds the low 24 bits of the window number, the flags and the
+// data the instance sends: SIOMLT_SEND, SIODATA8 or SIODATA32.
+#define POST_WINDOW_SHIFT 40
+#define POST_FLAGS_SHIFT 32
+#define POST_WINDOW_MASK 0xffffff
+
+struct LocalLinkSlot {
+  std::atomic<u64> mailbox[2];
+  std::atomic<bool> left;
+};
+
+struct LocalLink {
+  int players;
+  int window;
+  LocalLinkSlot slot[LOCAL_LINK_MAX_PLAYERS];
+};
+
+CORE_LOCAL bool localLinkEnabled = false;
+CORE_LOCAL int localLinkTicks = 0;
+
+static CORE_LOCAL LocalLink *linkGroup = NULL;
+static CORE_LOCAL int linkPlayer = 0;
+static CORE_LOCAL u32 linkWindow = 0;
+static CORE_LOCAL int linkTransfer = XFER_IDLE;
+// players present at the last window
+static CORE_LOCAL int linkPresent = 0;
+
+LocalLink *localLinkCreate(int players, int windowTicks)
+{
+  if(players < 2 || players > LOCAL_LINK_MAX_PLAYERS || windowTicks < 1)
+    return NULL;
+
+  LocalLink *l = new LocalLink;
+  l->players = players;
+  l->window = windowTicks;
+  for(int i = 0; i < LOCAL_LINK_MAX_PLAYERS; i++) {
+    // window 0 is never posted
+    l->slot[i].mailbox[0].store(0);
+    l->slot[i].mailbox[1].store(0);
+    l->slot[i].left.store(i >= players);
+  }
+  return l;
+}
+
+void localLinkDestroy(LocalLink *l)
+{
+  delete l;
+}
+
+bool localLinkJoin(LocalLink *l, int player)
+{
+  if(!l || player < 0 || player >= l->players)
+    return false;
+
+  linkGroup = l;
+  linkPlayer = player;
+  linkWindow = 0;
+  linkTransfer = XFER_IDLE;
+  linkPresent = l->players;
+  localLinkTicks = l->window;
+  localLinkEnabled = true;
+  return true;
+}
+
+void localLinkLeave()
+{
+  if(!linkGroup)
+    return;
+
+  linkGroup->slot[linkPlayer].left.store(true, std::memory_order_release);
+  linkGroup = NULL;
+  localLinkEnabled = false;
+}
+
+static int localLinkMode(u16 siocnt, u16 rcnt)
+{
+  if(rcnt & 0x8000)
+    return SIO_OTHER;
+  switch(siocnt & 0x3000) {
+  case 0x0000:
+    return SIO_NORMAL8;
+  case 0x1000:
+    return SIO_NORMAL32;
+  case 0x2000:
+    return SIO_MULTIPLAYER;
+  }
+  return SIO_OTHER;
+}
+
+void localLinkStart(u16 value)
+{
+  switch(localLinkMode(value, READ16LE(&ioMem[COMM_RCNT]))) {
+  case SIO_MULTIPLAYER: {
+    bool start = (value & 0x80) && !linkPlayer && linkTransfer == XFER_IDLE;
+    // clear start, seqno, si (RO on slave, start = pulse on master)
+    value &= 0xff4b;
+    // SI is low on slaves during a transfer
+    if(linkPlayer) {
+      if(linkTransfer == XFER_IDLE)
+        value |= 4;
+      else
+        value |= READ16LE(&ioMem[COMM_SIOCNT]) & 4;
+    }
+    if(start) {
+      if(linkPresent > 1) {
+        linkTransfer = XFER_PENDING;
+        value &= ~0x40;
+      } else {
+        value |= 0x40; // comm error
+      }
+    }
+    bool transfer = linkTransfer != XFER_IDLE;
+    value |= transfer << 7;
+    value |= (linkPlayer && !transfer ? 0xc : 8); // set SD (high), SI (low on master)
+    value |= linkPlayer << 4; // set seq
+    UPDATE_REG(COMM_SIOCNT, value);
+    // SC low during a transfer, SI always low on the master
+    UPDATE_REG(COMM_RCNT, linkPlayer ? (transfer ? 6 : 7) : (transfer ? 2 : 3));
+    break;
+  }
+  case SIO_NORMAL8:
+  case SIO_NORMAL32:
+    // only the internal clock starts a transfer; an external clock waits
+    // for the other end with the start bit set
+    if((value & 0x81) == 0x81 && linkTransfer == XFER_IDLE)
+      linkTransfer = XFER_PENDING;
+    else if(linkTransfer != XFER_IDLE)
+      value |= 0x80;
+    UPDATE_REG(COMM_SIOCNT, value);
+    break;
+  default:
+    UPDATE_REG(COMM_SIOCNT, value);
+    break;
+  }
+}
+
+void localLinkStartGP(u16 value)
+{
+  UPDATE_REG(COMM_RCNT, value);
+
+  if(!value)
+    return;
+
+  if(localLinkMode(READ16LE(&ioMem[COMM_SIOCNT]), value) == SIO_MULTIPLAYER)
+    UPDATE_REG(COMM_SIOCNT, (READ16LE(&ioMem[COMM_SIOCNT]) & 0xff8b) |
+               (linkPlayer ? 0xc : 8) | (linkPlayer << 4));
+}
+
+static void localLinkInterrupt(u16 siocnt)
+{
+  if(siocnt & 0x4000) {
+    IF |= 0x80;
+    UPDATE_REG(0x202, IF);
+  }
+}
+
+// Posts this instance's port for the window and waits for the others;
+// players that have left are given no flags.
+static void localLinkExchange(u32 window, int flags, u32 data,
+                              int *peerFlags, u32 *peerData)
+{
+  LocalLinkSlot *slot = linkGroup->slot;
+  u64 post = ((u64)(window & POST_WINDOW_MASK) << POST_WINDOW_SHIFT) |
+    ((u64)flags << POST_FLAGS_SHIFT) | data;
+  slot[linkPlayer].mailbox[window & 1].store(post, std::memory_order_release);
+
+  linkPresent = 0;
+  for(int i = 0; i < linkGroup->players; i++) {
+    for(;;) {
+      // a player posts its last window before leaving, so read the flag
+      // first
+      bool left = slot[i].left.load(std::memory_order_acquire);
+      u64 m = slot[i].mailbox[window & 1].load(std::memory_order_acquire);
+      if(((m >> POST_WINDOW_SHIFT) & POST_WINDOW_MASK) ==
+         (window & POST_WINDOW_MASK)) {
+        peerFlags[i] = (int)(m >> POST_FLAGS_SHIFT) & 0xff;
+        peerData[i] = (u32)m;
+        linkPresent++;
+        break;
+      }
+      if(left) {
+        peerFlags[i] = 0;
+        peerData[i] = 0xffffffff;
+        break;
+      }
+      std::this_thread::yield();
+    }
+  }
+}
+
+static void localLinkSync()
+{
+  u16 siocnt = READ16LE(&ioMem[COMM_SIOCNT]);
+  int mode = localLinkMode(siocnt, READ16LE(&ioMem[COMM_RCNT]));
+  int flags = 0;
+  u32 data;
+
+  switch(mode) {
+  case SIO_MULTIPLAYER:
+    data = READ16LE(&ioMem[COMM_SIOMLT_SEND]);
+    break;
+  case SIO_NORMAL32:
+    data = READ32LE(&ioMem[COMM_SIODATA32_L]);
+    break;
+  default:
+    data = ioMem[COMM_SIODATA8];
+    break;
+  }
+  if(linkTransfer == XFER_PENDING)
+    flags |= POST_START;
+  else if(linkTransfer == XFER_ACTIVE)
+    flags |= POST_ACTIVE;
+  else if(mode != SIO_MULTIPLAYER && (siocnt & 0x81) == 0x80)
+    flags |= POST_READY;
+
+  int peerFlags[LOCAL_LINK_MAX_PLAYERS];
+  u32 peerData[LOCAL_LINK_MAX_PLAYERS];
+  localLinkExchange(++linkWindow, flags, data, peerFlags, peerData);
+
+  int peer = linkPlayer ^ 1;
+  if(linkTransfer == XFER_ACTIVE) {
+    // the data posted for this window is what went over the wire
+    linkTransfer = XFER_IDLE;
+    if(mode == SIO_MULTIPLAYER) {
+      for(int i = 0; i < LOCAL_LINK_MAX_PLAYERS; i++) {
+        bool active = i < linkGroup->players && (peerFlags[i] & POST_ACTIVE);
+        UPDATE_REG(COMM_SIOMULTI0 + (i << 1),
+                   active ? (u16)peerData[i] : 0xffff);
+      }
+      if(!linkPlayer)
+        siocnt |= 4; // SI becomes high on slaves after xfer
+      UPDATE_REG(COMM_SIOCNT, (siocnt & 0xff0f) | (linkPlayer << 4));
+      // SC/SI high after transfer
+      UPDATE_REG(COMM_RCNT, linkPlayer ? 15 : 11);
+    } else {
+      u32 received = 0xffffffff;
+      if(peer < linkGroup->players && (peerFlags[peer] & POST_ACTIVE))
+        received = peerData[peer];
+      if(mode == SIO_NORMAL32)
+        WRITE32LE(&ioMem[COMM_SIODATA32_L], received);
+      else
+        ioMem[COMM_SIODATA8] = (u8)received;
+      UPDATE_REG(COMM_SIOCNT, siocnt & ~0x80);
+    }
+    localLinkInterrupt(siocnt);
+    return;
+  }
+
+  if(mode == SIO_MULTIPLAYER) {
+    if(peerFlags[0] & POST_START) {
+      linkTransfer = XFER_ACTIVE;
+      WRITE32LE(&ioMem[COMM_SIOMULTI0], 0xffffffff);
+      WRITE32LE(&ioMem[COMM_SIOMULTI2], 0xffffffff);
+      if(linkPlayer)
+        siocnt &= ~4; // SI low during the transfer
+      UPDATE_REG(COMM_SIOCNT, (siocnt & ~0x40) | 0x80);
+      UPDATE_REG(COMM_RCNT, linkPlayer ? 6 : 2);
+    }
+  } else if(linkTransfer == XFER_PENDING) {
+    linkTransfer = XFER_ACTIVE;
+  } else if((flags & POST_READY) && peer < linkGroup->players &&
+            (peerFlags[peer] & POST_START)) {
+    linkTransfer = XFER_ACTIVE;
+  }
+}
+
+void localLinkUpdate(int ticks)
+{
+  localLinkTicks -= ticks;
+  while(localLinkTicks <= 0 && linkGroup) {
+    localLinkTicks += linkGroup->window;
+    localLinkSync();
+  }
+}
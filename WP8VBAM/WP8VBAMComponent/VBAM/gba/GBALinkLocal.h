@@ -0,0 +1,56 @@
+#ifndef GBALINKLOCAL_H
+#define GBALINKLOCAL_H
+
+#include "../common/Types.h"
+
+// In-process link cable.
+//
+// Connects two to four core instances running on threads of the same
+// process (VBAM_MULTI_INSTANCE), without the shared memory and semaphores
+// of LINK_CABLE_IPC or the sockets of LINK_CABLE_SOCKET. The instances run
+// in lock-step: emulated time is cut into windows of a fixed number of
+// cycles, and at the end of each window every instance posts the state of
+// its serial port to its mailbox and waits until all the others have
+// posted the same window. Transfers start and complete on window
+// boundaries, so a linked run gives the same result every time and goes
+// as fast as the slowest instance rather than in real time.
+//
+// A mailbox is a single atomic word per player and window parity: no
+// instance can get two windows ahead of another, so the word it overwrites
+// has always been read.
+//
+// Multiplayer mode links all the players; normal 8 and 32 bit modes link
+// players 0 and 1, and 2 and 3. UART and general purpose modes are not
+// emulated, and the link is not part of save states.
+
+#define LOCAL_LINK_MAX_PLAYERS 4
+// one scanline
+#define LOCAL_LINK_DEFAULT_WINDOW 1232
+
+struct LocalLink;
+
+// Creates a link between players instances that sync every windowTicks
+// cycles, or returns NULL if either is out of range.
+extern LocalLink *localLinkCreate(int players, int windowTicks);
+// Frees a link once all its players have left.
+extern void localLinkDestroy(LocalLink *link);
+
+// Plugs the instance of the calling thread into the link as the given
+// player, 0 being the master. Every player has to join before the others
+// get past their first window, and leave when it stops emulating.
+extern bool localLinkJoin(LocalLink *link, int player);
+// Unplugs the instance of the calling thread; the others see it as
+// disconnected from their next window on.
+extern void localLinkLeave();
+
+// SIOCNT and RCNT writes while linked
+extern void localLinkStart(u16 siocnt);
+extern void localLinkStartGP(u16 rcnt);
+// Called from CPULoop with the cycles just emulated
+extern void localLinkUpdate(int ticks);
+
+extern CORE_LOCAL bool localLinkEnabled;
+// Cycles left in the current window, for CPUUpdateTicks
+extern CORE_LOCAL int localLinkTicks;
+
+#endif // GBALINKLOCAL_H
@@ -0,0 +1,25 @@
+#include <string.h>
+
+#include "GBA.h"
+#include "Globals.h"
+#include "GBATileCache.h"
+
+CORE_LOCAL u8 tileCacheDirty[TILE_CACHE_COUNT];
+CORE_LOCAL u8 tileCacheData[TILE_CACHE_COUNT][64];
+
+void tileCacheFlush()
+{
+  memset(tileCacheDirty, 1, sizeof(tileCacheDirty));
+}
+
+void tileCacheDecode(int tile)
+{
+  const u8 *source = &vram[tile << TILE_CACHE_SHIFT];
+  u8 *dest = tileCacheData[tile];
+  for(int i = 0; i < 32; i++) {
+    u8 b = *source++;
+    *dest++ = b & 0x0F;
+    *dest++ = b >> 4;
+  }
+  tileCacheDirty[tile] = 0;
+}
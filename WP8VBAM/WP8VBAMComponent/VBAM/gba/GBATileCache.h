@@ -0,0 +1,44 @@
+#ifndef GBATILECACHE_H
+#define GBATILECACHE_H
+
+#include "../common/Types.h"
+
+// Decoded 4bpp character data for gfxDrawTextScreen.
+//
+// Every 32-byte 4bpp tile of VRAM has a pre-expanded copy holding one
+// palette index per byte (8 rows of 8 pixels), so the text layer renderer
+// reads a whole tile row instead of splitting nibbles pixel by pixel.
+// Flipped tiles use the same copy with reversed indices. 8bpp tiles are
+// already stored one index per byte and are read straight from VRAM.
+//
+// A tile is decoded again on first use after any store to its 32 bytes. All
+// VRAM stores (CPU, DMA, BIOS calls) go through the CPUWrite* handlers,
+// which mark the tile dirty; bulk changes (reset, state load, BIOS RAM
+// clear) flush the whole cache.
+
+#define TILE_CACHE_SHIFT 5
+#define TILE_CACHE_COUNT (0x18000 >> TILE_CACHE_SHIFT)
+
+extern CORE_LOCAL u8 tileCacheDirty[TILE_CACHE_COUNT];
+extern CORE_LOCAL u8 tileCacheData[TILE_CACHE_COUNT][64];
+
+extern void tileCacheFlush();
+extern void tileCacheDecode(int tile);
+
+// Returns the palette indices of row y of the 4bpp tile at VRAM offset
+// address (below 0x18000, 32-byte aligned).
+static inline const u8 *tileCacheRow(u32 address, int y)
+{
+  int tile = address >> TILE_CACHE_SHIFT;
+  if(tileCacheDirty[tile])
+    tileCacheDecode(tile);
+  return &tileCacheData[tile][y << 3];
+}
+
+// Store hook, called with the VRAM offset (below 0x18000).
+static inline void tileCacheWriteVRAM(u32 address)
+{
+  tileCacheDirty[address >> TILE_CACHE_SHIFT] = 1;
+}
+
+#endif // GBATILECACHE_H
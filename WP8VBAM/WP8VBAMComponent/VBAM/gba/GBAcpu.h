@@ -42,21 +42,21 @@ extern int thumbExecute();
   cpuPrefetch[1] = CPUReadHalfWordQuick(armNextPC+2);
 
 
-extern int SWITicks;
-extern u32 mastercode;
-extern bool busPrefetch;
-extern bool busPrefetchEnable;
-extern u32 busPrefetchCount;
-extern int cpuNextEvent;
-extern bool holdState;
-extern u32 cpuPrefetch[2];
-extern int cpuTotalTicks;
-extern u8 memoryWait[16];
-extern u8 memoryWait32[16];
-extern u8 memoryWaitSeq[16];
-extern u8 memoryWaitSeq32[16];
-extern u8 cpuBitsSet[256];
-extern u8 cpuLowestBitSet[256];
+extern CORE_LOCAL int SWITicks;
+extern CORE_LOCAL u32 mastercode;
+extern CORE_LOCAL bool busPrefetch;
+extern CORE_LOCAL bool busPrefetchEnable;
+extern CORE_LOCAL u32 busPrefetchCount;
+extern CORE_LOCAL int cpuNextEvent;
+extern CORE_LOCAL bool holdState;
+extern CORE_LOCAL u32 cpuPrefetch[2];
+extern CORE_LOCAL int cpuTotalTicks;
+extern CORE_LOCAL u8 memoryWait[16];
+extern CORE_LOCAL u8 memoryWait32[16];
+extern CORE_LOCAL u8 memoryWaitSeq[16];
+extern CORE_LOCAL u8 memoryWaitSeq32[16];
+extern CORE_LOCAL u8 cpuBitsSet[256];
+extern CORE_LOCAL u8 cpuLowestBitSet[256];
 extern void CPUSwitchMode(int mode, bool saveState, bool breakLoop);
 extern void CPUSwitchMode(int mode, bool saveState);
 extern void CPUUpdateCPSR();
@@ -7,33 +7,35 @@
 #include "Sound.h"
 #include "agbprint.h"
 #include "GBAcpu.h"
+#include "GBABlockCache.h"
+#include "GBATileCache.h"
 #include "GBALink.h"
 
 extern const u32 objTilesAddress[3];
 
-extern bool stopState;
-extern bool holdState;
-extern int holdType;
-extern int cpuNextEvent;
-extern bool cpuSramEnabled;
-extern bool cpuFlashEnabled;
-extern bool cpuEEPROMEnabled;
-extern bool cpuEEPROMSensorEnabled;
-extern bool cpuDmaHack;
-extern u32 cpuDmaLast;
-extern bool timer0On;
-extern int timer0Ticks;
-extern int timer0ClockReload;
-extern bool timer1On;
-extern int timer1Ticks;
-extern int timer1ClockReload;
-extern bool timer2On;
-extern int timer2Ticks;
-extern int timer2ClockReload;
-extern bool timer3On;
-extern int timer3Ticks;
-extern int timer3ClockReload;
-extern int cpuTotalTicks;
+extern CORE_LOCAL bool stopState;
+extern CORE_LOCAL bool holdState;
+extern CORE_LOCAL int holdType;
+extern CORE_LOCAL int cpuNextEvent;
+extern CORE_LOCAL bool cpuSramEnabled;
+extern CORE_LOCAL bool cpuFlashEnabled;
+extern CORE_LOCAL bool cpuEEPROMEnabled;
+extern CORE_LOCAL bool cpuEEPROMSensorEnabled;
+extern CORE_LOCAL bool cpuDmaHack;
+extern CORE_LOCAL u32 cpuDmaLast;
+extern CORE_LOCAL bool timer0On;
+extern CORE_LOCAL int timer0Ticks;
+extern CORE_LOCAL int timer0ClockReload;
+extern CORE_LOCAL bool timer1On;
+extern CORE_LOCAL int timer1Ticks;
+extern CORE_LOCAL int timer1ClockReload;
+extern CORE_LOCAL bool timer2On;
+extern CORE_LOCAL int timer2Ticks;
+extern CORE_LOCAL int timer2ClockReload;
+extern CORE_LOCAL bool timer3On;
+extern CORE_LOCAL int timer3Ticks;
+extern CORE_LOCAL int timer3ClockReload;
+extern CORE_LOCAL int cpuTotalTicks;
 
 #define CPUReadByteQuick(addr) \
   map[(addr)>>24].address[(addr) & map[(addr)>>24].mask]
@@ -44,6 +46,121 @@ extern int cpuTotalTicks;
 #define CPUReadMemoryQuick(addr) \
   READ32LE(((u32*)&map[(addr)>>24].address[(addr) & map[(addr)>>24].mask]))
 
+// Page table lookups for the directly backed regions; NULL means the access
+// has to go through the region switch.
+static inline const memoryPage *CPUReadPage(u32 address)
+{
+  if(address >> 28)
+    return NULL;
+  const memoryPage *page = &cpuReadPages[address >> CPU_PAGE_SHIFT];
+  return page->address ? page : NULL;
+}
+
+static inline const memoryPage *CPUWritePage(u32 address)
+{
+  if(address >> 28)
+    return NULL;
+  const memoryPage *page = &cpuWritePages[address >> CPU_PAGE_SHIFT];
+  return page->address ? page : NULL;
+}
+
+// Offset into rom of a cartridge address, taking doMirroring into account.
+// Offsets past romMask are not backed by the image.
+static inline u32 CPURomOffset(u32 address)
+{
+  u32 offset = address & 0x1FFFFFF;
+  if(romMirrorSize && offset < 0x1000000)
+    offset %= romMirrorSize;
+  return offset;
+}
+
+// Past the end of the image the cartridge bus floats and reads back the
+// halfword address. The AGBPrint stub (SWI 0xFA, BX LR) lives up there,
+// and so may the AGBPrint buffer and control block.
+static inline u16 CPUReadRomOpenBus(u32 offset)
+{
+  if(romSize < 0x1fe2000) {
+    if(offset == 0x1fe209c)
+      return 0xdffa;
+    if(offset == 0x1fe209e)
+      return 0x4770;
+  }
+  const u8 *agbPrint = agbPrintMemory(offset);
+  if(agbPrint)
+    return READ16LE(((const u16 *)agbPrint));
+  return (offset >> 1) & 0xFFFF;
+}
+
+// Returns the store target inside page, invalidating cached code blocks
+// and decoded tiles.
+static inline u8 *CPUWritePageAddress(const memoryPage *page, u32 address)
+{
+  u32 offset = address & page->mask;
+  if(page->codePage >= 0)
+    blockCacheWritePage(page->codePage + (offset >> BLOCK_PAGE_SHIFT));
+  else if(page->tileDirty)
+    page->tileDirty[offset >> TILE_CACHE_SHIFT] = 1;
+  return &page->address[offset];
+}
+
+// Host address of address in the given page table, and how many of the
+// next size bytes follow on contiguously from it; 0 when address is not
+// directly backed.
+static inline u32 CPUBlockAddress(const memoryPage *pages, u32 address,
+                                  u32 size, u8 **data)
+{
+  *data = NULL;
+  if(address >> 28)
+    return 0;
+  const memoryPage *page = &pages[address >> CPU_PAGE_SHIFT];
+  if(!page->address)
+    return 0;
+  u8 *base = &page->address[address & page->mask];
+  u32 done = 0;
+  while(done < size) {
+    u32 a = address + done;
+    if(a >> 28)
+      break;
+    page = &pages[a >> CPU_PAGE_SHIFT];
+    u32 offset = a & page->mask;
+    if(!page->address || &page->address[offset] != base + done)
+      break;
+    // to the end of the page, or to where the region wraps inside it
+    u32 run = CPU_PAGE_SIZE - (a & (CPU_PAGE_SIZE - 1));
+    if(run > page->mask + 1 - offset)
+      run = page->mask + 1 - offset;
+    done += run;
+  }
+  *data = base;
+  return done < size ? done : size;
+}
+
+// Runs the store hooks of CPUWritePageAddress over size bytes written
+// straight into a block from CPUBlockAddress(cpuWritePages, ...).
+static inline void CPUWriteBlockDirty(u32 address, u32 size)
+{
+  while(size) {
+    const memoryPage *page = &cpuWritePages[address >> CPU_PAGE_SHIFT];
+    u32 offset = address & page->mask;
+    u32 run = CPU_PAGE_SIZE - (address & (CPU_PAGE_SIZE - 1));
+    if(run > page->mask + 1 - offset)
+      run = page->mask + 1 - offset;
+    if(run > size)
+      run = size;
+    if(page->codePage >= 0) {
+      for(u32 i = offset >> BLOCK_PAGE_SHIFT;
+          i <= (offset + run - 1) >> BLOCK_PAGE_SHIFT; i++)
+        blockCacheWritePage(page->codePage + i);
+    } else if(page->tileDirty) {
+      memset(&page->tileDirty[offset >> TILE_CACHE_SHIFT], 1,
+             ((offset + run - 1) >> TILE_CACHE_SHIFT) -
+             (offset >> TILE_CACHE_SHIFT) + 1);
+    }
+    address += run;
+    size -= run;
+  }
+}
+
 static inline u32 CPUReadMemory(u32 address)
 {
   u32 value;
@@ -53,7 +170,10 @@ static inline u32 CPUReadMemory(u32 address)
 	  address &= ~0x03;
   }
 
-  switch(address >> 24) {
+  const memoryPage *page = CPUReadPage(address);
+  if(page)
+    value = READ32LE(((u32 *)&page->address[address & page->mask]));
+  else switch(address >> 24) {
   case 0:
     if(reg[15].I >> 24) {
       if(address < 0x4000) {
@@ -110,9 +230,14 @@ static inline u32 CPUReadMemory(u32 address)
   case 9:
   case 10:
   case 11:
-  case 12:
-    value = READ32LE(((u32 *)&rom[address&0x1FFFFFC]));
+  case 12: {
+    u32 offset = CPURomOffset(address & 0x1FFFFFC);
+    if(offset <= romMask)
+      value = READ32LE(((u32 *)&rom[offset]));
+    else
+      value = CPUReadRomOpenBus(offset) | (CPUReadRomOpenBus(offset + 2) << 16);
     break;
+  }
   case 13:
 	value = eepromRead(address);
 	break;
@@ -186,7 +311,10 @@ static inline u32 CPUReadHalfWord(u32 address)
 	  address &= ~0x01;
   }
 
-  switch(address >> 24) {
+  const memoryPage *page = CPUReadPage(address);
+  if(page)
+    value = READ16LE(((u16 *)&page->address[address & page->mask]));
+  else switch(address >> 24) {
   case 0:
     if (reg[15].I >> 24) {
       if(address < 0x4000) {
@@ -256,8 +384,13 @@ static inline u32 CPUReadHalfWord(u32 address)
   case 12:
     if(address == 0x80000c4 || address == 0x80000c6 || address == 0x80000c8)
       value = rtcRead(address);
-    else
-      value = READ16LE(((u16 *)&rom[address & 0x1FFFFFE]));
+    else {
+      u32 offset = CPURomOffset(address & 0x1FFFFFE);
+      if(offset <= romMask)
+        value = READ16LE(((u16 *)&rom[offset]));
+      else
+        value = CPUReadRomOpenBus(offset);
+    }
     break;
   case 13:
 	value = eepromRead(address);
@@ -316,6 +449,10 @@ static inline s16 CPUReadHalfWordSigned(u32 address)
 
 static inline u8 CPUReadByte(u32 address)
 {
+  const memoryPage *page = CPUReadPage(address);
+  if(page)
+    return page->address[address & page->mask];
+
   switch(address >> 24) {
   case 0:
     if (reg[15].I >> 24) {
@@ -353,8 +490,12 @@ static inline u8 CPUReadByte(u32 address)
   case 9:
   case 10:
   case 11:
-  case 12:
-    return rom[address & 0x1FFFFFF];
+  case 12: {
+    u32 offset = CPURomOffset(address);
+    if(offset <= romMask)
+      return rom[offset];
+    return CPUReadRomOpenBus(offset & ~1) >> ((offset & 1) << 3);
+  }
   case 13:
 	return eepromRead(address);
   case 14:
@@ -411,8 +552,15 @@ static inline void CPUWriteMemory(u32 address, u32 value)
 
   address &= 0xFFFFFFFC;
 
+  const memoryPage *page = CPUWritePage(address);
+  if(page) {
+    WRITE32LE(((u32 *)CPUWritePageAddress(page, address)), value);
+    return;
+  }
+
   switch(address >> 24) {
   case 0x02:
+    blockCacheWriteEWRAM(address);
 #ifdef BKPT_SUPPORT
     if(*((u32 *)&freezeWorkRAM[address & 0x3FFFC]))
       cheatsWriteMemory(address & 0x203FFFC,
@@ -422,6 +570,7 @@ static inline void CPUWriteMemory(u32 address, u32 value)
       WRITE32LE(((u32 *)&workRAM[address & 0x3FFFC]), value);
     break;
   case 0x03:
+    blockCacheWriteIWRAM(address);
 #ifdef BKPT_SUPPORT
     if(*((u32 *)&freezeInternalRAM[address & 0x7ffc]))
       cheatsWriteMemory(address & 0x3007FFC,
@@ -443,7 +592,11 @@ static inline void CPUWriteMemory(u32 address, u32 value)
       value);
     else
 #endif
+    {
       WRITE32LE(((u32 *)&paletteRAM[address & 0x3FC]), value);
+      CPUUpdatePaletteColor((address & 0x3FC) >> 1);
+      CPUUpdatePaletteColor(((address & 0x3FC) >> 1) + 1);
+    }
     break;
   case 0x06:
     address = (address & 0x1fffc);
@@ -451,6 +604,7 @@ static inline void CPUWriteMemory(u32 address, u32 value)
       return;
     if ((address & 0x18000) == 0x18000)
       address &= 0x17fff;
+    tileCacheWriteVRAM(address);
 
 #ifdef BKPT_SUPPORT
     if(*((u32 *)&freezeVRAM[address]))
@@ -511,8 +665,15 @@ static inline void CPUWriteHalfWord(u32 address, u16 value)
 
   address &= 0xFFFFFFFE;
 
+  const memoryPage *page = CPUWritePage(address);
+  if(page) {
+    WRITE16LE(((u16 *)CPUWritePageAddress(page, address)), value);
+    return;
+  }
+
   switch(address >> 24) {
   case 2:
+    blockCacheWriteEWRAM(address);
 #ifdef BKPT_SUPPORT
     if(*((u16 *)&freezeWorkRAM[address & 0x3FFFE]))
       cheatsWriteHalfWord(address & 0x203FFFE,
@@ -522,6 +683,7 @@ static inline void CPUWriteHalfWord(u32 address, u16 value)
       WRITE16LE(((u16 *)&workRAM[address & 0x3FFFE]),value);
     break;
   case 3:
+    blockCacheWriteIWRAM(address);
 #ifdef BKPT_SUPPORT
     if(*((u16 *)&freezeInternalRAM[address & 0x7ffe]))
       cheatsWriteHalfWord(address & 0x3007ffe,
@@ -542,7 +704,10 @@ static inline void CPUWriteHalfWord(u32 address, u16 value)
       value);
     else
 #endif
+    {
       WRITE16LE(((u16 *)&paletteRAM[address & 0x3fe]), value);
+      CPUUpdatePaletteColor((address & 0x3fe) >> 1);
+    }
     break;
   case 6:
     address = (address & 0x1fffe);
@@ -550,6 +715,7 @@ static inline void CPUWriteHalfWord(u32 address, u16 value)
       return;
     if ((address & 0x18000) == 0x18000)
       address &= 0x17fff;
+    tileCacheWriteVRAM(address);
 #ifdef BKPT_SUPPORT
     if(*((u16 *)&freezeVRAM[address]))
       cheatsWriteHalfWord(address + 0x06000000,
@@ -603,8 +769,16 @@ unwritable:
 
 static inline void CPUWriteByte(u32 address, u8 b)
 {
+  // byte stores to palette, VRAM and OAM are special, see below
+  const memoryPage *page = CPUWritePage(address);
+  if(page && address < 0x04000000) {
+    *CPUWritePageAddress(page, address) = b;
+    return;
+  }
+
   switch(address >> 24) {
   case 2:
+    blockCacheWriteEWRAM(address);
 #ifdef BKPT_SUPPORT
     if(freezeWorkRAM[address & 0x3FFFF])
       cheatsWriteByte(address & 0x203FFFF, b);
@@ -613,6 +787,7 @@ static inline void CPUWriteByte(u32 address, u8 b)
       workRAM[address & 0x3FFFF] = b;
     break;
   case 3:
+    blockCacheWriteIWRAM(address);
 #ifdef BKPT_SUPPORT
     if(freezeInternalRAM[address & 0x7fff])
       cheatsWriteByte(address & 0x3007fff, b);
@@ -686,6 +861,7 @@ static inline void CPUWriteByte(u32 address, u8 b)
   case 5:
     // no need to switch
     *((u16 *)&paletteRAM[address & 0x3FE]) = (b << 8) | b;
+    CPUUpdatePaletteColor((address & 0x3FE) >> 1);
     break;
   case 6:
     address = (address & 0x1fffe);
@@ -698,6 +874,7 @@ static inline void CPUWriteByte(u32 address, u8 b)
     // byte writes to OBJ VRAM are ignored
     if ((address) < objTilesAddress[((DISPCNT&7)+1)>>2])
     {
+      tileCacheWriteVRAM(address);
 #ifdef BKPT_SUPPORT
       if(freezeVRAM[address])
         cheatsWriteByte(address + 0x06000000, b);
@@ -8,12 +8,13 @@
 #include <time.h>
 #include <memory.h>
 
-RTCCLOCKDATA rtcClockData;
-static bool rtcEnabled = false;
+CORE_LOCAL RTCCLOCKDATA rtcClockData;
+static CORE_LOCAL bool rtcEnabled = false;
 
 void rtcEnable(bool e)
 {
   rtcEnabled = e;
+  CPUUpdateMemoryPages();
 }
 
 bool rtcIsEnabled()
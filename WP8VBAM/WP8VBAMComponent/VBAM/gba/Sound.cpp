@@ -34,24 +34,25 @@
 #define NR51 0x81
 #define NR52 0x84
 
-SoundDriver * soundDriver = 0;
+CORE_LOCAL SoundDriver * soundDriver = 0;
 
-extern bool stopState;      // TODO: silence sound when true
+extern CORE_LOCAL bool stopState;      // TODO: silence sound when true
 
 int const SOUND_CLOCK_TICKS_ = 167772; // 1/100 second
 
-static u16   soundFinalWave [1600];
+static CORE_LOCAL u16   soundFinalWave [3200];
 long  soundSampleRate    = 44100; //32000;// 11500; //44100; 
+static int soundLatency  = 50;
 bool  soundInterpolation = true;
-bool  soundPaused        = true;
+CORE_LOCAL bool  soundPaused        = true;
 float soundFiltering     = 1.0f;
-int   SOUND_CLOCK_TICKS  = SOUND_CLOCK_TICKS_;
-int   soundTicks         = SOUND_CLOCK_TICKS_;
+CORE_LOCAL int   SOUND_CLOCK_TICKS  = SOUND_CLOCK_TICKS_;
+CORE_LOCAL int   soundTicks         = SOUND_CLOCK_TICKS_;
 
 static float soundVolume     = 1.0f;
 static int soundEnableFlag   = 0x3ff; // emulator channels enabled
-static float soundFiltering_ = -1;
-static float soundVolume_    = -1;
+static CORE_LOCAL float soundFiltering_ = -1;
+static CORE_LOCAL float soundVolume_    = -1;
 
 void interp_rate() { /* empty for now */ }
 
@@ -90,11 +91,12 @@ private:
 	bool enabled;
 };
 
-static Gba_Pcm_Fifo     pcm [2];
-Gb_Apu*          gb_apu;
-static Stereo_Buffer*   stereo_buffer;
+static CORE_LOCAL Gba_Pcm_Fifo     pcm [2];
+CORE_LOCAL Gb_Apu*          gb_apu;
+static CORE_LOCAL Stereo_Buffer*   stereo_buffer;
 
-static Blip_Synth<blip_best_quality,1> pcm_synth [3]; // 32 kHz, 16 kHz, 8 kHz
+typedef Blip_Synth<blip_best_quality,1> Pcm_Synth;
+static CORE_LOCAL Pcm_Synth*       pcm_synth; // [3]: 32 kHz, 16 kHz, 8 kHz
 
 static inline blip_time_t blip_time()
 {
@@ -348,22 +350,16 @@ static void end_frame( blip_time_t time )
 
 void flush_samples(Multi_Buffer * buffer)
 {
-	// We want to write the data frame by frame to support legacy audio drivers
-	// that don't use the length parameter of the write method.
-	// TODO: Update the Win32 audio drivers (DS, OAL, XA2), and flush all the
-	// samples at once to help reducing the audio delay on all platforms.
-	int soundBufferLen = ( soundSampleRate / 60 ) * 4;
+	// Hand everything the buffer has to the driver, which queues it and
+	// feeds the output at its own pace. A 1/100 s sound tick yields far
+	// fewer samples than soundFinalWave holds, so this is one write.
+	int const out_buf_size = sizeof soundFinalWave / sizeof *soundFinalWave;
 
-	// soundBufferLen should have a whole number of sample pairs
-	assert( soundBufferLen % (2 * sizeof *soundFinalWave) == 0 );
-
-	// number of samples in output buffer
-	int const out_buf_size = soundBufferLen / sizeof *soundFinalWave;
-
-	// Keep filling and writing soundFinalWave until it can't be fully filled
-	while ( buffer->samples_avail() >= out_buf_size )
+	while ( buffer->samples_avail() > 0 )
 	{
-		buffer->read_samples( (blip_sample_t*) soundFinalWave, out_buf_size );
+		// read_samples() returns whole sample pairs
+		int samples = buffer->read_samples( (blip_sample_t*) soundFinalWave, out_buf_size );
+		int soundBufferLen = samples * sizeof *soundFinalWave;
 		if(soundPaused)
 			soundResume();
 
@@ -458,6 +454,8 @@ static void remake_stereo_buffer()
 	stereo_buffer->clock_rate( gb_apu->clock_rate );
 
 	// PCM
+	if ( !pcm_synth )
+		pcm_synth = new Pcm_Synth [3]; // TODO: handle out of memory
 	pcm [0].which = 0;
 	pcm [1].which = 1;
 	apply_filtering();
@@ -580,152 +578,197 @@ void soundSetSampleRate(long sampleRate)
 	}
 }
 
-int dummy_state [16];
+int soundGetLatency()
+{
+	return soundLatency;
+}
+
+void soundSetLatency(int ms)
+{
+	if ( soundLatency != ms )
+	{
+		soundLatency = ms;
+
+		// the driver picks the new target up when it is initialized
+		if ( soundDriver && systemCanChangeSoundQuality() )
+		{
+			soundShutdown();
+			soundInit();
+		}
+	}
+}
+
+float soundGetFill()
+{
+	if ( !soundDriver )
+		return -1.0f;
+	return soundDriver->getFill();
+}
+
+CORE_LOCAL int dummy_state [16];
 
 #define SKIP( type, name ) { dummy_state, sizeof (type) }
 
 #define LOAD( type, name ) { &name, sizeof (type) }
 
-gb_apu_state_ss state;
+CORE_LOCAL gb_apu_state_ss state;
 
 // Old GBA sound state format
-static variable_desc old_gba_state [] =
-{
-	SKIP( int, soundPaused ),
-	SKIP( int, soundPlay ),
-	SKIP( int, soundTicks ),
-	SKIP( int, SOUND_CLOCK_TICKS ),
-	SKIP( int, soundLevel1 ),
-	SKIP( int, soundLevel2 ),
-	SKIP( int, soundBalance ),
-	SKIP( int, soundMasterOn ),
-	SKIP( int, soundIndex ),
-	SKIP( int, sound1On ),
-	SKIP( int, sound1ATL ),
-	SKIP( int, sound1Skip ),
-	SKIP( int, sound1Index ),
-	SKIP( int, sound1Continue ),
-	SKIP( int, sound1EnvelopeVolume ),
-	SKIP( int, sound1EnvelopeATL ),
-	SKIP( int, sound1EnvelopeATLReload ),
-	SKIP( int, sound1EnvelopeUpDown ),
-	SKIP( int, sound1SweepATL ),
-	SKIP( int, sound1SweepATLReload ),
-	SKIP( int, sound1SweepSteps ),
-	SKIP( int, sound1SweepUpDown ),
-	SKIP( int, sound1SweepStep ),
-	SKIP( int, sound2On ),
-	SKIP( int, sound2ATL ),
-	SKIP( int, sound2Skip ),
-	SKIP( int, sound2Index ),
-	SKIP( int, sound2Continue ),
-	SKIP( int, sound2EnvelopeVolume ),
-	SKIP( int, sound2EnvelopeATL ),
-	SKIP( int, sound2EnvelopeATLReload ),
-	SKIP( int, sound2EnvelopeUpDown ),
-	SKIP( int, sound3On ),
-	SKIP( int, sound3ATL ),
-	SKIP( int, sound3Skip ),
-	SKIP( int, sound3Index ),
-	SKIP( int, sound3Continue ),
-	SKIP( int, sound3OutputLevel ),
-	SKIP( int, sound4On ),
-	SKIP( int, sound4ATL ),
-	SKIP( int, sound4Skip ),
-	SKIP( int, sound4Index ),
-	SKIP( int, sound4Clock ),
-	SKIP( int, sound4ShiftRight ),
-	SKIP( int, sound4ShiftSkip ),
-	SKIP( int, sound4ShiftIndex ),
-	SKIP( int, sound4NSteps ),
-	SKIP( int, sound4CountDown ),
-	SKIP( int, sound4Continue ),
-	SKIP( int, sound4EnvelopeVolume ),
-	SKIP( int, sound4EnvelopeATL ),
-	SKIP( int, sound4EnvelopeATLReload ),
-	SKIP( int, sound4EnvelopeUpDown ),
-	LOAD( int, soundEnableFlag ),
-	SKIP( int, soundControl ),
-	LOAD( int, pcm [0].readIndex ),
-	LOAD( int, pcm [0].count ),
-	LOAD( int, pcm [0].writeIndex ),
-	SKIP( u8,  soundDSAEnabled ), // was bool, which was one byte on MS compiler
-	SKIP( int, soundDSATimer ),
-	LOAD( u8 [32], pcm [0].fifo ),
-	LOAD( u8,  state.soundDSAValue ),
-	LOAD( int, pcm [1].readIndex ),
-	LOAD( int, pcm [1].count ),
-	LOAD( int, pcm [1].writeIndex ),
-	SKIP( int, soundDSBEnabled ),
-	SKIP( int, soundDSBTimer ),
-	LOAD( u8 [32], pcm [1].fifo ),
-	LOAD( int, state.soundDSBValue ),
-
-	// skipped manually
-	//LOAD( int, soundBuffer[0][0], 6*735 },
-	//LOAD( int, soundFinalWave[0], 2*735 },
-	{ NULL, 0 }
-};
+static variable_desc *old_gba_state()
+{
+	variable_desc data [] =
+	{
+		SKIP( int, soundPaused ),
+		SKIP( int, soundPlay ),
+		SKIP( int, soundTicks ),
+		SKIP( int, SOUND_CLOCK_TICKS ),
+		SKIP( int, soundLevel1 ),
+		SKIP( int, soundLevel2 ),
+		SKIP( int, soundBalance ),
+		SKIP( int, soundMasterOn ),
+		SKIP( int, soundIndex ),
+		SKIP( int, sound1On ),
+		SKIP( int, sound1ATL ),
+		SKIP( int, sound1Skip ),
+		SKIP( int, sound1Index ),
+		SKIP( int, sound1Continue ),
+		SKIP( int, sound1EnvelopeVolume ),
+		SKIP( int, sound1EnvelopeATL ),
+		SKIP( int, sound1EnvelopeATLReload ),
+		SKIP( int, sound1EnvelopeUpDown ),
+		SKIP( int, sound1SweepATL ),
+		SKIP( int, sound1SweepATLReload ),
+		SKIP( int, sound1SweepSteps ),
+		SKIP( int, sound1SweepUpDown ),
+		SKIP( int, sound1SweepStep ),
+		SKIP( int, sound2On ),
+		SKIP( int, sound2ATL ),
+		SKIP( int, sound2Skip ),
+		SKIP( int, sound2Index ),
+		SKIP( int, sound2Continue ),
+		SKIP( int, sound2EnvelopeVolume ),
+		SKIP( int, sound2EnvelopeATL ),
+		SKIP( int, sound2EnvelopeATLReload ),
+		SKIP( int, sound2EnvelopeUpDown ),
+		SKIP( int, sound3On ),
+		SKIP( int, sound3ATL ),
+		SKIP( int, sound3Skip ),
+		SKIP( int, sound3Index ),
+		SKIP( int, sound3Continue ),
+		SKIP( int, sound3OutputLevel ),
+		SKIP( int, sound4On ),
+		SKIP( int, sound4ATL ),
+		SKIP( int, sound4Skip ),
+		SKIP( int, sound4Index ),
+		SKIP( int, sound4Clock ),
+		SKIP( int, sound4ShiftRight ),
+		SKIP( int, sound4ShiftSkip ),
+		SKIP( int, sound4ShiftIndex ),
+		SKIP( int, sound4NSteps ),
+		SKIP( int, sound4CountDown ),
+		SKIP( int, sound4Continue ),
+		SKIP( int, sound4EnvelopeVolume ),
+		SKIP( int, sound4EnvelopeATL ),
+		SKIP( int, sound4EnvelopeATLReload ),
+		SKIP( int, sound4EnvelopeUpDown ),
+		LOAD( int, soundEnableFlag ),
+		SKIP( int, soundControl ),
+		LOAD( int, pcm [0].readIndex ),
+		LOAD( int, pcm [0].count ),
+		LOAD( int, pcm [0].writeIndex ),
+		SKIP( u8,  soundDSAEnabled ), // was bool, which was one byte on MS compiler
+		SKIP( int, soundDSATimer ),
+		LOAD( u8 [32], pcm [0].fifo ),
+		LOAD( u8,  state.soundDSAValue ),
+		LOAD( int, pcm [1].readIndex ),
+		LOAD( int, pcm [1].count ),
+		LOAD( int, pcm [1].writeIndex ),
+		SKIP( int, soundDSBEnabled ),
+		SKIP( int, soundDSBTimer ),
+		LOAD( u8 [32], pcm [1].fifo ),
+		LOAD( int, state.soundDSBValue ),
+
+		// skipped manually
+		//LOAD( int, soundBuffer[0][0], 6*735 },
+		//LOAD( int, soundFinalWave[0], 2*735 },
+		{ NULL, 0 }
+	};
+	static CORE_LOCAL variable_desc table [sizeof data / sizeof *data];
+	memcpy( table, data, sizeof data );
+	return table;
+}
 
-variable_desc old_gba_state2 [] =
+static variable_desc *old_gba_state2()
 {
-	LOAD( u8 [0x20], state.apu.regs [0x20] ),
-	SKIP( int, sound3Bank ),
-	SKIP( int, sound3DataSize ),
-	SKIP( int, sound3ForcedOutput ),
-	{ NULL, 0 }
-};
+	variable_desc data [] =
+	{
+		LOAD( u8 [0x20], state.apu.regs [0x20] ),
+		SKIP( int, sound3Bank ),
+		SKIP( int, sound3DataSize ),
+		SKIP( int, sound3ForcedOutput ),
+		{ NULL, 0 }
+	};
+	static CORE_LOCAL variable_desc table [sizeof data / sizeof *data];
+	memcpy( table, data, sizeof data );
+	return table;
+}
 
 // New state format
-variable_desc gba_state [] =
+static variable_desc *gba_state()
 {
-	// PCM
-	LOAD( int, pcm [0].readIndex ),
-	LOAD( int, pcm [0].count ),
-	LOAD( int, pcm [0].writeIndex ),
-	LOAD(u8[32],pcm[0].fifo ),
-	LOAD( int, pcm [0].dac ),
+	variable_desc data [] =
+	{
+		// PCM
+		LOAD( int, pcm [0].readIndex ),
+		LOAD( int, pcm [0].count ),
+		LOAD( int, pcm [0].writeIndex ),
+		LOAD(u8[32],pcm[0].fifo ),
+		LOAD( int, pcm [0].dac ),
 
-	SKIP( int [4], room_for_expansion ),
+		SKIP( int [4], room_for_expansion ),
 
-	LOAD( int, pcm [1].readIndex ),
-	LOAD( int, pcm [1].count ),
-	LOAD( int, pcm [1].writeIndex ),
-	LOAD(u8[32],pcm[1].fifo ),
-	LOAD( int, pcm [1].dac ),
+		LOAD( int, pcm [1].readIndex ),
+		LOAD( int, pcm [1].count ),
+		LOAD( int, pcm [1].writeIndex ),
+		LOAD(u8[32],pcm[1].fifo ),
+		LOAD( int, pcm [1].dac ),
 
-	SKIP( int [4], room_for_expansion ),
+		SKIP( int [4], room_for_expansion ),
 
-	// APU
-	LOAD( u8 [0x40], state.apu.regs ),      // last values written to registers and wave RAM (both banks)
-	LOAD( int, state.apu.frame_time ),      // clocks until next frame sequencer action
-	LOAD( int, state.apu.frame_phase ),     // next step frame sequencer will run
+		// APU
+		LOAD( u8 [0x40], state.apu.regs ),      // last values written to registers and wave RAM (both banks)
+		LOAD( int, state.apu.frame_time ),      // clocks until next frame sequencer action
+		LOAD( int, state.apu.frame_phase ),     // next step frame sequencer will run
 
-	LOAD( int, state.apu.sweep_freq ),      // sweep's internal frequency register
-	LOAD( int, state.apu.sweep_delay ),     // clocks until next sweep action
-	LOAD( int, state.apu.sweep_enabled ),
-	LOAD( int, state.apu.sweep_neg ),       // obscure internal flag
-	LOAD( int, state.apu.noise_divider ),
-	LOAD( int, state.apu.wave_buf ),        // last read byte of wave RAM
+		LOAD( int, state.apu.sweep_freq ),      // sweep's internal frequency register
+		LOAD( int, state.apu.sweep_delay ),     // clocks until next sweep action
+		LOAD( int, state.apu.sweep_enabled ),
+		LOAD( int, state.apu.sweep_neg ),       // obscure internal flag
+		LOAD( int, state.apu.noise_divider ),
+		LOAD( int, state.apu.wave_buf ),        // last read byte of wave RAM
 
-	LOAD( int [4], state.apu.delay ),       // clocks until next channel action
-	LOAD( int [4], state.apu.length_ctr ),
-	LOAD( int [4], state.apu.phase ),       // square/wave phase, noise LFSR
-	LOAD( int [4], state.apu.enabled ),     // internal enabled flag
+		LOAD( int [4], state.apu.delay ),       // clocks until next channel action
+		LOAD( int [4], state.apu.length_ctr ),
+		LOAD( int [4], state.apu.phase ),       // square/wave phase, noise LFSR
+		LOAD( int [4], state.apu.enabled ),     // internal enabled flag
 
-	LOAD( int [3], state.apu.env_delay ),   // clocks until next envelope action
-	LOAD( int [3], state.apu.env_volume ),
-	LOAD( int [3], state.apu.env_enabled ),
+		LOAD( int [3], state.apu.env_delay ),   // clocks until next envelope action
+		LOAD( int [3], state.apu.env_volume ),
+		LOAD( int [3], state.apu.env_enabled ),
 
-	SKIP( int [13], room_for_expansion ),
+		SKIP( int [13], room_for_expansion ),
 
-	// Emulator
-	LOAD( int, soundEnableFlag ),
+		// Emulator
+		LOAD( int, soundEnableFlag ),
 
-	SKIP( int [15], room_for_expansion ),
+		SKIP( int [15], room_for_expansion ),
 
-	{ NULL, 0 }
-};
+		{ NULL, 0 }
+	};
+	static CORE_LOCAL variable_desc table [sizeof data / sizeof *data];
+	memcpy( table, data, sizeof data );
+	return table;
+}
 
 // Reads and discards count bytes from in
 static void skip_read( gzFile in, int count )
@@ -750,13 +793,13 @@ void soundSaveGame( gzFile out )
 	// Be sure areas for expansion get written as zero
 	memset( dummy_state, 0, sizeof dummy_state );
 
-	utilWriteData( out, gba_state );
+	utilWriteData( out, gba_state() );
 }
 
 static void soundReadGameOld( gzFile in, int version )
 {
 	// Read main data
-	utilReadData( in, old_gba_state );
+	utilReadData( in, old_gba_state() );
 	skip_read( in, 6*735 + 2*735 );
 
 	// Copy APU regs
@@ -779,7 +822,7 @@ static void soundReadGameOld( gzFile in, int version )
 
 	// Read both banks of wave RAM if available
 	if ( version >= SAVE_GAME_VERSION_3 )
-		utilReadData( in, old_gba_state2 );
+		utilReadData( in, old_gba_state2() );
 
 	// Restore PCM
 	pcm [0].dac = state.soundDSAValue;
@@ -797,7 +840,7 @@ void soundReadGame( gzFile in, int version )
 	gb_apu->save_state( &state.apu );
 
 	if ( version > SAVE_GAME_VERSION_9 )
-		utilReadData( in, gba_state );
+		utilReadData( in, gba_state() );
 	else
 		soundReadGameOld( in, version );
 
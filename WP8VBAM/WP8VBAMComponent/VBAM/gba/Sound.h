@@ -31,7 +31,7 @@ int  soundGetEnable();
 // Pauses/resumes system sound output
 void soundPause();
 void soundResume();
-extern bool soundPaused; // current paused state
+extern CORE_LOCAL bool soundPaused; // current paused state
 
 // Cleans up sound. Afterwards, soundInit() can be called again.
 void soundShutdown();
@@ -41,6 +41,15 @@ void soundShutdown();
 long soundGetSampleRate();
 void soundSetSampleRate(long sampleRate);
 
+// Amount of audio, in milliseconds, the sound driver keeps queued ahead of
+// the output
+int  soundGetLatency();
+void soundSetLatency(int ms);
+
+// Audio queued by the sound driver relative to the latency, or a negative
+// value if there is no driver or it does not queue
+float soundGetFill();
+
 // Sound settings
 extern bool soundInterpolation; // 1 if PCM should have low-pass filtering
 extern float soundFiltering;    // 0.0 = none, 1.0 = max
@@ -70,8 +79,8 @@ void interp_rate();
 
 // Notifies emulator that SOUND_CLOCK_TICKS clocks have passed
 void psoundTickfn();
-extern int SOUND_CLOCK_TICKS;   // Number of 16.8 MHz clocks between calls to soundTick()
-extern int soundTicks;          // Number of 16.8 MHz clocks until soundTick() will be called
+extern CORE_LOCAL int SOUND_CLOCK_TICKS;   // Number of 16.8 MHz clocks between calls to soundTick()
+extern CORE_LOCAL int soundTicks;          // Number of 16.8 MHz clocks until soundTick() will be called
 
 // Saves/loads emulator state
 void soundSaveGame( gzFile );
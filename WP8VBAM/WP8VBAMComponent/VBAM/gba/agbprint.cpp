@@ -2,22 +2,46 @@
 #include <string.h>
 
 #include "GBA.h"
+#include "GBAinline.h"
 #include "Globals.h"
 #include "../common/Port.h"
 #include "../System.h"
 
 #define debuggerWriteHalfWord(addr, value) \
-  WRITE16LE((u16*)&map[(addr)>>24].address[(addr) & map[(addr)>>24].mask], (value))
+  WRITE16LE((u16*)agbPrintMemory(CPURomOffset(addr)), (value))
 
 #define debuggerReadHalfWord(addr) \
-  READ16LE(((u16*)&map[(addr)>>24].address[(addr) & map[(addr)>>24].mask]))
+  READ16LE(((u16*)agbPrintMemory(CPURomOffset(addr))))
 
-static bool agbPrintEnabled = false;
-static bool agbPrintProtect = false;
+#define debuggerReadByte(addr) \
+  (*agbPrintMemory(CPURomOffset(addr)))
+
+static CORE_LOCAL bool agbPrintEnabled = false;
+static CORE_LOCAL bool agbPrintProtect = false;
+
+// The buffer and the control block lie past the end of the images that
+// use AGBPrint: in the padding of rom when it reaches that far, otherwise
+// here, where CPUReadRomOpenBus reads them back.
+static CORE_LOCAL u8 agbPrintBuffer[0x10000];  // 0xfd0000 or 0x1fd0000 on
+static CORE_LOCAL u8 agbPrintControl[0x1000];  // 0x1fe2000 on
+
+u8 *agbPrintMemory(u32 offset)
+{
+  // never over the image itself
+  if(!agbPrintEnabled || offset < (u32)romSize)
+    return NULL;
+  if(offset <= romMask)
+    return &rom[offset];
+  if((offset & 0xEFF0000) == 0xfd0000)
+    return &agbPrintBuffer[offset & 0xFFFF];
+  if((offset & 0x1FFF000) == 0x1fe2000)
+    return &agbPrintControl[offset & 0xFFF];
+  return NULL;
+}
 
 bool agbPrintWrite(u32 address, u16 value)
 {
-  if(agbPrintEnabled) {
+  if(agbPrintEnabled && agbPrintMemory(CPURomOffset(address))) {
     if(address == 0x9fe2ffe) { // protect
       agbPrintProtect = (value != 0);
       debuggerWriteHalfWord(address, value);
@@ -42,6 +66,10 @@ void agbPrintReset()
 
 void agbPrintEnable(bool enable)
 {
+  if(enable && !agbPrintEnabled) {
+    memset(agbPrintBuffer, 0, sizeof(agbPrintBuffer));
+    memset(agbPrintControl, 0, sizeof(agbPrintControl));
+  }
   agbPrintEnabled = enable;
 }
 
@@ -52,6 +80,9 @@ bool agbPrintIsEnabled()
 
 void agbPrintFlush()
 {
+  if(!agbPrintMemory(CPURomOffset(0x9fe20f8)))
+    return;
+
   u16 get = debuggerReadHalfWord(0x9fe20fc);
   u16 put = debuggerReadHalfWord(0x9fe20fe);
 
@@ -63,10 +94,13 @@ void agbPrintFlush()
     return;
   }
 
-  u8 *data = &rom[address];
+  address += 0x8000000;
+  if(!agbPrintMemory(CPURomOffset(address)))
+    return;
 
   while(get != put) {
-    char c = data[get++];
+    char c = debuggerReadByte(address + get);
+    get++;
     char s[2];
     s[0] = c;
     s[1] = 0;
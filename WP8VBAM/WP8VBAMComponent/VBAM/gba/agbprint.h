@@ -6,5 +6,9 @@ bool agbPrintIsEnabled();
 void agbPrintReset();
 bool agbPrintWrite(u32 address, u16 value);
 void agbPrintFlush();
+// Backing of the AGBPrint buffer and control block at a cartridge offset,
+// or NULL when AGBPrint is off or the offset is not one of them or inside
+// the image
+u8 *agbPrintMemory(u32 offset);
 
 #endif // AGBPRINT_H
@@ -512,6 +512,152 @@ void BIOS_DivARM()
   BIOS_Div();
 }
 
+// The decompressors below read the compressed stream straight from host
+// memory as far as it is contiguous and through the bus past that, and
+// decode into the destination directly when all of it is backed by one
+// writable buffer. They return false, before touching anything, when the
+// destination is IO, palette, a save chip or unmapped, so that the caller
+// can fall back to the bus version.
+typedef struct {
+  u32 address;
+  const u8 *data;
+  const u8 *end;
+} BiosStream;
+
+static void BIOS_StreamInit(BiosStream *s, u32 address, u32 size)
+{
+  u8 *data;
+  u32 avail = CPUBlockAddress(cpuReadPages, address, size, &data);
+  s->address = address;
+  s->data = data;
+  s->end = data + avail;
+}
+
+static inline u8 BIOS_StreamByte(BiosStream *s)
+{
+  u32 address = s->address++;
+  if(s->data < s->end)
+    return *s->data++;
+  return CPUReadByte(address);
+}
+
+// word aligned streams only
+static inline u32 BIOS_StreamWord(BiosStream *s)
+{
+  u32 address = s->address;
+  s->address += 4;
+  if(s->end - s->data >= 4) {
+    u32 value = READ32LE(((u32 *)s->data));
+    s->data += 4;
+    return value;
+  }
+  s->data = s->end;
+  return CPUReadMemory(address);
+}
+
+// Host address of size bytes at dest, flagged as written, or NULL.
+static u8 *BIOS_DestBlock(u32 dest, u32 size)
+{
+  u8 *out;
+  if(size == 0 || CPUBlockAddress(cpuWritePages, dest, size, &out) < size)
+    return NULL;
+  CPUWriteBlockDirty(dest, size);
+  return out;
+}
+
+static bool BIOS_HuffUnCompFast(u32 source, u32 dest, int len, int bits)
+{
+  if(len <= 0 || ((source | dest) & 3))
+    return false;
+  u8 treeSize = CPUReadByte(source);
+  // a stream left halfword aligned by the tree is read rotated
+  if(!(treeSize & 1))
+    return false;
+  u8 *out = BIOS_DestBlock(dest, (len + 3) & ~3);
+  if(!out)
+    return false;
+
+  u32 treeStart = source + 1;
+  u8 *tree;
+  u32 treeAvail = CPUBlockAddress(cpuReadPages, treeStart, (treeSize+1)<<1,
+                                  &tree);
+  BiosStream in;
+  BIOS_StreamInit(&in, source + ((treeSize+1)<<1), len + 0x200);
+
+  u32 mask = 0x80000000;
+  u32 data = BIOS_StreamWord(&in);
+
+  u32 pos = 0;
+  u8 rootNode = treeAvail ? tree[0] : CPUReadByte(treeStart);
+  u8 currentNode = rootNode;
+  bool writeData = false;
+  int byteShift = 0;
+  int byteCount = 0;
+  u32 writeValue = 0;
+  int halfLen = 0;
+  int value = 0;
+
+  while(len > 0) {
+    // take left
+    if(pos == 0)
+      pos++;
+    else
+      pos += (((currentNode & 0x3F)+1)<<1);
+
+    u32 node = pos;
+    if(data & mask) {
+      // right
+      if(currentNode & 0x40)
+        writeData = true;
+      node++;
+    } else {
+      // left
+      if(currentNode & 0x80)
+        writeData = true;
+    }
+    currentNode = node < treeAvail ? tree[node] : CPUReadByte(treeStart+node);
+
+    if(writeData) {
+      if(bits == 8) {
+        value = currentNode;
+        halfLen = 8;
+      } else {
+        if(halfLen == 0)
+          value |= currentNode;
+        else
+          value |= (currentNode<<4);
+        halfLen += 4;
+      }
+      if(halfLen == 8) {
+        writeValue |= (value << byteShift);
+        byteCount++;
+        byteShift += 8;
+
+        halfLen = 0;
+        value = 0;
+
+        if(byteCount == 4) {
+          byteCount = 0;
+          byteShift = 0;
+          WRITE32LE(((u32 *)out), writeValue);
+          out += 4;
+          writeValue = 0;
+          len -= 4;
+        }
+      }
+      pos = 0;
+      currentNode = rootNode;
+      writeData = false;
+    }
+    mask >>= 1;
+    if(mask == 0) {
+      mask = 0x80000000;
+      data = BIOS_StreamWord(&in);
+    }
+  }
+  return true;
+}
+
 void BIOS_HuffUnComp()
 {
 #ifdef GBA_LOGGING
@@ -533,6 +679,10 @@ void BIOS_HuffUnComp()
      ((source + ((header >> 8) & 0x1fffff)) & 0xe000000) == 0)
     return;
 
+  if(BIOS_HuffUnCompFast(source, dest, header >> 8,
+                         (header & 0x0F) == 8 ? 8 : 4))
+    return;
+
   u8 treeSize = CPUReadByte(source++);
 
   u32 treeStart = source;
@@ -658,6 +808,82 @@ void BIOS_HuffUnComp()
   }
 }
 
+// The VRAM version stores halfwords, so the last byte of an odd length is
+// dropped, and a window reaching the byte still pending reads what was
+// there before.
+static bool BIOS_LZ77UnCompFast(u32 source, u32 dest, int len, bool vram)
+{
+  if(vram && (dest & 1))
+    return false;
+  u8 *out = BIOS_DestBlock(dest, vram ? len & ~1 : len);
+  if(!out)
+    return false;
+
+  BiosStream in;
+  BIOS_StreamInit(&in, source, len + (len >> 3) + 0x10);
+
+  int pos = 0;
+  u8 pending = 0;
+
+  while(len > 0) {
+    u8 d = BIOS_StreamByte(&in);
+
+    for(int i = 0; i < 8; i++) {
+      if(d & 0x80) {
+        u16 data = BIOS_StreamByte(&in) << 8;
+        data |= BIOS_StreamByte(&in);
+        int length = (data >> 12) + 3;
+        int offset = (data & 0x0FFF);
+        while(length > 0) {
+          int window = pos - offset - 1;
+          // whole runs that are already written and do not overlap the
+          // bytes being produced
+          int count = length < len ? length : len;
+          if(count > offset + 1)
+            count = offset + 1;
+          if(vram)
+            count = (pos & 1) ? 0 : count & ~1;
+          if(window >= 0 && count > 0) {
+            memcpy(out + pos, out + window, count);
+            pos += count;
+            length -= count;
+            len -= count;
+          } else {
+            u8 b = window >= 0 ? out[window] : CPUReadByte(dest + window);
+            if(!vram)
+              out[pos] = b;
+            else if(pos & 1) {
+              out[pos - 1] = pending;
+              out[pos] = b;
+            } else
+              pending = b;
+            pos++;
+            length--;
+            len--;
+          }
+          if(len == 0)
+            return true;
+        }
+      } else {
+        u8 b = BIOS_StreamByte(&in);
+        if(!vram)
+          out[pos] = b;
+        else if(pos & 1) {
+          out[pos - 1] = pending;
+          out[pos] = b;
+        } else
+          pending = b;
+        pos++;
+        len--;
+        if(len == 0)
+          return true;
+      }
+      d <<= 1;
+    }
+  }
+  return true;
+}
+
 void BIOS_LZ77UnCompVram()
 {
 #ifdef GBA_LOGGING
@@ -685,6 +911,9 @@ void BIOS_LZ77UnCompVram()
 
   int len = header >> 8;
 
+  if(BIOS_LZ77UnCompFast(source, dest, len, true))
+    return;
+
   while(len > 0) {
     u8 d = CPUReadByte(source++);
 
@@ -770,6 +999,9 @@ void BIOS_LZ77UnCompWram()
 
   int len = header >> 8;
 
+  if(BIOS_LZ77UnCompFast(source, dest, len, false))
+    return;
+
   while(len > 0) {
     u8 d = CPUReadByte(source++);
 
@@ -859,6 +1091,7 @@ void BIOS_RegisterRamReset(u32 flags)
   CPUUpdateRegister(0x0, 0x80);
 
   if(flags) {
+    blockCacheFlush();
     if(flags & 0x01) {
       // clear work RAM
       memset(workRAM, 0, 0x40000);
@@ -870,10 +1103,12 @@ void BIOS_RegisterRamReset(u32 flags)
     if(flags & 0x04) {
       // clear palette RAM
       memset(paletteRAM, 0, 0x400);
+      CPUUpdatePaletteColors();
     }
     if(flags & 0x08) {
       // clear VRAM
       memset(vram, 0, 0x18000);
+      tileCacheFlush();
     }
     if(flags & 0x10) {
       // clean OAM
@@ -940,6 +1175,47 @@ void BIOS_RegisterRamReset()
   BIOS_RegisterRamReset(reg[0].I);
 }
 
+// The VRAM version drops the last byte of an odd length.
+static bool BIOS_RLUnCompFast(u32 source, u32 dest, int len, bool vram)
+{
+  if(vram && (dest & 1))
+    return false;
+  int size = vram ? len & ~1 : len;
+  u8 *out = BIOS_DestBlock(dest, size);
+  if(!out)
+    return false;
+
+  BiosStream in;
+  BIOS_StreamInit(&in, source, (len << 1) + 0x10);
+
+  int pos = 0;
+
+  while(len > 0) {
+    u8 d = BIOS_StreamByte(&in);
+    int l = d & 0x7F;
+    if(d & 0x80) {
+      u8 data = BIOS_StreamByte(&in);
+      l += 3;
+      if(l > len)
+        l = len;
+      memset(out + pos, data, pos + l > size ? size - pos : l);
+      pos += l;
+      len -= l;
+    } else {
+      l++;
+      if(l > len)
+        l = len;
+      for(int i = 0; i < l; i++, pos++) {
+        u8 b = BIOS_StreamByte(&in);
+        if(pos < size)
+          out[pos] = b;
+      }
+      len -= l;
+    }
+  }
+  return true;
+}
+
 void BIOS_RLUnCompVram()
 {
 #ifdef GBA_LOGGING
@@ -966,6 +1242,9 @@ void BIOS_RLUnCompVram()
   int byteShift = 0;
   u32 writeValue = 0;
 
+  if(BIOS_RLUnCompFast(source, dest, len, true))
+    return;
+
   while(len > 0) {
     u8 d = CPUReadByte(source++);
     int l = d & 0x7F;
@@ -1032,6 +1311,9 @@ void BIOS_RLUnCompWram()
 
   int len = header >> 8;
 
+  if(BIOS_RLUnCompFast(source, dest, len, false))
+    return;
+
   while(len > 0) {
     u8 d = CPUReadByte(source++);
     int l = d & 0x7F;
@@ -1080,6 +1362,7 @@ void BIOS_SoftReset()
   u8 b = internalRAM[0x7ffa];
 
   memset(&internalRAM[0x7e00], 0, 0x200);
+  blockCacheFlush();
 
   if(b) {
     armNextPC = 0x02000000;
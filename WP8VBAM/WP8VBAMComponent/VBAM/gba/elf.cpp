@@ -216,26 +216,26 @@ struct ELFFrameState {
   int returnAddress;
 };
 
-extern bool cpuIsMultiBoot;
+extern CORE_LOCAL bool cpuIsMultiBoot;
 
-Symbol *elfSymbols = NULL;
-char *elfSymbolsStrTab = NULL;
-int elfSymbolsCount = 0;
+CORE_LOCAL Symbol *elfSymbols = NULL;
+CORE_LOCAL char *elfSymbolsStrTab = NULL;
+CORE_LOCAL int elfSymbolsCount = 0;
 
-ELFSectionHeader **elfSectionHeaders = NULL;
-char *elfSectionHeadersStringTable = NULL;
-int elfSectionHeadersCount = 0;
-u8 *elfFileData = NULL;
+CORE_LOCAL ELFSectionHeader **elfSectionHeaders = NULL;
+CORE_LOCAL char *elfSectionHeadersStringTable = NULL;
+CORE_LOCAL int elfSectionHeadersCount = 0;
+CORE_LOCAL u8 *elfFileData = NULL;
 
-CompileUnit *elfCompileUnits = NULL;
-DebugInfo *elfDebugInfo = NULL;
-char *elfDebugStrings = NULL;
+CORE_LOCAL CompileUnit *elfCompileUnits = NULL;
+CORE_LOCAL DebugInfo *elfDebugInfo = NULL;
+CORE_LOCAL char *elfDebugStrings = NULL;
 
-ELFcie *elfCies = NULL;
-ELFfde **elfFdes = NULL;
-int elfFdeCount = 0;
+CORE_LOCAL ELFcie *elfCies = NULL;
+CORE_LOCAL ELFfde **elfFdes = NULL;
+CORE_LOCAL int elfFdeCount = 0;
 
-CompileUnit *elfCurrentUnit = NULL;
+CORE_LOCAL CompileUnit *elfCurrentUnit = NULL;
 
 u32 elfRead4Bytes(u8 *);
 u16 elfRead2Bytes(u8 *);
@@ -266,7 +266,7 @@ CompileUnit *elfGetCompileUnit(u32 addr)
 
 const char *elfGetAddressSymbol(u32 addr)
 {
-  static char buffer[256];
+  static CORE_LOCAL char buffer[256];
 
   CompileUnit *unit = elfGetCompileUnit(addr);
   // found unit, need to find function
@@ -2774,7 +2774,7 @@ bool elfReadProgram(ELFHeader *eh, u8 *data, int& size, bool parseDebug)
   return true;
 }
 
-extern bool parseDebug;
+extern CORE_LOCAL bool parseDebug;
 
 bool elfRead(const char *name, int& siz, FILE *f)
 {
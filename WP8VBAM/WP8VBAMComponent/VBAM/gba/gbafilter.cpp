@@ -27,133 +27,141 @@ inline void swap(short & a, short & b)
 	b = temp;
 }
 
-void gbafilter_pal(u16 * buf, int count)
+// LCD colour response applied to one 16bpp pixel
+u16 gbafilter_pixel16(u16 pix)
 {
 	short temp[3 * 3], s;
-	unsigned pix;
 	u8 red, green, blue;
 
+	s = curve[(pix >> systemGreenShift) & 0x1f];
+	temp[3] = s * influence[3];
+	temp[4] = s * influence[4];
+	temp[5] = s * influence[5];
+
+	s = curve[(pix >> systemRedShift) & 0x1f];
+	temp[0] = s * influence[0];
+	temp[1] = s * influence[1];
+	temp[2] = s * influence[2];
+
+	s = curve[(pix >> systemBlueShift) & 0x1f];
+	temp[6] = s * influence[6];
+	temp[7] = s * influence[7];
+	temp[8] = s * influence[8];
+
+	if (temp[0] < temp[3]) swap(temp[0], temp[3]);
+	if (temp[0] < temp[6]) swap(temp[0], temp[6]);
+	if (temp[3] < temp[6]) swap(temp[3], temp[6]);
+	temp[3] <<= 1;
+	temp[0] <<= 2;
+	temp[0] += temp[3] + temp[6];
+
+	red = ((int(temp[0]) * 160) >> 17) + 4;
+	if (red > 31) red = 31;
+
+	if (temp[2] < temp[5]) swap(temp[2], temp[5]);
+	if (temp[2] < temp[8]) swap(temp[2], temp[8]);
+	if (temp[5] < temp[8]) swap(temp[5], temp[8]);
+	temp[5] <<= 1;
+	temp[2] <<= 2;
+	temp[2] += temp[5] + temp[8];
+
+	blue = ((int(temp[2]) * 160) >> 17) + 4;
+	if (blue > 31) blue = 31;
+
+	if (temp[1] < temp[4]) swap(temp[1], temp[4]);
+	if (temp[1] < temp[7]) swap(temp[1], temp[7]);
+	if (temp[4] < temp[7]) swap(temp[4], temp[7]);
+	temp[4] <<= 1;
+	temp[1] <<= 2;
+	temp[1] += temp[4] + temp[7];
+
+	green = ((int(temp[1]) * 160) >> 17) + 4;
+	if (green > 31) green = 31;
+
+	pix  = red << systemRedShift;
+	pix += green << systemGreenShift;
+	pix += blue << systemBlueShift;
+
+	return pix;
+}
+
+void gbafilter_pal(u16 * buf, int count)
+{
 	while (count--)
 	{
-		pix = *buf;
-
-		s = curve[(pix >> systemGreenShift) & 0x1f];
-		temp[3] = s * influence[3];
-		temp[4] = s * influence[4];
-		temp[5] = s * influence[5];
-
-		s = curve[(pix >> systemRedShift) & 0x1f];
-		temp[0] = s * influence[0];
-		temp[1] = s * influence[1];
-		temp[2] = s * influence[2];
-
-		s = curve[(pix >> systemBlueShift) & 0x1f];
-		temp[6] = s * influence[6];
-		temp[7] = s * influence[7];
-		temp[8] = s * influence[8];
-
-		if (temp[0] < temp[3]) swap(temp[0], temp[3]);
-		if (temp[0] < temp[6]) swap(temp[0], temp[6]);
-		if (temp[3] < temp[6]) swap(temp[3], temp[6]);
-		temp[3] <<= 1;
-		temp[0] <<= 2;
-		temp[0] += temp[3] + temp[6];
-
-		red = ((int(temp[0]) * 160) >> 17) + 4;
-		if (red > 31) red = 31;
-
-		if (temp[2] < temp[5]) swap(temp[2], temp[5]);
-		if (temp[2] < temp[8]) swap(temp[2], temp[8]);
-		if (temp[5] < temp[8]) swap(temp[5], temp[8]);
-		temp[5] <<= 1;
-		temp[2] <<= 2;
-		temp[2] += temp[5] + temp[8];
-
-		blue = ((int(temp[2]) * 160) >> 17) + 4;
-		if (blue > 31) blue = 31;
-
-		if (temp[1] < temp[4]) swap(temp[1], temp[4]);
-		if (temp[1] < temp[7]) swap(temp[1], temp[7]);
-		if (temp[4] < temp[7]) swap(temp[4], temp[7]);
-		temp[4] <<= 1;
-		temp[1] <<= 2;
-		temp[1] += temp[4] + temp[7];
-
-		green = ((int(temp[1]) * 160) >> 17) + 4;
-		if (green > 31) green = 31;
-
-		pix  = red << systemRedShift;
-		pix += green << systemGreenShift;
-		pix += blue << systemBlueShift;
-
-		*buf++ = pix;
+		*buf = gbafilter_pixel16(*buf);
+		buf++;
 	}
 }
 
-void gbafilter_pal32(u32 * buf, int count)
+// LCD colour response applied to one 32bpp pixel
+u32 gbafilter_pixel32(u32 pix)
 {
 	short temp[3 * 3], s;
-	unsigned pix;
 	u8 red, green, blue;
 
+	s = curve[(pix >> systemGreenShift) & 0x1f];
+	temp[3] = s * influence[3];
+	temp[4] = s * influence[4];
+	temp[5] = s * influence[5];
+
+	s = curve[(pix >> systemRedShift) & 0x1f];
+	temp[0] = s * influence[0];
+	temp[1] = s * influence[1];
+	temp[2] = s * influence[2];
+
+	s = curve[(pix >> systemBlueShift) & 0x1f];
+	temp[6] = s * influence[6];
+	temp[7] = s * influence[7];
+	temp[8] = s * influence[8];
+
+	if (temp[0] < temp[3]) swap(temp[0], temp[3]);
+	if (temp[0] < temp[6]) swap(temp[0], temp[6]);
+	if (temp[3] < temp[6]) swap(temp[3], temp[6]);
+	temp[3] <<= 1;
+	temp[0] <<= 2;
+	temp[0] += temp[3] + temp[6];
+
+	//red = ((int(temp[0]) * 160) >> 17) + 4;
+	red = ((int(temp[0]) * 160) >> 14) + 32;
+
+	if (temp[2] < temp[5]) swap(temp[2], temp[5]);
+	if (temp[2] < temp[8]) swap(temp[2], temp[8]);
+	if (temp[5] < temp[8]) swap(temp[5], temp[8]);
+	temp[5] <<= 1;
+	temp[2] <<= 2;
+	temp[2] += temp[5] + temp[8];
+
+	//blue = ((int(temp[2]) * 160) >> 17) + 4;
+	blue = ((int(temp[2]) * 160) >> 14) + 32;
+
+	if (temp[1] < temp[4]) swap(temp[1], temp[4]);
+	if (temp[1] < temp[7]) swap(temp[1], temp[7]);
+	if (temp[4] < temp[7]) swap(temp[4], temp[7]);
+	temp[4] <<= 1;
+	temp[1] <<= 2;
+	temp[1] += temp[4] + temp[7];
+
+	//green = ((int(temp[1]) * 160) >> 17) + 4;
+	green = ((int(temp[1]) * 160) >> 14) + 32;
+
+	//pix  = red << redshift;
+	//pix += green << greenshift;
+	//pix += blue << blueshift;
+
+	pix  = red << (systemRedShift - 3);
+	pix += green << (systemGreenShift - 3);
+	pix += blue << (systemBlueShift - 3);
+
+	return pix;
+}
+
+void gbafilter_pal32(u32 * buf, int count)
+{
 	while (count--)
 	{
-		pix = *buf;
-
-		s = curve[(pix >> systemGreenShift) & 0x1f];
-		temp[3] = s * influence[3];
-		temp[4] = s * influence[4];
-		temp[5] = s * influence[5];
-
-		s = curve[(pix >> systemRedShift) & 0x1f];
-		temp[0] = s * influence[0];
-		temp[1] = s * influence[1];
-		temp[2] = s * influence[2];
-
-		s = curve[(pix >> systemBlueShift) & 0x1f];
-		temp[6] = s * influence[6];
-		temp[7] = s * influence[7];
-		temp[8] = s * influence[8];
-
-		if (temp[0] < temp[3]) swap(temp[0], temp[3]);
-		if (temp[0] < temp[6]) swap(temp[0], temp[6]);
-		if (temp[3] < temp[6]) swap(temp[3], temp[6]);
-		temp[3] <<= 1;
-		temp[0] <<= 2;
-		temp[0] += temp[3] + temp[6];
-
-		//red = ((int(temp[0]) * 160) >> 17) + 4;
-		red = ((int(temp[0]) * 160) >> 14) + 32;
-
-		if (temp[2] < temp[5]) swap(temp[2], temp[5]);
-		if (temp[2] < temp[8]) swap(temp[2], temp[8]);
-		if (temp[5] < temp[8]) swap(temp[5], temp[8]);
-		temp[5] <<= 1;
-		temp[2] <<= 2;
-		temp[2] += temp[5] + temp[8];
-
-		//blue = ((int(temp[2]) * 160) >> 17) + 4;
-		blue = ((int(temp[2]) * 160) >> 14) + 32;
-
-		if (temp[1] < temp[4]) swap(temp[1], temp[4]);
-		if (temp[1] < temp[7]) swap(temp[1], temp[7]);
-		if (temp[4] < temp[7]) swap(temp[4], temp[7]);
-		temp[4] <<= 1;
-		temp[1] <<= 2;
-		temp[1] += temp[4] + temp[7];
-
-		//green = ((int(temp[1]) * 160) >> 17) + 4;
-		green = ((int(temp[1]) * 160) >> 14) + 32;
-
-		//pix  = red << redshift;
-		//pix += green << greenshift;
-		//pix += blue << blueshift;
-
-		pix  = red << (systemRedShift - 3);
-		pix += green << (systemGreenShift - 3);
-		pix += blue << (systemBlueShift - 3);
-
-		*buf++ = pix;
+		*buf = gbafilter_pixel32(*buf);
+		buf++;
 	}
 }
 
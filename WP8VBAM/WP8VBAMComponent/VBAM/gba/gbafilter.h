@@ -1,5 +1,7 @@
 #include "../System.h"
 
+u16 gbafilter_pixel16(u16 pix);
+u32 gbafilter_pixel32(u32 pix);
 void gbafilter_pal(u16 * buf, int count);
 void gbafilter_pal32(u32 * buf, int count);
 void gbafilter_pad(u8 * buf, int count);
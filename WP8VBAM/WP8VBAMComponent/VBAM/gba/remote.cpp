@@ -457,6 +457,8 @@ void remoteWriteWatch(char *p, bool active)
       freezeInternalRAM[address & 0x7fff] = active;
     address++;
   }
+  cpuMemoryFrozen = true;
+  CPUUpdateMemoryPages();
 #endif
 
   remotePutPacket("OK");
@@ -546,7 +548,7 @@ void remoteWriteRegister(char *p)
   remotePutPacket("OK");
 }
 
-extern int emulating;
+extern CORE_LOCAL int emulating;
 
 void remoteStubMain()
 {
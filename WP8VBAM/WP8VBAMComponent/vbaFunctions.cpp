@@ -1,4 +1,6 @@
 #include "vbam/System.h"
+#include "vbam/common/SoundDrivers.h"
+#include "vbam/common/FramePacer.h"
 #include "EmulatorSettings.h"
 #include "VirtualController.h"
 #include "WP8VBAMComponent.h"
@@ -8,7 +10,8 @@
 using namespace Emulator;
 using namespace PhoneDirect3DXamlAppComponent;
 
-extern bool synchronize;
+extern CORE_LOCAL bool synchronize;
+extern FramePacer framePacer;
 
 bool cameraPressed = false;
 bool autoFireToggle = false;
@@ -46,17 +49,18 @@ bool systemCanChangeSoundQuality() { return false; }
 // speed = percent of 60 frames by second
 // called every 60 frames
 void systemShowSpeed(int speed) { 
-	char test[100];
-	_snprintf(test, sizeof(test), "speed: %d%%\n", speed);
+	const FramePacerStats &stats = framePacer.getStats();
+	char test[200];
+	_snprintf(test, sizeof(test), "speed: %d%% skip: %d cost: %.1fms audio: %d%% drawn: %u/%u ahead: %u slept: %u underruns: %u\n",
+		speed, stats.frameSkip, stats.averageCost * 1000.0f, (int) (stats.fill * 100.0f),
+		stats.drawn, stats.frames, stats.ranAhead, stats.slept, stats.underruns);
 	OutputDebugStringA(test);
 }
 void system10Frames(int){ }
-void systemFrame(){ }
 void systemGbBorderOn(){ }
 void winlog(const char *, ...) { }
 void systemOnWriteDataToSoundBuffer(const u16 * finalWave, int length) { }
 void systemOnSoundShutdown() { }
-extern SoundDriver *newXAudio2_Output();
 extern void soundShutdown();
 void systemGbPrint(unsigned char *, int, int, int, int, int) { }
 //FG Moga::Windows::Phone::ControllerManager^ GetMogaController(void);
@@ -75,7 +79,7 @@ SoundDriver * systemSoundInit()
 
 	if(EmulatorSettings::Current->SoundEnabled)
 	{	
-		drv = newXAudio2_Output();
+		drv = soundDriverCreate("xaudio2");
 	}
 
 	return drv;
@@ -837,8 +841,8 @@ int  systemGetSensorY()
 }
 
 int RGB_LOW_BITS_MASK = 65793;
-int emulating;
-bool systemSoundOn;
+CORE_LOCAL int emulating;
+CORE_LOCAL bool systemSoundOn;
 u16 systemColorMap16[0x10000];
 u32 systemColorMap32[0x10000];
 u16 systemGbPalette[24];
@@ -849,4 +853,4 @@ int systemColorDepth;
 int systemDebug;
 int systemVerbose;
 int systemFrameSkip;
-int systemSaveUpdateCounter;
\ No newline at end of file
+CORE_LOCAL int systemSaveUpdateCounter;
\ No newline at end of file